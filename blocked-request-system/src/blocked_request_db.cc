@@ -1,6 +1,9 @@
 #include "blocked_request_db.h"
+#include "blocked_request_schema.h"
+#include "database_backup.h"
 
 #include <chrono>
+#include <cstdint>
 #include <sstream>
 #include <iomanip>
 
@@ -14,27 +17,204 @@ const char kCreateTableSQL[] = R"(
     timestamp INTEGER NOT NULL,
     reported INTEGER DEFAULT 0,
     browser_id TEXT DEFAULT '',
-    tab_id INTEGER DEFAULT 0
+    tab_id INTEGER DEFAULT 0,
+    country TEXT DEFAULT ''
   );
-  
-  CREATE INDEX IF NOT EXISTS idx_timestamp ON blocked_requests(timestamp);
-  CREATE INDEX IF NOT EXISTS idx_reported ON blocked_requests(reported);
-  CREATE INDEX IF NOT EXISTS idx_host ON blocked_requests(host);
-  CREATE INDEX IF NOT EXISTS idx_browser_id ON blocked_requests(browser_id);
-  CREATE INDEX IF NOT EXISTS idx_tab_id ON blocked_requests(tab_id);
+
+  CREATE TABLE IF NOT EXISTS schema_meta (
+    key TEXT PRIMARY KEY,
+    value TEXT NOT NULL
+  );
+)";
+
+// 旧数据库没有country列时补上；ADD COLUMN只修改表定义，不重写已有数据
+const char kCountryColumnSQL[] = "SELECT country FROM blocked_requests LIMIT 0";
+const char kAddCountryColumnSQL[] =
+    "ALTER TABLE blocked_requests ADD COLUMN country TEXT DEFAULT ''";
+
+const char kTableExistsSQL[] =
+    "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'blocked_requests'";
+
+const char kSelectMetaSQL[] =
+    "SELECT value FROM schema_meta WHERE key = ?";
+
+const char kUpsertMetaSQL[] =
+    "INSERT OR REPLACE INTO schema_meta (key, value) VALUES (?, ?)";
+
+const char kSchemaProfileKey[] = "schema_profile";
+
+// 由索引方案管理的全部索引
+struct IndexDefinition {
+  const char* name;
+  const char* create_sql;
+};
+
+const IndexDefinition kManagedIndexes[] = {
+  // 旧版单列索引
+  {"idx_timestamp",
+   "CREATE INDEX IF NOT EXISTS idx_timestamp ON blocked_requests(timestamp)"},
+  {"idx_reported",
+   "CREATE INDEX IF NOT EXISTS idx_reported ON blocked_requests(reported)"},
+  {"idx_host",
+   "CREATE INDEX IF NOT EXISTS idx_host ON blocked_requests(host)"},
+  {"idx_browser_id",
+   "CREATE INDEX IF NOT EXISTS idx_browser_id ON blocked_requests(browser_id)"},
+  {"idx_tab_id",
+   "CREATE INDEX IF NOT EXISTS idx_tab_id ON blocked_requests(tab_id)"},
+  // 未上报队列的部分索引，记录上报后自动移出，索引随队列收缩
+  {"idx_unreported_queue",
+   "CREATE INDEX IF NOT EXISTS idx_unreported_queue "
+   "ON blocked_requests(timestamp, id) WHERE reported = 0"},
+  // 已上报记录的部分索引，供按时间清理；插入的记录不进入索引，
+  // 只在标记上报时增加一项
+  {"idx_reported_retention",
+   "CREATE INDEX IF NOT EXISTS idx_reported_retention "
+   "ON blocked_requests(timestamp) WHERE reported = 1"},
+  // 查询优化的复合索引
+  {"idx_host_timestamp",
+   "CREATE INDEX IF NOT EXISTS idx_host_timestamp "
+   "ON blocked_requests(host, timestamp)"},
+  {"idx_browser_tab_timestamp",
+   "CREATE INDEX IF NOT EXISTS idx_browser_tab_timestamp "
+   "ON blocked_requests(browser_id, tab_id, timestamp)"},
+  {"idx_reported_timestamp",
+   "CREATE INDEX IF NOT EXISTS idx_reported_timestamp "
+   "ON blocked_requests(reported, timestamp)"},
+};
+
+const char* const kLegacyIndexes[] = {
+  "idx_timestamp", "idx_reported", "idx_host", "idx_browser_id", "idx_tab_id",
+};
+
+const char* const kWriteOptimizedIndexes[] = {
+  "idx_unreported_queue", "idx_reported_retention",
+};
+
+const char* const kQueryOptimizedIndexes[] = {
+  "idx_unreported_queue", "idx_timestamp", "idx_host_timestamp",
+  "idx_browser_tab_timestamp", "idx_reported_timestamp",
+};
+
+using request_schema::BindColumn;
+using request_schema::FullRow;
+using request_schema::InsertRow;
+using request_schema::UnreportedRow;
+
+template <size_t N>
+bool ContainsIndex(const char* const (&indexes)[N], const std::string& name) {
+  for (const char* index : indexes) {
+    if (name == index) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// 判断索引是否属于指定方案
+bool IndexInProfile(const std::string& name, SchemaProfile profile) {
+  switch (profile) {
+    case SchemaProfile::kLegacy:
+      return ContainsIndex(kLegacyIndexes, name);
+    case SchemaProfile::kWriteOptimized:
+      return ContainsIndex(kWriteOptimizedIndexes, name);
+    case SchemaProfile::kQueryOptimized:
+      return ContainsIndex(kQueryOptimizedIndexes, name);
+  }
+  return false;
+}
+
+// URL子串索引：trigram分词的FTS5外部内容表，不重复存储url
+// 插入由AddBlockedRequest直接写入索引：触发器里的FTS5写入每行都要建保存点，
+// 批量写入时慢约2.5倍。删除和修改url较少，由触发器维护；
+// 标记上报只更新reported列，不触发索引维护
+const char kUrlSearchTableExistsSQL[] =
+    "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'blocked_requests_url_fts'";
+
+const char kCreateUrlSearchSQL[] = R"(
+  CREATE VIRTUAL TABLE blocked_requests_url_fts USING fts5(
+    url, content = 'blocked_requests', content_rowid = 'id',
+    tokenize = 'trigram case_sensitive 1', detail = 'none'
+  );
+
+  CREATE TRIGGER blocked_requests_url_fts_ad AFTER DELETE ON blocked_requests BEGIN
+    INSERT INTO blocked_requests_url_fts (blocked_requests_url_fts, rowid, url)
+    VALUES ('delete', old.id, old.url);
+  END;
+
+  CREATE TRIGGER blocked_requests_url_fts_au AFTER UPDATE OF url ON blocked_requests BEGIN
+    INSERT INTO blocked_requests_url_fts (blocked_requests_url_fts, rowid, url)
+    VALUES ('delete', old.id, old.url);
+    INSERT INTO blocked_requests_url_fts (rowid, url) VALUES (new.id, new.url);
+  END;
+
+  INSERT INTO blocked_requests_url_fts (blocked_requests_url_fts) VALUES ('rebuild');
 )";
 
-const char kInsertSQL[] = 
-    "INSERT INTO blocked_requests (url, host, reason, timestamp, browser_id, tab_id) "
-    "VALUES (?, ?, ?, ?, ?, ?)";
+const char kDropUrlSearchSQL[] = R"(
+  DROP TRIGGER IF EXISTS blocked_requests_url_fts_ad;
+  DROP TRIGGER IF EXISTS blocked_requests_url_fts_au;
+  DROP TABLE IF EXISTS blocked_requests_url_fts;
+)";
 
-const char kSelectUnreportedSQL[] = 
-    "SELECT id, url, host, reason, timestamp, reported, browser_id, tab_id "
-    "FROM blocked_requests WHERE reported = 0 ORDER BY timestamp ASC LIMIT ?";
+const char kInsertUrlIndexSQL[] =
+    "INSERT INTO blocked_requests_url_fts (rowid, url) VALUES (?, ?)";
 
-const char kSelectAllSQL[] = 
-    "SELECT id, url, host, reason, timestamp, reported, browser_id, tab_id "
-    "FROM blocked_requests ORDER BY timestamp DESC LIMIT ?";
+const char kSchemaVersionSQL[] = "PRAGMA schema_version";
+
+// 通过索引搜索：trigram分词对GLOB模式取出候选行，再按内容表校验
+// detail='none'不支持短语查询，但不存位置信息，索引比'full'小得多
+constexpr auto kSearchUrlIndexedSQL =
+    "SELECT " + FullRow::QualifiedColumnList("b.") +
+    " FROM blocked_requests_url_fts f JOIN blocked_requests b ON b.id = f.rowid "
+    "WHERE f.url GLOB ? AND f.rowid < ? "
+    "ORDER BY f.rowid DESC LIMIT ?";
+
+// 不足3个字符或未开启索引时扫描全表
+constexpr auto kSearchUrlScanSQL =
+    "SELECT " + FullRow::kColumnList +
+    " FROM blocked_requests WHERE instr(url, ?) > 0 AND id < ? "
+    "ORDER BY id DESC LIMIT ?";
+
+// trigram能索引的最短子串（按字符计）
+const size_t kMinIndexedPatternChars = 3;
+
+// UTF-8字符数
+size_t Utf8Length(std::string_view text) {
+  size_t length = 0;
+  for (unsigned char c : text) {
+    length += (c & 0xC0) != 0x80;
+  }
+  return length;
+}
+
+// 把pattern转成子串GLOB模式"*pattern*"，通配符放进字符类按字面匹配
+std::string SubstringGlob(std::string_view pattern) {
+  std::string glob;
+  glob.reserve(pattern.size() + 8);
+  glob.push_back('*');
+  for (char c : pattern) {
+    if (c == '*' || c == '?' || c == '[') {
+      glob.push_back('[');
+      glob.push_back(c);
+      glob.push_back(']');
+    } else {
+      glob.push_back(c);
+    }
+  }
+  glob.push_back('*');
+  return glob;
+}
+
+// 列清单和占位符由blocked_request_schema.h中的投影在编译期生成
+constexpr auto kInsertSQL =
+    "INSERT INTO blocked_requests (" + InsertRow::kColumnList +
+    ") VALUES (" + InsertRow::kPlaceholders + ")";
+
+constexpr auto kSelectUnreportedSQL =
+    "SELECT " + UnreportedRow::kColumnList + request_schema::kUnreportedQueryTail;
+
+constexpr auto kSelectAllSQL =
+    "SELECT " + FullRow::kColumnList + request_schema::kAllQueryTail;
 
 const char kUpdateReportedSQL[] = 
     "UPDATE blocked_requests SET reported = 1 WHERE id = ?";
@@ -48,6 +228,13 @@ const char kCountSQL[] =
     "FROM blocked_requests";
 }
 
+BlockedRequestView MakeRequestView(const BlockedRequest& request) {
+  return BlockedRequestView{request.url, request.host, request.reason,
+                            request.timestamp, request.browser_id,
+                            request.tab_id, request.dest_ip,
+                            request.country};
+}
+
 BlockedRequestDB::BlockedRequestDB()
     : db_(nullptr),
       insert_stmt_(nullptr),
@@ -56,6 +243,11 @@ BlockedRequestDB::BlockedRequestDB()
       update_reported_stmt_(nullptr),
       delete_old_stmt_(nullptr),
       count_stmt_(nullptr),
+      schema_version_stmt_(nullptr),
+      url_index_stmt_(nullptr),
+      schema_profile_(SchemaProfile::kWriteOptimized),
+      schema_version_(-1),
+      url_search_enabled_(false),
       initialized_(false) {
 }
 
@@ -83,12 +275,36 @@ bool BlockedRequestDB::Initialize(const std::string& db_path) {
   sqlite3_exec(db_, "PRAGMA busy_timeout=5000;", nullptr, nullptr, nullptr);
   sqlite3_exec(db_, "PRAGMA synchronous=NORMAL;", nullptr, nullptr, nullptr);
 
+  // 创建表之前记录表是否已存在，用于识别没有方案记录的旧数据库
+  sqlite3_stmt* exists_stmt = nullptr;
+  bool table_existed = false;
+  if (sqlite3_prepare_v2(db_, kTableExistsSQL, -1, &exists_stmt, nullptr) == SQLITE_OK) {
+    table_existed = sqlite3_step(exists_stmt) == SQLITE_ROW;
+    sqlite3_finalize(exists_stmt);
+  }
+
   // 创建表
   if (!CreateTables()) {
     Close();
     return false;
   }
 
+  // 确定索引方案：优先使用数据库记录的方案，旧数据库视为kLegacy
+  SchemaProfile profile = SchemaProfile::kWriteOptimized;
+  if (!LoadSchemaProfile(&profile)) {
+    profile = table_existed ? SchemaProfile::kLegacy
+                            : SchemaProfile::kWriteOptimized;
+    if (!MigrateSchemaProfile(profile)) {
+      Close();
+      return false;
+    }
+  } else if (!CreateProfileIndexes(profile)) {
+    // 补齐方案中后来增加的索引
+    Close();
+    return false;
+  }
+  schema_profile_ = profile;
+
   // 准备SQL语句
   if (!PrepareStatements()) {
     Close();
@@ -96,6 +312,51 @@ bool BlockedRequestDB::Initialize(const std::string& db_path) {
   }
 
   initialized_ = true;
+  SyncUrlSearchState();
+  return true;
+}
+
+bool BlockedRequestDB::Initialize(const std::string& db_path,
+                                  SchemaProfile profile) {
+  if (!Initialize(db_path)) {
+    return false;
+  }
+
+  if (schema_profile_ == profile) {
+    return true;
+  }
+
+  return MigrateSchemaProfile(profile);
+}
+
+bool BlockedRequestDB::InitializeReadOnly(const std::string& db_path) {
+  if (initialized_) {
+    return true;
+  }
+
+  if (sqlite3_open_v2(db_path.c_str(), &db_, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+    sqlite3_close(db_);
+    db_ = nullptr;
+    return false;
+  }
+
+  sqlite3_exec(db_, "PRAGMA busy_timeout=5000;", nullptr, nullptr, nullptr);
+
+  // 只读取记录的方案，没有记录时视为旧数据库
+  SchemaProfile profile = SchemaProfile::kLegacy;
+  LoadSchemaProfile(&profile);
+  schema_profile_ = profile;
+
+  // 表由写连接创建，表不存在时语句准备失败
+  if (!PrepareStatements()) {
+    CleanupStatements();
+    sqlite3_close(db_);
+    db_ = nullptr;
+    return false;
+  }
+
+  initialized_ = true;
+  SyncUrlSearchState();
   return true;
 }
 
@@ -124,23 +385,219 @@ bool BlockedRequestDB::CreateTables() {
     }
     return false;
   }
-  
+
+  sqlite3_stmt* stmt = nullptr;
+  if (sqlite3_prepare_v2(db_, kCountryColumnSQL, -1, &stmt, nullptr) == SQLITE_OK) {
+    sqlite3_finalize(stmt);
+    return true;
+  }
+  return sqlite3_exec(db_, kAddCountryColumnSQL, nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
+bool BlockedRequestDB::CreateProfileIndexes(SchemaProfile profile) {
+  for (const auto& index : kManagedIndexes) {
+    if (IndexInProfile(index.name, profile) &&
+        sqlite3_exec(db_, index.create_sql, nullptr, nullptr, nullptr) != SQLITE_OK) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool BlockedRequestDB::LoadSchemaProfile(SchemaProfile* profile) {
+  sqlite3_stmt* stmt = nullptr;
+  if (sqlite3_prepare_v2(db_, kSelectMetaSQL, -1, &stmt, nullptr) != SQLITE_OK) {
+    return false;
+  }
+
+  sqlite3_bind_text(stmt, 1, kSchemaProfileKey, -1, SQLITE_STATIC);
+
+  bool found = false;
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    int value = sqlite3_column_int(stmt, 0);
+    if (value >= static_cast<int>(SchemaProfile::kLegacy) &&
+        value <= static_cast<int>(SchemaProfile::kQueryOptimized)) {
+      *profile = static_cast<SchemaProfile>(value);
+      found = true;
+    }
+  }
+
+  sqlite3_finalize(stmt);
+  return found;
+}
+
+bool BlockedRequestDB::MigrateSchemaProfile(SchemaProfile profile) {
+  if (!db_) {
+    return false;
+  }
+
+  // IMMEDIATE事务：迁移期间其他写者等待，WAL模式下读者继续读取旧快照
+  if (sqlite3_exec(db_, "BEGIN IMMEDIATE", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    return false;
+  }
+
+  // 先创建目标方案的索引，再删除多余索引
+  bool success = CreateProfileIndexes(profile);
+
+  if (success) {
+    for (const auto& index : kManagedIndexes) {
+      if (IndexInProfile(index.name, profile)) {
+        continue;
+      }
+      std::string drop_sql = std::string("DROP INDEX IF EXISTS ") + index.name;
+      if (sqlite3_exec(db_, drop_sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK) {
+        success = false;
+        break;
+      }
+    }
+  }
+
+  // 记录当前方案
+  if (success) {
+    sqlite3_stmt* stmt = nullptr;
+    std::string value = std::to_string(static_cast<int>(profile));
+    success = sqlite3_prepare_v2(db_, kUpsertMetaSQL, -1, &stmt, nullptr) == SQLITE_OK;
+    if (success) {
+      sqlite3_bind_text(stmt, 1, kSchemaProfileKey, -1, SQLITE_STATIC);
+      sqlite3_bind_text(stmt, 2, value.c_str(), -1, SQLITE_STATIC);
+      success = sqlite3_step(stmt) == SQLITE_DONE;
+    }
+    sqlite3_finalize(stmt);
+  }
+
+  if (success) {
+    success = sqlite3_exec(db_, "COMMIT", nullptr, nullptr, nullptr) == SQLITE_OK;
+  }
+  if (!success) {
+    sqlite3_exec(db_, "ROLLBACK", nullptr, nullptr, nullptr);
+    return false;
+  }
+
+  schema_profile_ = profile;
+  return true;
+}
+
+bool BlockedRequestDB::UrlSearchTableExists() {
+  sqlite3_stmt* stmt = nullptr;
+  if (sqlite3_prepare_v2(db_, kUrlSearchTableExistsSQL, -1, &stmt, nullptr) != SQLITE_OK) {
+    return false;
+  }
+  bool exists = sqlite3_step(stmt) == SQLITE_ROW;
+  sqlite3_finalize(stmt);
+  return exists;
+}
+
+void BlockedRequestDB::SyncUrlSearchState() {
+  sqlite3_reset(schema_version_stmt_);
+  if (sqlite3_step(schema_version_stmt_) != SQLITE_ROW) {
+    sqlite3_reset(schema_version_stmt_);
+    return;
+  }
+  int64_t version = sqlite3_column_int64(schema_version_stmt_, 0);
+  sqlite3_reset(schema_version_stmt_);
+  if (version == schema_version_) {
+    return;
+  }
+  schema_version_ = version;
+
+  url_search_enabled_ = UrlSearchTableExists();
+  if (url_index_stmt_) {
+    sqlite3_finalize(url_index_stmt_);
+    url_index_stmt_ = nullptr;
+  }
+  if (url_search_enabled_ &&
+      sqlite3_prepare_v2(db_, kInsertUrlIndexSQL, -1, &url_index_stmt_, nullptr) != SQLITE_OK) {
+    // 准备失败时下次写入重试
+    url_index_stmt_ = nullptr;
+    schema_version_ = -1;
+  }
+}
+
+bool BlockedRequestDB::SetUrlSearchEnabled(bool enabled) {
+  if (!initialized_) {
+    return false;
+  }
+  SyncUrlSearchState();
+  if (enabled == url_search_enabled_) {
+    return true;
+  }
+
+  // 建表、建触发器和重建索引在同一个事务内，失败时整体回滚
+  if (sqlite3_exec(db_, "BEGIN IMMEDIATE", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    return false;
+  }
+
+  const char* sql = enabled ? kCreateUrlSearchSQL : kDropUrlSearchSQL;
+  bool success = sqlite3_exec(db_, sql, nullptr, nullptr, nullptr) == SQLITE_OK;
+  if (success) {
+    success = sqlite3_exec(db_, "COMMIT", nullptr, nullptr, nullptr) == SQLITE_OK;
+  }
+  if (!success) {
+    sqlite3_exec(db_, "ROLLBACK", nullptr, nullptr, nullptr);
+    return false;
+  }
+
+  SyncUrlSearchState();
+  return url_search_enabled_ == enabled;
+}
+
+bool BlockedRequestDB::SearchByUrl(std::string_view pattern, int64_t cursor, int limit,
+                                   UrlSearchPage* page) {
+  if (!initialized_ || pattern.empty() || limit <= 0) {
+    return false;
+  }
+
+  page->requests.clear();
+  page->next_cursor = 0;
+
+  bool use_index = url_search_enabled_ &&
+                   Utf8Length(pattern) >= kMinIndexedPatternChars;
+  const char* sql = use_index ? kSearchUrlIndexedSQL.c_str() : kSearchUrlScanSQL.c_str();
+
+  // 搜索用于排查问题，调用不频繁，每次单独准备语句
+  sqlite3_stmt* stmt = nullptr;
+  if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    return false;
+  }
+
+  std::string glob;
+  if (use_index) {
+    glob = SubstringGlob(pattern);
+    BindColumn(stmt, 1, glob);
+  } else {
+    BindColumn(stmt, 1, pattern);
+  }
+  sqlite3_bind_int64(stmt, 2, cursor > 0 ? cursor : INT64_MAX);
+  sqlite3_bind_int(stmt, 3, limit);
+
+  bool success = request_schema::ReadRows<FullRow>(stmt, &page->requests);
+  sqlite3_finalize(stmt);
+
+  if (!success) {
+    page->requests.clear();
+    return false;
+  }
+
+  // 取满一页时可能还有更多结果
+  if (page->requests.size() == static_cast<size_t>(limit)) {
+    page->next_cursor = page->requests.back().id;
+  }
   return true;
 }
 
 bool BlockedRequestDB::PrepareStatements() {
   // 准备插入语句
-  if (sqlite3_prepare_v2(db_, kInsertSQL, -1, &insert_stmt_, nullptr) != SQLITE_OK) {
+  if (sqlite3_prepare_v2(db_, kInsertSQL.c_str(), -1, &insert_stmt_, nullptr) != SQLITE_OK) {
     return false;
   }
 
   // 准备查询未上报记录的语句
-  if (sqlite3_prepare_v2(db_, kSelectUnreportedSQL, -1, &select_unreported_stmt_, nullptr) != SQLITE_OK) {
+  if (sqlite3_prepare_v2(db_, kSelectUnreportedSQL.c_str(), -1, &select_unreported_stmt_, nullptr) != SQLITE_OK) {
     return false;
   }
 
   // 准备查询所有记录的语句
-  if (sqlite3_prepare_v2(db_, kSelectAllSQL, -1, &select_all_stmt_, nullptr) != SQLITE_OK) {
+  if (sqlite3_prepare_v2(db_, kSelectAllSQL.c_str(), -1, &select_all_stmt_, nullptr) != SQLITE_OK) {
     return false;
   }
 
@@ -159,6 +616,11 @@ bool BlockedRequestDB::PrepareStatements() {
     return false;
   }
 
+  // 准备检查表结构版本的语句
+  if (sqlite3_prepare_v2(db_, kSchemaVersionSQL, -1, &schema_version_stmt_, nullptr) != SQLITE_OK) {
+    return false;
+  }
+
   return true;
 }
 
@@ -187,43 +649,72 @@ void BlockedRequestDB::CleanupStatements() {
     sqlite3_finalize(count_stmt_);
     count_stmt_ = nullptr;
   }
+  if (schema_version_stmt_) {
+    sqlite3_finalize(schema_version_stmt_);
+    schema_version_stmt_ = nullptr;
+  }
+  if (url_index_stmt_) {
+    sqlite3_finalize(url_index_stmt_);
+    url_index_stmt_ = nullptr;
+  }
+  for (auto& cached : cached_stmts_) {
+    sqlite3_finalize(cached.second);
+  }
+  cached_stmts_.clear();
+  schema_version_ = -1;
+  url_search_enabled_ = false;
 }
 
 bool BlockedRequestDB::AddBlockedRequest(const BlockedRequest& request) {
+  return AddBlockedRequest(MakeRequestView(request));
+}
+
+bool BlockedRequestDB::AddBlockedRequest(const BlockedRequestView& request) {
   if (!initialized_ || !insert_stmt_) {
     return false;
   }
 
+  // 不在事务内时先同步索引状态；开启了URL索引则放进事务，记录和索引一起提交
+  if (sqlite3_get_autocommit(db_)) {
+    SyncUrlSearchState();
+    if (url_index_stmt_) {
+      return AddBlockedRequests(std::vector<BlockedRequestView>{request});
+    }
+  }
+
   // 重置语句
   sqlite3_reset(insert_stmt_);
   
   // 绑定参数
-  int param_index = 1;
-  sqlite3_bind_text(insert_stmt_, param_index++, request.url.c_str(), -1, SQLITE_STATIC);
-  sqlite3_bind_text(insert_stmt_, param_index++, request.host.c_str(), -1, SQLITE_STATIC);
-  sqlite3_bind_text(insert_stmt_, param_index++, request.reason.c_str(), -1, SQLITE_STATIC);
-  sqlite3_bind_int64(insert_stmt_, param_index++, request.timestamp);
-  sqlite3_bind_text(insert_stmt_, param_index++, request.browser_id.c_str(), -1, SQLITE_STATIC);
-  sqlite3_bind_int64(insert_stmt_, param_index++, request.tab_id);
+  InsertRow::Bind(insert_stmt_, request);
 
   // 执行插入
   int result = sqlite3_step(insert_stmt_);
-  return result == SQLITE_DONE;
+  if (result != SQLITE_DONE || !url_index_stmt_) {
+    return result == SQLITE_DONE;
+  }
+
+  // 写入URL索引
+  sqlite3_reset(url_index_stmt_);
+  sqlite3_bind_int64(url_index_stmt_, 1, sqlite3_last_insert_rowid(db_));
+  BindColumn(url_index_stmt_, 2, request.url);
+  return sqlite3_step(url_index_stmt_) == SQLITE_DONE;
 }
 
-bool BlockedRequestDB::AddBlockedRequests(const std::vector<BlockedRequest>& requests) {
-  if (!initialized_ || requests.empty()) {
-    return false;
-  }
+namespace {
 
+// 在一个事务中写入一批记录，RequestT为BlockedRequest或BlockedRequestView
+template <typename RequestT>
+bool AddInTransaction(sqlite3* db, const std::vector<RequestT>& requests,
+                      BlockedRequestDB* target) {
   // 开始事务
-  if (sqlite3_exec(db_, "BEGIN TRANSACTION", nullptr, nullptr, nullptr) != SQLITE_OK) {
+  if (sqlite3_exec(db, "BEGIN TRANSACTION", nullptr, nullptr, nullptr) != SQLITE_OK) {
     return false;
   }
 
   bool success = true;
   for (const auto& request : requests) {
-    if (!AddBlockedRequest(request)) {
+    if (!target->AddBlockedRequest(request)) {
       success = false;
       break;
     }
@@ -231,14 +722,35 @@ bool BlockedRequestDB::AddBlockedRequests(const std::vector<BlockedRequest>& req
 
   // 提交或回滚事务
   if (success) {
-    sqlite3_exec(db_, "COMMIT", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "COMMIT", nullptr, nullptr, nullptr);
   } else {
-    sqlite3_exec(db_, "ROLLBACK", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "ROLLBACK", nullptr, nullptr, nullptr);
   }
 
   return success;
 }
 
+}  // namespace
+
+bool BlockedRequestDB::AddBlockedRequests(const std::vector<BlockedRequest>& requests) {
+  if (!initialized_ || requests.empty()) {
+    return false;
+  }
+
+  SyncUrlSearchState();
+  return AddInTransaction(db_, requests, this);
+}
+
+bool BlockedRequestDB::AddBlockedRequests(
+    const std::vector<BlockedRequestView>& requests) {
+  if (!initialized_ || requests.empty()) {
+    return false;
+  }
+
+  SyncUrlSearchState();
+  return AddInTransaction(db_, requests, this);
+}
+
 std::vector<BlockedRequest> BlockedRequestDB::GetUnreportedRequests(int limit) {
   std::vector<BlockedRequest> requests;
   
@@ -252,10 +764,8 @@ std::vector<BlockedRequest> BlockedRequestDB::GetUnreportedRequests(int limit) {
   // 绑定limit参数
   sqlite3_bind_int(select_unreported_stmt_, 1, limit);
 
-  // 执行查询
-  while (sqlite3_step(select_unreported_stmt_) == SQLITE_ROW) {
-    requests.push_back(BuildRequestFromRow(select_unreported_stmt_));
-  }
+  // 执行查询，未上报记录的reported恒为false，不读取该列
+  request_schema::ReadRows<UnreportedRow>(select_unreported_stmt_, &requests);
 
   return requests;
 }
@@ -270,16 +780,11 @@ std::vector<BlockedRequest> BlockedRequestDB::GetAllRequests(int limit) {
   // 重置语句
   sqlite3_reset(select_all_stmt_);
   
-  // 重置语句
-  sqlite3_reset(select_all_stmt_);
-  
   // 绑定limit参数
   sqlite3_bind_int(select_all_stmt_, 1, limit);
 
   // 执行查询
-  while (sqlite3_step(select_all_stmt_) == SQLITE_ROW) {
-    requests.push_back(BuildRequestFromRow(select_all_stmt_));
-  }
+  request_schema::ReadRows<FullRow>(select_all_stmt_, &requests);
 
   return requests;
 }
@@ -306,21 +811,54 @@ bool BlockedRequestDB::MarkAsReported(int64_t request_id, int status_code,
   return result == SQLITE_DONE;
 }
 
-bool BlockedRequestDB::DeleteReportedRequests(int days_old) {
-  if (!initialized_ || !delete_old_stmt_) {
+bool BlockedRequestDB::MarkAsReported(const std::vector<int64_t>& request_ids) {
+  if (!initialized_ || !update_reported_stmt_) {
     return false;
   }
 
+  if (sqlite3_exec(db_, "BEGIN TRANSACTION", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    return false;
+  }
+
+  bool success = true;
+  for (int64_t request_id : request_ids) {
+    sqlite3_reset(update_reported_stmt_);
+    sqlite3_bind_int64(update_reported_stmt_, 1, request_id);
+    if (sqlite3_step(update_reported_stmt_) != SQLITE_DONE) {
+      success = false;
+      break;
+    }
+  }
+
+  if (success) {
+    success = sqlite3_exec(db_, "COMMIT", nullptr, nullptr, nullptr) == SQLITE_OK;
+  }
+  if (!success) {
+    sqlite3_exec(db_, "ROLLBACK", nullptr, nullptr, nullptr);
+  }
+
+  return success;
+}
+
+bool BlockedRequestDB::DeleteReportedRequests(int days_old) {
   // 计算时间戳
   auto cutoff_time = std::chrono::duration_cast<std::chrono::milliseconds>(
       std::chrono::system_clock::now().time_since_epoch()).count() - 
       (days_old * 24 * 60 * 60 * 1000LL);
 
+  return DeleteReportedRequestsBefore(cutoff_time);
+}
+
+bool BlockedRequestDB::DeleteReportedRequestsBefore(int64_t cutoff_timestamp) {
+  if (!initialized_ || !delete_old_stmt_) {
+    return false;
+  }
+
   // 重置语句
   sqlite3_reset(delete_old_stmt_);
   
   // 绑定参数
-  sqlite3_bind_int64(delete_old_stmt_, 1, cutoff_time);
+  sqlite3_bind_int64(delete_old_stmt_, 1, cutoff_timestamp);
 
   // 执行删除
   int result = sqlite3_step(delete_old_stmt_);
@@ -348,17 +886,36 @@ BlockedRequestDB::Statistics BlockedRequestDB::GetStatistics() {
   return stats;
 }
 
-BlockedRequest BlockedRequestDB::BuildRequestFromRow(sqlite3_stmt* stmt) {
-  BlockedRequest request;
-  
-  request.id = sqlite3_column_int64(stmt, 0);
-  request.url = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-  request.host = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-  request.reason = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-  request.timestamp = sqlite3_column_int64(stmt, 4);
-  request.reported = sqlite3_column_int(stmt, 5) != 0;
-  request.browser_id = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 6));
-  request.tab_id = sqlite3_column_int64(stmt, 7);
-  
-  return request;
+sqlite3_stmt* BlockedRequestDB::CachedStatement(const char* sql) {
+  if (!initialized_) {
+    return nullptr;
+  }
+
+  // 每个投影的SQL是一个静态常量，按地址查找即可
+  for (const auto& cached : cached_stmts_) {
+    if (cached.first == sql) {
+      sqlite3_reset(cached.second);
+      return cached.second;
+    }
+  }
+
+  sqlite3_stmt* stmt = nullptr;
+  if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    return nullptr;
+  }
+  cached_stmts_.emplace_back(sql, stmt);
+  return stmt;
+}
+
+std::unique_ptr<DatabaseBackup> BlockedRequestDB::StartBackup(
+    const std::string& dest_path, const BackupOptions& options) {
+  if (!initialized_) {
+    return nullptr;
+  }
+
+  const char* source_path = sqlite3_db_filename(db_, "main");
+  if (!source_path || source_path[0] == '\0') {
+    return nullptr;
+  }
+  return DatabaseBackup::Start(source_path, dest_path, options);
 }
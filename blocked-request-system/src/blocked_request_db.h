@@ -2,10 +2,15 @@
 #define BLOCKED_REQUEST_DB_H_
 
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 #include <memory>
 #include <sqlite3.h>
 
+class DatabaseBackup;
+struct BackupOptions;
+
 // 拦截请求的数据结构
 struct BlockedRequest {
   int64_t id;                    // 主键ID
@@ -16,6 +21,35 @@ struct BlockedRequest {
   bool reported;                 // 是否已上报
   std::string browser_id;        // 标识店铺
   int64_t tab_id;                // 标签页ID
+  std::string dest_ip;           // 被拦截请求的目的IP，由调用方提供，不落库
+  std::string country;           // 目的IP所属国家（ISO代码），由地理解析阶段填充
+};
+
+// 拦截请求的只读视图，字符串不拥有内存
+// 写入路径使用视图，避免为每条请求复制std::string
+struct BlockedRequestView {
+  std::string_view url;
+  std::string_view host;
+  std::string_view reason;
+  int64_t timestamp;
+  std::string_view browser_id;
+  int64_t tab_id;
+  std::string_view dest_ip;
+  std::string_view country;
+};
+
+// 从BlockedRequest构建视图，视图的生命周期不能超过request
+BlockedRequestView MakeRequestView(const BlockedRequest& request);
+
+// 索引配置方案
+// kLegacy: 旧版的五个单列索引，仅为兼容已有数据库保留
+// kWriteOptimized: 只保留未上报队列和已上报记录两个部分索引，插入开销最小，
+//   按时间清理已上报记录也不需要全表扫描
+// kQueryOptimized: 在未上报队列索引之外，增加按时间/域名/店铺查询的复合索引
+enum class SchemaProfile {
+  kLegacy = 0,
+  kWriteOptimized = 1,
+  kQueryOptimized = 2,
 };
 
 // SQLite数据库管理类
@@ -25,7 +59,15 @@ class BlockedRequestDB {
   ~BlockedRequestDB();
 
   // 初始化数据库
+  // 新建的数据库使用kWriteOptimized；已有数据库沿用其记录的索引方案
   bool Initialize(const std::string& db_path);
+
+  // 初始化数据库，并在需要时将索引在线迁移到指定方案
+  bool Initialize(const std::string& db_path, SchemaProfile profile);
+
+  // 以只读方式打开已有数据库：不建表、不修改日志模式、不迁移索引方案，
+  // 写入接口返回false。供与写连接并存的读连接使用
+  bool InitializeReadOnly(const std::string& db_path);
   
   // 关闭数据库
   void Close();
@@ -33,20 +75,37 @@ class BlockedRequestDB {
   // 添加拦截记录
   bool AddBlockedRequest(const BlockedRequest& request);
   
+  bool AddBlockedRequest(const BlockedRequestView& request);
+
   // 批量添加拦截记录
   bool AddBlockedRequests(const std::vector<BlockedRequest>& requests);
+  bool AddBlockedRequests(const std::vector<BlockedRequestView>& requests);
   
   // 获取未上报的记录
   std::vector<BlockedRequest> GetUnreportedRequests(int limit = 100);
   
   // 获取所有记录
   std::vector<BlockedRequest> GetAllRequests(int limit = 1000);
+
+  // 按投影读取，只取request_schema::Projection中的列，其余成员保持默认值
+  // 定义见blocked_request_schema.h，使用时包含该头文件
+  template <typename RowProjection>
+  std::vector<BlockedRequest> GetUnreportedRequests(int limit);
+
+  template <typename RowProjection>
+  std::vector<BlockedRequest> GetAllRequests(int limit);
   
   // 标记记录为已上报
   bool MarkAsReported(int64_t request_id, int status_code, const std::string& response);
+
+  // 在一个事务中批量标记为已上报
+  bool MarkAsReported(const std::vector<int64_t>& request_ids);
   
   // 删除已上报的记录（可选，用于清理）
   bool DeleteReportedRequests(int days_old = 7);
+
+  // 删除时间戳早于cutoff_timestamp（毫秒）的已上报记录
+  bool DeleteReportedRequestsBefore(int64_t cutoff_timestamp);
   
   // 获取统计信息
   struct Statistics {
@@ -57,12 +116,56 @@ class BlockedRequestDB {
   };
   Statistics GetStatistics();
 
+  // 在线迁移索引方案（单个事务内完成，WAL模式下读者不受阻塞）
+  bool MigrateSchemaProfile(SchemaProfile profile);
+
+  // 当前使用的索引方案
+  SchemaProfile schema_profile() const { return schema_profile_; }
+
+  // 开启或关闭URL子串索引（FTS5 trigram，外部内容表）
+  // 写入记录时在同一事务内更新索引，删除和修改url由触发器维护；
+  // 其他连接在下一次写入时发现状态变化。开启时为已有记录重建索引，
+  // SQLite未编译FTS5时返回false
+  bool SetUrlSearchEnabled(bool enabled);
+
+  bool url_search_enabled() const { return url_search_enabled_; }
+
+  // URL子串搜索结果的一页，按id从新到旧
+  struct UrlSearchPage {
+    std::vector<BlockedRequest> requests;
+    int64_t next_cursor = 0;     // 传给下一次搜索的cursor，0表示没有更多结果
+  };
+
+  // 搜索url中包含pattern的记录（区分大小写）
+  // cursor为0表示从最新的记录开始，否则只返回id小于cursor的记录
+  // 开启索引且pattern不少于3个字符时走索引，否则扫描全表
+  bool SearchByUrl(std::string_view pattern, int64_t cursor, int limit,
+                   UrlSearchPage* page);
+
+  // 在线备份到dest_path，定义见database_backup.h
+  // 备份在后台线程上用独立的连接进行，本对象可以继续写入，也可以先于备份关闭；
+  // 未初始化或为内存数据库时返回nullptr
+  std::unique_ptr<DatabaseBackup> StartBackup(const std::string& dest_path,
+                                              const BackupOptions& options);
+
   // 检查数据库是否可用
   bool IsValid() const { return db_ != nullptr; }
 
  private:
   // 创建表结构
   bool CreateTables();
+
+  // 读取数据库中记录的索引方案，新建数据库返回false
+  bool LoadSchemaProfile(SchemaProfile* profile);
+
+  // 创建方案中缺少的索引，已有的索引不变
+  bool CreateProfileIndexes(SchemaProfile profile);
+
+  // URL子串索引是否存在
+  bool UrlSearchTableExists();
+
+  // schema_version变化时重新检查URL索引是否存在，准备或释放索引写入语句
+  void SyncUrlSearchState();
   
   // 准备SQL语句
   bool PrepareStatements();
@@ -70,8 +173,8 @@ class BlockedRequestDB {
   // 清理SQL语句
   void CleanupStatements();
   
-  // 从查询结果构建BlockedRequest对象
-  BlockedRequest BuildRequestFromRow(sqlite3_stmt* stmt);
+  // 按SQL文本地址缓存的语句，供按投影读取使用；未初始化或准备失败时返回nullptr
+  sqlite3_stmt* CachedStatement(const char* sql);
 
   sqlite3* db_;
   sqlite3_stmt* insert_stmt_;
@@ -80,7 +183,13 @@ class BlockedRequestDB {
   sqlite3_stmt* update_reported_stmt_;
   sqlite3_stmt* delete_old_stmt_;
   sqlite3_stmt* count_stmt_;
+  sqlite3_stmt* schema_version_stmt_;
+  sqlite3_stmt* url_index_stmt_;     // 未开启URL索引时为nullptr
+  std::vector<std::pair<const char*, sqlite3_stmt*>> cached_stmts_;
   
+  SchemaProfile schema_profile_;
+  int64_t schema_version_;
+  bool url_search_enabled_;
   bool initialized_;
 };
 
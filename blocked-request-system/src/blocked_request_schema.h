@@ -0,0 +1,265 @@
+#ifndef BLOCKED_REQUEST_SCHEMA_H_
+#define BLOCKED_REQUEST_SCHEMA_H_
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sqlite3.h>
+#include "blocked_request_db.h"
+
+// blocked_requests表的编译期列描述
+// 每列记录列名和对应的BlockedRequest成员，Projection<列...>在编译期生成：
+// - 列清单和占位符（拼接进SQL文本，SQL是constexpr常量）
+// - 按列类型展开的读取和绑定函数，列下标由列在投影中的位置决定
+// 读取时只取投影内的列，投影外的成员保持默认值，不产生字符串复制
+//
+// 用法:
+//   using HostRow = request_schema::Projection<request_schema::Id, request_schema::Host>;
+//   auto rows = db.GetUnreportedRequests<HostRow>(100);   // 只读id和host
+namespace request_schema {
+
+// 定长SQL文本，可在编译期拼接
+template <size_t N>
+struct SqlText {
+  char data[N + 1] = {};
+
+  static constexpr size_t size() { return N; }
+  constexpr const char* c_str() const { return data; }
+};
+
+template <size_t N>
+constexpr size_t CopyText(char* out, size_t pos, const char* text) {
+  for (size_t i = 0; i < N; ++i) {
+    out[pos + i] = text[i];
+  }
+  return pos + N;
+}
+
+template <size_t A, size_t B>
+constexpr SqlText<A + B> operator+(const SqlText<A>& lhs, const SqlText<B>& rhs) {
+  SqlText<A + B> text;
+  CopyText<B>(text.data, CopyText<A>(text.data, 0, lhs.data), rhs.data);
+  return text;
+}
+
+template <size_t A, size_t B>
+constexpr SqlText<A + B - 1> operator+(const SqlText<A>& lhs, const char (&rhs)[B]) {
+  SqlText<A + B - 1> text;
+  CopyText<B - 1>(text.data, CopyText<A>(text.data, 0, lhs.data), rhs);
+  return text;
+}
+
+template <size_t A, size_t B>
+constexpr SqlText<A - 1 + B> operator+(const char (&lhs)[A], const SqlText<B>& rhs) {
+  SqlText<A - 1 + B> text;
+  CopyText<B>(text.data, CopyText<A - 1>(text.data, 0, lhs), rhs.data);
+  return text;
+}
+
+// 列定义：kName为列名，kMember为BlockedRequest中的成员，
+// 可写入的列另有kViewMember指向BlockedRequestView中的成员
+struct Id {
+  static constexpr char kName[] = "id";
+  static constexpr auto kMember = &BlockedRequest::id;
+};
+
+struct Url {
+  static constexpr char kName[] = "url";
+  static constexpr auto kMember = &BlockedRequest::url;
+  static constexpr auto kViewMember = &BlockedRequestView::url;
+};
+
+struct Host {
+  static constexpr char kName[] = "host";
+  static constexpr auto kMember = &BlockedRequest::host;
+  static constexpr auto kViewMember = &BlockedRequestView::host;
+};
+
+struct Reason {
+  static constexpr char kName[] = "reason";
+  static constexpr auto kMember = &BlockedRequest::reason;
+  static constexpr auto kViewMember = &BlockedRequestView::reason;
+};
+
+struct Timestamp {
+  static constexpr char kName[] = "timestamp";
+  static constexpr auto kMember = &BlockedRequest::timestamp;
+  static constexpr auto kViewMember = &BlockedRequestView::timestamp;
+};
+
+struct Reported {
+  static constexpr char kName[] = "reported";
+  static constexpr auto kMember = &BlockedRequest::reported;
+};
+
+struct BrowserId {
+  static constexpr char kName[] = "browser_id";
+  static constexpr auto kMember = &BlockedRequest::browser_id;
+  static constexpr auto kViewMember = &BlockedRequestView::browser_id;
+};
+
+struct TabId {
+  static constexpr char kName[] = "tab_id";
+  static constexpr auto kMember = &BlockedRequest::tab_id;
+  static constexpr auto kViewMember = &BlockedRequestView::tab_id;
+};
+
+struct Country {
+  static constexpr char kName[] = "country";
+  static constexpr auto kMember = &BlockedRequest::country;
+  static constexpr auto kViewMember = &BlockedRequestView::country;
+};
+
+// 按成员类型读取一列；文本按sqlite3_column_bytes给出的长度复制，NULL读为空串
+inline void ReadColumn(sqlite3_stmt* stmt, int column, int64_t* value) {
+  *value = sqlite3_column_int64(stmt, column);
+}
+
+inline void ReadColumn(sqlite3_stmt* stmt, int column, bool* value) {
+  *value = sqlite3_column_int(stmt, column) != 0;
+}
+
+inline void ReadColumn(sqlite3_stmt* stmt, int column, std::string* value) {
+  const unsigned char* text = sqlite3_column_text(stmt, column);
+  if (text) {
+    value->assign(reinterpret_cast<const char*>(text),
+                  static_cast<size_t>(sqlite3_column_bytes(stmt, column)));
+  } else {
+    value->clear();
+  }
+}
+
+// 按成员类型绑定一个参数；空视图绑定为空字符串而不是NULL
+inline void BindColumn(sqlite3_stmt* stmt, int index, int64_t value) {
+  sqlite3_bind_int64(stmt, index, value);
+}
+
+inline void BindColumn(sqlite3_stmt* stmt, int index, std::string_view value) {
+  sqlite3_bind_text(stmt, index, value.empty() ? "" : value.data(),
+                    static_cast<int>(value.size()), SQLITE_STATIC);
+}
+
+template <size_t P, size_t N>
+constexpr size_t AppendColumn(char* out, size_t pos, const char (&prefix)[P],
+                              const char (&name)[N]) {
+  if (pos > 0) {
+    out[pos++] = ',';
+    out[pos++] = ' ';
+  }
+  pos = CopyText<P - 1>(out, pos, prefix);
+  return CopyText<N - 1>(out, pos, name);
+}
+
+// 以prefix限定的列清单，如ColumnList<Id, Url>("b.")得到"b.id, b.url"
+template <typename... Columns, size_t P>
+constexpr auto ColumnList(const char (&prefix)[P]) {
+  constexpr size_t kCount = sizeof...(Columns);
+  constexpr size_t kNamesSize = (0 + ... + (sizeof(Columns::kName) - 1));
+  SqlText<kNamesSize + kCount * (P - 1) + (kCount - 1) * 2> text;
+  size_t pos = 0;
+  ((pos = AppendColumn(text.data, pos, prefix, Columns::kName)), ...);
+  return text;
+}
+
+// N个参数的占位符"?, ?, ..."
+template <size_t N>
+constexpr SqlText<N * 3 - 2> Placeholders() {
+  SqlText<N * 3 - 2> text;
+  for (size_t i = 0; i < N; ++i) {
+    if (i > 0) {
+      text.data[i * 3 - 2] = ',';
+      text.data[i * 3 - 1] = ' ';
+    }
+    text.data[i * 3] = '?';
+  }
+  return text;
+}
+
+template <typename... Columns>
+struct Projection {
+  static constexpr size_t kColumnCount = sizeof...(Columns);
+  static_assert(kColumnCount > 0, "投影至少包含一列");
+
+  static constexpr auto kColumnList = ColumnList<Columns...>("");
+  static constexpr auto kPlaceholders = Placeholders<kColumnCount>();
+
+  // 带表别名的列清单，用于连接查询
+  template <size_t P>
+  static constexpr auto QualifiedColumnList(const char (&prefix)[P]) {
+    return ColumnList<Columns...>(prefix);
+  }
+
+  // 从first_column开始按投影顺序读取，只写入投影内的成员
+  static void Read(sqlite3_stmt* stmt, BlockedRequest* row, int first_column = 0) {
+    int column = first_column;
+    (ReadColumn(stmt, column++, &(row->*Columns::kMember)), ...);
+  }
+
+  // 从first_index开始按投影顺序绑定，投影中的列都必须有kViewMember
+  static void Bind(sqlite3_stmt* stmt, const BlockedRequestView& request,
+                   int first_index = 1) {
+    int index = first_index;
+    (BindColumn(stmt, index++, request.*Columns::kViewMember), ...);
+  }
+};
+
+// 完整的一行
+using FullRow =
+    Projection<Id, Url, Host, Reason, Timestamp, Reported, BrowserId, TabId, Country>;
+
+// 写入时的列，id自增、reported使用默认值
+using InsertRow = Projection<Url, Host, Reason, Timestamp, BrowserId, TabId, Country>;
+
+// 未上报队列：reported恒为0，不读取
+using UnreportedRow = Projection<Id, Url, Host, Reason, Timestamp, BrowserId, TabId, Country>;
+
+// 各查询在列清单之后的部分
+constexpr char kUnreportedQueryTail[] =
+    " FROM blocked_requests WHERE reported = 0 ORDER BY timestamp ASC LIMIT ?";
+constexpr char kAllQueryTail[] =
+    " FROM blocked_requests ORDER BY timestamp DESC LIMIT ?";
+
+// 逐行读取stmt的结果，追加到rows
+template <typename RowProjection>
+bool ReadRows(sqlite3_stmt* stmt, std::vector<BlockedRequest>* rows) {
+  int result;
+  while ((result = sqlite3_step(stmt)) == SQLITE_ROW) {
+    rows->emplace_back();
+    RowProjection::Read(stmt, &rows->back());
+  }
+  return result == SQLITE_DONE;
+}
+
+}  // namespace request_schema
+
+// BlockedRequestDB按投影读取的实现，语句在首次使用时准备并缓存
+template <typename RowProjection>
+std::vector<BlockedRequest> BlockedRequestDB::GetUnreportedRequests(int limit) {
+  static constexpr auto kSQL =
+      "SELECT " + RowProjection::kColumnList + request_schema::kUnreportedQueryTail;
+  std::vector<BlockedRequest> requests;
+  sqlite3_stmt* stmt = CachedStatement(kSQL.c_str());
+  if (stmt) {
+    sqlite3_bind_int(stmt, 1, limit);
+    request_schema::ReadRows<RowProjection>(stmt, &requests);
+    sqlite3_reset(stmt);
+  }
+  return requests;
+}
+
+template <typename RowProjection>
+std::vector<BlockedRequest> BlockedRequestDB::GetAllRequests(int limit) {
+  static constexpr auto kSQL =
+      "SELECT " + RowProjection::kColumnList + request_schema::kAllQueryTail;
+  std::vector<BlockedRequest> requests;
+  sqlite3_stmt* stmt = CachedStatement(kSQL.c_str());
+  if (stmt) {
+    sqlite3_bind_int(stmt, 1, limit);
+    request_schema::ReadRows<RowProjection>(stmt, &requests);
+    sqlite3_reset(stmt);
+  }
+  return requests;
+}
+
+#endif  // BLOCKED_REQUEST_SCHEMA_H_
@@ -0,0 +1,1038 @@
+#include "bulk_importer.h"
+#include "blocked_request_db.h"
+#include "blocked_request_schema.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sqlite3.h>
+#include <string_view>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// schema_meta中的键：导入进度按输入文件分别记录；
+// 被删除的索引和URL索引在导入完成并重建前一直记录在案，中断后重新运行时据此恢复
+const char kProgressKeyPrefix[] = "bulk_import:";
+const char kPendingIndexesKey[] = "bulk_import_indexes";
+const char kPendingUrlSearchKey[] = "bulk_import_url_search";
+
+// 待重建索引的序列化：记录之间用\x1e分隔，名称与SQL之间用\x1f分隔
+const char kRecordSeparator = '\x1e';
+const char kFieldSeparator = '\x1f';
+
+using request_schema::InsertRow;
+
+// 写入列与BlockedRequestDB一致，另外保留归档中的上报状态
+constexpr auto kImportInsertSQL =
+    "INSERT INTO blocked_requests (" + InsertRow::kColumnList + ", reported) VALUES (" +
+    InsertRow::kPlaceholders + ", ?)";
+constexpr int kReportedIndex = static_cast<int>(InsertRow::kColumnCount) + 1;
+
+const char kSelectIndexesSQL[] =
+    "SELECT name, sql FROM sqlite_master "
+    "WHERE type = 'index' AND tbl_name = 'blocked_requests' AND sql IS NOT NULL";
+
+const char kSelectMetaSQL[] = "SELECT value FROM schema_meta WHERE key = ?";
+const char kUpsertMetaSQL[] = "INSERT OR REPLACE INTO schema_meta (key, value) VALUES (?, ?)";
+const char kDeleteMetaSQL[] = "DELETE FROM schema_meta WHERE key = ?";
+
+// 解析结果中的字符串位置，指向ParsedChunk::storage
+struct Span {
+    uint32_t offset = 0;
+    uint32_t size = 0;
+};
+
+struct ImportRow {
+    Span url;
+    Span host;
+    Span reason;
+    Span browser_id;
+    Span country;
+    int64_t timestamp = 0;
+    int64_t tab_id = 0;
+    bool reported = false;
+};
+
+enum class Field {
+    kUnknown, kUrl, kHost, kReason, kTimestamp, kBrowserId, kTabId, kReported, kCountry
+};
+
+Field FieldFromName(std::string_view name) {
+    if (name == "url") return Field::kUrl;
+    if (name == "host") return Field::kHost;
+    if (name == "reason") return Field::kReason;
+    if (name == "timestamp") return Field::kTimestamp;
+    if (name == "browser_id") return Field::kBrowserId;
+    if (name == "tab_id") return Field::kTabId;
+    if (name == "reported") return Field::kReported;
+    if (name == "country") return Field::kCountry;
+    return Field::kUnknown;
+}
+
+struct RawChunk {
+    uint64_t index = 0;
+    int64_t end_offset = 0;     // 块末尾在文件中的偏移
+    std::string text;           // 完整的若干行
+};
+
+struct ParsedChunk {
+    int64_t end_offset = 0;
+    int64_t bytes = 0;
+    int64_t bad_lines = 0;
+    std::string storage;        // 解码后的字符串，行内字段以Span引用
+    std::vector<ImportRow> rows;
+};
+
+// ---------------------------------------------------------------------------
+// 字段解析
+
+bool ParseInteger(std::string_view text, int64_t* value) {
+    if (text.empty()) return false;
+    size_t i = 0;
+    bool negative = text[0] == '-';
+    if (negative || text[0] == '+') ++i;
+    if (i == text.size()) return false;
+
+    int64_t result = 0;
+    bool integral = true;
+    for (size_t j = i; j < text.size(); ++j) {
+        char c = text[j];
+        if (c < '0' || c > '9' || result > (INT64_MAX - 9) / 10) {
+            integral = false;
+            break;
+        }
+        result = result * 10 + (c - '0');
+    }
+    if (integral) {
+        *value = negative ? -result : result;
+        return true;
+    }
+
+    // 小数或科学计数法（如1.7e12）按浮点解析后取整
+    std::string copy(text);
+    char* end = nullptr;
+    double number = std::strtod(copy.c_str(), &end);
+    if (end != copy.c_str() + copy.size() || !std::isfinite(number) ||
+        std::fabs(number) >= 9.2e18) {
+        return false;
+    }
+    *value = std::llround(number);
+    return true;
+}
+
+bool ParseBool(std::string_view text, bool* value) {
+    if (text == "true" || text == "1") {
+        *value = true;
+        return true;
+    }
+    if (text == "false" || text == "0" || text.empty()) {
+        *value = false;
+        return true;
+    }
+    return false;
+}
+
+// 从url中取出host：scheme之后到第一个'/'、'?'、'#'或端口号为止，跳过userinfo
+Span HostFromUrl(const std::string& storage, Span url) {
+    std::string_view text(storage.data() + url.offset, url.size);
+    size_t begin = text.find("://");
+    begin = begin == std::string_view::npos ? 0 : begin + 3;
+    size_t end = text.find_first_of("/?#", begin);
+    if (end == std::string_view::npos) end = text.size();
+    size_t at = text.rfind('@', end);
+    if (at != std::string_view::npos && at >= begin) begin = at + 1;
+    size_t colon = text.find(':', begin);
+    if (colon != std::string_view::npos && colon < end) end = colon;
+    return Span{static_cast<uint32_t>(url.offset + begin), static_cast<uint32_t>(end - begin)};
+}
+
+void AppendUtf8(uint32_t code_point, std::string* out) {
+    if (code_point < 0x80) {
+        out->push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+        out->push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+        out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else if (code_point < 0x10000) {
+        out->push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+        out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else {
+        out->push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+        out->push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+        out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+}
+
+bool ParseHex4(const char* p, const char* end, uint32_t* value) {
+    if (end - p < 4) return false;
+    uint32_t result = 0;
+    for (int i = 0; i < 4; ++i) {
+        char c = p[i];
+        result <<= 4;
+        if (c >= '0' && c <= '9') result |= c - '0';
+        else if (c >= 'a' && c <= 'f') result |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') result |= c - 'A' + 10;
+        else return false;
+    }
+    *value = result;
+    return true;
+}
+
+// 逐行解析器，每个解析线程一个
+class RowParser {
+public:
+    RowParser(BulkImporter::Format format, std::vector<Field> csv_columns)
+        : format_(format), csv_columns_(std::move(csv_columns)) {}
+
+    void Parse(const std::string& text, ParsedChunk* chunk) {
+        chunk->storage.clear();
+        chunk->storage.reserve(text.size());
+        chunk->rows.clear();
+        chunk->rows.reserve(text.size() / 128 + 1);
+
+        size_t begin = 0;
+        while (begin < text.size()) {
+            size_t end = text.find('\n', begin);
+            if (end == std::string::npos) end = text.size();
+            std::string_view line(text.data() + begin, end - begin);
+            begin = end + 1;
+
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (line.find_first_not_of(" \t") == std::string_view::npos) continue;
+
+            size_t mark = chunk->storage.size();
+            ImportRow row;
+            bool ok = format_ == BulkImporter::Format::kCsv ? ParseCsvLine(line, chunk, &row)
+                                                            : ParseJsonLine(line, chunk, &row);
+            if (ok) {
+                chunk->rows.push_back(row);
+            } else {
+                chunk->storage.resize(mark);
+                ++chunk->bad_lines;
+            }
+        }
+    }
+
+private:
+    struct Seen {
+        bool url = false;
+        bool host = false;
+        bool timestamp = false;
+    };
+
+    // 字符串字段已追加到storage末尾[offset, size)，按字段名赋值
+    bool AssignString(Field field, Span value, const std::string& storage, ImportRow* row,
+                      Seen* seen) {
+        std::string_view text(storage.data() + value.offset, value.size);
+        switch (field) {
+            case Field::kUrl:
+                row->url = value;
+                seen->url = !text.empty();
+                return true;
+            case Field::kHost:
+                row->host = value;
+                seen->host = !text.empty();
+                return true;
+            case Field::kReason:
+                row->reason = value;
+                return true;
+            case Field::kBrowserId:
+                row->browser_id = value;
+                return true;
+            case Field::kCountry:
+                row->country = value;
+                return true;
+            case Field::kTimestamp:
+                seen->timestamp = ParseInteger(text, &row->timestamp);
+                return seen->timestamp;
+            case Field::kTabId:
+                return text.empty() || ParseInteger(text, &row->tab_id);
+            case Field::kReported:
+                return ParseBool(text, &row->reported);
+            case Field::kUnknown:
+                return true;
+        }
+        return true;
+    }
+
+    bool Finish(const Seen& seen, const std::string& storage, ImportRow* row) {
+        if (!seen.url || !seen.timestamp) return false;
+        if (!seen.host) row->host = HostFromUrl(storage, row->url);
+        return true;
+    }
+
+    // ---- NDJSON ----
+
+    static void SkipSpace(const char*& p, const char* end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) ++p;
+    }
+
+    // 解析以'"'开头的字符串，解码后追加到out
+    static bool ParseJsonString(const char*& p, const char* end, std::string* out) {
+        if (p == end || *p != '"') return false;
+        ++p;
+        while (p < end) {
+            // 连续的普通字符一次追加
+            const char* run = p;
+            while (p < end && *p != '"' && *p != '\\') ++p;
+            out->append(run, p - run);
+            if (p == end) return false;
+            if (*p == '"') {
+                ++p;
+                return true;
+            }
+
+            ++p;  // 反斜杠
+            if (p == end) return false;
+            char c = *p++;
+            switch (c) {
+                case '"': out->push_back('"'); break;
+                case '\\': out->push_back('\\'); break;
+                case '/': out->push_back('/'); break;
+                case 'b': out->push_back('\b'); break;
+                case 'f': out->push_back('\f'); break;
+                case 'n': out->push_back('\n'); break;
+                case 'r': out->push_back('\r'); break;
+                case 't': out->push_back('\t'); break;
+                case 'u': {
+                    uint32_t code_point = 0;
+                    if (!ParseHex4(p, end, &code_point)) return false;
+                    p += 4;
+                    if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+                        uint32_t low = 0;
+                        if (end - p < 6 || p[0] != '\\' || p[1] != 'u' ||
+                            !ParseHex4(p + 2, end, &low) || low < 0xDC00 || low > 0xDFFF) {
+                            return false;
+                        }
+                        p += 6;
+                        code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                    } else if (code_point >= 0xDC00 && code_point <= 0xDFFF) {
+                        return false;
+                    }
+                    AppendUtf8(code_point, out);
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        return false;
+    }
+
+    // 数字、true/false/null：到分隔符为止的原文
+    static std::string_view ParseJsonScalar(const char*& p, const char* end) {
+        const char* begin = p;
+        while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\t' &&
+               *p != '\r') {
+            ++p;
+        }
+        return std::string_view(begin, p - begin);
+    }
+
+    // 跳过任意值（包括嵌套的对象和数组）
+    bool SkipJsonValue(const char*& p, const char* end) {
+        if (p == end) return false;
+        if (*p == '"') {
+            scratch_.clear();
+            return ParseJsonString(p, end, &scratch_);
+        }
+        if (*p != '{' && *p != '[') {
+            return !ParseJsonScalar(p, end).empty();
+        }
+
+        int depth = 0;
+        while (p < end) {
+            char c = *p;
+            if (c == '"') {
+                scratch_.clear();
+                if (!ParseJsonString(p, end, &scratch_)) return false;
+                continue;
+            }
+            ++p;
+            if (c == '{' || c == '[') {
+                ++depth;
+            } else if (c == '}' || c == ']') {
+                if (--depth == 0) return true;
+            }
+        }
+        return false;
+    }
+
+    bool ParseJsonLine(std::string_view line, ParsedChunk* chunk, ImportRow* row) {
+        const char* p = line.data();
+        const char* end = p + line.size();
+        std::string& storage = chunk->storage;
+        Seen seen;
+
+        SkipSpace(p, end);
+        if (p == end || *p != '{') return false;
+        ++p;
+        SkipSpace(p, end);
+        if (p < end && *p == '}') return false;
+
+        while (true) {
+            SkipSpace(p, end);
+            key_.clear();
+            if (!ParseJsonString(p, end, &key_)) return false;
+            SkipSpace(p, end);
+            if (p == end || *p != ':') return false;
+            ++p;
+            SkipSpace(p, end);
+            if (p == end) return false;
+
+            Field field = FieldFromName(key_);
+            if (field == Field::kUnknown) {
+                if (!SkipJsonValue(p, end)) return false;
+            } else if (*p == '"') {
+                size_t offset = storage.size();
+                if (!ParseJsonString(p, end, &storage)) return false;
+                Span value{static_cast<uint32_t>(offset),
+                           static_cast<uint32_t>(storage.size() - offset)};
+                if (!AssignString(field, value, storage, row, &seen)) return false;
+            } else {
+                std::string_view scalar = ParseJsonScalar(p, end);
+                if (!AssignScalar(field, scalar, row, &seen)) return false;
+            }
+
+            SkipSpace(p, end);
+            if (p == end) return false;
+            if (*p == ',') {
+                ++p;
+                continue;
+            }
+            if (*p != '}') return false;
+            ++p;
+            break;
+        }
+
+        SkipSpace(p, end);
+        return p == end && Finish(seen, storage, row);
+    }
+
+    // 非字符串的值：数字、布尔、null
+    static bool AssignScalar(Field field, std::string_view text, ImportRow* row, Seen* seen) {
+        if (text == "null") return field != Field::kUrl && field != Field::kTimestamp;
+        switch (field) {
+            case Field::kTimestamp:
+                seen->timestamp = ParseInteger(text, &row->timestamp);
+                return seen->timestamp;
+            case Field::kTabId:
+                return ParseInteger(text, &row->tab_id);
+            case Field::kReported:
+                return ParseBool(text, &row->reported);
+            default:
+                // 文本字段不接受数字等非字符串值
+                return false;
+        }
+    }
+
+    // ---- CSV ----
+
+    // 解析一个字段，解码后追加到storage；p停在分隔符或行尾
+    static bool ParseCsvField(const char*& p, const char* end, std::string* storage) {
+        if (p < end && *p == '"') {
+            ++p;
+            while (true) {
+                const char* run = p;
+                while (p < end && *p != '"') ++p;
+                storage->append(run, p - run);
+                if (p == end) return false;  // 引号未闭合（字段不能跨行）
+                ++p;
+                if (p < end && *p == '"') {
+                    storage->push_back('"');
+                    ++p;
+                    continue;
+                }
+                break;
+            }
+            return p == end || *p == ',';
+        }
+
+        const char* run = p;
+        while (p < end && *p != ',') ++p;
+        storage->append(run, p - run);
+        return true;
+    }
+
+    bool ParseCsvLine(std::string_view line, ParsedChunk* chunk, ImportRow* row) {
+        const char* p = line.data();
+        const char* end = p + line.size();
+        std::string& storage = chunk->storage;
+        Seen seen;
+
+        for (size_t column = 0;; ++column) {
+            size_t offset = storage.size();
+            if (!ParseCsvField(p, end, &storage)) return false;
+            Field field = column < csv_columns_.size() ? csv_columns_[column] : Field::kUnknown;
+            Span value{static_cast<uint32_t>(offset),
+                       static_cast<uint32_t>(storage.size() - offset)};
+            if (field == Field::kUnknown) {
+                storage.resize(offset);
+            } else if (!AssignString(field, value, storage, row, &seen)) {
+                return false;
+            }
+            if (p == end) break;
+            ++p;  // 逗号
+        }
+        return Finish(seen, storage, row);
+    }
+
+    BulkImporter::Format format_;
+    std::vector<Field> csv_columns_;
+    std::string key_;
+    std::string scratch_;
+
+    friend bool ParseCsvHeader(std::string_view line, std::vector<Field>* columns);
+};
+
+bool ParseCsvHeader(std::string_view line, std::vector<Field>* columns) {
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    const char* p = line.data();
+    const char* end = p + line.size();
+    std::string name;
+    bool has_url = false;
+    bool has_timestamp = false;
+    while (true) {
+        name.clear();
+        if (!RowParser::ParseCsvField(p, end, &name)) return false;
+        size_t first = name.find_first_not_of(" \t");
+        size_t last = name.find_last_not_of(" \t");
+        Field field = first == std::string::npos
+                          ? Field::kUnknown
+                          : FieldFromName(std::string_view(name).substr(first, last - first + 1));
+        has_url = has_url || field == Field::kUrl;
+        has_timestamp = has_timestamp || field == Field::kTimestamp;
+        columns->push_back(field);
+        if (p == end) break;
+        ++p;
+    }
+    return has_url && has_timestamp;
+}
+
+// ---------------------------------------------------------------------------
+// 读-解析-写流水线
+
+struct Pipeline {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<RawChunk> raw;
+    std::map<uint64_t, std::unique_ptr<ParsedChunk>> parsed;
+    uint64_t chunks_read = 0;       // 已切出的块数
+    uint64_t chunks_written = 0;    // 已写入的块数
+    bool reader_done = false;
+    bool abort = false;
+    std::string read_error;
+};
+
+bool ReadSome(int fd, std::string* text, size_t want, bool* eof) {
+    size_t old_size = text->size();
+    text->resize(old_size + want);
+    while (true) {
+        ssize_t n = read(fd, &(*text)[old_size], want);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            text->resize(old_size);
+            return false;
+        }
+        text->resize(old_size + static_cast<size_t>(n));
+        *eof = n == 0;
+        return true;
+    }
+}
+
+// 从offset开始按行边界切块；超过max_in_flight个块未写入时等待
+void ReadChunks(int fd, int64_t offset, size_t chunk_bytes, size_t max_in_flight,
+                Pipeline* pipeline) {
+    std::string carry;
+    bool eof = false;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(pipeline->mutex);
+            pipeline->cv.wait(lock, [&] {
+                return pipeline->abort ||
+                       pipeline->chunks_read - pipeline->chunks_written < max_in_flight;
+            });
+            if (pipeline->abort) return;
+        }
+
+        std::string text;
+        text.swap(carry);
+        // 至少读满chunk_bytes，并且包含一个换行（单行超过块大小时继续读）
+        while (!eof && (text.size() < chunk_bytes || text.rfind('\n') == std::string::npos)) {
+            size_t want = text.size() < chunk_bytes ? chunk_bytes - text.size() : chunk_bytes;
+            if (!ReadSome(fd, &text, want, &eof)) {
+                std::lock_guard<std::mutex> lock(pipeline->mutex);
+                pipeline->read_error = std::string("读取输入失败: ") + std::strerror(errno);
+                pipeline->abort = true;
+                pipeline->cv.notify_all();
+                return;
+            }
+        }
+        if (!eof) {
+            size_t cut = text.rfind('\n') + 1;
+            carry.assign(text, cut, std::string::npos);
+            text.resize(cut);
+        }
+
+        std::lock_guard<std::mutex> lock(pipeline->mutex);
+        if (text.empty()) {
+            pipeline->reader_done = true;
+            pipeline->cv.notify_all();
+            return;
+        }
+        offset += static_cast<int64_t>(text.size());
+        RawChunk chunk;
+        chunk.index = pipeline->chunks_read++;
+        chunk.end_offset = offset;
+        chunk.text = std::move(text);
+        pipeline->raw.push_back(std::move(chunk));
+        pipeline->cv.notify_all();
+    }
+}
+
+void ParseChunks(RowParser parser, Pipeline* pipeline) {
+    while (true) {
+        RawChunk raw;
+        {
+            std::unique_lock<std::mutex> lock(pipeline->mutex);
+            pipeline->cv.wait(lock, [&] {
+                return pipeline->abort || !pipeline->raw.empty() || pipeline->reader_done;
+            });
+            if (pipeline->abort || pipeline->raw.empty()) return;
+            raw = std::move(pipeline->raw.front());
+            pipeline->raw.pop_front();
+        }
+
+        auto chunk = std::make_unique<ParsedChunk>();
+        parser.Parse(raw.text, chunk.get());
+        chunk->end_offset = raw.end_offset;
+        chunk->bytes = static_cast<int64_t>(raw.text.size());
+
+        std::lock_guard<std::mutex> lock(pipeline->mutex);
+        pipeline->parsed.emplace(raw.index, std::move(chunk));
+        pipeline->cv.notify_all();
+    }
+}
+
+// ---------------------------------------------------------------------------
+// 数据库辅助
+
+bool Exec(sqlite3* db, const char* sql, std::string* error) {
+    char* message = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &message) == SQLITE_OK) {
+        return true;
+    }
+    *error = std::string(sql) + ": " + (message ? message : sqlite3_errmsg(db));
+    sqlite3_free(message);
+    return false;
+}
+
+bool ReadMeta(sqlite3* db, const std::string& key, std::string* value) {
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, kSelectMetaSQL, -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, key.data(), static_cast<int>(key.size()), SQLITE_STATIC);
+    bool found = sqlite3_step(stmt) == SQLITE_ROW;
+    if (found) {
+        const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        value->assign(text ? text : "");
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+bool WriteMeta(sqlite3* db, const std::string& key, const std::string* value) {
+    sqlite3_stmt* stmt = nullptr;
+    const char* sql = value ? kUpsertMetaSQL : kDeleteMetaSQL;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, key.data(), static_cast<int>(key.size()), SQLITE_STATIC);
+    if (value) {
+        sqlite3_bind_text(stmt, 2, value->data(), static_cast<int>(value->size()),
+                          SQLITE_STATIC);
+    }
+    bool success = sqlite3_step(stmt) == SQLITE_DONE;
+    sqlite3_finalize(stmt);
+    return success;
+}
+
+using IndexList = std::vector<std::pair<std::string, std::string>>;
+
+void DecodeIndexes(const std::string& text, IndexList* indexes) {
+    size_t begin = 0;
+    while (begin < text.size()) {
+        size_t end = text.find(kRecordSeparator, begin);
+        if (end == std::string::npos) end = text.size();
+        std::string record = text.substr(begin, end - begin);
+        size_t split = record.find(kFieldSeparator);
+        if (split != std::string::npos) {
+            indexes->emplace_back(record.substr(0, split), record.substr(split + 1));
+        }
+        begin = end + 1;
+    }
+}
+
+std::string EncodeIndexes(const IndexList& indexes) {
+    std::string text;
+    for (const auto& index : indexes) {
+        if (!text.empty()) text.push_back(kRecordSeparator);
+        text += index.first;
+        text.push_back(kFieldSeparator);
+        text += index.second;
+    }
+    return text;
+}
+
+bool ListIndexes(sqlite3* db, IndexList* indexes) {
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, kSelectIndexesSQL, -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        indexes->emplace_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)),
+                              reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)));
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+std::string QuoteIdentifier(const std::string& name) {
+    std::string quoted = "\"";
+    for (char c : name) {
+        if (c == '"') quoted.push_back('"');
+        quoted.push_back(c);
+    }
+    quoted.push_back('"');
+    return quoted;
+}
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+BulkImporter::BulkImporter() : BulkImporter(Options()) {}
+
+BulkImporter::BulkImporter(const Options& options) : options_(options) {
+    options_.chunk_bytes = std::clamp<size_t>(options_.chunk_bytes, 4096, 256u << 20);
+    options_.rows_per_transaction = std::max<size_t>(options_.rows_per_transaction, 1);
+    if (options_.parser_threads == 0) {
+        options_.parser_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+bool BulkImporter::Import(const std::string& db_path, const std::string& input_path,
+                          Result* result) {
+    *result = Result();
+
+    // 以规范化路径区分不同输入的进度
+    char resolved[PATH_MAX];
+    if (!realpath(input_path.c_str(), resolved)) {
+        result->error = "无法打开输入文件: " + input_path;
+        return false;
+    }
+    const std::string progress_key = std::string(kProgressKeyPrefix) + resolved;
+
+    int fd = open(resolved, O_RDONLY);
+    if (fd < 0) {
+        result->error = "无法打开输入文件: " + input_path;
+        return false;
+    }
+    struct FdCloser {
+        int fd;
+        ~FdCloser() { close(fd); }
+    } fd_closer{fd};
+
+    // 确定格式；CSV需要表头，从断点继续时同样从文件开头读取
+    std::string head;
+    bool head_eof = false;
+    while (!head_eof && head.find('\n') == std::string::npos && head.size() < (1 << 20)) {
+        if (!ReadSome(fd, &head, 64 * 1024, &head_eof)) {
+            result->error = std::string("读取输入失败: ") + std::strerror(errno);
+            return false;
+        }
+    }
+    Format format = options_.format;
+    if (format == Format::kAuto) {
+        size_t first = head.find_first_not_of(" \t\r\n");
+        format = first != std::string::npos && head[first] == '{' ? Format::kNdjson : Format::kCsv;
+    }
+    std::vector<Field> csv_columns;
+    int64_t data_start = 0;
+    if (format == Format::kCsv) {
+        size_t newline = head.find('\n');
+        std::string_view header(head.data(), newline == std::string::npos ? head.size() : newline);
+        if (!ParseCsvHeader(header, &csv_columns)) {
+            result->error = "CSV表头无效，至少需要url和timestamp列";
+            return false;
+        }
+        data_start = newline == std::string::npos ? static_cast<int64_t>(head.size())
+                                                  : static_cast<int64_t>(newline + 1);
+    }
+
+    // 用BlockedRequestDB建表，记录并关闭URL索引
+    BlockedRequestDB schema_db;
+    if (!schema_db.Initialize(db_path)) {
+        result->error = "无法初始化数据库: " + db_path;
+        return false;
+    }
+
+    sqlite3* db = nullptr;
+    if (sqlite3_open_v2(db_path.c_str(), &db, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK) {
+        sqlite3_close(db);
+        result->error = "无法打开数据库: " + db_path;
+        return false;
+    }
+    struct DbCloser {
+        sqlite3* db;
+        ~DbCloser() { sqlite3_close(db); }
+    } db_closer{db};
+    sqlite3_exec(db, "PRAGMA busy_timeout=5000;", nullptr, nullptr, nullptr);
+
+    std::string value;
+    int64_t offset = data_start;
+    if (ReadMeta(db, progress_key, &value)) {
+        offset = std::max<int64_t>(offset, std::strtoll(value.c_str(), nullptr, 10));
+    }
+    result->resumed_from = offset > data_start ? offset : 0;
+
+    // 删除二级索引：与之前中断时记录的合并后写入schema_meta，再删除，同一事务内完成
+    IndexList pending;
+    if (ReadMeta(db, kPendingIndexesKey, &value)) {
+        DecodeIndexes(value, &pending);
+    }
+    IndexList existing;
+    if (!ListIndexes(db, &existing)) {
+        result->error = std::string("读取索引失败: ") + sqlite3_errmsg(db);
+        return false;
+    }
+    for (const auto& index : existing) {
+        bool known = std::any_of(pending.begin(), pending.end(),
+                                 [&](const auto& entry) { return entry.first == index.first; });
+        if (!known) pending.push_back(index);
+    }
+    bool url_search = schema_db.url_search_enabled() || ReadMeta(db, kPendingUrlSearchKey, &value);
+
+    if (!Exec(db, "BEGIN IMMEDIATE", &result->error)) {
+        return false;
+    }
+    std::string encoded = EncodeIndexes(pending);
+    std::string url_search_flag = "1";
+    bool prepared = WriteMeta(db, kPendingIndexesKey, &encoded) &&
+                    (!url_search || WriteMeta(db, kPendingUrlSearchKey, &url_search_flag));
+    for (const auto& index : existing) {
+        std::string drop_sql = "DROP INDEX IF EXISTS " + QuoteIdentifier(index.first);
+        prepared = prepared && Exec(db, drop_sql.c_str(), &result->error);
+    }
+    if (!prepared || !Exec(db, "COMMIT", &result->error)) {
+        if (result->error.empty()) result->error = sqlite3_errmsg(db);
+        sqlite3_exec(db, "ROLLBACK", nullptr, nullptr, nullptr);
+        return false;
+    }
+    if (schema_db.url_search_enabled() && !schema_db.SetUrlSearchEnabled(false)) {
+        result->error = "无法关闭URL索引";
+        return false;
+    }
+    schema_db.Close();
+
+    // 导入期间的连接设置；切换日志模式要求没有其他连接
+    if (options_.disable_journal && !Exec(db, "PRAGMA journal_mode=OFF", &result->error)) {
+        return false;
+    }
+    std::string cache_sql = "PRAGMA cache_size=-" + std::to_string(options_.cache_mb * 1024);
+    Exec(db, "PRAGMA synchronous=OFF", &result->error);
+    Exec(db, cache_sql.c_str(), &result->error);
+    Exec(db, "PRAGMA temp_store=MEMORY", &result->error);
+    result->error.clear();
+
+    sqlite3_stmt* insert = nullptr;
+    if (sqlite3_prepare_v2(db, kImportInsertSQL.c_str(), -1, &insert, nullptr) != SQLITE_OK) {
+        result->error = std::string("准备插入语句失败: ") + sqlite3_errmsg(db);
+        return false;
+    }
+
+    if (lseek(fd, offset, SEEK_SET) < 0) {
+        sqlite3_finalize(insert);
+        result->error = std::string("定位输入失败: ") + std::strerror(errno);
+        return false;
+    }
+
+    // 启动读线程和解析线程，当前线程作为唯一的写者
+    auto load_start = std::chrono::steady_clock::now();
+    Pipeline pipeline;
+    const size_t max_in_flight = options_.parser_threads * 2 + 2;
+    std::vector<std::thread> threads;
+    threads.emplace_back(ReadChunks, fd, offset, options_.chunk_bytes, max_in_flight, &pipeline);
+    for (size_t i = 0; i < options_.parser_threads; ++i) {
+        threads.emplace_back(ParseChunks, RowParser(format, csv_columns), &pipeline);
+    }
+
+    bool success = Exec(db, "BEGIN", &result->error);
+    bool in_transaction = success;
+    size_t rows_in_transaction = 0;
+    int64_t pending_rows = 0;
+    int64_t pending_bad_lines = 0;
+
+    auto commit = [&](int64_t end_offset) {
+        std::string progress = std::to_string(end_offset);
+        if (!WriteMeta(db, progress_key, &progress)) {
+            result->error = std::string("记录导入进度失败: ") + sqlite3_errmsg(db);
+            return false;
+        }
+        if (!Exec(db, "COMMIT", &result->error)) {
+            return false;
+        }
+        in_transaction = false;
+        result->rows_imported += pending_rows;
+        result->bad_lines += pending_bad_lines;
+        pending_rows = 0;
+        pending_bad_lines = 0;
+        rows_in_transaction = 0;
+        return true;
+    };
+
+    int64_t chunk_end = offset;
+    while (success) {
+        std::unique_ptr<ParsedChunk> chunk;
+        {
+            std::unique_lock<std::mutex> lock(pipeline.mutex);
+            pipeline.cv.wait(lock, [&] {
+                return pipeline.abort || pipeline.parsed.count(pipeline.chunks_written) > 0 ||
+                       (pipeline.reader_done && pipeline.chunks_written == pipeline.chunks_read);
+            });
+            if (pipeline.abort) {
+                result->error = pipeline.read_error;
+                success = false;
+                break;
+            }
+            auto it = pipeline.parsed.find(pipeline.chunks_written);
+            if (it == pipeline.parsed.end()) break;  // 全部写完
+            chunk = std::move(it->second);
+            pipeline.parsed.erase(it);
+        }
+
+        const char* storage = chunk->storage.data();
+        auto text = [storage](Span span) {
+            return std::string_view(storage + span.offset, span.size);
+        };
+        for (const ImportRow& row : chunk->rows) {
+            sqlite3_reset(insert);
+            BlockedRequestView request{text(row.url), text(row.host), text(row.reason),
+                                       row.timestamp, text(row.browser_id), row.tab_id,
+                                       {}, text(row.country)};
+            InsertRow::Bind(insert, request);
+            sqlite3_bind_int(insert, kReportedIndex, row.reported ? 1 : 0);
+            if (sqlite3_step(insert) != SQLITE_DONE) {
+                result->error = std::string("写入失败: ") + sqlite3_errmsg(db);
+                success = false;
+                break;
+            }
+        }
+        sqlite3_reset(insert);
+        if (!success) break;
+
+        rows_in_transaction += chunk->rows.size();
+        pending_rows += static_cast<int64_t>(chunk->rows.size());
+        pending_bad_lines += chunk->bad_lines;
+        result->bytes_read += chunk->bytes;
+        chunk_end = chunk->end_offset;
+        {
+            std::lock_guard<std::mutex> lock(pipeline.mutex);
+            ++pipeline.chunks_written;
+        }
+        pipeline.cv.notify_all();
+
+        if (rows_in_transaction >= options_.rows_per_transaction) {
+            success = commit(chunk_end);
+            if (success && stop_requested_) {
+                result->stopped = true;
+                break;
+            }
+            success = success && Exec(db, "BEGIN", &result->error);
+            in_transaction = success;
+        }
+    }
+
+    if (success && in_transaction) {
+        success = commit(chunk_end);
+    }
+    sqlite3_finalize(insert);
+
+    {
+        std::lock_guard<std::mutex> lock(pipeline.mutex);
+        pipeline.abort = true;
+    }
+    pipeline.cv.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    result->load_seconds = SecondsSince(load_start);
+
+    if (!success) {
+        // 关闭日志时回滚的行为未定义，只能放弃连接；数据库可能包含部分写入的数据
+        if (in_transaction && !options_.disable_journal) {
+            sqlite3_exec(db, "ROLLBACK", nullptr, nullptr, nullptr);
+        } else if (in_transaction) {
+            result->error += "（日志已关闭，数据库可能包含上次提交后的部分数据）";
+        }
+        return false;
+    }
+
+    // 恢复正常的日志模式，之后的重建在WAL事务内完成，中途失败可以安全回滚
+    if (!Exec(db, "PRAGMA journal_mode=WAL", &result->error) ||
+        !Exec(db, "PRAGMA synchronous=NORMAL", &result->error)) {
+        return false;
+    }
+    if (result->stopped) {
+        return true;
+    }
+
+    auto index_start = std::chrono::steady_clock::now();
+    if (!Exec(db, "BEGIN IMMEDIATE", &result->error)) {
+        return false;
+    }
+    bool rebuilt = true;
+    for (const auto& index : pending) {
+        std::string drop_sql = "DROP INDEX IF EXISTS " + QuoteIdentifier(index.first);
+        rebuilt = rebuilt && Exec(db, drop_sql.c_str(), &result->error) &&
+                  Exec(db, index.second.c_str(), &result->error);
+    }
+    rebuilt = rebuilt && WriteMeta(db, kPendingIndexesKey, nullptr);
+    if (!rebuilt || !Exec(db, "COMMIT", &result->error)) {
+        sqlite3_exec(db, "ROLLBACK", nullptr, nullptr, nullptr);
+        return false;
+    }
+
+    if (url_search) {
+        BlockedRequestDB url_db;
+        if (!url_db.Initialize(db_path) || !url_db.SetUrlSearchEnabled(true)) {
+            result->error = "重建URL索引失败";
+            return false;
+        }
+        url_db.Close();
+        if (!WriteMeta(db, kPendingUrlSearchKey, nullptr)) {
+            result->error = std::string("清除导入记录失败: ") + sqlite3_errmsg(db);
+            return false;
+        }
+    }
+    result->index_seconds = SecondsSince(index_start);
+    return true;
+}
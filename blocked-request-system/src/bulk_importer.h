@@ -0,0 +1,68 @@
+#ifndef BULK_IMPORTER_H_
+#define BULK_IMPORTER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// 历史数据批量导入
+// 从NDJSON或CSV归档文件把拦截记录直接写入SQLite数据库，不经过AddBlockedRequests：
+// - 导入期间关闭synchronous和日志（可选保留WAL），使用大事务
+// - 导入前删除blocked_requests上的二级索引和URL索引，结束后按原定义重建
+// - 一个读线程按行边界切块，多个线程并行解析，唯一的写线程按顺序写入
+// - 每个事务提交时在schema_meta中记录已导入的字节偏移，中断后重新运行从断点继续
+//
+// 导入需要独占数据库：期间不能有SmartBatchManager或写入代理在写入
+//
+// NDJSON每行一个对象，字段: url（必需）, timestamp（必需，毫秒）, host, reason,
+// browser_id, tab_id, reported, country；缺少host时从url中提取，其他字段被忽略
+// CSV第一行为表头，列名同上，列顺序任意；带引号的字段不能跨行
+class BulkImporter {
+public:
+    enum class Format {
+        kAuto,      // 首个非空白字符为'{'时按NDJSON，否则按CSV
+        kNdjson,
+        kCsv,
+    };
+
+    struct Options {
+        Format format = Format::kAuto;
+        size_t parser_threads = 0;                 // 0表示按CPU核数
+        size_t chunk_bytes = 4 << 20;              // 每个解析块的大小
+        size_t rows_per_transaction = 1000000;     // 达到后在块边界提交并记录进度
+        int64_t cache_mb = 256;                    // 导入连接的页缓存，重建索引时排序受益
+        // 关闭日志（journal_mode=OFF）时写入最快，但进程在事务中途崩溃可能损坏数据库；
+        // 为false时保留WAL，崩溃后可从上次提交的进度继续
+        bool disable_journal = true;
+    };
+
+    struct Result {
+        int64_t rows_imported = 0;      // 本次导入的行数
+        int64_t bad_lines = 0;          // 无法解析而跳过的行数
+        int64_t bytes_read = 0;         // 本次读取的字节数
+        int64_t resumed_from = 0;       // 开始时的字节偏移，>0表示从断点继续
+        double load_seconds = 0;        // 解析和写入耗时
+        double index_seconds = 0;       // 重建索引耗时
+        bool stopped = false;           // 因RequestStop()提前结束，索引保持删除状态
+        std::string error;              // 失败原因
+    };
+
+    BulkImporter();
+    explicit BulkImporter(const Options& options);
+
+    BulkImporter(const BulkImporter&) = delete;
+    BulkImporter& operator=(const BulkImporter&) = delete;
+
+    // 导入input_path，数据库不存在时创建；失败时返回false，原因见result->error
+    // 文件已全部导入过时不写入任何记录
+    bool Import(const std::string& db_path, const std::string& input_path, Result* result);
+
+    // 请求在当前事务提交后停止，可从任意线程调用
+    void RequestStop() { stop_requested_ = true; }
+
+private:
+    Options options_;
+    std::atomic<bool> stop_requested_{false};
+};
+
+#endif  // BULK_IMPORTER_H_
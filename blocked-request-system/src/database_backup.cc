@@ -0,0 +1,342 @@
+#include "database_backup.h"
+#include "blocked_request_schema.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <sqlite3.h>
+#include <unistd.h>
+
+namespace {
+
+// 页数翻倍到这个值以上时直接一步复制剩余页
+constexpr int kMaxPagesPerStep = 1 << 20;
+
+// 源库忙或被锁时至少等待这么久再重试，step_interval_ms为0时也不会空转
+constexpr int kBusyBackoffMs = 5;
+
+using request_schema::FullRow;
+
+// 增量备份：按id顺序追加高水位之后的一批记录，保留原id和上报状态
+constexpr auto kAppendRowsSQL =
+    "INSERT INTO main.blocked_requests (" + FullRow::kColumnList + ") SELECT " +
+    FullRow::kColumnList + " FROM src.blocked_requests WHERE id > ? ORDER BY id LIMIT ?";
+
+// 备份库带URL索引时为新追加的记录补上索引（写入路径直接写索引，没有插入触发器）
+const char kAppendUrlIndexSQL[] =
+    "INSERT INTO main.blocked_requests_url_fts (rowid, url) "
+    "SELECT id, url FROM main.blocked_requests WHERE id > ?";
+
+const char kHighWaterSQL[] = "SELECT COALESCE(MAX(id), 0) FROM main.blocked_requests";
+
+const char kUrlIndexExistsSQL[] =
+    "SELECT 1 FROM main.sqlite_master "
+    "WHERE type = 'table' AND name = 'blocked_requests_url_fts'";
+
+// 源库变化、全量备份重新开始后每步复制的页数：翻倍，超过max_restarts后直接取上限；
+// 没有上限时为-1，一步复制剩余页
+int GrowStepPages(int pages, int restarts, const BackupOptions& options) {
+    if (pages < 0) {
+        return pages;
+    }
+    if (options.max_pages_per_step <= 0) {
+        return (restarts > options.max_restarts || pages >= kMaxPagesPerStep) ? -1 : pages * 2;
+    }
+    if (restarts > options.max_restarts || pages >= options.max_pages_per_step / 2) {
+        return options.max_pages_per_step;
+    }
+    return pages * 2;
+}
+
+void RemoveDatabaseFiles(const std::string& path) {
+    unlink(path.c_str());
+    unlink((path + "-journal").c_str());
+    unlink((path + "-wal").c_str());
+    unlink((path + "-shm").c_str());
+}
+
+bool QueryInt64(sqlite3* db, const char* sql, int64_t* value) {
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+    bool ok = sqlite3_step(stmt) == SQLITE_ROW;
+    if (ok) {
+        *value = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+}  // namespace
+
+std::unique_ptr<DatabaseBackup> DatabaseBackup::Start(const std::string& source_path,
+                                                      const std::string& dest_path,
+                                                      const BackupOptions& options) {
+    std::unique_ptr<DatabaseBackup> backup(new DatabaseBackup(source_path, dest_path, options));
+    backup->thread_ = std::thread(&DatabaseBackup::Run, backup.get());
+    return backup;
+}
+
+DatabaseBackup::DatabaseBackup(const std::string& source_path, const std::string& dest_path,
+                               const BackupOptions& options)
+    : source_path_(source_path), dest_path_(dest_path), options_(options) {
+    if (options_.pages_per_step <= 0) {
+        options_.pages_per_step = 64;
+    }
+    if (options_.rows_per_step <= 0) {
+        options_.rows_per_step = 5000;
+    }
+}
+
+DatabaseBackup::~DatabaseBackup() {
+    Cancel();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool DatabaseBackup::Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    finished_cv_.wait(lock, [this] { return progress_.finished; });
+    return progress_.succeeded;
+}
+
+void DatabaseBackup::Cancel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cancelled_ = true;
+    cancel_cv_.notify_all();
+}
+
+DatabaseBackup::Progress DatabaseBackup::GetProgress() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return progress_;
+}
+
+void DatabaseBackup::Run() {
+    // 增量备份需要一个已有的基础备份，没有时先做全量
+    bool incremental = options_.incremental && access(dest_path_.c_str(), F_OK) == 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        progress_.incremental = incremental;
+    }
+
+    bool succeeded = incremental ? RunIncremental() : RunFull();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    progress_.finished = true;
+    progress_.succeeded = succeeded;
+    finished_cv_.notify_all();
+}
+
+bool DatabaseBackup::Throttle(int min_interval_ms) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    int interval_ms = std::max(options_.step_interval_ms, min_interval_ms);
+    if (interval_ms > 0) {
+        cancel_cv_.wait_for(lock, std::chrono::milliseconds(interval_ms),
+                            [this] { return cancelled_; });
+    }
+    return !cancelled_;
+}
+
+void DatabaseBackup::Fail(const std::string& error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    progress_.error = error;
+}
+
+bool DatabaseBackup::RunFull() {
+    const std::string temp_path = dest_path_ + ".tmp";
+    RemoveDatabaseFiles(temp_path);
+
+    sqlite3* source = nullptr;
+    sqlite3* dest = nullptr;
+    if (sqlite3_open_v2(source_path_.c_str(), &source, SQLITE_OPEN_READONLY, nullptr) !=
+        SQLITE_OK) {
+        Fail(std::string("打开源数据库失败: ") + sqlite3_errmsg(source));
+        sqlite3_close(source);
+        return false;
+    }
+    sqlite3_busy_timeout(source, 5000);
+
+    if (sqlite3_open_v2(temp_path.c_str(), &dest, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
+                        nullptr) != SQLITE_OK) {
+        Fail(std::string("创建备份文件失败: ") + sqlite3_errmsg(dest));
+        sqlite3_close(dest);
+        sqlite3_close(source);
+        return false;
+    }
+
+    sqlite3_backup* backup = sqlite3_backup_init(dest, "main", source, "main");
+    if (!backup) {
+        Fail(std::string("启动备份失败: ") + sqlite3_errmsg(dest));
+        sqlite3_close(dest);
+        sqlite3_close(source);
+        RemoveDatabaseFiles(temp_path);
+        return false;
+    }
+
+    int pages = options_.pages_per_step;
+    int restarts = 0;
+    int64_t copied_before = 0;
+    bool cancelled = false;
+    int result;
+    while (true) {
+        // 每步结束时释放源库上的读事务，写入和检查点不受影响
+        result = sqlite3_backup_step(backup, pages);
+        int64_t total = sqlite3_backup_pagecount(backup);
+        int64_t remaining = sqlite3_backup_remaining(backup);
+        int64_t copied = total - remaining;
+
+        // 源库被其他连接修改后，这一步从第一页重新开始
+        if (result == SQLITE_OK && copied_before > 0 && copied <= copied_before) {
+            restarts++;
+            pages = GrowStepPages(pages, restarts, options_);
+        }
+        copied_before = copied;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            progress_.total_pages = total;
+            progress_.remaining_pages = remaining;
+            progress_.steps++;
+            progress_.restarts = restarts;
+        }
+
+        if (result == SQLITE_DONE) {
+            break;
+        }
+        // 源库暂时被锁（如WAL恢复中）时稍后重试
+        bool busy = result == SQLITE_BUSY || result == SQLITE_LOCKED;
+        if (result != SQLITE_OK && !busy) {
+            break;
+        }
+        if (!Throttle(busy ? kBusyBackoffMs : 0)) {
+            cancelled = true;
+            break;
+        }
+    }
+
+    sqlite3_backup_finish(backup);
+    std::string error = sqlite3_errmsg(dest);
+    bool succeeded = result == SQLITE_DONE && !cancelled;
+    succeeded = sqlite3_close(dest) == SQLITE_OK && succeeded;
+    sqlite3_close(source);
+
+    if (!succeeded) {
+        Fail(cancelled ? std::string("备份已取消") : "备份失败: " + error);
+        RemoveDatabaseFiles(temp_path);
+        return false;
+    }
+
+    // 旧备份残留的WAL不能应用到新文件上
+    unlink((dest_path_ + "-wal").c_str());
+    unlink((dest_path_ + "-shm").c_str());
+    if (std::rename(temp_path.c_str(), dest_path_.c_str()) != 0) {
+        Fail("备份文件改名失败");
+        RemoveDatabaseFiles(temp_path);
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseBackup::RunIncremental() {
+    sqlite3* dest = nullptr;
+    if (sqlite3_open_v2(dest_path_.c_str(), &dest, SQLITE_OPEN_READWRITE, nullptr) !=
+        SQLITE_OK) {
+        Fail(std::string("打开备份库失败: ") + sqlite3_errmsg(dest));
+        sqlite3_close(dest);
+        return false;
+    }
+    sqlite3_busy_timeout(dest, 5000);
+
+    // 源库作为附加库只读取；每批的读事务在提交时结束
+    sqlite3_stmt* attach = nullptr;
+    bool ok = sqlite3_prepare_v2(dest, "ATTACH DATABASE ? AS src", -1, &attach, nullptr) ==
+              SQLITE_OK;
+    if (ok) {
+        sqlite3_bind_text(attach, 1, source_path_.c_str(), -1, SQLITE_STATIC);
+        ok = sqlite3_step(attach) == SQLITE_DONE;
+    }
+    sqlite3_finalize(attach);
+
+    int64_t high_water = 0;
+    if (!ok || !QueryInt64(dest, kHighWaterSQL, &high_water)) {
+        Fail(std::string("备份库不可用: ") + sqlite3_errmsg(dest));
+        sqlite3_close(dest);
+        return false;
+    }
+    int64_t unused = 0;
+    bool has_url_index = QueryInt64(dest, kUrlIndexExistsSQL, &unused);
+
+    sqlite3_stmt* append_stmt = nullptr;
+    sqlite3_stmt* url_index_stmt = nullptr;
+    ok = sqlite3_prepare_v2(dest, kAppendRowsSQL.c_str(), -1, &append_stmt, nullptr) ==
+         SQLITE_OK;
+    if (ok && has_url_index) {
+        ok = sqlite3_prepare_v2(dest, kAppendUrlIndexSQL, -1, &url_index_stmt, nullptr) ==
+             SQLITE_OK;
+    }
+    if (!ok) {
+        Fail(std::string("准备增量备份语句失败: ") + sqlite3_errmsg(dest));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        progress_.high_water_mark = high_water;
+    }
+
+    bool cancelled = false;
+    while (ok) {
+        ok = sqlite3_exec(dest, "BEGIN IMMEDIATE", nullptr, nullptr, nullptr) == SQLITE_OK;
+        if (!ok) {
+            Fail(std::string("增量备份失败: ") + sqlite3_errmsg(dest));
+            break;
+        }
+
+        sqlite3_reset(append_stmt);
+        sqlite3_bind_int64(append_stmt, 1, high_water);
+        sqlite3_bind_int(append_stmt, 2, options_.rows_per_step);
+        ok = sqlite3_step(append_stmt) == SQLITE_DONE;
+        int64_t appended = ok ? sqlite3_changes(dest) : 0;
+
+        if (ok && url_index_stmt && appended > 0) {
+            sqlite3_reset(url_index_stmt);
+            sqlite3_bind_int64(url_index_stmt, 1, high_water);
+            ok = sqlite3_step(url_index_stmt) == SQLITE_DONE;
+        }
+
+        int64_t new_high_water = high_water;
+        ok = ok && QueryInt64(dest, kHighWaterSQL, &new_high_water);
+        ok = ok && sqlite3_exec(dest, "COMMIT", nullptr, nullptr, nullptr) == SQLITE_OK;
+        if (!ok) {
+            Fail(std::string("增量备份失败: ") + sqlite3_errmsg(dest));
+            sqlite3_exec(dest, "ROLLBACK", nullptr, nullptr, nullptr);
+            break;
+        }
+        high_water = new_high_water;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            progress_.rows_copied += appended;
+            progress_.high_water_mark = high_water;
+            progress_.steps++;
+        }
+
+        if (appended < options_.rows_per_step) {
+            break;
+        }
+        if (!Throttle(0)) {
+            Fail("备份已取消");
+            cancelled = true;
+            break;
+        }
+    }
+
+    sqlite3_finalize(append_stmt);
+    sqlite3_finalize(url_index_stmt);
+    if (sqlite3_close(dest) != SQLITE_OK) {
+        ok = false;
+    }
+    // 取消时已提交的批次保留，下次从新的高水位继续
+    return ok && !cancelled;
+}
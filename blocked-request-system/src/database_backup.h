@@ -0,0 +1,92 @@
+#ifndef DATABASE_BACKUP_H_
+#define DATABASE_BACKUP_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// 拦截记录数据库的在线备份
+// 在后台线程上用独立的连接读取源库，写入方（SmartBatchManager、写入代理）不需要停止：
+// - 全量备份使用SQLite在线备份接口，每步只复制pages_per_step页，两步之间释放读事务，
+//   WAL检查点可以照常推进；源库被其他连接修改时从头重新复制，
+//   每次重新开始把每步页数翻倍，超过max_restarts后取max_pages_per_step；
+//   没有设置上限时一步复制剩余页，这一步在整个复制期间持有读事务，
+//   检查点不能越过它读取的快照，期间的写入使WAL持续增长
+// - 源库忙或被锁时按step_interval_ms重试，间隔至少5ms
+// - 增量备份按id高水位把新记录追加到已有的备份库，每批一个短事务；
+//   只追加新记录，已备份记录的上报状态变化和删除不会同步，需要定期做全量备份
+// 全量备份先写入dest_path + ".tmp"，成功后改名，失败或取消时不会留下不完整的备份
+struct BackupOptions {
+    bool incremental = false;          // 备份库不存在时退化为全量备份
+    int pages_per_step = 64;           // 全量备份每步复制的页数
+    int rows_per_step = 5000;          // 增量备份每批追加的行数
+    int step_interval_ms = 10;         // 两步之间的间隔，限制备份占用的I/O
+    int max_restarts = 4;              // 超过后每步页数直接取上限
+    int max_pages_per_step = 0;        // 每步页数上限，<=0为不限（一步复制剩余页）；
+                                       // 设置后每步持有读事务的时间有界，但源库持续
+                                       // 写入且大于上限时备份可能一直重新开始
+};
+
+class DatabaseBackup {
+public:
+    struct Progress {
+        int64_t total_pages = 0;       // 全量备份：源库页数
+        int64_t remaining_pages = 0;   // 全量备份：剩余页数
+        int64_t rows_copied = 0;       // 增量备份：本次追加的行数
+        int64_t high_water_mark = 0;   // 增量备份：备份库中最大的id
+        int steps = 0;
+        int restarts = 0;              // 因源库变化重新开始的次数
+        bool incremental = false;      // 实际执行的是否为增量备份
+        bool finished = false;
+        bool succeeded = false;
+        std::string error;
+    };
+
+    // 启动后台备份，source_path为正在使用的数据库文件
+    static std::unique_ptr<DatabaseBackup> Start(const std::string& source_path,
+                                                 const std::string& dest_path,
+                                                 const BackupOptions& options);
+
+    // 析构时取消未完成的备份并等待线程退出
+    ~DatabaseBackup();
+
+    DatabaseBackup(const DatabaseBackup&) = delete;
+    DatabaseBackup& operator=(const DatabaseBackup&) = delete;
+
+    // 等待备份结束，返回是否成功
+    bool Wait();
+
+    // 请求在当前一步结束后停止，可从任意线程调用
+    void Cancel();
+
+    Progress GetProgress() const;
+
+private:
+    DatabaseBackup(const std::string& source_path, const std::string& dest_path,
+                   const BackupOptions& options);
+
+    void Run();
+    bool RunFull();
+    bool RunIncremental();
+
+    // 按step_interval_ms等待，至少等待min_interval_ms，被取消时返回false
+    bool Throttle(int min_interval_ms);
+
+    void Fail(const std::string& error);
+
+    std::string source_path_;
+    std::string dest_path_;
+    BackupOptions options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cancel_cv_;
+    std::condition_variable finished_cv_;
+    bool cancelled_ = false;
+    Progress progress_;
+    std::thread thread_;
+};
+
+#endif  // DATABASE_BACKUP_H_
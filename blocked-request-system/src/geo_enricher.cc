@@ -0,0 +1,239 @@
+#include "geo_enricher.h"
+#include <arpa/inet.h>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#ifdef HAVE_MAXMINDDB
+#include "maxminddb.h"
+#endif
+
+bool IpAddress::Parse(std::string_view text, IpAddress* address) {
+    // inet_pton需要以\0结尾，最长的IPv6文本为45个字符
+    char buffer[INET6_ADDRSTRLEN + 1];
+    if (text.empty() || text.size() >= sizeof(buffer)) {
+        return false;
+    }
+    std::memcpy(buffer, text.data(), text.size());
+    buffer[text.size()] = '\0';
+
+    IpAddress parsed;
+    if (inet_pton(AF_INET, buffer, parsed.bytes + 12) == 1) {
+        parsed.bytes[10] = 0xff;
+        parsed.bytes[11] = 0xff;
+        parsed.is_v4 = true;
+    } else if (inet_pton(AF_INET6, buffer, parsed.bytes) != 1) {
+        return false;
+    }
+    *address = parsed;
+    return true;
+}
+
+#ifdef HAVE_MAXMINDDB
+
+namespace {
+
+class MaxMindResolver : public GeoResolver {
+public:
+    ~MaxMindResolver() override {
+        if (opened_) {
+            MMDB_close(&mmdb_);
+        }
+    }
+
+    bool Open(const std::string& path, std::string* error) {
+        int status = MMDB_open(path.c_str(), MMDB_MODE_MMAP, &mmdb_);
+        if (status != MMDB_SUCCESS) {
+            if (error) *error = MMDB_strerror(status);
+            return false;
+        }
+        opened_ = true;
+        return true;
+    }
+
+    bool Lookup(const IpAddress& address, std::string* country, int* prefix_length) override {
+        sockaddr_storage storage = {};
+        if (address.is_v4) {
+            auto* v4 = reinterpret_cast<sockaddr_in*>(&storage);
+            v4->sin_family = AF_INET;
+            std::memcpy(&v4->sin_addr, address.bytes + 12, 4);
+        } else {
+            auto* v6 = reinterpret_cast<sockaddr_in6*>(&storage);
+            v6->sin6_family = AF_INET6;
+            std::memcpy(&v6->sin6_addr, address.bytes, 16);
+        }
+
+        int mmdb_error = MMDB_SUCCESS;
+        MMDB_lookup_result_s result =
+            MMDB_lookup_sockaddr(&mmdb_, reinterpret_cast<sockaddr*>(&storage), &mmdb_error);
+        if (mmdb_error != MMDB_SUCCESS) {
+            return false;
+        }
+
+        // IPv4数据库的网段按32位计，换算到128位地址空间
+        *prefix_length = result.netmask;
+        if (mmdb_.metadata.ip_version == 4) {
+            *prefix_length += 96;
+        }
+        if (!result.found_entry) {
+            return false;
+        }
+
+        // 国家数据库和城市数据库都有country.iso_code；
+        // 没有country时（如卫星网络）退回registered_country
+        MMDB_entry_data_s entry_data;
+        int status = MMDB_get_value(&result.entry, &entry_data, "country", "iso_code", nullptr);
+        if (status != MMDB_SUCCESS || !entry_data.has_data) {
+            status = MMDB_get_value(&result.entry, &entry_data, "registered_country", "iso_code",
+                                    nullptr);
+        }
+        country->clear();
+        if (status == MMDB_SUCCESS && entry_data.has_data &&
+            entry_data.type == MMDB_DATA_TYPE_UTF8_STRING) {
+            country->assign(entry_data.utf8_string, entry_data.data_size);
+        }
+        return true;
+    }
+
+private:
+    MMDB_s mmdb_ = {};
+    bool opened_ = false;
+};
+
+}  // namespace
+
+std::unique_ptr<GeoResolver> OpenMaxMindResolver(const std::string& mmdb_path,
+                                                 std::string* error) {
+    auto resolver = std::make_unique<MaxMindResolver>();
+    if (!resolver->Open(mmdb_path, error)) {
+        return nullptr;
+    }
+    return resolver;
+}
+
+#else
+
+std::unique_ptr<GeoResolver> OpenMaxMindResolver(const std::string& mmdb_path,
+                                                 std::string* error) {
+    (void)mmdb_path;
+    if (error) *error = "未启用MaxMind支持";
+    return nullptr;
+}
+
+#endif  // HAVE_MAXMINDDB
+
+bool GeoEnricher::CacheKey::operator==(const CacheKey& other) const {
+    return prefix_length == other.prefix_length &&
+           std::memcmp(bytes, other.bytes, sizeof(bytes)) == 0;
+}
+
+size_t GeoEnricher::CacheKeyHash::operator()(const CacheKey& key) const {
+    uint64_t high;
+    uint64_t low;
+    std::memcpy(&high, key.bytes, 8);
+    std::memcpy(&low, key.bytes + 8, 8);
+    uint64_t hash = (high * 0x9E3779B97F4A7C15ULL) ^ (low + key.prefix_length);
+    hash ^= hash >> 29;
+    hash *= 0xBF58476D1CE4E5B9ULL;
+    return static_cast<size_t>(hash ^ (hash >> 32));
+}
+
+GeoEnricher::GeoEnricher(std::unique_ptr<GeoResolver> resolver)
+    : GeoEnricher(std::move(resolver), Options()) {}
+
+GeoEnricher::GeoEnricher(std::unique_ptr<GeoResolver> resolver, const Options& options)
+    : resolver_(std::move(resolver)), options_(options) {
+    if (options_.cache_prefix_v4 < 0 || options_.cache_prefix_v4 > 32) {
+        options_.cache_prefix_v4 = 24;
+    }
+    if (options_.cache_prefix_v6 < 0 || options_.cache_prefix_v6 > 128) {
+        options_.cache_prefix_v6 = 48;
+    }
+    countries_.emplace_back();
+    country_index_.emplace(std::string(), 0);
+}
+
+GeoEnricher::CacheKey GeoEnricher::MakeKey(const IpAddress& address, int prefix_length) {
+    CacheKey key;
+    std::memset(key.bytes, 0, sizeof(key.bytes));
+    int full_bytes = prefix_length / 8;
+    std::memcpy(key.bytes, address.bytes, full_bytes);
+    if (prefix_length % 8) {
+        key.bytes[full_bytes] =
+            address.bytes[full_bytes] & static_cast<uint8_t>(0xFF << (8 - prefix_length % 8));
+    }
+    key.prefix_length = static_cast<uint8_t>(prefix_length);
+    return key;
+}
+
+uint16_t GeoEnricher::Intern(const std::string& country) {
+    auto it = country_index_.find(country);
+    if (it != country_index_.end()) {
+        return it->second;
+    }
+    // 正常数据不会超过上限，超出时按未知处理
+    if (countries_.size() >= 0xFFFF) {
+        return 0;
+    }
+    uint16_t index = static_cast<uint16_t>(countries_.size());
+    countries_.push_back(country);
+    country_index_.emplace(country, index);
+    return index;
+}
+
+std::string_view GeoEnricher::ResolveLocked(std::string_view ip) {
+    IpAddress address;
+    if (!IpAddress::Parse(ip, &address)) {
+        stats_.invalid_ips++;
+        return std::string_view();
+    }
+
+    // 先查网段缓存，再查单地址缓存
+    int coarse = address.is_v4 ? 96 + options_.cache_prefix_v4 : options_.cache_prefix_v6;
+    CacheKey coarse_key = MakeKey(address, coarse);
+    auto it = cache_.find(coarse_key);
+    if (it == cache_.end()) {
+        it = cache_.find(MakeKey(address, 128));
+    }
+    if (it != cache_.end()) {
+        stats_.cache_hits++;
+        return countries_[it->second];
+    }
+
+    stats_.lookups++;
+    int prefix_length = 128;
+    bool found = resolver_ && resolver_->Lookup(address, &lookup_country_, &prefix_length);
+    if (!found) {
+        stats_.not_found++;
+        lookup_country_.clear();
+    }
+    uint16_t index = Intern(lookup_country_);
+
+    if (cache_.size() >= options_.max_cache_entries) {
+        cache_.clear();
+    }
+    // 数据库中的网段覆盖整个缓存粒度时按网段缓存，否则只缓存这个地址
+    cache_.emplace(prefix_length <= coarse ? coarse_key : MakeKey(address, 128), index);
+    return countries_[index];
+}
+
+std::string_view GeoEnricher::Resolve(std::string_view ip) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ResolveLocked(ip);
+}
+
+void GeoEnricher::Enrich(std::vector<BlockedRequestView>* requests) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& request : *requests) {
+        if (request.dest_ip.empty() || !request.country.empty()) continue;
+        request.country = ResolveLocked(request.dest_ip);
+        if (!request.country.empty()) {
+            stats_.enriched++;
+        }
+    }
+}
+
+GeoEnricher::Stats GeoEnricher::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
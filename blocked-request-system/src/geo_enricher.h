@@ -0,0 +1,103 @@
+#ifndef GEO_ENRICHER_H_
+#define GEO_ENRICHER_H_
+
+#include "blocked_request_db.h"
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// IP地址，IPv4以IPv4映射的IPv6形式（::ffff:a.b.c.d）保存
+struct IpAddress {
+    uint8_t bytes[16] = {};
+    bool is_v4 = false;
+
+    // 解析点分十进制或IPv6文本，失败返回false
+    static bool Parse(std::string_view text, IpAddress* address);
+};
+
+// 目的IP到国家的解析接口
+class GeoResolver {
+public:
+    virtual ~GeoResolver() = default;
+
+    // 查到时返回true，country为ISO国家代码（可能为空，如匿名网络）；
+    // 无论是否查到，prefix_length都给出结果所属网段在128位地址空间中的前缀长度
+    // （IPv4地址的/24为120），用于按网段缓存
+    virtual bool Lookup(const IpAddress& address, std::string* country, int* prefix_length) = 0;
+};
+
+// 打开MaxMind GeoIP2/GeoLite2国家或城市数据库，整个进程生命周期内保持打开
+// 未启用MaxMind支持（CMake选项BLOCKED_REQUEST_WITH_MAXMINDDB）或打开失败时返回nullptr
+std::unique_ptr<GeoResolver> OpenMaxMindResolver(const std::string& mmdb_path,
+                                                 std::string* error = nullptr);
+
+// 地理信息补全阶段
+// 在批次写入前为带dest_ip且country为空的请求填写country，由刷新线程调用，
+// 不在AddRequest()的调用线程上执行。解析结果按网段缓存：数据库给出的网段不小于
+// cache_prefix_v4/v6时整段共用一条缓存，否则按单个地址缓存
+class GeoEnricher {
+public:
+    struct Options {
+        int cache_prefix_v4 = 24;          // IPv4缓存粒度
+        int cache_prefix_v6 = 48;          // IPv6缓存粒度
+        size_t max_cache_entries = 65536;  // 超过后清空重建
+    };
+
+    struct Stats {
+        int64_t enriched = 0;        // 填写了country的请求数
+        int64_t cache_hits = 0;
+        int64_t lookups = 0;         // 实际调用解析器的次数
+        int64_t not_found = 0;       // 数据库中没有该地址
+        int64_t invalid_ips = 0;     // dest_ip无法解析
+    };
+
+    explicit GeoEnricher(std::unique_ptr<GeoResolver> resolver);
+    GeoEnricher(std::unique_ptr<GeoResolver> resolver, const Options& options);
+
+    GeoEnricher(const GeoEnricher&) = delete;
+    GeoEnricher& operator=(const GeoEnricher&) = delete;
+
+    // 补全一批请求，写入的country指向本对象内部的字符串，在本对象销毁前有效
+    void Enrich(std::vector<BlockedRequestView>* requests);
+
+    // 解析单个IP，未知时返回空
+    std::string_view Resolve(std::string_view ip);
+
+    Stats GetStats() const;
+
+private:
+    struct CacheKey {
+        uint8_t bytes[16];
+        uint8_t prefix_length;
+
+        bool operator==(const CacheKey& other) const;
+    };
+
+    struct CacheKeyHash {
+        size_t operator()(const CacheKey& key) const;
+    };
+
+    static CacheKey MakeKey(const IpAddress& address, int prefix_length);
+
+    // 调用方持有mutex_
+    std::string_view ResolveLocked(std::string_view ip);
+
+    // 国家代码只有两百多种，驻留后用下标缓存，string_view一直有效
+    uint16_t Intern(const std::string& country);
+
+    std::unique_ptr<GeoResolver> resolver_;
+    Options options_;
+    mutable std::mutex mutex_;
+    std::unordered_map<CacheKey, uint16_t, CacheKeyHash> cache_;
+    std::deque<std::string> countries_;            // 下标0为空串，表示未知
+    std::unordered_map<std::string, uint16_t> country_index_;
+    std::string lookup_country_;
+    Stats stats_;
+};
+
+#endif  // GEO_ENRICHER_H_
@@ -0,0 +1,56 @@
+#include "io_executor.h"
+#include <utility>
+
+IoExecutor::~IoExecutor() {
+    Stop();
+}
+
+void IoExecutor::Start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return;
+
+    running_ = true;
+    thread_ = std::thread(&IoExecutor::Run, this);
+}
+
+void IoExecutor::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+        running_ = false;
+    }
+    cv_.notify_all();
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void IoExecutor::Post(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_) {
+            tasks_.push_back(std::move(task));
+            cv_.notify_one();
+            return;
+        }
+    }
+    task();
+}
+
+void IoExecutor::Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this] { return !tasks_.empty() || !running_; });
+        if (tasks_.empty()) {
+            return;
+        }
+
+        std::function<void()> task = std::move(tasks_.front());
+        tasks_.pop_front();
+
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef IO_EXECUTOR_H_
+#define IO_EXECUTOR_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// 单线程I/O执行器
+// 任务按提交顺序在后台线程执行，Submit()返回任务结果的future，
+// 让数据库读取等阻塞操作不占用调用方线程
+class IoExecutor {
+public:
+    IoExecutor() = default;
+    ~IoExecutor();
+
+    IoExecutor(const IoExecutor&) = delete;
+    IoExecutor& operator=(const IoExecutor&) = delete;
+
+    void Start();
+
+    // 执行完队列中剩余的任务后停止
+    void Stop();
+
+    // 提交任务；执行器未运行时在调用方线程直接执行，future仍然有效
+    template <typename Task>
+    auto Submit(Task&& task) -> std::future<decltype(task())> {
+        using Result = decltype(task());
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<Task>(task));
+        std::future<Result> future = packaged->get_future();
+        Post([packaged] { (*packaged)(); });
+        return future;
+    }
+
+private:
+    void Post(std::function<void()> task);
+    void Run();
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> tasks_;
+    bool running_ = false;
+};
+
+#endif  // IO_EXECUTOR_H_
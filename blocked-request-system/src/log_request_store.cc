@@ -0,0 +1,635 @@
+#include "log_request_store.h"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const uint32_t kBatchMagic = 0x32474c42;        // "BLG2"
+const uint32_t kLegacyBatchMagic = 0x31474c42;  // "BLG1"，没有country，只读取
+const uint32_t kAckMagic = 0x314b4341;    // "ACK1"
+const char kAckLogName[] = "acks.log";
+
+struct FrameHeader {
+    uint32_t magic;
+    uint32_t count;
+    uint32_t payload_size;
+    uint32_t crc;
+};
+
+// 字符串依次为url host reason browser_id country
+struct RecordHeader {
+    int64_t id;
+    int64_t timestamp;
+    int64_t tab_id;
+    uint32_t lengths[5];
+};
+
+struct LegacyRecordHeader {
+    int64_t id;
+    int64_t timestamp;
+    int64_t tab_id;
+    uint32_t lengths[4];
+};
+
+size_t RecordHeaderSize(bool legacy) {
+    return legacy ? sizeof(LegacyRecordHeader) : sizeof(RecordHeader);
+}
+
+// 解码记录头，旧格式的记录country长度为0
+void DecodeRecordHeader(const char* data, bool legacy, RecordHeader* record) {
+    if (!legacy) {
+        std::memcpy(record, data, sizeof(*record));
+        return;
+    }
+    LegacyRecordHeader old;
+    std::memcpy(&old, data, sizeof(old));
+    *record = {old.id, old.timestamp, old.tab_id,
+               {old.lengths[0], old.lengths[1], old.lengths[2], old.lengths[3], 0}};
+}
+
+size_t StringsSize(const RecordHeader& record) {
+    size_t total = 0;
+    for (uint32_t length : record.lengths) {
+        total += length;
+    }
+    return total;
+}
+
+// CRC32（IEEE），按字节查表
+uint32_t Crc32(const char* data, size_t size) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> result{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            result[i] = c;
+        }
+        return result;
+    }();
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+bool PreadFull(int fd, void* data, size_t size, uint64_t offset) {
+    char* cursor = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t n = pread(fd, cursor, size, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        cursor += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+void AppendBytes(std::vector<char>* out, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    out->insert(out->end(), bytes, bytes + size);
+}
+
+std::string SegmentFileName(uint32_t sequence) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "segment-%08u.log", sequence);
+    return name;
+}
+
+// 从文件名解析段序号
+bool ParseSegmentFileName(const char* name, uint32_t* sequence) {
+    unsigned int value = 0;
+    int consumed = 0;
+    if (std::sscanf(name, "segment-%8u.log%n", &value, &consumed) != 1 ||
+        name[consumed] != '\0' || SegmentFileName(value) != name) {
+        return false;
+    }
+    *sequence = value;
+    return true;
+}
+
+}  // namespace
+
+LogRequestStore::LogRequestStore() = default;
+
+LogRequestStore::LogRequestStore(const Options& options)
+    : options_(options) {
+    // 记录位置用32位偏移
+    options_.segment_bytes = std::min<size_t>(options_.segment_bytes, 1u << 30);
+}
+
+LogRequestStore::~LogRequestStore() {
+    Close();
+}
+
+bool LogRequestStore::Open(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (opened_) return true;
+
+    directory_ = directory;
+    if (mkdir(directory_.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "无法创建存储目录: " << directory_ << std::endl;
+        return false;
+    }
+
+    // 收集段文件并按序号恢复
+    std::vector<uint32_t> sequences;
+    DIR* dir = opendir(directory_.c_str());
+    if (!dir) {
+        return false;
+    }
+    while (dirent* entry = readdir(dir)) {
+        uint32_t sequence = 0;
+        if (ParseSegmentFileName(entry->d_name, &sequence)) {
+            sequences.push_back(sequence);
+        }
+    }
+    closedir(dir);
+    std::sort(sequences.begin(), sequences.end());
+
+    base_id_ = 1;
+    index_.clear();
+    bool success = true;
+    for (size_t i = 0; i < sequences.size(); ++i) {
+        bool last = i + 1 == sequences.size();
+        if (!OpenSegment(sequences[i], false) || !RecoverSegment(&segments_.back(), last)) {
+            success = false;
+            break;
+        }
+    }
+
+    if (!success || !ReplayAcks()) {
+        ReleaseFiles();
+        return false;
+    }
+
+    unreported_cursor_ = base_id_;
+    opened_ = true;
+    return true;
+}
+
+void LogRequestStore::Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ReleaseFiles();
+}
+
+void LogRequestStore::ReleaseFiles() {
+    for (auto& segment : segments_) {
+        close(segment.fd);
+    }
+    segments_.clear();
+    index_.clear();
+    if (ack_fd_ >= 0) {
+        close(ack_fd_);
+        ack_fd_ = -1;
+    }
+    opened_ = false;
+}
+
+size_t LogRequestStore::segment_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return segments_.size();
+}
+
+bool LogRequestStore::OpenSegment(uint32_t sequence, bool create) {
+    std::string path = directory_ + "/" + SegmentFileName(sequence);
+    int flags = O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_EXCL : 0);
+    int fd = open(path.c_str(), flags, 0644);
+    if (fd < 0) {
+        std::cerr << "无法打开段文件: " << path << std::endl;
+        return false;
+    }
+
+    if (create && options_.sync_mode == SyncMode::kEveryBatch) {
+        // 新文件的目录项也要落盘
+        int dir_fd = open(directory_.c_str(), O_RDONLY | O_CLOEXEC);
+        if (dir_fd >= 0) {
+            fsync(dir_fd);
+            close(dir_fd);
+        }
+    }
+
+    int64_t next_id = base_id_ + static_cast<int64_t>(index_.size());
+    segments_.push_back(Segment{sequence, path, fd, 0, next_id, next_id,
+                                INT64_MIN, 0});
+    return true;
+}
+
+bool LogRequestStore::RecoverSegment(Segment* segment, bool last) {
+    struct stat st;
+    if (fstat(segment->fd, &st) != 0) {
+        return false;
+    }
+    uint64_t file_size = static_cast<uint64_t>(st.st_size);
+
+    std::vector<char> payload;
+    uint64_t offset = 0;
+    while (offset + sizeof(FrameHeader) <= file_size) {
+        FrameHeader header;
+        if (!PreadFull(segment->fd, &header, sizeof(header), offset) ||
+            (header.magic != kBatchMagic && header.magic != kLegacyBatchMagic) ||
+            offset + sizeof(header) + header.payload_size > file_size) {
+            break;
+        }
+
+        payload.resize(header.payload_size);
+        if (!PreadFull(segment->fd, payload.data(), payload.size(), offset + sizeof(header)) ||
+            Crc32(payload.data(), payload.size()) != header.crc) {
+            break;
+        }
+
+        // 校验记录结构和id连续性，任一不符都视为损坏的尾帧
+        bool legacy = header.magic == kLegacyBatchMagic;
+        size_t header_size = RecordHeaderSize(legacy);
+        bool valid = true;
+        size_t position = 0;
+        size_t first_new = index_.size();
+        for (uint32_t i = 0; i < header.count && valid; ++i) {
+            RecordHeader record;
+            if (payload.size() - position < header_size) {
+                valid = false;
+                break;
+            }
+            DecodeRecordHeader(payload.data() + position, legacy, &record);
+
+            if (index_.empty()) {
+                base_id_ = record.id;
+                segment->first_id = record.id;
+                segment->end_id = record.id;
+            }
+            if (record.id != base_id_ + static_cast<int64_t>(index_.size())) {
+                valid = false;
+                break;
+            }
+
+            index_.push_back(RecordLocation{
+                segment->sequence,
+                static_cast<uint32_t>(offset + sizeof(header) + position), false, legacy});
+
+            size_t strings = StringsSize(record);
+            position += header_size;
+            if (payload.size() - position < strings) {
+                valid = false;
+                break;
+            }
+            position += strings;
+            segment->max_timestamp = std::max(segment->max_timestamp, record.timestamp);
+        }
+
+        if (!valid || position != payload.size()) {
+            index_.resize(first_new);
+            break;
+        }
+
+        segment->end_id = base_id_ + static_cast<int64_t>(index_.size());
+        segment->unreported += header.count;
+        offset += sizeof(header) + header.payload_size;
+    }
+
+    // 只有最后一个段可能留下写入中途崩溃的尾帧；之前的段损坏或id不连续时截断会丢掉
+    // 之后所有段中已提交的记录，打开失败并保留文件
+    if (offset != file_size && !last) {
+        std::cerr << "段文件在 " << offset << " 字节处损坏: " << segment->path << std::endl;
+        return false;
+    }
+
+    // 截掉不完整或损坏的尾部，之后从这里继续追加
+    if (offset != file_size) {
+        std::cerr << "段文件尾部不完整，截断到 " << offset << " 字节: "
+                  << segment->path << std::endl;
+        if (ftruncate(segment->fd, static_cast<off_t>(offset)) != 0) {
+            return false;
+        }
+    }
+    segment->size = offset;
+    return lseek(segment->fd, static_cast<off_t>(offset), SEEK_SET) >= 0;
+}
+
+bool LogRequestStore::ReplayAcks() {
+    std::string path = directory_ + "/" + kAckLogName;
+    ack_fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (ack_fd_ < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(ack_fd_, &st) != 0) {
+        return false;
+    }
+    uint64_t file_size = static_cast<uint64_t>(st.st_size);
+
+    std::vector<int64_t> ids;
+    uint64_t offset = 0;
+    while (offset + sizeof(FrameHeader) <= file_size) {
+        FrameHeader header;
+        if (!PreadFull(ack_fd_, &header, sizeof(header), offset) ||
+            header.magic != kAckMagic ||
+            header.payload_size != header.count * sizeof(int64_t) ||
+            offset + sizeof(header) + header.payload_size > file_size) {
+            break;
+        }
+
+        ids.resize(header.count);
+        if (!PreadFull(ack_fd_, ids.data(), header.payload_size, offset + sizeof(header)) ||
+            Crc32(reinterpret_cast<const char*>(ids.data()), header.payload_size) != header.crc) {
+            break;
+        }
+
+        for (int64_t id : ids) {
+            MarkReported(id);
+        }
+        offset += sizeof(header) + header.payload_size;
+    }
+
+    if (offset != file_size && ftruncate(ack_fd_, static_cast<off_t>(offset)) != 0) {
+        return false;
+    }
+    return true;
+}
+
+bool LogRequestStore::WriteFrame(int fd, const std::vector<char>& frame) {
+    const char* cursor = frame.data();
+    size_t remaining = frame.size();
+    while (remaining > 0) {
+        ssize_t n = write(fd, cursor, remaining);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        cursor += n;
+        remaining -= static_cast<size_t>(n);
+    }
+
+    if (options_.sync_mode == SyncMode::kEveryBatch && fdatasync(fd) != 0) {
+        return false;
+    }
+    return true;
+}
+
+bool LogRequestStore::AppendBatch(const std::vector<BlockedRequestView>& batch) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!opened_ || batch.empty()) {
+        return false;
+    }
+
+    // 当前段写满后滚动到新段
+    if (segments_.empty() || segments_.back().size >= options_.segment_bytes) {
+        uint32_t sequence = segments_.empty() ? 1 : segments_.back().sequence + 1;
+        if (!OpenSegment(sequence, true)) {
+            return false;
+        }
+    }
+    Segment& segment = segments_.back();
+
+    // 编码整批为一帧，记录位置先加入索引，写入失败时撤回
+    size_t index_size = index_.size();
+    int64_t next_id = base_id_ + static_cast<int64_t>(index_size);
+    int64_t max_timestamp = segment.max_timestamp;
+
+    frame_buffer_.resize(sizeof(FrameHeader));
+    for (const auto& request : batch) {
+        RecordHeader record = {
+            next_id++, request.timestamp, request.tab_id,
+            {static_cast<uint32_t>(request.url.size()),
+             static_cast<uint32_t>(request.host.size()),
+             static_cast<uint32_t>(request.reason.size()),
+             static_cast<uint32_t>(request.browser_id.size()),
+             static_cast<uint32_t>(request.country.size())}};
+
+        index_.push_back(RecordLocation{
+            segment.sequence,
+            static_cast<uint32_t>(segment.size + frame_buffer_.size()), false, false});
+
+        AppendBytes(&frame_buffer_, &record, sizeof(record));
+        AppendBytes(&frame_buffer_, request.url.data(), request.url.size());
+        AppendBytes(&frame_buffer_, request.host.data(), request.host.size());
+        AppendBytes(&frame_buffer_, request.reason.data(), request.reason.size());
+        AppendBytes(&frame_buffer_, request.browser_id.data(), request.browser_id.size());
+        AppendBytes(&frame_buffer_, request.country.data(), request.country.size());
+        max_timestamp = std::max(max_timestamp, request.timestamp);
+    }
+
+    uint32_t payload_size = static_cast<uint32_t>(frame_buffer_.size() - sizeof(FrameHeader));
+    FrameHeader header = {kBatchMagic, static_cast<uint32_t>(batch.size()), payload_size,
+                          Crc32(frame_buffer_.data() + sizeof(FrameHeader), payload_size)};
+    std::memcpy(frame_buffer_.data(), &header, sizeof(header));
+
+    if (!WriteFrame(segment.fd, frame_buffer_)) {
+        // 回滚半写入的帧，保持文件只包含完整批次
+        if (ftruncate(segment.fd, static_cast<off_t>(segment.size)) != 0) {
+            std::cerr << "段文件回滚失败: " << segment.path << std::endl;
+        }
+        lseek(segment.fd, 0, SEEK_END);
+        index_.resize(index_size);
+        return false;
+    }
+
+    segment.size += frame_buffer_.size();
+    segment.end_id = next_id;
+    segment.max_timestamp = max_timestamp;
+    segment.unreported += static_cast<int64_t>(batch.size());
+    return true;
+}
+
+std::vector<BlockedRequest> LogRequestStore::ScanUnreported(int limit) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<BlockedRequest> requests;
+    if (!opened_ || limit <= 0) {
+        return requests;
+    }
+
+    int64_t end_id = base_id_ + static_cast<int64_t>(index_.size());
+
+    // 跳过已全部上报的前缀
+    unreported_cursor_ = std::max(unreported_cursor_, base_id_);
+    while (unreported_cursor_ < end_id && index_[unreported_cursor_ - base_id_].reported) {
+        ++unreported_cursor_;
+    }
+
+    for (int64_t id = unreported_cursor_;
+         id < end_id && requests.size() < static_cast<size_t>(limit); ++id) {
+        const RecordLocation& location = index_[id - base_id_];
+        if (location.reported) continue;
+
+        BlockedRequest request;
+        if (!ReadRecord(location, id, &request)) {
+            break;
+        }
+        requests.push_back(std::move(request));
+    }
+
+    return requests;
+}
+
+bool LogRequestStore::ReadRecord(const RecordLocation& location, int64_t id,
+                                 BlockedRequest* request) {
+    Segment* segment = FindSegment(location.segment_sequence);
+    if (!segment) {
+        return false;
+    }
+
+    char header[sizeof(RecordHeader)];
+    size_t header_size = RecordHeaderSize(location.legacy);
+    RecordHeader record;
+    if (!PreadFull(segment->fd, header, header_size, location.offset)) {
+        return false;
+    }
+    DecodeRecordHeader(header, location.legacy, &record);
+    if (record.id != id) {
+        return false;
+    }
+
+    size_t total = StringsSize(record);
+    std::string strings(total, '\0');
+    if (total > 0 &&
+        !PreadFull(segment->fd, &strings[0], total, location.offset + header_size)) {
+        return false;
+    }
+
+    size_t position = 0;
+    auto take = [&strings, &position](uint32_t length) {
+        std::string value = strings.substr(position, length);
+        position += length;
+        return value;
+    };
+
+    request->id = record.id;
+    request->url = take(record.lengths[0]);
+    request->host = take(record.lengths[1]);
+    request->reason = take(record.lengths[2]);
+    request->timestamp = record.timestamp;
+    request->reported = false;
+    request->browser_id = take(record.lengths[3]);
+    request->tab_id = record.tab_id;
+    request->country = take(record.lengths[4]);
+    return true;
+}
+
+LogRequestStore::Segment* LogRequestStore::FindSegment(uint32_t sequence) {
+    if (segments_.empty() || sequence < segments_.front().sequence) {
+        return nullptr;
+    }
+    size_t position = sequence - segments_.front().sequence;
+    return position < segments_.size() ? &segments_[position] : nullptr;
+}
+
+void LogRequestStore::MarkReported(int64_t id) {
+    if (id < base_id_ || id >= base_id_ + static_cast<int64_t>(index_.size())) {
+        return;
+    }
+
+    RecordLocation& location = index_[id - base_id_];
+    if (location.reported) {
+        return;
+    }
+    location.reported = true;
+
+    if (Segment* segment = FindSegment(location.segment_sequence)) {
+        segment->unreported--;
+    }
+}
+
+bool LogRequestStore::Ack(const std::vector<int64_t>& ids) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!opened_) {
+        return false;
+    }
+    if (ids.empty()) {
+        return true;
+    }
+
+    uint32_t payload_size = static_cast<uint32_t>(ids.size() * sizeof(int64_t));
+    FrameHeader header = {kAckMagic, static_cast<uint32_t>(ids.size()), payload_size,
+                          Crc32(reinterpret_cast<const char*>(ids.data()), payload_size)};
+
+    frame_buffer_.clear();
+    AppendBytes(&frame_buffer_, &header, sizeof(header));
+    AppendBytes(&frame_buffer_, ids.data(), payload_size);
+    if (!WriteFrame(ack_fd_, frame_buffer_)) {
+        return false;
+    }
+
+    for (int64_t id : ids) {
+        MarkReported(id);
+    }
+    return true;
+}
+
+bool LogRequestStore::Expire(int64_t cutoff_timestamp) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!opened_) {
+        return false;
+    }
+
+    // 只从最旧的段开始整段删除；保留最后一个段，保证重启后id继续递增
+    bool removed = false;
+    while (segments_.size() > 1) {
+        Segment& segment = segments_.front();
+        if (segment.unreported > 0 || segment.max_timestamp >= cutoff_timestamp) {
+            break;
+        }
+
+        close(segment.fd);
+        unlink(segment.path.c_str());
+
+        size_t records = static_cast<size_t>(segment.end_id - segment.first_id);
+        index_.erase(index_.begin(), index_.begin() + static_cast<std::ptrdiff_t>(records));
+        base_id_ = segment.end_id;
+        segments_.pop_front();
+        removed = true;
+    }
+
+    unreported_cursor_ = std::max(unreported_cursor_, base_id_);
+
+    // 已删除段的确认记录不再需要，重写确认日志
+    return !removed || RewriteAckLog();
+}
+
+bool LogRequestStore::RewriteAckLog() {
+    std::vector<int64_t> ids;
+    for (size_t i = 0; i < index_.size(); ++i) {
+        if (index_[i].reported) {
+            ids.push_back(base_id_ + static_cast<int64_t>(i));
+        }
+    }
+
+    std::string path = directory_ + "/" + kAckLogName;
+    std::string temp_path = path + ".tmp";
+    int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    bool success = true;
+    if (!ids.empty()) {
+        uint32_t payload_size = static_cast<uint32_t>(ids.size() * sizeof(int64_t));
+        FrameHeader header = {kAckMagic, static_cast<uint32_t>(ids.size()), payload_size,
+                              Crc32(reinterpret_cast<const char*>(ids.data()), payload_size)};
+        frame_buffer_.clear();
+        AppendBytes(&frame_buffer_, &header, sizeof(header));
+        AppendBytes(&frame_buffer_, ids.data(), payload_size);
+        success = WriteFrame(fd, frame_buffer_);
+    }
+    success = success && fdatasync(fd) == 0;
+    close(fd);
+
+    if (!success || rename(temp_path.c_str(), path.c_str()) != 0) {
+        unlink(temp_path.c_str());
+        return false;
+    }
+
+    close(ack_fd_);
+    ack_fd_ = open(path.c_str(), O_RDWR | O_APPEND | O_CLOEXEC);
+    return ack_fd_ >= 0;
+}
@@ -0,0 +1,99 @@
+#ifndef LOG_REQUEST_STORE_H_
+#define LOG_REQUEST_STORE_H_
+
+#include "request_store.h"
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 日志结构存储后端
+// - 记录按批次追加到只追加的段文件（segment-<序号>.log），每个批次一帧，
+//   帧头带CRC，打开时截掉最后一个段中不完整的尾帧，保证批次原子性；
+//   之前的段损坏时打开失败，不修改文件
+// - 记录保存地理信息补全得到的country；旧格式中没有country的帧仍可读取
+// - 确认上报写入acks.log，打开时重放
+// - 内存中按id保存每条记录的位置和上报标记，未上报扫描从游标处顺序进行
+// - 清理时整段删除：段内记录全部已上报且最大时间戳早于截止时间
+//
+// 目录结构：
+//   <dir>/segment-00000001.log
+//   <dir>/segment-00000002.log
+//   <dir>/acks.log
+class LogRequestStore : public RequestStore {
+public:
+    enum class SyncMode {
+        kNone,        // 只write()，进程崩溃不丢数据，与SQLite WAL + synchronous=NORMAL相当
+        kEveryBatch,  // 每个批次fdatasync
+    };
+
+    struct Options {
+        size_t segment_bytes = 64 * 1024 * 1024;  // 段文件滚动阈值
+        SyncMode sync_mode = SyncMode::kNone;
+    };
+
+    LogRequestStore();
+    explicit LogRequestStore(const Options& options);
+    ~LogRequestStore() override;
+
+    bool Open(const std::string& directory) override;
+    void Close() override;
+    bool AppendBatch(const std::vector<BlockedRequestView>& batch) override;
+    std::vector<BlockedRequest> ScanUnreported(int limit) override;
+    bool Ack(const std::vector<int64_t>& ids) override;
+    bool Expire(int64_t cutoff_timestamp) override;
+
+    // 当前段文件数量
+    size_t segment_count() const;
+
+private:
+    struct Segment {
+        uint32_t sequence;
+        std::string path;
+        int fd;
+        uint64_t size;
+        int64_t first_id;
+        int64_t end_id;           // 段内最后一条记录id + 1
+        int64_t max_timestamp;
+        int64_t unreported;
+    };
+
+    struct RecordLocation {
+        uint32_t segment_sequence;
+        uint32_t offset;
+        bool reported;
+        bool legacy;              // 位于旧格式（BLG1）的帧中，记录没有country
+    };
+
+    // 关闭所有文件并清空内存状态，调用方持有mutex_
+    void ReleaseFiles();
+    bool OpenSegment(uint32_t sequence, bool create);
+    bool RecoverSegment(Segment* segment, bool last);
+    bool ReplayAcks();
+    bool RewriteAckLog();
+    bool ReadRecord(const RecordLocation& location, int64_t id, BlockedRequest* request);
+    bool WriteFrame(int fd, const std::vector<char>& frame);
+    Segment* FindSegment(uint32_t sequence);
+    void MarkReported(int64_t id);
+
+    Options options_;
+    std::string directory_;
+    bool opened_ = false;
+
+    std::deque<Segment> segments_;
+    int ack_fd_ = -1;
+
+    // index_[i]对应id为base_id_ + i的记录
+    int64_t base_id_ = 1;
+    std::deque<RecordLocation> index_;
+
+    // 小于该id的记录都已上报
+    int64_t unreported_cursor_ = 1;
+
+    // 复用的编码缓冲区
+    std::vector<char> frame_buffer_;
+
+    mutable std::mutex mutex_;
+};
+
+#endif  // LOG_REQUEST_STORE_H_
@@ -0,0 +1,448 @@
+#include "report_codec.h"
+#include <cstring>
+#include <iostream>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+const char kMagic[4] = {'B', 'R', 'P', '1'};
+// 版本2增加country列；解码仍接受没有country列的版本1
+const uint8_t kVersion = 2;
+const uint8_t kVersionWithoutCountry = 1;
+
+// 正文长度上限，防止损坏的负载导致超大内存申请
+const uint64_t kMaxBodySize = 256 * 1024 * 1024;
+
+// url前缀标记，存放在url长度的低两位
+enum UrlPrefix : uint64_t {
+    kUrlRaw = 0,
+    kUrlHttpsHost = 1,
+    kUrlHttpHost = 2,
+};
+
+void PutVarint(std::string* out, uint64_t value) {
+    char buffer[10];
+    size_t size = 0;
+    while (value >= 0x80) {
+        buffer[size++] = static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    buffer[size++] = static_cast<char>(value);
+    out->append(buffer, size);
+}
+
+bool GetVarint(const char** cursor, const char* end, uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && *cursor < end; shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(*(*cursor)++);
+        result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t ZigZag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t UnZigZag(uint64_t value) {
+    return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+// 差值用无符号运算，避免有符号溢出
+int64_t Delta(int64_t value, int64_t previous) {
+    return static_cast<int64_t>(static_cast<uint64_t>(value) - static_cast<uint64_t>(previous));
+}
+
+int64_t ApplyDelta(int64_t previous, int64_t delta) {
+    return static_cast<int64_t>(static_cast<uint64_t>(previous) + static_cast<uint64_t>(delta));
+}
+
+bool StartsWithHost(std::string_view url, std::string_view scheme, std::string_view host) {
+    return url.size() >= scheme.size() + host.size() &&
+           url.compare(0, scheme.size(), scheme) == 0 &&
+           url.compare(scheme.size(), host.size(), host) == 0;
+}
+
+}  // namespace
+
+bool IsReportCompressionAvailable(ReportCompression compression) {
+    switch (compression) {
+        case ReportCompression::kNone:
+            return true;
+        case ReportCompression::kZstd:
+#ifdef HAVE_ZSTD
+            return true;
+#else
+            return false;
+#endif
+        case ReportCompression::kLz4:
+#ifdef HAVE_LZ4
+            return true;
+#else
+            return false;
+#endif
+        case ReportCompression::kZlib:
+#ifdef HAVE_ZLIB
+            return true;
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+ReportCompression DefaultReportCompression() {
+    for (ReportCompression compression : {ReportCompression::kZstd, ReportCompression::kZlib,
+                                          ReportCompression::kLz4}) {
+        if (IsReportCompressionAvailable(compression)) {
+            return compression;
+        }
+    }
+    return ReportCompression::kNone;
+}
+
+const char* ReportCompressionName(ReportCompression compression) {
+    switch (compression) {
+        case ReportCompression::kNone: return "none";
+        case ReportCompression::kZstd: return "zstd";
+        case ReportCompression::kLz4: return "lz4";
+        case ReportCompression::kZlib: return "zlib";
+    }
+    return "unknown";
+}
+
+ReportEncoder::ReportEncoder(ReportCompression compression)
+    : compression_(compression) {
+#ifdef HAVE_ZSTD
+    if (compression_ == ReportCompression::kZstd) {
+        compression_context_ = ZSTD_createCCtx();
+    }
+#endif
+}
+
+ReportEncoder::~ReportEncoder() {
+#ifdef HAVE_ZSTD
+    ZSTD_freeCCtx(static_cast<ZSTD_CCtx*>(compression_context_));
+#endif
+}
+
+uint32_t ReportEncoder::Intern(std::string_view value) {
+    auto result = string_index_.emplace(value, static_cast<uint32_t>(strings_.size()));
+    if (result.second) {
+        strings_.push_back(value);
+    }
+    return result.first->second;
+}
+
+bool ReportEncoder::Encode(const std::vector<BlockedRequest>& requests, std::string* out) {
+    if (!IsReportCompressionAvailable(compression_)) {
+        std::cerr << "不支持的压缩方式: " << ReportCompressionName(compression_) << std::endl;
+        return false;
+    }
+
+    const size_t count = requests.size();
+    body_.clear();
+    PutVarint(&body_, count);
+
+    // 字符串表
+    string_index_.clear();
+    strings_.clear();
+    columns_.resize(count * 4);
+    for (size_t i = 0; i < count; ++i) {
+        columns_[i] = Intern(requests[i].host);
+        columns_[count + i] = Intern(requests[i].reason);
+        columns_[count * 2 + i] = Intern(requests[i].browser_id);
+        columns_[count * 3 + i] = Intern(requests[i].country);
+    }
+    PutVarint(&body_, strings_.size());
+    for (std::string_view value : strings_) {
+        PutVarint(&body_, value.size());
+        body_.append(value.data(), value.size());
+    }
+
+    // 数值列
+    int64_t previous = 0;
+    for (const auto& request : requests) {
+        PutVarint(&body_, ZigZag(Delta(request.id, previous)));
+        previous = request.id;
+    }
+    previous = 0;
+    for (const auto& request : requests) {
+        PutVarint(&body_, ZigZag(Delta(request.timestamp, previous)));
+        previous = request.timestamp;
+    }
+    for (const auto& request : requests) {
+        PutVarint(&body_, ZigZag(request.tab_id));
+    }
+    for (uint32_t index : columns_) {
+        PutVarint(&body_, index);
+    }
+
+    // url列：先存全部长度和前缀标记，再存全部内容
+    for (const auto& request : requests) {
+        std::string_view url = request.url;
+        uint64_t prefix = kUrlRaw;
+        size_t skip = 0;
+        if (StartsWithHost(url, "https://", request.host)) {
+            prefix = kUrlHttpsHost;
+            skip = 8 + request.host.size();
+        } else if (StartsWithHost(url, "http://", request.host)) {
+            prefix = kUrlHttpHost;
+            skip = 7 + request.host.size();
+        }
+        PutVarint(&body_, (static_cast<uint64_t>(url.size() - skip) << 2) | prefix);
+    }
+    for (const auto& request : requests) {
+        std::string_view url = request.url;
+        if (StartsWithHost(url, "https://", request.host)) {
+            url.remove_prefix(8 + request.host.size());
+        } else if (StartsWithHost(url, "http://", request.host)) {
+            url.remove_prefix(7 + request.host.size());
+        }
+        body_.append(url.data(), url.size());
+    }
+
+    // 头部
+    out->clear();
+    out->append(kMagic, sizeof(kMagic));
+    out->push_back(static_cast<char>(kVersion));
+    out->push_back(static_cast<char>(compression_));
+    PutVarint(out, body_.size());
+
+    switch (compression_) {
+        case ReportCompression::kNone:
+            out->append(body_);
+            return true;
+
+        case ReportCompression::kZstd: {
+#ifdef HAVE_ZSTD
+            size_t header_size = out->size();
+            out->resize(header_size + ZSTD_compressBound(body_.size()));
+            size_t size = ZSTD_compressCCtx(static_cast<ZSTD_CCtx*>(compression_context_),
+                                            &(*out)[header_size], out->size() - header_size,
+                                            body_.data(), body_.size(), 3);
+            if (ZSTD_isError(size)) {
+                return false;
+            }
+            out->resize(header_size + size);
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        case ReportCompression::kLz4: {
+#ifdef HAVE_LZ4
+            size_t header_size = out->size();
+            out->resize(header_size + LZ4_compressBound(static_cast<int>(body_.size())));
+            int size = LZ4_compress_default(body_.data(), &(*out)[header_size],
+                                            static_cast<int>(body_.size()),
+                                            static_cast<int>(out->size() - header_size));
+            if (size <= 0) {
+                return false;
+            }
+            out->resize(header_size + size);
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        case ReportCompression::kZlib: {
+#ifdef HAVE_ZLIB
+            size_t header_size = out->size();
+            uLongf size = compressBound(body_.size());
+            out->resize(header_size + size);
+            if (compress2(reinterpret_cast<Bytef*>(&(*out)[header_size]), &size,
+                          reinterpret_cast<const Bytef*>(body_.data()), body_.size(),
+                          6) != Z_OK) {
+                return false;
+            }
+            out->resize(header_size + size);
+            return true;
+#else
+            return false;
+#endif
+        }
+    }
+    return false;
+}
+
+bool ReportDecoder::Decode(const char* data, size_t size, std::vector<BlockedRequest>* requests) {
+    const char* cursor = data;
+    const char* end = data + size;
+
+    // 头部
+    if (size < sizeof(kMagic) + 2 || std::memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+        return false;
+    }
+    version_ = static_cast<uint8_t>(data[4]);
+    if (version_ != kVersion && version_ != kVersionWithoutCountry) {
+        return false;
+    }
+    auto compression = static_cast<ReportCompression>(data[5]);
+    cursor += sizeof(kMagic) + 2;
+
+    uint64_t body_size = 0;
+    if (!GetVarint(&cursor, end, &body_size) || body_size > kMaxBodySize ||
+        !IsReportCompressionAvailable(compression)) {
+        return false;
+    }
+
+    size_t payload_size = static_cast<size_t>(end - cursor);
+    switch (compression) {
+        case ReportCompression::kNone:
+            if (payload_size != body_size) return false;
+            body_.assign(cursor, payload_size);
+            break;
+
+        case ReportCompression::kZstd:
+#ifdef HAVE_ZSTD
+            body_.resize(body_size);
+            if (ZSTD_decompress(&body_[0], body_size, cursor, payload_size) != body_size) {
+                return false;
+            }
+#endif
+            break;
+
+        case ReportCompression::kLz4:
+#ifdef HAVE_LZ4
+            body_.resize(body_size);
+            if (LZ4_decompress_safe(cursor, &body_[0], static_cast<int>(payload_size),
+                                    static_cast<int>(body_size)) !=
+                static_cast<int>(body_size)) {
+                return false;
+            }
+#endif
+            break;
+
+        case ReportCompression::kZlib: {
+#ifdef HAVE_ZLIB
+            body_.resize(body_size);
+            uLongf decoded_size = body_size;
+            if (uncompress(reinterpret_cast<Bytef*>(&body_[0]), &decoded_size,
+                           reinterpret_cast<const Bytef*>(cursor), payload_size) != Z_OK ||
+                decoded_size != body_size) {
+                return false;
+            }
+#endif
+            break;
+        }
+    }
+
+    size_t first = requests->size();
+    if (!DecodeBody(requests)) {
+        requests->resize(first);
+        return false;
+    }
+    return true;
+}
+
+bool ReportDecoder::DecodeBody(std::vector<BlockedRequest>* requests) {
+    const char* cursor = body_.data();
+    const char* end = body_.data() + body_.size();
+
+    // 每条记录至少每列一个字节（三个数值列、三个或四个字符串列和url长度），
+    // 据此拒绝伪造的记录数
+    size_t field_count = version_ == kVersionWithoutCountry ? 3 : 4;
+    uint64_t count = 0;
+    if (!GetVarint(&cursor, end, &count) || count > body_.size() / (field_count + 4)) {
+        return false;
+    }
+
+    uint64_t string_count = 0;
+    if (!GetVarint(&cursor, end, &string_count) ||
+        string_count > static_cast<uint64_t>(end - cursor)) {
+        return false;
+    }
+    strings_.resize(string_count);
+    for (auto& value : strings_) {
+        uint64_t length = 0;
+        if (!GetVarint(&cursor, end, &length) ||
+            length > static_cast<uint64_t>(end - cursor)) {
+            return false;
+        }
+        value.assign(cursor, length);
+        cursor += length;
+    }
+
+    size_t first = requests->size();
+    requests->resize(first + count);
+    BlockedRequest* batch = requests->data() + first;
+    uint64_t value = 0;
+
+    // 数值列
+    int64_t previous = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        if (!GetVarint(&cursor, end, &value)) return false;
+        previous = ApplyDelta(previous, UnZigZag(value));
+        batch[i].id = previous;
+        batch[i].reported = false;
+    }
+    previous = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        if (!GetVarint(&cursor, end, &value)) return false;
+        previous = ApplyDelta(previous, UnZigZag(value));
+        batch[i].timestamp = previous;
+    }
+    for (uint64_t i = 0; i < count; ++i) {
+        if (!GetVarint(&cursor, end, &value)) return false;
+        batch[i].tab_id = UnZigZag(value);
+    }
+
+    // 字符串列，版本1没有country列
+    std::string BlockedRequest::*fields[4] = {
+        &BlockedRequest::host, &BlockedRequest::reason, &BlockedRequest::browser_id,
+        &BlockedRequest::country};
+    for (size_t f = 0; f < field_count; ++f) {
+        auto field = fields[f];
+        for (uint64_t i = 0; i < count; ++i) {
+            if (!GetVarint(&cursor, end, &value) || value >= strings_.size()) return false;
+            batch[i].*field = strings_[value];
+        }
+    }
+
+    // url列：长度区之后是内容区，先读完长度再回填内容
+    const char* lengths = cursor;
+    for (uint64_t i = 0; i < count; ++i) {
+        if (!GetVarint(&cursor, end, &value)) return false;
+    }
+    const char* content = cursor;
+    for (uint64_t i = 0; i < count; ++i) {
+        GetVarint(&lengths, end, &value);
+        uint64_t length = value >> 2;
+        if (length > static_cast<uint64_t>(end - content)) return false;
+
+        std::string& url = batch[i].url;
+        switch (value & 3) {
+            case kUrlHttpsHost:
+                url = "https://" + batch[i].host;
+                break;
+            case kUrlHttpHost:
+                url = "http://" + batch[i].host;
+                break;
+            case kUrlRaw:
+                url.clear();
+                break;
+            default:
+                return false;
+        }
+        url.append(content, length);
+        content += length;
+    }
+
+    return content == end;
+}
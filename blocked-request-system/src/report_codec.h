@@ -0,0 +1,78 @@
+#ifndef REPORT_CODEC_H_
+#define REPORT_CODEC_H_
+
+#include "blocked_request_db.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// 上报批次的压缩方式，除kNone外都需要编译时找到对应的库
+enum class ReportCompression : uint8_t {
+    kNone = 0,
+    kZstd = 1,
+    kLz4 = 2,
+    kZlib = 3,
+};
+
+// 当前构建是否支持该压缩方式
+bool IsReportCompressionAvailable(ReportCompression compression);
+
+// 可用压缩方式中压缩率最好的一种（zstd > zlib > lz4 > 不压缩）
+ReportCompression DefaultReportCompression();
+
+const char* ReportCompressionName(ReportCompression compression);
+
+// 上报批次编码器
+// 把一批记录编码为一个紧凑的二进制负载：
+//   头部: "BRP1" | 版本(1字节) | 压缩方式(1字节) | 正文原始长度(varint)
+//   正文（按列存放，便于压缩）:
+//     记录数
+//     字符串表: host/reason/browser_id/country去重后按首次出现顺序存放
+//     id列、时间戳列: 与上一条的差值，zigzag + varint
+//     tab_id列: zigzag + varint
+//     host/reason/browser_id/country列: 字符串表下标（版本1没有country列）
+//     url列: 以"https://<host>"或"http://<host>"开头时只存剩余部分
+// 编码器复用内部缓冲区和压缩上下文，适合长期持有
+class ReportEncoder {
+public:
+    explicit ReportEncoder(ReportCompression compression = ReportCompression::kNone);
+    ~ReportEncoder();
+
+    ReportEncoder(const ReportEncoder&) = delete;
+    ReportEncoder& operator=(const ReportEncoder&) = delete;
+
+    // 编码一批记录，结果写入out（覆盖原内容）
+    // 压缩方式不可用或压缩失败时返回false
+    bool Encode(const std::vector<BlockedRequest>& requests, std::string* out);
+
+    ReportCompression compression() const { return compression_; }
+
+private:
+    uint32_t Intern(std::string_view value);
+
+    ReportCompression compression_;
+    std::string body_;
+    std::unordered_map<std::string_view, uint32_t> string_index_;
+    std::vector<std::string_view> strings_;
+    std::vector<uint32_t> columns_;
+    void* compression_context_ = nullptr;
+};
+
+// 上报批次解码器，供收集端使用
+class ReportDecoder {
+public:
+    // 解码负载，记录追加到requests；格式错误时返回false
+    // 解码出的记录reported为false，id与编码前一致
+    bool Decode(const char* data, size_t size, std::vector<BlockedRequest>* requests);
+
+private:
+    bool DecodeBody(std::vector<BlockedRequest>* requests);
+
+    std::string body_;
+    std::vector<std::string> strings_;
+    uint8_t version_ = 0;
+};
+
+#endif  // REPORT_CODEC_H_
@@ -0,0 +1,73 @@
+#include "request_batch.h"
+#include <algorithm>
+#include <cstring>
+
+BatchArena::BatchArena(size_t block_size)
+    : block_size_(block_size) {
+}
+
+char* BatchArena::Allocate(size_t size) {
+    // 当前块放得下则直接递增游标
+    if (current_block_ < blocks_.size() &&
+        offset_ + size <= blocks_[current_block_].size) {
+        char* result = blocks_[current_block_].data.get() + offset_;
+        offset_ += size;
+        return result;
+    }
+
+    // 复用Reset()之前留下的后续块
+    while (current_block_ + 1 < blocks_.size()) {
+        ++current_block_;
+        offset_ = 0;
+        if (size <= blocks_[current_block_].size) {
+            offset_ = size;
+            return blocks_[current_block_].data.get();
+        }
+    }
+
+    // 所有块都用完，申请新块；超长字符串单独占用一个块
+    size_t new_size = std::max(block_size_, size);
+    blocks_.push_back(Block{std::unique_ptr<char[]>(new char[new_size]), new_size});
+    bytes_reserved_ += new_size;
+    current_block_ = blocks_.size() - 1;
+    offset_ = size;
+    return blocks_[current_block_].data.get();
+}
+
+void BatchArena::Reset() {
+    current_block_ = 0;
+    offset_ = 0;
+}
+
+void RequestBatch::Add(const BlockedRequestView& request) {
+    // 所有字符串合并成一次arena分配
+    size_t total = request.url.size() + request.host.size() +
+                   request.reason.size() + request.browser_id.size() +
+                   request.dest_ip.size() + request.country.size();
+    char* cursor = arena_.Allocate(total);
+
+    auto copy = [&cursor](std::string_view value) {
+        if (!value.empty()) {
+            std::memcpy(cursor, value.data(), value.size());
+        }
+        std::string_view copied(cursor, value.size());
+        cursor += value.size();
+        return copied;
+    };
+
+    BlockedRequestView stored;
+    stored.url = copy(request.url);
+    stored.host = copy(request.host);
+    stored.reason = copy(request.reason);
+    stored.timestamp = request.timestamp;
+    stored.browser_id = copy(request.browser_id);
+    stored.tab_id = request.tab_id;
+    stored.dest_ip = copy(request.dest_ip);
+    stored.country = copy(request.country);
+    requests_.push_back(stored);
+}
+
+void RequestBatch::Clear() {
+    requests_.clear();
+    arena_.Reset();
+}
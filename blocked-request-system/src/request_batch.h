@@ -0,0 +1,77 @@
+#ifndef REQUEST_BATCH_H_
+#define REQUEST_BATCH_H_
+
+#include "blocked_request_db.h"
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// 批次内存arena
+// 按块做指针递增分配，Reset()只复位游标、保留所有块，
+// 因此同一个arena在稳定状态下反复使用不会再申请堆内存
+class BatchArena {
+public:
+    static constexpr size_t kDefaultBlockSize = 64 * 1024;
+
+    explicit BatchArena(size_t block_size = kDefaultBlockSize);
+
+    BatchArena(const BatchArena&) = delete;
+    BatchArena& operator=(const BatchArena&) = delete;
+    BatchArena(BatchArena&&) = default;
+    BatchArena& operator=(BatchArena&&) = default;
+
+    // 分配size字节，返回的内存在下一次Reset()之前有效
+    char* Allocate(size_t size);
+
+    // 复位游标，已分配的块保留给下一个批次
+    void Reset();
+
+    // 已申请的块总字节数
+    size_t bytes_reserved() const { return bytes_reserved_; }
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    size_t block_size_;
+    std::vector<Block> blocks_;
+    size_t current_block_ = 0;
+    size_t offset_ = 0;
+    size_t bytes_reserved_ = 0;
+};
+
+// 一个写入批次：请求视图 + 承载字符串内容的arena
+// 批次提交后调用Clear()整体回收，视图和arena的容量都保留
+class RequestBatch {
+public:
+    RequestBatch() = default;
+
+    RequestBatch(const RequestBatch&) = delete;
+    RequestBatch& operator=(const RequestBatch&) = delete;
+    RequestBatch(RequestBatch&&) = default;
+    RequestBatch& operator=(RequestBatch&&) = default;
+
+    // 预留请求数量
+    void Reserve(size_t count) { requests_.reserve(count); }
+
+    // 把请求的字符串复制进arena，并记录指向arena的视图
+    void Add(const BlockedRequestView& request);
+
+    // 清空批次，保留容量
+    void Clear();
+
+    bool empty() const { return requests_.empty(); }
+    size_t size() const { return requests_.size(); }
+    const std::vector<BlockedRequestView>& requests() const { return requests_; }
+
+    // 写入前的补全阶段修改视图（如填写country），新值的内存由调用方保证有效
+    std::vector<BlockedRequestView>* mutable_requests() { return &requests_; }
+
+private:
+    std::vector<BlockedRequestView> requests_;
+    BatchArena arena_;
+};
+
+#endif  // REQUEST_BATCH_H_
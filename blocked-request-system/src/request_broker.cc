@@ -0,0 +1,423 @@
+#include "request_broker.h"
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// 版本2增加country字段；版本1的请求帧按无效帧处理，断开连接
+const uint32_t kFrameMagic = 0x32515242;  // "BRQ2"
+
+// 单帧负载上限，防止异常客户端导致代理分配过大的内存
+const uint32_t kMaxPayloadSize = 64 * 1024 * 1024;
+
+struct FrameHeader {
+    uint32_t magic;
+    uint32_t payload_size;
+    uint64_t sequence;
+    uint32_t count;
+};
+
+struct RecordHeader {
+    int64_t timestamp;
+    int64_t tab_id;
+    uint32_t lengths[5];
+};
+
+struct AckFrame {
+    uint64_t sequence;
+    uint32_t status;
+};
+
+bool ReadFull(int fd, void* data, size_t size) {
+    char* cursor = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t n = recv(fd, cursor, size, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        cursor += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool WriteFull(int fd, const void* data, size_t size) {
+    const char* cursor = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = send(fd, cursor, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        cursor += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void AppendBytes(std::vector<char>* out, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    out->insert(out->end(), bytes, bytes + size);
+}
+
+// 把批次编码为一个请求帧
+void EncodeFrame(uint64_t sequence, const std::vector<BlockedRequestView>& batch,
+                 std::vector<char>* out) {
+    out->clear();
+    FrameHeader header = {kFrameMagic, 0, sequence,
+                          static_cast<uint32_t>(batch.size())};
+    AppendBytes(out, &header, sizeof(header));
+
+    for (const auto& request : batch) {
+        RecordHeader record = {
+            request.timestamp, request.tab_id,
+            {static_cast<uint32_t>(request.url.size()),
+             static_cast<uint32_t>(request.host.size()),
+             static_cast<uint32_t>(request.reason.size()),
+             static_cast<uint32_t>(request.browser_id.size()),
+             static_cast<uint32_t>(request.country.size())}};
+        AppendBytes(out, &record, sizeof(record));
+        AppendBytes(out, request.url.data(), request.url.size());
+        AppendBytes(out, request.host.data(), request.host.size());
+        AppendBytes(out, request.reason.data(), request.reason.size());
+        AppendBytes(out, request.browser_id.data(), request.browser_id.size());
+        AppendBytes(out, request.country.data(), request.country.size());
+    }
+
+    uint32_t payload_size = static_cast<uint32_t>(out->size() - sizeof(FrameHeader));
+    std::memcpy(out->data() + offsetof(FrameHeader, payload_size),
+                &payload_size, sizeof(payload_size));
+}
+
+// 解码负载中的记录，视图指向payload内部
+bool DecodeRecords(const std::vector<char>& payload, uint32_t count,
+                   std::vector<BlockedRequestView>* out) {
+    out->clear();
+    // count来自客户端，先按最小记录长度检查，再按它预留空间
+    if (count > payload.size() / sizeof(RecordHeader)) return false;
+    out->reserve(count);
+
+    size_t offset = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (payload.size() - offset < sizeof(RecordHeader)) return false;
+        RecordHeader record;
+        std::memcpy(&record, payload.data() + offset, sizeof(record));
+        offset += sizeof(record);
+
+        std::string_view fields[5];
+        for (int f = 0; f < 5; ++f) {
+            if (payload.size() - offset < record.lengths[f]) return false;
+            fields[f] = std::string_view(payload.data() + offset, record.lengths[f]);
+            offset += record.lengths[f];
+        }
+
+        // 客户端在发送前完成地理信息补全，只传输结果country；目的IP不落库，不传输
+        out->push_back(BlockedRequestView{fields[0], fields[1], fields[2],
+                                          record.timestamp, fields[3],
+                                          record.tab_id, {}, fields[4]});
+    }
+
+    return offset == payload.size();
+}
+
+}  // namespace
+
+// 客户端连接，批次在写线程回复确认前持有引用，保证fd不被提前关闭复用
+struct RequestBrokerServer::Connection
+    : std::enable_shared_from_this<Connection> {
+    explicit Connection(int fd) : fd(fd) {}
+    ~Connection() { close(fd); }
+
+    int fd;
+    std::thread reader;
+    std::atomic<bool> finished{false};
+};
+
+struct RequestBrokerServer::PendingBatch {
+    std::shared_ptr<Connection> connection;
+    uint64_t sequence;
+    std::vector<char> payload;
+    std::vector<BlockedRequestView> requests;
+};
+
+RequestBrokerServer::RequestBrokerServer(const Config& config)
+    : config_(config) {
+    stats_ = {0, 0, 0, 0, 0};
+}
+
+RequestBrokerServer::~RequestBrokerServer() {
+    Stop();
+}
+
+bool RequestBrokerServer::Start() {
+    if (running_.load()) return true;
+
+    if (!db_.Initialize(config_.db_path)) {
+        std::cerr << "代理数据库初始化失败: " << config_.db_path << std::endl;
+        return false;
+    }
+
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (config_.socket_path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "套接字路径过长: " << config_.socket_path << std::endl;
+        return false;
+    }
+    std::memcpy(addr.sun_path, config_.socket_path.c_str(), config_.socket_path.size());
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        return false;
+    }
+
+    // 清理上次异常退出留下的套接字文件
+    unlink(config_.socket_path.c_str());
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        listen(listen_fd_, 64) != 0) {
+        std::cerr << "监听失败: " << std::strerror(errno) << std::endl;
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+
+    running_.store(true);
+    writer_thread_ = std::thread(&RequestBrokerServer::WriterLoop, this);
+    accept_thread_ = std::thread(&RequestBrokerServer::AcceptLoop, this);
+
+    std::cout << "写入代理已启动: " << config_.socket_path << std::endl;
+    return true;
+}
+
+void RequestBrokerServer::Stop() {
+    if (!running_.load()) return;
+
+    running_.store(false);
+
+    // 唤醒accept
+    shutdown(listen_fd_, SHUT_RDWR);
+    if (accept_thread_.joinable()) {
+        accept_thread_.join();
+    }
+    close(listen_fd_);
+    listen_fd_ = -1;
+    unlink(config_.socket_path.c_str());
+
+    // 唤醒并等待所有连接的读线程
+    std::vector<std::shared_ptr<Connection>> connections;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        connections.swap(connections_);
+    }
+    for (const auto& connection : connections) {
+        shutdown(connection->fd, SHUT_RD);
+    }
+    for (const auto& connection : connections) {
+        connection->reader.join();
+    }
+    connections.clear();
+
+    // 写线程提交剩余批次后退出
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+    }
+    pending_cv_.notify_all();
+    if (writer_thread_.joinable()) {
+        writer_thread_.join();
+    }
+
+    std::cout << "写入代理已停止" << std::endl;
+}
+
+RequestBrokerServer::Stats RequestBrokerServer::GetStats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return stats_;
+}
+
+void RequestBrokerServer::AcceptLoop() {
+    while (running_.load()) {
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        auto connection = std::make_shared<Connection>(fd);
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            stats_.connections++;
+        }
+
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        ReapFinishedConnections();
+        connection->reader = std::thread(&RequestBrokerServer::ConnectionLoop,
+                                         this, connection.get());
+        connections_.push_back(std::move(connection));
+    }
+}
+
+void RequestBrokerServer::ReapFinishedConnections() {
+    for (auto it = connections_.begin(); it != connections_.end();) {
+        if ((*it)->finished.load()) {
+            (*it)->reader.join();
+            it = connections_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void RequestBrokerServer::ConnectionLoop(Connection* connection) {
+    while (running_.load()) {
+        FrameHeader header;
+        if (!ReadFull(connection->fd, &header, sizeof(header))) break;
+        if (header.magic != kFrameMagic || header.payload_size > kMaxPayloadSize) {
+            std::cerr << "收到无效的请求帧，断开连接" << std::endl;
+            break;
+        }
+
+        PendingBatch batch;
+        batch.connection = connection->shared_from_this();
+        batch.sequence = header.sequence;
+        batch.payload.resize(header.payload_size);
+        if (!ReadFull(connection->fd, batch.payload.data(), batch.payload.size())) break;
+
+        if (!DecodeRecords(batch.payload, header.count, &batch.requests)) {
+            std::cerr << "请求帧解码失败，断开连接" << std::endl;
+            break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            stats_.batches++;
+            stats_.requests += header.count;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            pending_.push_back(std::move(batch));
+        }
+        pending_cv_.notify_one();
+    }
+
+    // 由AcceptLoop或Stop回收；未确认的批次仍持有连接，写线程回复后才真正关闭fd
+    connection->finished.store(true);
+}
+
+void RequestBrokerServer::WriterLoop() {
+    std::vector<PendingBatch> group;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(pending_mutex_);
+            pending_cv_.wait(lock, [this] {
+                return !pending_.empty() || !running_.load();
+            });
+
+            if (pending_.empty()) {
+                // 已停止且没有剩余批次
+                break;
+            }
+
+            // 取出此刻排队的所有批次，合并到一次提交中
+            size_t group_requests = 0;
+            while (!pending_.empty() &&
+                   (group.empty() ||
+                    group_requests + pending_.front().requests.size() <=
+                        config_.max_group_requests)) {
+                group_requests += pending_.front().requests.size();
+                group.push_back(std::move(pending_.front()));
+                pending_.pop_front();
+            }
+        }
+
+        CommitGroup(&group);
+        group.clear();
+    }
+}
+
+void RequestBrokerServer::CommitGroup(std::vector<PendingBatch>* group) {
+    group_requests_.clear();
+    for (const auto& batch : *group) {
+        group_requests_.insert(group_requests_.end(), batch.requests.begin(),
+                               batch.requests.end());
+    }
+
+    bool success = group_requests_.empty() || db_.AddBlockedRequests(group_requests_);
+
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.commits++;
+        if (!success) {
+            stats_.failed_commits++;
+        }
+    }
+
+    // 逐个回复确认；客户端已断开时发送失败，直接忽略
+    for (const auto& batch : *group) {
+        AckFrame ack = {batch.sequence, success ? 1u : 0u};
+        WriteFull(batch.connection->fd, &ack, sizeof(ack));
+    }
+}
+
+RequestBrokerClient::RequestBrokerClient(const std::string& socket_path)
+    : socket_path_(socket_path) {
+}
+
+RequestBrokerClient::~RequestBrokerClient() {
+    Close();
+}
+
+bool RequestBrokerClient::Connect() {
+    if (fd_ >= 0) return true;
+
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path_.size() >= sizeof(addr.sun_path)) {
+        return false;
+    }
+    std::memcpy(addr.sun_path, socket_path_.c_str(), socket_path_.size());
+
+    fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) {
+        return false;
+    }
+
+    if (connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void RequestBrokerClient::Close() {
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool RequestBrokerClient::SendBatch(const std::vector<BlockedRequestView>& batch) {
+    if (fd_ < 0 || batch.empty()) {
+        return false;
+    }
+
+    uint64_t sequence = next_sequence_++;
+    EncodeFrame(sequence, batch, &buffer_);
+    if (!WriteFull(fd_, buffer_.data(), buffer_.size())) {
+        Close();
+        return false;
+    }
+
+    AckFrame ack;
+    if (!ReadFull(fd_, &ack, sizeof(ack)) || ack.sequence != sequence) {
+        Close();
+        return false;
+    }
+
+    return ack.status == 1;
+}
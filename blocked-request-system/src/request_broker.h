@@ -0,0 +1,118 @@
+#ifndef REQUEST_BROKER_H_
+#define REQUEST_BROKER_H_
+
+#include "blocked_request_db.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 单写者代理
+// 多个浏览器进程共用一个数据库文件时，各自的写连接会争抢WAL写锁。
+// 代理进程独占唯一的写连接，客户端通过Unix域套接字发送批次，
+// 代理把同一时刻到达的多个客户端批次合并到一个事务中提交（group commit），
+// 提交后再逐个回复确认。
+//
+// 线路格式（本机通信，使用主机字节序）：
+//   请求帧: magic(u32) payload_size(u32) sequence(u64) count(u32) 记录...
+//   记录:   timestamp(i64) tab_id(i64) 五个字符串长度(u32 x5)
+//           字符串内容(url host reason browser_id country)
+//   确认帧: sequence(u64) status(u32, 1=已提交 0=失败)
+
+// 代理服务端
+class RequestBrokerServer {
+public:
+    struct Config {
+        std::string socket_path;             // Unix域套接字路径
+        std::string db_path;                 // 数据库路径
+        size_t max_group_requests = 20000;   // 单次合并提交的最大条数
+    };
+
+    struct Stats {
+        int64_t connections;                 // 累计连接数
+        int64_t batches;                     // 收到的批次数
+        int64_t requests;                    // 收到的请求数
+        int64_t commits;                     // 合并提交次数
+        int64_t failed_commits;              // 失败的提交次数
+    };
+
+    explicit RequestBrokerServer(const Config& config);
+    ~RequestBrokerServer();
+
+    // 打开数据库并开始监听
+    bool Start();
+
+    // 停止监听，断开所有客户端，提交剩余批次
+    void Stop();
+
+    Stats GetStats() const;
+
+    BlockedRequestDB* GetDatabase() { return &db_; }
+
+private:
+    struct Connection;
+    struct PendingBatch;
+
+    void AcceptLoop();
+    void ConnectionLoop(Connection* connection);
+
+    // 回收已结束的连接线程，调用方持有connections_mutex_
+    void ReapFinishedConnections();
+
+    void WriterLoop();
+
+    // 提交一组批次并回复确认
+    void CommitGroup(std::vector<PendingBatch>* group);
+
+    Config config_;
+    BlockedRequestDB db_;
+    int listen_fd_ = -1;
+    std::atomic<bool> running_{false};
+
+    std::thread accept_thread_;
+    std::thread writer_thread_;
+
+    // 客户端连接，每个连接一个读线程
+    std::mutex connections_mutex_;
+    std::vector<std::shared_ptr<Connection>> connections_;
+
+    // 等待提交的批次
+    std::mutex pending_mutex_;
+    std::condition_variable pending_cv_;
+    std::deque<PendingBatch> pending_;
+
+    // 合并提交时复用的视图缓冲区，只在写线程中使用
+    std::vector<BlockedRequestView> group_requests_;
+
+    mutable std::mutex stats_mutex_;
+    Stats stats_;
+};
+
+// 代理客户端
+// 非线程安全，每个SmartBatchManager持有一个
+class RequestBrokerClient {
+public:
+    explicit RequestBrokerClient(const std::string& socket_path);
+    ~RequestBrokerClient();
+
+    bool Connect();
+    void Close();
+    bool IsConnected() const { return fd_ >= 0; }
+
+    // 发送一个批次并等待代理确认，返回批次是否已提交
+    bool SendBatch(const std::vector<BlockedRequestView>& batch);
+
+private:
+    std::string socket_path_;
+    int fd_ = -1;
+    uint64_t next_sequence_ = 1;
+
+    // 复用的编码缓冲区
+    std::vector<char> buffer_;
+};
+
+#endif  // REQUEST_BROKER_H_
@@ -0,0 +1,32 @@
+#include "request_store.h"
+
+SqliteRequestStore::SqliteRequestStore(SchemaProfile profile)
+    : has_profile_(true), profile_(profile) {
+}
+
+bool SqliteRequestStore::Open(const std::string& path) {
+    if (has_profile_) {
+        return db_.Initialize(path, profile_);
+    }
+    return db_.Initialize(path);
+}
+
+void SqliteRequestStore::Close() {
+    db_.Close();
+}
+
+bool SqliteRequestStore::AppendBatch(const std::vector<BlockedRequestView>& batch) {
+    return db_.AddBlockedRequests(batch);
+}
+
+std::vector<BlockedRequest> SqliteRequestStore::ScanUnreported(int limit) {
+    return db_.GetUnreportedRequests(limit);
+}
+
+bool SqliteRequestStore::Ack(const std::vector<int64_t>& ids) {
+    return db_.MarkAsReported(ids);
+}
+
+bool SqliteRequestStore::Expire(int64_t cutoff_timestamp) {
+    return db_.DeleteReportedRequestsBefore(cutoff_timestamp);
+}
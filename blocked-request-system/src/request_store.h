@@ -0,0 +1,53 @@
+#ifndef REQUEST_STORE_H_
+#define REQUEST_STORE_H_
+
+#include "blocked_request_db.h"
+#include <string>
+#include <vector>
+
+// 拦截记录存储后端接口
+// SmartBatchManager的负载只有四种操作：批量追加、按写入顺序扫描未上报记录、
+// 确认上报、按时间清理，存储后端只需实现这四种操作
+class RequestStore {
+public:
+    virtual ~RequestStore() = default;
+
+    // 打开存储，path的含义由后端决定（数据库文件或目录）
+    virtual bool Open(const std::string& path) = 0;
+    virtual void Close() = 0;
+
+    // 追加一批记录，整批成功或整批失败
+    virtual bool AppendBatch(const std::vector<BlockedRequestView>& batch) = 0;
+
+    // 按写入顺序返回最多limit条未上报记录
+    virtual std::vector<BlockedRequest> ScanUnreported(int limit) = 0;
+
+    // 确认记录已上报
+    virtual bool Ack(const std::vector<int64_t>& ids) = 0;
+
+    // 清理时间戳早于cutoff_timestamp（毫秒）的已上报记录
+    virtual bool Expire(int64_t cutoff_timestamp) = 0;
+};
+
+// SQLite后端，封装BlockedRequestDB
+class SqliteRequestStore : public RequestStore {
+public:
+    SqliteRequestStore() = default;
+    explicit SqliteRequestStore(SchemaProfile profile);
+
+    bool Open(const std::string& path) override;
+    void Close() override;
+    bool AppendBatch(const std::vector<BlockedRequestView>& batch) override;
+    std::vector<BlockedRequest> ScanUnreported(int limit) override;
+    bool Ack(const std::vector<int64_t>& ids) override;
+    bool Expire(int64_t cutoff_timestamp) override;
+
+    BlockedRequestDB* database() { return &db_; }
+
+private:
+    BlockedRequestDB db_;
+    bool has_profile_ = false;
+    SchemaProfile profile_ = SchemaProfile::kWriteOptimized;
+};
+
+#endif  // REQUEST_STORE_H_
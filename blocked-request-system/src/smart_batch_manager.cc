@@ -1,57 +1,300 @@
 #include "smart_batch_manager.h"
+#include <algorithm>
 #include <iostream>
+#include <utility>
 
 SmartBatchManager::SmartBatchManager(const std::string& db_path)
-    : db_path_(db_path) {
+    : SmartBatchManager(db_path, std::make_unique<SqliteRequestStore>()) {
+}
+
+SmartBatchManager::SmartBatchManager(const std::string& store_path,
+                                     std::unique_ptr<RequestStore> store)
+    : store_(std::move(store)), db_path_(store_path) {
     stats_ = {0, 0, 0, 0, 0, 0, 0, false};
+    BuildLanes();
     last_flush_time_ = std::chrono::steady_clock::now();
 }
 
 SmartBatchManager::~SmartBatchManager() {
     Stop();
+    io_executor_.Stop();
+
+    // 未启动时缓冲区不会被刷新，让等待中的future以失败结束
+    for (auto& lane : lanes_) {
+        if (lane->active_promise) {
+            lane->active_promise->set_value(false);
+        }
+    }
 }
 
 bool SmartBatchManager::Initialize() {
-    return db_.Initialize(db_path_);
+    bool success = false;
+    if (!config_.broker_socket_path.empty()) {
+        broker_client_ = std::make_unique<RequestBrokerClient>(config_.broker_socket_path);
+        success = broker_client_->Connect();
+    } else {
+        success = store_->Open(db_path_);
+    }
+
+    if (success) {
+        io_executor_.Start();
+    }
+    return success;
+}
+
+BlockedRequestDB* SmartBatchManager::GetDatabase() {
+    auto* sqlite_store = dynamic_cast<SqliteRequestStore*>(store_.get());
+    return sqlite_store ? sqlite_store->database() : nullptr;
+}
+
+void SmartBatchManager::BuildLanes() {
+    std::vector<LaneConfig> configs = config_.lanes;
+    if (configs.empty()) {
+        LaneConfig lane;
+        lane.name = "default";
+        lane.batch_size = config_.batch_size;
+        lane.max_delay_ms = config_.flush_interval_minutes * 60 * 1000;
+        configs.push_back(lane);
+    }
+    if (configs.size() > 64) {
+        std::cerr << "优先级通道超过64个，多余的通道被忽略" << std::endl;
+        configs.resize(64);
+    }
+
+    lanes_.clear();
+    reason_routes_.clear();
+    for (size_t i = 0; i < configs.size(); ++i) {
+        auto lane = std::make_unique<Lane>();
+        lane->index = i;
+        lane->config = configs[i];
+        lane->config.batch_size = std::max<size_t>(lane->config.batch_size, 1);
+        lane->max_delay = std::chrono::milliseconds(std::max(lane->config.max_delay_ms, 0));
+        lane->active_batch.Reserve(lane->config.batch_size);
+        lane->standby_batch.Reserve(lane->config.batch_size);
+        for (const auto& reason : lane->config.reasons) {
+            reason_routes_.emplace_back(reason, i);
+        }
+        lanes_.push_back(std::move(lane));
+    }
+    lane_generation_++;
+
+    flushing_lanes_.clear();
+    flushing_lanes_.reserve(lanes_.size());
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    lane_stats_.assign(lanes_.size(), LaneStats{});
+    for (size_t i = 0; i < lanes_.size(); ++i) {
+        lane_stats_[i].name = lanes_[i]->config.name;
+    }
+}
+
+size_t SmartBatchManager::LaneIndex(std::string_view reason) const {
+    if (lanes_.size() == 1) return 0;
+
+    for (const auto& route : reason_routes_) {
+        if (route.first == reason) {
+            return route.second;
+        }
+    }
+    return lanes_.size() - 1;
 }
 
 void SmartBatchManager::AddRequest(const BlockedRequest& request) {
+    AddRequest(MakeRequestView(request));
+}
+
+void SmartBatchManager::AddRequest(const BlockedRequestView& request) {
+    AddToBatch(request, nullptr);
+}
+
+std::shared_future<bool> SmartBatchManager::AddRequestAsync(const BlockedRequest& request) {
+    return AddRequestAsync(MakeRequestView(request));
+}
+
+std::shared_future<bool> SmartBatchManager::AddRequestAsync(const BlockedRequestView& request) {
+    std::shared_future<bool> future;
+    AddToBatch(request, &future);
+    return future;
+}
+
+void SmartBatchManager::AddToBatch(const BlockedRequestView& request,
+                                   std::shared_future<bool>* future) {
+    bool should_flush = false;
+    bool wake_scheduler = false;
+    size_t lane_index = 0;
+    size_t lane_buffered = 0;
+    int64_t buffered = 0;
+
     {
-        std::lock_guard<std::mutex> lock(stats_mutex_);
+        std::lock_guard<std::mutex> lock(batch_mutex_);
+        lane_index = LaneIndex(request.reason);
+        Lane& lane = *lanes_[lane_index];
+
+        // 批次的第一条请求决定该通道的截止时间
+        if (lane.active_batch.empty()) {
+            lane.oldest_time = std::chrono::steady_clock::now();
+            wake_scheduler = true;
+        }
+        lane.active_batch.Add(request);
+        if (sketches_) {
+            sketches_->Add(request);
+        }
+        if (future) {
+            if (!lane.active_promise) {
+                lane.active_promise.emplace();
+                lane.active_future = lane.active_promise->get_future().share();
+            }
+            *future = lane.active_future;
+        }
+
+        lane_buffered = lane.active_batch.size();
+        for (const auto& each : lanes_) {
+            buffered += static_cast<int64_t>(each->active_batch.size());
+        }
+        should_flush = config_.enable_immediate_flush &&
+                       lane_buffered >= lane.config.batch_size;
+
+        // 需要补全时不在调用线程上刷新，标记后由调度线程处理
+        if (should_flush && config_.geo_enricher && config_.enable_timer_flush &&
+            running_.load()) {
+            should_flush = false;
+            if (!lane.size_due) {
+                lane.size_due = true;
+                wake_scheduler = true;
+            }
+        }
+
+        // 仍持有batch_mutex_：SetConfig()不能在此之前重建通道和lane_stats_，
+        // 计数一定落在刚写入的通道上
+        std::lock_guard<std::mutex> stats_lock(stats_mutex_);
         stats_.total_requests++;
+        stats_.buffered_requests = buffered;
+        lane_stats_[lane_index].total_requests++;
+        lane_stats_[lane_index].buffered_requests = static_cast<int64_t>(lane_buffered);
     }
-    
+
+    if (should_flush) {
+        FlushLanes(uint64_t{1} << lane_index, FlushTrigger::kSize);
+    } else if (wake_scheduler) {
+        scheduler_cv_.notify_one();
+    }
+}
+
+void SmartBatchManager::FlushBatch() {
+    FlushLanes(~uint64_t{0}, FlushTrigger::kManual);
+}
+
+size_t SmartBatchManager::FlushLanes(uint64_t lane_mask, FlushTrigger trigger) {
+    std::lock_guard<std::mutex> flush_lock(flush_mutex_);
+    flushing_lanes_.clear();
+
     {
         std::lock_guard<std::mutex> lock(batch_mutex_);
-        request_batch_.push_back(request);
-        stats_.buffered_requests = request_batch_.size();
-        FlushBatch();
+        auto now = std::chrono::steady_clock::now();
 
-        if (config_.enable_immediate_flush && 
-            request_batch_.size() >= config_.batch_size) {
-            FlushBatch();
+        for (size_t i = 0; i < lanes_.size(); ++i) {
+            Lane& lane = *lanes_[i];
+            if (lane.active_batch.empty()) continue;
+
+            // 超过最长等待时间的通道随本次写入一起提交，
+            // 高优先级通道持续刷新时低优先级通道也不会饿死
+            bool requested = lane_mask & (uint64_t{1} << i);
+            auto waited = now - lane.oldest_time;
+            if (!requested && waited < lane.max_delay) continue;
+
+            std::swap(lane.active_batch, lane.standby_batch);
+            std::swap(lane.active_promise, lane.standby_promise);
+            lane.size_due = false;
+            lane.active_future = std::shared_future<bool>();
+            lane.flushing_sequence = lane.active_sequence++;
+            lane.flushing_trigger = trigger;
+            lane.flushing_piggyback = !requested;
+            lane.flushing_wait_ms =
+                std::chrono::duration_cast<std::chrono::milliseconds>(waited).count();
+            flushing_lanes_.push_back(&lane);
         }
     }
-}
 
-void SmartBatchManager::FlushBatch() {
-    std::vector<BlockedRequest> batch;
-    
+    if (flushing_lanes_.empty()) return 0;
+
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        for (Lane* lane : flushing_lanes_) {
+            int64_t size = static_cast<int64_t>(lane->standby_batch.size());
+            stats_.buffered_requests -= size;
+
+            LaneStats& stats = lane_stats_[lane->index];
+            stats.buffered_requests = 0;
+            stats.flushed_requests += size;
+            stats.flush_operations++;
+            if (lane->flushing_piggyback) {
+                stats.piggyback_flushes++;
+            } else if (lane->flushing_trigger == FlushTrigger::kSize) {
+                stats.size_flushes++;
+            } else if (lane->flushing_trigger == FlushTrigger::kDeadline) {
+                stats.deadline_flushes++;
+            }
+            stats.max_wait_ms = std::max(stats.max_wait_ms, lane->flushing_wait_ms);
+            stats.total_wait_ms += lane->flushing_wait_ms;
+        }
+    }
+
+    // 只有一个通道时直接写入它的批次，否则按优先级顺序合并
+    std::vector<BlockedRequestView>* batch = flushing_lanes_.front()->standby_batch.mutable_requests();
+    if (flushing_lanes_.size() > 1) {
+        combined_batch_.clear();
+        for (Lane* lane : flushing_lanes_) {
+            const auto& requests = lane->standby_batch.requests();
+            combined_batch_.insert(combined_batch_.end(), requests.begin(), requests.end());
+        }
+        batch = &combined_batch_;
+    }
+
+    size_t batch_size = batch->size();
+    EnrichBatch(batch);
+    bool success = ExecuteBatchWrite(*batch);
+    UpdateStats(trigger == FlushTrigger::kDeadline, batch_size);
+
+    for (Lane* lane : flushing_lanes_) {
+        // 提交后整体回收批次，arena和容量留给下一次交换
+        lane->standby_batch.Clear();
+
+        // 通知异步调用方
+        if (lane->standby_promise) {
+            lane->standby_promise->set_value(success);
+            lane->standby_promise.reset();
+        }
+    }
+
+    // 通知WaitForFlushComplete()
     {
         std::lock_guard<std::mutex> lock(batch_mutex_);
-        if (request_batch_.empty()) return;
-        
-        batch.swap(request_batch_);
-        stats_.buffered_requests = 0;
+        for (Lane* lane : flushing_lanes_) {
+            lane->committed_sequence = lane->flushing_sequence;
+        }
     }
-    
-    if (!batch.empty()) {
-        ExecuteBatchWrite(batch);
+    flush_cv_.notify_all();
+
+    return batch_size;
+}
+
+void SmartBatchManager::EnrichBatch(std::vector<BlockedRequestView>* batch) {
+    if (config_.geo_enricher) {
+        config_.geo_enricher->Enrich(batch);
     }
 }
 
-void SmartBatchManager::ExecuteBatchWrite(const std::vector<BlockedRequest>& batch) {
-    bool success = db_.AddBlockedRequests(batch);
+bool SmartBatchManager::ExecuteBatchWrite(const std::vector<BlockedRequestView>& batch) {
+    bool success = false;
+    if (broker_client_) {
+        // 代理重启后连接会断开，重连后重试一次
+        success = broker_client_->SendBatch(batch);
+        if (!success && !broker_client_->IsConnected() && broker_client_->Connect()) {
+            success = broker_client_->SendBatch(batch);
+        }
+    } else {
+        success = store_->AppendBatch(batch);
+    }
     
     if (success) {
         std::cout << "批量写入成功: " << batch.size() << " 条记录" << std::endl;
@@ -60,6 +303,7 @@ void SmartBatchManager::ExecuteBatchWrite(const std::vector<BlockedRequest>& bat
     }
     
     last_flush_time_ = std::chrono::steady_clock::now();
+    return success;
 }
 
 void SmartBatchManager::UpdateStats(bool is_timer_flush, size_t batch_size) {
@@ -77,13 +321,53 @@ void SmartBatchManager::UpdateStats(bool is_timer_flush, size_t batch_size) {
     }
 }
 
+std::shared_ptr<const StreamSketches> SmartBatchManager::GetSketches() const {
+    std::lock_guard<std::mutex> lock(batch_mutex_);
+    return sketches_;
+}
+
 SmartBatchManager::Stats SmartBatchManager::GetStats() const {
     std::lock_guard<std::mutex> lock(stats_mutex_);
     return stats_;
 }
 
+std::vector<SmartBatchManager::LaneStats> SmartBatchManager::GetLaneStats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return lane_stats_;
+}
+
 void SmartBatchManager::SetConfig(const Config& config) {
+    std::lock_guard<std::mutex> flush_lock(flush_mutex_);
+    std::lock_guard<std::mutex> lock(batch_mutex_);
+
+    // 通道重建前提交旧通道中缓冲的请求；持有batch_mutex_，期间不会有新请求进入旧通道
+    for (auto& lane : lanes_) {
+        if (lane->active_batch.empty()) continue;
+
+        EnrichBatch(lane->active_batch.mutable_requests());
+        bool success = ExecuteBatchWrite(lane->active_batch.requests());
+        UpdateStats(false, lane->active_batch.size());
+        lane->active_batch.Clear();
+        if (lane->active_promise) {
+            lane->active_promise->set_value(success);
+            lane->active_promise.reset();
+        }
+    }
+
     config_ = config;
+    BuildLanes();
+
+    // 统计参数不变时保留已有数据
+    if (!config_.enable_sketches) {
+        sketches_.reset();
+    } else if (!sketches_ || !sketches_->HasOptions(config_.sketch_options)) {
+        sketches_ = std::make_shared<StreamSketches>(config_.sketch_options);
+    }
+    {
+        std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+        stats_.buffered_requests = 0;
+    }
+    flush_cv_.notify_all();
 }
 
 void SmartBatchManager::Start() {
@@ -93,7 +377,7 @@ void SmartBatchManager::Start() {
     stats_.is_running = true;
     
     if (config_.enable_timer_flush) {
-        timer_thread_ = std::thread(&SmartBatchManager::TimerLoop, this);
+        scheduler_thread_ = std::thread(&SmartBatchManager::SchedulerLoop, this);
     }
     
     std::cout << "智能批量管理器已启动" << std::endl;
@@ -101,41 +385,108 @@ void SmartBatchManager::Start() {
 
 void SmartBatchManager::Stop() {
     if (!running_.load()) return;
-    
-    running_.store(false);
+
+    {
+        // 持有batch_mutex_修改，避免调度线程错过唤醒
+        std::lock_guard<std::mutex> lock(batch_mutex_);
+        running_.store(false);
+    }
+    scheduler_cv_.notify_all();
     stats_.is_running = false;
-    
-    if (timer_thread_.joinable()) {
-        timer_thread_.join();
+
+    if (scheduler_thread_.joinable()) {
+        scheduler_thread_.join();
     }
-    
+
     FlushBatch();
     std::cout << "智能批量管理器已停止" << std::endl;
 }
 
-void SmartBatchManager::TimerLoop() {
+void SmartBatchManager::SchedulerLoop() {
+    std::unique_lock<std::mutex> lock(batch_mutex_);
     while (running_.load()) {
-        std::this_thread::sleep_for(std::chrono::minutes(config_.flush_interval_minutes));
-        
-        if (running_.load()) {
-            FlushBatch();
-            
-            {
-                std::lock_guard<std::mutex> lock(batch_mutex_);
-                if (!request_batch_.empty()) {
-                    UpdateStats(true, request_batch_.size());
-                }
+        auto now = std::chrono::steady_clock::now();
+        auto next_deadline = std::chrono::steady_clock::time_point::max();
+        uint64_t due_lanes = 0;
+        uint64_t size_lanes = 0;
+
+        for (size_t i = 0; i < lanes_.size(); ++i) {
+            const Lane& lane = *lanes_[i];
+            if (lane.active_batch.empty()) continue;
+            if (lane.size_due) {
+                size_lanes |= uint64_t{1} << i;
+                continue;
+            }
+
+            auto deadline = lane.oldest_time + lane.max_delay;
+            if (deadline <= now) {
+                due_lanes |= uint64_t{1} << i;
+            } else {
+                next_deadline = std::min(next_deadline, deadline);
             }
         }
+
+        if (size_lanes || due_lanes) {
+            lock.unlock();
+            if (size_lanes) {
+                FlushLanes(size_lanes, FlushTrigger::kSize);
+            }
+            if (due_lanes) {
+                FlushLanes(due_lanes, FlushTrigger::kDeadline);
+            }
+            lock.lock();
+            continue;
+        }
+
+        // 没有缓冲请求时一直等到新请求加入
+        if (next_deadline == std::chrono::steady_clock::time_point::max()) {
+            scheduler_cv_.wait(lock);
+        } else {
+            scheduler_cv_.wait_until(lock, next_deadline);
+        }
     }
 }
 
 void SmartBatchManager::WaitForFlushComplete() {
-    while (true) {
-        {
-            std::lock_guard<std::mutex> lock(batch_mutex_);
-            if (request_batch_.empty()) break;
-        }
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::unique_lock<std::mutex> lock(batch_mutex_);
+
+    // 每个通道当前批次为空时只需等待它正在写入的批次
+    std::vector<uint64_t> targets;
+    for (const auto& lane : lanes_) {
+        targets.push_back(lane->active_batch.empty() ? lane->active_sequence - 1
+                                                     : lane->active_sequence);
     }
+
+    uint64_t generation = lane_generation_;
+    flush_cv_.wait(lock, [this, &targets, generation] {
+        if (lane_generation_ != generation) return true;
+        for (size_t i = 0; i < lanes_.size(); ++i) {
+            if (lanes_[i]->committed_sequence < targets[i]) return false;
+        }
+        return true;
+    });
+}
+
+bool SmartBatchManager::OpenReadDatabase() {
+    return read_db_.IsValid() || read_db_.InitializeReadOnly(db_path_);
+}
+
+std::future<std::vector<BlockedRequest>> SmartBatchManager::GetUnreportedRequestsAsync(int limit) {
+    return io_executor_.Submit([this, limit] {
+        if (!GetDatabase()) {
+            return store_->ScanUnreported(limit);
+        }
+        return OpenReadDatabase() ? read_db_.GetUnreportedRequests(limit)
+                                  : std::vector<BlockedRequest>();
+    });
+}
+
+std::future<BlockedRequestDB::Statistics> SmartBatchManager::GetStatisticsAsync() {
+    return io_executor_.Submit([this] {
+        BlockedRequestDB::Statistics stats = {0, 0, 0, 0};
+        if (GetDatabase() && OpenReadDatabase()) {
+            stats = read_db_.GetStatistics();
+        }
+        return stats;
+    });
 }
@@ -2,32 +2,79 @@
 #define SMART_BATCH_MANAGER_H_
 
 #include "blocked_request_db.h"
+#include "geo_enricher.h"
+#include "io_executor.h"
+#include "request_batch.h"
+#include "request_broker.h"
+#include "request_store.h"
+#include "stream_sketches.h"
 #include <vector>
 #include <mutex>
 #include <thread>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string_view>
 
 // 智能批量管理器
 // 实现数量触发 + 时间触发的双重机制
+// 请求按拦截原因进入不同优先级的通道，每个通道有独立的批次和刷新策略
 class SmartBatchManager {
 public:
+    // 优先级通道配置
+    struct LaneConfig {
+        std::string name;
+        std::vector<std::string> reasons;    // 路由到该通道的拦截原因
+        size_t batch_size = 10;              // 数量触发阈值
+        int max_delay_ms = 60000;            // 批次中最早一条请求的最长等待时间
+    };
+
     // 配置参数
     struct Config {
         size_t batch_size = 10;              // 批量大小
         int flush_interval_minutes = 1;      // 刷新间隔（分钟）
         bool enable_immediate_flush = true;  // 是否启用立即刷新
         bool enable_timer_flush = true;      // 是否启用定时刷新
+        std::string broker_socket_path;      // 非空时通过写入代理提交，不直接写数据库
+
+        // 优先级通道，按优先级从高到低排列，最多64个
+        // 为空时只有一个通道，使用batch_size和flush_interval_minutes；
+        // 不为空时reasons中未列出的请求进入最后一个通道
+        std::vector<LaneConfig> lanes;
+
+        // 请求到达时更新流式统计（高频host/reason、不同url数），供看板查询
+        bool enable_sketches = false;
+        StreamSketches::Options sketch_options;
+
+        // 非空时在批次写入前按dest_ip补全country
+        // 补全在刷新线程上执行：调度线程运行时，数量触发的刷新也交给调度线程，
+        // AddRequest()只负责放入批次
+        std::shared_ptr<GeoEnricher> geo_enricher;
     };
 
+    // 默认使用SQLite后端
     explicit SmartBatchManager(const std::string& db_path);
+    // 使用指定的存储后端，store_path传给RequestStore::Open()
+    SmartBatchManager(const std::string& store_path, std::unique_ptr<RequestStore> store);
     ~SmartBatchManager();
 
     // 初始化管理器
+    // 代理模式需要在Initialize()之前调用SetConfig()
     bool Initialize();
 
     // 添加拦截请求
+    // 字符串内容复制进当前批次的arena，稳定状态下不申请堆内存
     void AddRequest(const BlockedRequest& request);
+    void AddRequest(const BlockedRequestView& request);
+
+    // 添加拦截请求，返回所在批次提交后就绪的future
+    // 值为该批次是否写入成功；同一批次的调用方共享同一个future，
+    // 不会为了等待而提前刷新批次
+    std::shared_future<bool> AddRequestAsync(const BlockedRequest& request);
+    std::shared_future<bool> AddRequestAsync(const BlockedRequestView& request);
 
     // 强制刷新缓冲区
     void FlushBatch();
@@ -49,44 +96,138 @@ public:
     };
     Stats GetStats() const;
 
+    // 每个通道的统计信息，顺序与配置一致
+    struct LaneStats {
+        std::string name;
+        int64_t total_requests;           // 进入该通道的请求数
+        int64_t buffered_requests;        // 缓冲中的请求数
+        int64_t flushed_requests;         // 已刷新的请求数
+        int64_t flush_operations;         // 刷新次数
+        int64_t size_flushes;             // 数量触发刷新次数
+        int64_t deadline_flushes;         // 达到最长等待时间触发的刷新次数
+        int64_t piggyback_flushes;        // 超时后随其他通道一起提交的次数
+        int64_t max_wait_ms;              // 批次最早请求的最长等待时间
+        int64_t total_wait_ms;            // 每次刷新时最早请求等待时间之和
+    };
+    std::vector<LaneStats> GetLaneStats() const;
+
     // 设置配置
     void SetConfig(const Config& config);
 
-    // 获取数据库实例
-    BlockedRequestDB* GetDatabase() { return &db_; }
+    // 获取数据库实例，非SQLite后端返回nullptr
+    BlockedRequestDB* GetDatabase();
 
-    // 等待所有数据刷新完成
+    // 获取存储后端
+    RequestStore* GetStore() { return store_.get(); }
+
+    // 获取流式统计，未启用时返回nullptr
+    std::shared_ptr<const StreamSketches> GetSketches() const;
+
+    // 等待调用时已缓冲的请求全部提交（不触发刷新）
+    // 期间SetConfig()会先提交全部缓冲请求，此时也会返回
     void WaitForFlushComplete();
 
+    // 异步读取，在I/O执行器线程上使用独立的只读连接执行
+    // 非SQLite后端时未上报记录从存储后端读取，统计信息返回全零
+    std::future<std::vector<BlockedRequest>> GetUnreportedRequestsAsync(int limit = 100);
+    std::future<BlockedRequestDB::Statistics> GetStatisticsAsync();
+
 private:
-    // 定时刷新线程
-    void TimerLoop();
+    enum class FlushTrigger {
+        kSize,       // 数量触发
+        kDeadline,   // 达到最长等待时间
+        kManual,     // FlushBatch()/Stop()
+    };
+
+    // 一个优先级通道
+    // 批次、promise和序号受batch_mutex_保护；flushing_*只在持有flush_mutex_时访问
+    struct Lane {
+        size_t index = 0;
+        LaneConfig config;
+        std::chrono::milliseconds max_delay{0};
+
+        // active_batch接收新请求，standby_batch用于写入，两个批次循环复用
+        RequestBatch active_batch;
+        RequestBatch standby_batch;
+        std::chrono::steady_clock::time_point oldest_time;  // active_batch第一条请求的加入时间
+        bool size_due = false;             // 已达到数量阈值，等待调度线程刷新
+
+        // 只有异步调用方加入的批次才创建promise，同步路径不受影响
+        std::optional<std::promise<bool>> active_promise;
+        std::optional<std::promise<bool>> standby_promise;
+        std::shared_future<bool> active_future;
+        uint64_t active_sequence = 1;      // 当前批次的序号
+        uint64_t committed_sequence = 0;   // 已完成写入的最大批次序号
+
+        uint64_t flushing_sequence = 0;
+        FlushTrigger flushing_trigger = FlushTrigger::kManual;
+        bool flushing_piggyback = false;
+        int64_t flushing_wait_ms = 0;
+    };
+
+    // 调度线程：在最早到期的通道截止时间醒来并刷新到期通道
+    void SchedulerLoop();
+
+    // 按当前配置重建通道，调用方持有flush_mutex_和batch_mutex_
+    void BuildLanes();
+
+    // 按拦截原因选择通道，调用方持有batch_mutex_
+    size_t LaneIndex(std::string_view reason) const;
+
+    // 加入当前批次，future非空时返回批次的提交future
+    void AddToBatch(const BlockedRequestView& request, std::shared_future<bool>* future);
+
+    // 刷新lane_mask中的通道，并带上已超过最长等待时间的其他通道，
+    // 所有通道在同一次写入中提交；返回写入的条数
+    size_t FlushLanes(uint64_t lane_mask, FlushTrigger trigger);
+
+    // 写入前的补全阶段，调用方持有flush_mutex_
+    void EnrichBatch(std::vector<BlockedRequestView>* batch);
 
     // 执行批量写入
-    void ExecuteBatchWrite(const std::vector<BlockedRequest>& batch);
+    bool ExecuteBatchWrite(const std::vector<BlockedRequestView>& batch);
+
+    // 在I/O执行器线程上打开只读连接
+    bool OpenReadDatabase();
 
     // 更新统计信息
     void UpdateStats(bool is_timer_flush, size_t batch_size);
 
     // 成员变量
-    BlockedRequestDB db_;
+    std::unique_ptr<RequestStore> store_;
+    std::unique_ptr<RequestBrokerClient> broker_client_;
     std::string db_path_;
     Config config_;
     
-    // 请求缓冲区
-    std::vector<BlockedRequest> request_batch_;
+    // 优先级通道，下标越小优先级越高
+    std::vector<std::unique_ptr<Lane>> lanes_;
+    std::vector<std::pair<std::string, size_t>> reason_routes_;
+    uint64_t lane_generation_ = 0;     // SetConfig()重建通道时递增
+    std::shared_ptr<StreamSketches> sketches_;
     mutable std::mutex batch_mutex_;
+    std::condition_variable flush_cv_;
+    std::condition_variable scheduler_cv_;
+
+    // 串行化刷新，保护各通道的standby_batch和数据库写入
+    std::mutex flush_mutex_;
+    std::vector<Lane*> flushing_lanes_;
+    std::vector<BlockedRequestView> combined_batch_;   // 多个通道一起提交时的合并批次
     
     // 统计信息
     mutable std::mutex stats_mutex_;
     Stats stats_;
+    std::vector<LaneStats> lane_stats_;
     
     // 控制线程
-    std::thread timer_thread_;
+    std::thread scheduler_thread_;
     std::atomic<bool> running_{false};
     
     // 最后刷新时间
     std::chrono::steady_clock::time_point last_flush_time_;
+
+    // 异步读取使用的执行器和只读连接，read_db_只在执行器线程上访问
+    IoExecutor io_executor_;
+    BlockedRequestDB read_db_;
 };
 
 #endif  // SMART_BATCH_MANAGER_H_
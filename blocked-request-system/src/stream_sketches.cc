@@ -0,0 +1,513 @@
+#include "stream_sketches.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+
+uint64_t SketchHash(std::string_view value) {
+    // std::hash的结果再做一次splitmix64混合，保证高位分布均匀
+    uint64_t x = std::hash<std::string_view>()(value);
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// ---------------------------------------------------------------------------
+// SpaceSaving
+
+SpaceSaving::SpaceSaving(size_t capacity)
+    : capacity_(std::max<size_t>(capacity, 1)) {
+    heap_.reserve(capacity_);
+}
+
+void SpaceSaving::Add(std::string_view key, uint64_t hash, int64_t weight) {
+    auto it = positions_.find(hash);
+    if (it != positions_.end()) {
+        heap_[it->second].count += weight;
+        SiftDown(it->second);
+        return;
+    }
+
+    if (heap_.size() < capacity_) {
+        heap_.push_back(Counter{std::string(key), hash, weight, 0});
+        positions_[hash] = heap_.size() - 1;
+        SiftUp(heap_.size() - 1);
+        return;
+    }
+
+    // 替换计数最小的项，新项的误差上界为被替换项的计数
+    Counter& minimum = heap_.front();
+    positions_.erase(minimum.hash);
+    minimum.key.assign(key.data(), key.size());
+    minimum.hash = hash;
+    minimum.error = minimum.count;
+    minimum.count += weight;
+    positions_[hash] = 0;
+    SiftDown(0);
+}
+
+int64_t SpaceSaving::MinCount() const {
+    return heap_.size() < capacity_ ? 0 : heap_.front().count;
+}
+
+void SpaceSaving::Merge(const SpaceSaving& other) {
+    int64_t min_this = MinCount();
+    int64_t min_other = other.MinCount();
+
+    std::unordered_map<uint64_t, Counter> combined;
+    for (const auto& counter : heap_) {
+        combined.emplace(counter.hash, Counter{counter.key, counter.hash,
+                                               counter.count + min_other,
+                                               counter.error + min_other});
+    }
+    for (const auto& counter : other.heap_) {
+        auto it = combined.find(counter.hash);
+        if (it != combined.end()) {
+            // 两边都有：去掉上面预加的min_other，换成实际计数
+            it->second.count += counter.count - min_other;
+            it->second.error += counter.error - min_other;
+        } else {
+            combined.emplace(counter.hash, Counter{counter.key, counter.hash,
+                                                   counter.count + min_this,
+                                                   counter.error + min_this});
+        }
+    }
+
+    std::vector<Counter> merged;
+    merged.reserve(combined.size());
+    for (auto& entry : combined) {
+        merged.push_back(std::move(entry.second));
+    }
+    Rebuild(std::move(merged));
+}
+
+std::vector<SpaceSaving::Entry> SpaceSaving::CombinedTop(
+    const std::vector<const SpaceSaving*>& parts, size_t capacity, size_t n) {
+    // 项k的合并计数 = 各草图中k的计数之和，缺少k的草图按其MinCount计入；
+    // 先把所有MinCount加到每一项上，再对出现k的草图换成实际值
+    struct Combined {
+        uint64_t hash;
+        const std::string* key;
+        int64_t count;
+        int64_t error;
+    };
+
+    int64_t total_min = 0;
+    size_t total_size = 0;
+    for (const SpaceSaving* part : parts) {
+        total_min += part->MinCount();
+        total_size += part->heap_.size();
+    }
+
+    // 开放寻址表按hash聚合：窗口内的计数器有数千个，
+    // 逐项分配哈希表节点或整体排序都比线性探测慢一个数量级
+    size_t table_size = 16;
+    while (table_size < total_size * 2) table_size <<= 1;
+    const size_t mask = table_size - 1;
+    std::vector<uint32_t> slots(table_size, UINT32_MAX);
+    std::vector<Combined> combined;
+    combined.reserve(total_size);
+    for (const SpaceSaving* part : parts) {
+        int64_t min_count = part->MinCount();
+        for (const auto& counter : part->heap_) {
+            size_t slot = counter.hash & mask;
+            while (slots[slot] != UINT32_MAX && combined[slots[slot]].hash != counter.hash) {
+                slot = (slot + 1) & mask;
+            }
+            if (slots[slot] == UINT32_MAX) {
+                slots[slot] = static_cast<uint32_t>(combined.size());
+                combined.push_back(Combined{counter.hash, &counter.key, total_min, total_min});
+            }
+            Combined& target = combined[slots[slot]];
+            target.count += counter.count - min_count;
+            target.error += counter.error - min_count;
+        }
+    }
+
+    // 合并后只保留capacity项，再从中取前n项；长尾项计数大量相同，按hash而不是key定序
+    auto by_count = [](const Combined& a, const Combined& b) {
+        return a.count != b.count ? a.count > b.count : a.hash < b.hash;
+    };
+    size_t keep = std::min({n, capacity, combined.size()});
+    std::partial_sort(combined.begin(), combined.begin() + keep, combined.end(), by_count);
+
+    std::vector<Entry> entries;
+    entries.reserve(keep);
+    for (size_t i = 0; i < keep; ++i) {
+        entries.push_back(Entry{*combined[i].key, combined[i].count, combined[i].error});
+    }
+    return entries;
+}
+
+void SpaceSaving::Rebuild(std::vector<Counter> counters) {
+    if (counters.size() > capacity_) {
+        std::nth_element(counters.begin(), counters.begin() + capacity_, counters.end(),
+                         [](const Counter& a, const Counter& b) { return a.count > b.count; });
+        counters.resize(capacity_);
+    }
+
+    heap_ = std::move(counters);
+    positions_.clear();
+    for (size_t i = 0; i < heap_.size(); ++i) {
+        positions_[heap_[i].hash] = i;
+    }
+    for (size_t i = heap_.size() / 2; i-- > 0;) {
+        SiftDown(i);
+    }
+}
+
+std::vector<SpaceSaving::Entry> SpaceSaving::Top(size_t n) const {
+    std::vector<Entry> entries;
+    entries.reserve(heap_.size());
+    for (const auto& counter : heap_) {
+        entries.push_back(Entry{counter.key, counter.count, counter.error});
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.count != b.count ? a.count > b.count : a.key < b.key;
+    });
+    if (entries.size() > n) {
+        entries.resize(n);
+    }
+    return entries;
+}
+
+void SpaceSaving::Clear() {
+    heap_.clear();
+    positions_.clear();
+}
+
+void SpaceSaving::SiftUp(size_t index) {
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (heap_[parent].count <= heap_[index].count) break;
+        Swap(parent, index);
+        index = parent;
+    }
+}
+
+void SpaceSaving::SiftDown(size_t index) {
+    while (true) {
+        size_t smallest = index;
+        size_t left = index * 2 + 1;
+        size_t right = left + 1;
+        if (left < heap_.size() && heap_[left].count < heap_[smallest].count) smallest = left;
+        if (right < heap_.size() && heap_[right].count < heap_[smallest].count) smallest = right;
+        if (smallest == index) break;
+        Swap(smallest, index);
+        index = smallest;
+    }
+}
+
+void SpaceSaving::Swap(size_t a, size_t b) {
+    std::swap(heap_[a], heap_[b]);
+    positions_[heap_[a].hash] = a;
+    positions_[heap_[b].hash] = b;
+}
+
+// ---------------------------------------------------------------------------
+// CountMinSketch
+
+CountMinSketch::CountMinSketch(size_t width, size_t depth)
+    : width_(std::max<size_t>(width, 1)),
+      depth_(std::max<size_t>(depth, 1)),
+      cells_(width_ * depth_, 0) {
+}
+
+void CountMinSketch::Add(uint64_t hash, uint32_t weight) {
+    // 由一个64位哈希派生各行的下标（Kirsch-Mitzenmacher）
+    uint32_t h1 = static_cast<uint32_t>(hash);
+    uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+    for (size_t row = 0; row < depth_; ++row) {
+        size_t column = (h1 + row * h2) % width_;
+        cells_[row * width_ + column] += weight;
+    }
+}
+
+int64_t CountMinSketch::Estimate(uint64_t hash) const {
+    uint32_t h1 = static_cast<uint32_t>(hash);
+    uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+    int64_t estimate = INT64_MAX;
+    for (size_t row = 0; row < depth_; ++row) {
+        size_t column = (h1 + row * h2) % width_;
+        estimate = std::min<int64_t>(estimate, cells_[row * width_ + column]);
+    }
+    return estimate;
+}
+
+bool CountMinSketch::Merge(const CountMinSketch& other) {
+    if (other.width_ != width_ || other.depth_ != depth_) {
+        return false;
+    }
+    for (size_t i = 0; i < cells_.size(); ++i) {
+        cells_[i] += other.cells_[i];
+    }
+    return true;
+}
+
+void CountMinSketch::Clear() {
+    std::fill(cells_.begin(), cells_.end(), 0);
+}
+
+// ---------------------------------------------------------------------------
+// HyperLogLog
+
+HyperLogLog::HyperLogLog(int precision)
+    : precision_(std::min(std::max(precision, 4), 18)),
+      registers_(size_t{1} << precision_, 0) {
+}
+
+void HyperLogLog::Add(uint64_t hash) {
+    size_t index = hash >> (64 - precision_);
+    uint64_t rest = (hash << precision_) | (uint64_t{1} << (precision_ - 1));
+    uint8_t rank = static_cast<uint8_t>(__builtin_clzll(rest) + 1);
+    registers_[index] = std::max(registers_[index], rank);
+}
+
+double HyperLogLog::Estimate() const {
+    const double m = static_cast<double>(registers_.size());
+    double alpha = 0.7213 / (1.0 + 1.079 / m);
+    if (registers_.size() == 16) alpha = 0.673;
+    if (registers_.size() == 32) alpha = 0.697;
+    if (registers_.size() == 64) alpha = 0.709;
+
+    // 寄存器值不超过65，2^-value查表
+    static const auto kInversePowers = [] {
+        std::array<double, 66> table{};
+        for (size_t i = 0; i < table.size(); ++i) table[i] = std::ldexp(1.0, -static_cast<int>(i));
+        return table;
+    }();
+
+    double sum = 0;
+    size_t zeros = 0;
+    for (uint8_t value : registers_) {
+        sum += kInversePowers[value];
+        zeros += value == 0;
+    }
+
+    double estimate = alpha * m * m / sum;
+    // 小基数时用线性计数修正
+    if (estimate <= 2.5 * m && zeros > 0) {
+        estimate = m * std::log(m / static_cast<double>(zeros));
+    }
+    return estimate;
+}
+
+bool HyperLogLog::Merge(const HyperLogLog& other) {
+    if (other.precision_ != precision_) {
+        return false;
+    }
+    // uint8_t可与任意类型别名，先取出指针和长度，循环才能向量化
+    uint8_t* target = registers_.data();
+    const uint8_t* source = other.registers_.data();
+    const size_t size = registers_.size();
+    for (size_t i = 0; i < size; ++i) {
+        target[i] = std::max(target[i], source[i]);
+    }
+    return true;
+}
+
+void HyperLogLog::Clear() {
+    std::fill(registers_.begin(), registers_.end(), 0);
+}
+
+// ---------------------------------------------------------------------------
+// StreamSketches
+
+StreamSketches::StreamSketches()
+    : StreamSketches(Options()) {
+}
+
+StreamSketches::StreamSketches(const Options& options)
+    : options_(options) {
+    options_.bucket_ms = std::max<int64_t>(options_.bucket_ms, 1);
+    options_.bucket_count = std::max<size_t>(options_.bucket_count, 1);
+}
+
+uint64_t StreamSketches::TabKey(uint64_t browser_hash, int64_t tab_id) {
+    uint64_t x = browser_hash ^ (static_cast<uint64_t>(tab_id) * 0x9e3779b97f4a7c15ull);
+    x = (x ^ (x >> 29)) * 0xbf58476d1ce4e5b9ull;
+    return x ^ (x >> 32);
+}
+
+StreamSketches::Bucket* StreamSketches::BucketFor(int64_t timestamp) {
+    int64_t start = timestamp - (((timestamp % options_.bucket_ms) + options_.bucket_ms) %
+                                 options_.bucket_ms);
+
+    // 最常见的情况：落在最新的桶
+    if (!buckets_.empty() && buckets_.back().start_ms == start) {
+        return &buckets_.back();
+    }
+
+    int64_t span = options_.bucket_ms * static_cast<int64_t>(options_.bucket_count);
+    if (!buckets_.empty() && start <= buckets_.back().start_ms - span) {
+        return nullptr;  // 早于保留范围
+    }
+
+    // 查找或按顺序插入（迟到的请求可能落在较早的桶）
+    auto it = std::lower_bound(buckets_.begin(), buckets_.end(), start,
+                               [](const Bucket& bucket, int64_t value) {
+                                   return bucket.start_ms < value;
+                               });
+    if (it != buckets_.end() && it->start_ms == start) {
+        return &*it;
+    }
+
+    bool newest = it == buckets_.end();
+    Bucket bucket{start,
+                  SpaceSaving(options_.top_k),
+                  SpaceSaving(options_.top_k),
+                  CountMinSketch(options_.count_min_width, options_.count_min_depth),
+                  {},
+                  {}};
+
+    // 最新桶推进时淘汰超出保留范围的旧桶
+    if (newest) {
+        while (!buckets_.empty() && buckets_.front().start_ms <= start - span) {
+            buckets_.pop_front();
+        }
+        buckets_.push_back(std::move(bucket));
+        return &buckets_.back();
+    }
+
+    return &*buckets_.insert(it, std::move(bucket));
+}
+
+void StreamSketches::Add(const BlockedRequestView& request) {
+    uint64_t host_hash = SketchHash(request.host);
+    uint64_t reason_hash = SketchHash(request.reason);
+    uint64_t browser_hash = SketchHash(request.browser_id);
+    uint64_t url_hash = SketchHash(request.url);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Bucket* bucket = BucketFor(request.timestamp);
+    if (!bucket) {
+        return;
+    }
+
+    bucket->hosts.Add(request.host, host_hash);
+    bucket->reasons.Add(request.reason, reason_hash);
+    bucket->host_counts.Add(host_hash);
+
+    auto browser = bucket->browser_urls.find(browser_hash);
+    if (browser == bucket->browser_urls.end()) {
+        browser = bucket->browser_urls.emplace(browser_hash,
+                                               HyperLogLog(options_.browser_precision)).first;
+    }
+    browser->second.Add(url_hash);
+
+    uint64_t tab_key = TabKey(browser_hash, request.tab_id);
+    auto tab = bucket->tab_urls.find(tab_key);
+    if (tab == bucket->tab_urls.end()) {
+        tab = bucket->tab_urls.emplace(tab_key, HyperLogLog(options_.tab_precision)).first;
+    }
+    tab->second.Add(url_hash);
+}
+
+template <typename Visitor>
+void StreamSketches::ForEachBucket(int64_t window_ms, Visitor visitor) const {
+    if (buckets_.empty()) return;
+
+    int64_t oldest = INT64_MIN;
+    if (window_ms > 0) {
+        int64_t buckets = (window_ms + options_.bucket_ms - 1) / options_.bucket_ms;
+        oldest = buckets_.back().start_ms - (buckets - 1) * options_.bucket_ms;
+    }
+    for (auto it = buckets_.rbegin(); it != buckets_.rend() && it->start_ms >= oldest; ++it) {
+        visitor(*it);
+    }
+}
+
+std::vector<StreamSketches::HeavyHitter> StreamSketches::TopHosts(size_t n,
+                                                                  int64_t window_ms) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<const SpaceSaving*> parts;
+    ForEachBucket(window_ms, [&parts](const Bucket& bucket) { parts.push_back(&bucket.hosts); });
+    return SpaceSaving::CombinedTop(parts, options_.top_k, n);
+}
+
+std::vector<StreamSketches::HeavyHitter> StreamSketches::TopReasons(size_t n,
+                                                                    int64_t window_ms) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<const SpaceSaving*> parts;
+    ForEachBucket(window_ms, [&parts](const Bucket& bucket) { parts.push_back(&bucket.reasons); });
+    return SpaceSaving::CombinedTop(parts, options_.top_k, n);
+}
+
+int64_t StreamSketches::EstimateHostCount(std::string_view host, int64_t window_ms) const {
+    uint64_t hash = SketchHash(host);
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t total = 0;
+    ForEachBucket(window_ms, [&total, hash](const Bucket& bucket) {
+        total += bucket.host_counts.Estimate(hash);
+    });
+    return total;
+}
+
+double StreamSketches::DistinctUrls(std::string_view browser_id, int64_t window_ms) const {
+    uint64_t hash = SketchHash(browser_id);
+    std::lock_guard<std::mutex> lock(mutex_);
+    HyperLogLog merged(options_.browser_precision);
+    ForEachBucket(window_ms, [&merged, hash](const Bucket& bucket) {
+        auto it = bucket.browser_urls.find(hash);
+        if (it != bucket.browser_urls.end()) merged.Merge(it->second);
+    });
+    return merged.Estimate();
+}
+
+double StreamSketches::DistinctTabUrls(std::string_view browser_id, int64_t tab_id,
+                                       int64_t window_ms) const {
+    uint64_t key = TabKey(SketchHash(browser_id), tab_id);
+    std::lock_guard<std::mutex> lock(mutex_);
+    HyperLogLog merged(options_.tab_precision);
+    ForEachBucket(window_ms, [&merged, key](const Bucket& bucket) {
+        auto it = bucket.tab_urls.find(key);
+        if (it != bucket.tab_urls.end()) merged.Merge(it->second);
+    });
+    return merged.Estimate();
+}
+
+bool StreamSketches::Merge(const StreamSketches& other) {
+    if (&other == this) return false;
+
+    if (!HasOptions(other.options_)) {
+        return false;
+    }
+    const Options& a = options_;
+
+    std::scoped_lock lock(mutex_, other.mutex_);
+    for (const auto& source : other.buckets_) {
+        Bucket* bucket = BucketFor(source.start_ms);
+        if (!bucket) continue;
+
+        bucket->hosts.Merge(source.hosts);
+        bucket->reasons.Merge(source.reasons);
+        bucket->host_counts.Merge(source.host_counts);
+        for (const auto& entry : source.browser_urls) {
+            auto it = bucket->browser_urls.emplace(entry.first,
+                                                   HyperLogLog(a.browser_precision)).first;
+            it->second.Merge(entry.second);
+        }
+        for (const auto& entry : source.tab_urls) {
+            auto it = bucket->tab_urls.emplace(entry.first, HyperLogLog(a.tab_precision)).first;
+            it->second.Merge(entry.second);
+        }
+    }
+    return true;
+}
+
+bool StreamSketches::HasOptions(const Options& options) const {
+    // 构造时会修正bucket_ms和bucket_count，比较修正后的值
+    const Options& a = options_;
+    return a.top_k == options.top_k && a.count_min_width == options.count_min_width &&
+           a.count_min_depth == options.count_min_depth &&
+           a.browser_precision == options.browser_precision &&
+           a.tab_precision == options.tab_precision &&
+           a.bucket_ms == std::max<int64_t>(options.bucket_ms, 1) &&
+           a.bucket_count == std::max<size_t>(options.bucket_count, 1);
+}
+
+int64_t StreamSketches::latest_bucket_start() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return buckets_.empty() ? 0 : buckets_.back().start_ms;
+}
@@ -0,0 +1,172 @@
+#ifndef STREAM_SKETCHES_H_
+#define STREAM_SKETCHES_H_
+
+#include "blocked_request_db.h"
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// 字符串的64位哈希，各草图共用
+uint64_t SketchHash(std::string_view value);
+
+// Space-Saving 高频项统计
+// 固定capacity个计数器，按计数维护最小堆；未命中且已满时替换计数最小的项，
+// 新项继承其计数作为误差上界。计数 - 误差 <= 真实次数 <= 计数
+class SpaceSaving {
+public:
+    struct Entry {
+        std::string key;
+        int64_t count;
+        int64_t error;
+    };
+
+    explicit SpaceSaving(size_t capacity = 64);
+
+    void Add(std::string_view key, uint64_t hash, int64_t weight = 1);
+
+    // 合并另一个草图（Agarwal等人的可合并Space-Saving）
+    void Merge(const SpaceSaving& other);
+
+    // 合并多个草图后的前n项，结果与逐个Merge后调用Top相同
+    // 只建一次哈希表，只复制最终返回的key，供窗口查询使用
+    static std::vector<Entry> CombinedTop(const std::vector<const SpaceSaving*>& parts,
+                                          size_t capacity, size_t n);
+
+    // 按计数从高到低返回最多n项
+    std::vector<Entry> Top(size_t n) const;
+
+    void Clear();
+
+private:
+    struct Counter {
+        std::string key;
+        uint64_t hash;
+        int64_t count;
+        int64_t error;
+    };
+
+    // 已满时未出现的项计数上界
+    int64_t MinCount() const;
+    // 保留计数最大的capacity_项并重建堆
+    void Rebuild(std::vector<Counter> counters);
+    void SiftUp(size_t index);
+    void SiftDown(size_t index);
+    void Swap(size_t a, size_t b);
+
+    size_t capacity_;
+    std::vector<Counter> heap_;
+    std::unordered_map<uint64_t, size_t> positions_;
+};
+
+// Count-Min 频率草图，估计值只会偏大
+class CountMinSketch {
+public:
+    CountMinSketch(size_t width = 2048, size_t depth = 4);
+
+    void Add(uint64_t hash, uint32_t weight = 1);
+    int64_t Estimate(uint64_t hash) const;
+
+    // 宽度和深度必须一致
+    bool Merge(const CountMinSketch& other);
+    void Clear();
+
+    size_t width() const { return width_; }
+    size_t depth() const { return depth_; }
+    const std::vector<uint32_t>& cells() const { return cells_; }
+
+private:
+    size_t width_;
+    size_t depth_;
+    std::vector<uint32_t> cells_;
+};
+
+// HyperLogLog 基数估计，标准误差约 1.04 / sqrt(2^precision)
+class HyperLogLog {
+public:
+    explicit HyperLogLog(int precision = 12);
+
+    void Add(uint64_t hash);
+    double Estimate() const;
+
+    // 精度必须一致
+    bool Merge(const HyperLogLog& other);
+    void Clear();
+
+    int precision() const { return precision_; }
+
+private:
+    int precision_;
+    std::vector<uint8_t> registers_;
+};
+
+// 拦截请求的流式统计
+// SmartBatchManager在请求到达时更新，看板直接查询，不访问数据库：
+// - 按host、reason统计高频项（Space-Saving），按host估计次数（Count-Min）
+// - 按browser_id、按(browser_id, tab_id)估计不同url数（HyperLogLog）
+//
+// 按请求时间戳分桶（默认1分钟一桶，保留60桶），查询时合并最近若干桶，
+// 窗口长度按桶向上取整。所有草图可合并，多实例的统计可以汇总到一起
+class StreamSketches {
+public:
+    struct Options {
+        size_t top_k = 64;                 // 每个桶的Space-Saving计数器个数
+        size_t count_min_width = 2048;
+        size_t count_min_depth = 4;
+        int browser_precision = 12;        // 每个browser_id的HyperLogLog精度
+        int tab_precision = 8;             // 每个标签页的HyperLogLog精度
+        int64_t bucket_ms = 60 * 1000;     // 桶宽度（毫秒）
+        size_t bucket_count = 60;          // 保留的桶数
+    };
+
+    using HeavyHitter = SpaceSaving::Entry;
+
+    StreamSketches();
+    explicit StreamSketches(const Options& options);
+
+    void Add(const BlockedRequestView& request);
+
+    // window_ms为从最新桶往前的窗口长度，<=0表示全部保留的桶
+    std::vector<HeavyHitter> TopHosts(size_t n, int64_t window_ms = 0) const;
+    std::vector<HeavyHitter> TopReasons(size_t n, int64_t window_ms = 0) const;
+    int64_t EstimateHostCount(std::string_view host, int64_t window_ms = 0) const;
+    double DistinctUrls(std::string_view browser_id, int64_t window_ms = 0) const;
+    double DistinctTabUrls(std::string_view browser_id, int64_t tab_id, int64_t window_ms = 0) const;
+
+    // 合并另一个实例的统计，两者的Options必须一致
+    bool Merge(const StreamSketches& other);
+
+    // 参数是否与options一致（决定能否合并）
+    bool HasOptions(const Options& options) const;
+
+    // 最新桶的起始时间（毫秒），没有数据时为0
+    int64_t latest_bucket_start() const;
+
+private:
+    struct Bucket {
+        int64_t start_ms;
+        SpaceSaving hosts;
+        SpaceSaving reasons;
+        CountMinSketch host_counts;
+        std::unordered_map<uint64_t, HyperLogLog> browser_urls;
+        std::unordered_map<uint64_t, HyperLogLog> tab_urls;
+    };
+
+    // 返回时间戳所在的桶，太旧的时间戳返回nullptr；调用方持有mutex_
+    Bucket* BucketFor(int64_t timestamp);
+
+    // 窗口内的桶，调用方持有mutex_
+    template <typename Visitor>
+    void ForEachBucket(int64_t window_ms, Visitor visitor) const;
+
+    static uint64_t TabKey(uint64_t browser_hash, int64_t tab_id);
+
+    Options options_;
+    std::deque<Bucket> buckets_;   // 按start_ms递增
+    mutable std::mutex mutex_;
+};
+
+#endif  // STREAM_SKETCHES_H_
@@ -0,0 +1,73 @@
+#include "smart_batch_manager.h"
+#include "test_util.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+// 异步提交确认测试
+// 验证AddRequestAsync()的future在所在批次提交后才就绪、WaitForFlushComplete()
+// 不轮询也能被刷新唤醒，以及异步读取能看到已提交的记录
+
+namespace {
+
+bool IsReady(const std::shared_future<bool>& future) {
+    return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+}  // namespace
+
+int main() {
+    const char kDbPath[] = "async_flush_test.db";
+    RemoveDatabase(kDbPath);
+
+    SmartBatchManager manager(kDbPath);
+    SmartBatchManager::Config config;
+    config.batch_size = 10;
+    config.enable_immediate_flush = true;
+    config.enable_timer_flush = false;
+    manager.SetConfig(config);
+    if (!manager.Initialize()) {
+        std::fprintf(stderr, "初始化失败\n");
+        return 1;
+    }
+
+    // 批次未满时future不就绪，满批次提交后同一批次的future全部就绪
+    std::vector<std::shared_future<bool>> futures;
+    for (int i = 0; i < 9; ++i) {
+        futures.push_back(manager.AddRequestAsync(MakeRequest(i)));
+    }
+    Check(!IsReady(futures.front()), "批次未满时future未就绪");
+
+    futures.push_back(manager.AddRequestAsync(MakeRequest(9)));
+    for (const auto& future : futures) {
+        Check(IsReady(future) && future.get(), "满批次提交后future就绪且成功");
+    }
+
+    // 同步和异步调用混合在同一批次中
+    manager.AddRequest(MakeRequest(10));
+    std::shared_future<bool> pending = manager.AddRequestAsync(MakeRequest(11));
+    Check(!IsReady(pending), "新批次的future未就绪");
+
+    // WaitForFlushComplete()由其他线程的刷新唤醒
+    std::thread flusher([&manager] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        manager.FlushBatch();
+    });
+    manager.WaitForFlushComplete();
+    Check(IsReady(pending) && pending.get(), "刷新后WaitForFlushComplete返回且future就绪");
+    flusher.join();
+
+    // 没有缓冲的请求时立即返回
+    manager.WaitForFlushComplete();
+
+    // 异步读取
+    auto unreported = manager.GetUnreportedRequestsAsync(100);
+    auto stats = manager.GetStatisticsAsync();
+    Check(unreported.get().size() == 12, "异步读取到已提交的记录");
+    Check(stats.get().total_requests == 12, "异步统计");
+
+    return TestResult("异步提交确认");
+}
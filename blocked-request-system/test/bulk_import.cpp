@@ -0,0 +1,103 @@
+#include "bulk_importer.h"
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <pthread.h>
+#include <string>
+#include <thread>
+
+// 历史数据批量导入工具
+// Ctrl-C在当前事务提交后停止，重新运行同样的命令从断点继续
+
+namespace {
+
+void PrintUsage(const char* program) {
+    std::cout << "用法: " << program << " <db_path> <input> [选项]\n"
+              << "  --format auto|ndjson|csv  输入格式，默认按内容判断\n"
+              << "  --threads N               解析线程数，默认按CPU核数\n"
+              << "  --txn-rows N              每个事务的行数，默认1000000\n"
+              << "  --safe                    保留WAL日志，崩溃后数据库不会损坏" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    BulkImporter::Options options;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--format" && has_value) {
+            std::string format = argv[++i];
+            if (format == "ndjson") {
+                options.format = BulkImporter::Format::kNdjson;
+            } else if (format == "csv") {
+                options.format = BulkImporter::Format::kCsv;
+            } else if (format != "auto") {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--threads" && has_value) {
+            options.parser_threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--txn-rows" && has_value) {
+            options.rows_per_transaction = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--safe") {
+            options.disable_journal = false;
+        } else {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // 屏蔽退出信号，由专门的线程等待；导入结束后用SIGUSR1唤醒它
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    BulkImporter importer(options);
+    std::thread waiter([&] {
+        int received = 0;
+        sigwait(&signals, &received);
+        if (received != SIGUSR1) {
+            std::cout << "\n收到退出信号，当前事务提交后停止..." << std::endl;
+            importer.RequestStop();
+        }
+    });
+
+    BulkImporter::Result result;
+    bool success = importer.Import(argv[1], argv[2], &result);
+    pthread_kill(waiter.native_handle(), SIGUSR1);
+    waiter.join();
+
+    std::cout << "\n=== 导入统计 ===" << std::endl;
+    if (result.resumed_from > 0) {
+        std::cout << "从偏移继续: " << result.resumed_from << std::endl;
+    }
+    std::cout << "导入行数: " << result.rows_imported << std::endl;
+    std::cout << "跳过行数: " << result.bad_lines << std::endl;
+    std::cout << "读取字节: " << result.bytes_read << std::endl;
+    std::cout << "写入耗时: " << result.load_seconds << " 秒";
+    if (result.load_seconds > 0) {
+        std::cout << "（" << static_cast<int64_t>(result.rows_imported / result.load_seconds)
+                  << " 行/秒）";
+    }
+    std::cout << std::endl;
+    std::cout << "重建索引: " << result.index_seconds << " 秒" << std::endl;
+
+    if (!success) {
+        std::cerr << "导入失败: " << result.error << std::endl;
+        return 1;
+    }
+    if (result.stopped) {
+        std::cout << "导入已中断，重新运行同样的命令继续，完成后重建索引" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,207 @@
+#include "blocked_request_db.h"
+#include "bulk_importer.h"
+#include "test_util.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// 批量导入测试
+// 验证NDJSON/CSV解析（转义、引号、坏行）、断点续传、中途停止，
+// 以及导入结束后二级索引和URL索引按原样恢复
+
+namespace {
+
+const char kDbPath[] = "bulk_import_test.db";
+const char kNdjsonPath[] = "bulk_import_test.ndjson";
+const char kCsvPath[] = "bulk_import_test.csv";
+
+void RemoveFiles() {
+    RemoveDatabase(kDbPath);
+    unlink(kNdjsonPath);
+    unlink(kCsvPath);
+}
+
+void WriteFile(const char* path, const std::string& text, bool append = false) {
+    std::ofstream out(path, append ? std::ios::app : std::ios::trunc);
+    out << text;
+}
+
+std::string NdjsonLine(int i) {
+    return "{\"url\":\"https://tracker.example.net/p?i=" + std::to_string(i) +
+           "\",\"timestamp\":" + std::to_string(1700000000000 + i) +
+           ",\"reason\":\"广告追踪\",\"browser_id\":\"Chrome/120\",\"tab_id\":" +
+           std::to_string(i % 8) + "}\n";
+}
+
+std::vector<BlockedRequest> AllRequests() {
+    BlockedRequestDB db;
+    if (!db.Initialize(kDbPath)) {
+        return {};
+    }
+    std::vector<BlockedRequest> requests = db.GetAllRequests(1000000);
+    std::sort(requests.begin(), requests.end(),
+              [](const BlockedRequest& a, const BlockedRequest& b) { return a.id < b.id; });
+    return requests;
+}
+
+int CountIndexes() {
+    sqlite3* db = nullptr;
+    int count = -1;
+    if (sqlite3_open(kDbPath, &db) == SQLITE_OK) {
+        sqlite3_stmt* stmt = nullptr;
+        sqlite3_prepare_v2(db,
+                           "SELECT COUNT(*) FROM sqlite_master WHERE type = 'index' "
+                           "AND tbl_name = 'blocked_requests' AND sql IS NOT NULL",
+                           -1, &stmt, nullptr);
+        if (sqlite3_step(stmt) == SQLITE_ROW) count = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_close(db);
+    return count;
+}
+
+// 行内容按seq连续且不重复
+bool SequenceComplete(const std::vector<BlockedRequest>& requests, int total) {
+    if (static_cast<int>(requests.size()) != total) return false;
+    for (int i = 0; i < total; ++i) {
+        if (requests[i].timestamp != 1700000000000 + i) return false;
+    }
+    return true;
+}
+
+void TestParsing() {
+    RemoveFiles();
+    WriteFile(kNdjsonPath,
+              "{\"url\":\"https://a.example.com:8443/x?q=\\\"1\\\"\",\"timestamp\":1000,"
+              "\"extra\":{\"nested\":[1,2,{\"k\":\"}\"}]},\"reported\":true}\n"
+              "not json\n"
+              "{\"url\":\"https://b.example.com/\\u4e2d\\ud83d\\ude00\",\"timestamp\":1.001e3,"
+              "\"host\":\"custom\",\"tab_id\":null,\"country\":\"JP\"}\r\n"
+              "{\"timestamp\":1002}\n"
+              "\n"
+              "{\"url\":\"https://c.example.com/\",\"timestamp\":\"1003\",\"tab_id\":7} \n"
+              "{\"url\":\"https://d.example.com/\",\"timestamp\":1004");
+
+    BulkImporter::Options options;
+    options.parser_threads = 2;
+    BulkImporter importer(options);
+    BulkImporter::Result result;
+    Check(importer.Import(kDbPath, kNdjsonPath, &result), "NDJSON导入成功");
+    Check(result.rows_imported == 3, "NDJSON有效行数");
+    Check(result.bad_lines == 3, "NDJSON坏行数");
+
+    std::vector<BlockedRequest> requests = AllRequests();
+    Check(requests.size() == 3, "NDJSON写入行数");
+    if (requests.size() == 3) {
+        Check(requests[0].url == "https://a.example.com:8443/x?q=\"1\"", "转义引号");
+        Check(requests[0].host == "a.example.com", "从url提取host");
+        Check(requests[0].reported, "reported字段");
+        Check(requests[1].url == "https://b.example.com/\xe4\xb8\xad\xf0\x9f\x98\x80",
+              "\\u转义与代理对");
+        Check(requests[1].host == "custom" && requests[1].timestamp == 1001, "host字段和浮点时间戳");
+        Check(requests[0].country.empty() && requests[1].country == "JP", "country字段");
+        Check(requests[2].tab_id == 7 && requests[2].timestamp == 1003, "字符串形式的数字");
+    }
+
+    WriteFile(kCsvPath,
+              "timestamp,url,reason,ignored,tab_id,country\r\n"
+              "2000,\"https://e.example.com/a,b\",\"说\"\"明\"\"\",x,3,DE\r\n"
+              "2001,https://f.example.com/,plain,,,\r\n"
+              "bad,https://g.example.com/,,,,\r\n"
+              "2002,\"https://h.example.com/unterminated\r\n");
+    BulkImporter csv_importer;
+    Check(csv_importer.Import(kDbPath, kCsvPath, &result), "CSV导入成功");
+    Check(result.rows_imported == 2 && result.bad_lines == 2, "CSV有效行与坏行");
+    requests = AllRequests();
+    Check(requests.size() == 5, "CSV追加写入");
+    if (requests.size() == 5) {
+        Check(requests[3].url == "https://e.example.com/a,b", "引号内的逗号");
+        Check(requests[3].reason == "说\"明\"", "双引号转义");
+        Check(requests[3].tab_id == 3 && requests[3].host == "e.example.com", "CSV数字列");
+        Check(requests[4].reason == "plain" && requests[4].tab_id == 0, "CSV空列");
+        Check(requests[3].country == "DE" && requests[4].country.empty(), "CSV的country列");
+    }
+
+    WriteFile(kCsvPath, "url,host\nhttps://x.example.com/,x\n");
+    Check(!csv_importer.Import(kDbPath, kCsvPath, &result), "缺少timestamp列时失败");
+}
+
+void TestResumeAndIndexes() {
+    RemoveFiles();
+    int indexes = 0;
+    bool url_search = false;
+    {
+        BlockedRequestDB db;
+        Check(db.Initialize(kDbPath), "初始化");
+        url_search = db.SetUrlSearchEnabled(true);
+        indexes = CountIndexes();
+    }
+    Check(indexes > 0, "初始存在二级索引");
+
+    std::string text;
+    for (int i = 0; i < 3000; ++i) text += NdjsonLine(i);
+    WriteFile(kNdjsonPath, text);
+
+    BulkImporter::Options options;
+    options.chunk_bytes = 4096;
+    options.rows_per_transaction = 100;
+
+    // 开始前请求停止：第一个事务提交后结束，索引保持删除状态
+    {
+        BulkImporter importer(options);
+        importer.RequestStop();
+        BulkImporter::Result result;
+        Check(importer.Import(kDbPath, kNdjsonPath, &result), "停止的导入返回成功");
+        Check(result.stopped, "标记为已停止");
+        Check(result.rows_imported > 0 && result.rows_imported < 3000, "只导入了一部分");
+        Check(CountIndexes() == 0, "停止后索引未重建");
+        Check(SequenceComplete(AllRequests(), static_cast<int>(result.rows_imported)),
+              "已提交部分完整");
+    }
+
+    // 重新运行从断点继续，完成后恢复索引
+    {
+        BulkImporter importer(options);
+        BulkImporter::Result result;
+        Check(importer.Import(kDbPath, kNdjsonPath, &result), "继续导入成功");
+        Check(result.resumed_from > 0, "从断点继续");
+        Check(!result.stopped, "继续导入未停止");
+        Check(SequenceComplete(AllRequests(), 3000), "继续后行完整且不重复");
+        Check(CountIndexes() == indexes, "索引全部重建");
+    }
+
+    // 文件追加新行后只导入新增部分，已全部导入时不写入
+    WriteFile(kNdjsonPath, NdjsonLine(3000) + NdjsonLine(3001), true);
+    {
+        BulkImporter importer(options);
+        BulkImporter::Result result;
+        Check(importer.Import(kDbPath, kNdjsonPath, &result), "追加导入成功");
+        Check(result.rows_imported == 2, "只导入追加的行");
+        Check(importer.Import(kDbPath, kNdjsonPath, &result), "重复导入成功");
+        Check(result.rows_imported == 0, "重复导入不写入");
+    }
+    Check(SequenceComplete(AllRequests(), 3002), "追加后行完整");
+    Check(CountIndexes() == indexes, "追加后索引完整");
+
+    BlockedRequestDB db;
+    Check(db.Initialize(kDbPath), "重新打开");
+    Check(db.url_search_enabled() == url_search, "URL索引状态恢复");
+    if (url_search) {
+        BlockedRequestDB::UrlSearchPage page;
+        Check(db.SearchByUrl("p?i=2999", 0, 10, &page) && page.requests.size() == 1,
+              "导入的行进入URL索引");
+    }
+}
+
+}  // namespace
+
+int main() {
+    TestParsing();
+    TestResumeAndIndexes();
+    RemoveFiles();
+
+    return TestResult("批量导入");
+}
@@ -0,0 +1,240 @@
+#include "blocked_request_db.h"
+#include "database_backup.h"
+#include "test_util.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// 在线备份测试
+// 验证写入进行中的全量备份、备份期间WAL检查点不受阻塞、取消不留下文件，
+// 以及按高水位的增量备份（含URL索引）
+
+namespace {
+
+const char kDbPath[] = "database_backup_test.db";
+const char kBackupPath[] = "database_backup_test.backup.db";
+
+// 连同备份过程中的临时文件一起删除
+void RemoveBackupFiles(const std::string& path) {
+    RemoveDatabase(path);
+    unlink((path + ".tmp").c_str());
+}
+
+bool FileExists(const std::string& path) {
+    return access(path.c_str(), F_OK) == 0;
+}
+
+// 带长查询串的url，让备份有足够多的页
+BlockedRequest MakeLongRequest(int64_t i) {
+    BlockedRequest request = MakeRequest(i);
+    request.url = "https://tracker.example.net/pixel?uid=" + std::to_string(i) +
+                  "&ref=https%3A%2F%2Fshop.example.com%2Fitem%2F" + std::to_string(i * 7);
+    request.tab_id = i % 16;
+    return request;
+}
+
+bool AddRows(BlockedRequestDB* db, int64_t first, int64_t count) {
+    std::vector<BlockedRequest> requests;
+    for (int64_t i = first; i < first + count; ++i) {
+        requests.push_back(MakeLongRequest(i));
+    }
+    return db->AddBlockedRequests(requests);
+}
+
+// 用独立连接执行查询，返回第一行第一列
+int64_t QueryValue(const std::string& path, const char* sql) {
+    sqlite3* db = nullptr;
+    int64_t value = -1;
+    if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) == SQLITE_OK) {
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK &&
+            sqlite3_step(stmt) == SQLITE_ROW) {
+            value = sqlite3_column_int64(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_close(db);
+    return value;
+}
+
+bool IntegrityOk(const std::string& path) {
+    sqlite3* db = nullptr;
+    bool ok = false;
+    if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READWRITE, nullptr) == SQLITE_OK) {
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db, "PRAGMA integrity_check", -1, &stmt, nullptr) == SQLITE_OK &&
+            sqlite3_step(stmt) == SQLITE_ROW) {
+            ok = std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0))) == "ok";
+        }
+        sqlite3_finalize(stmt);
+        // 外部内容FTS表的integrity-check会核对索引与内容表是否一致
+        ok = ok && sqlite3_exec(db,
+                                "INSERT INTO blocked_requests_url_fts (blocked_requests_url_fts) "
+                                "VALUES ('integrity-check')",
+                                nullptr, nullptr, nullptr) == SQLITE_OK;
+    }
+    sqlite3_close(db);
+    return ok;
+}
+
+// 写入线程持续写入时做全量备份，备份应完成且与某一时刻的源库一致
+void TestFullBackupWhileWriting(BlockedRequestDB* db) {
+    BackupOptions options;
+    options.pages_per_step = 16;
+    options.step_interval_ms = 2;
+    std::unique_ptr<DatabaseBackup> backup = db->StartBackup(kBackupPath, options);
+    Check(backup != nullptr, "启动备份");
+    if (!backup) return;
+
+    // 写入与备份并发，记录单次写入的最大耗时
+    std::atomic<bool> done{false};
+    int64_t written = 0;
+    double max_write_ms = 0;
+    std::thread writer([&] {
+        int64_t next = 100000;
+        while (!done) {
+            auto start = std::chrono::steady_clock::now();
+            AddRows(db, next, 20);
+            max_write_ms = std::max(max_write_ms, std::chrono::duration<double, std::milli>(
+                                                      std::chrono::steady_clock::now() - start)
+                                                      .count());
+            next += 20;
+            written += 20;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    });
+
+    bool ok = backup->Wait();
+    done = true;
+    writer.join();
+
+    DatabaseBackup::Progress progress = backup->GetProgress();
+    Check(ok && progress.succeeded && progress.finished, "全量备份成功");
+    Check(!progress.incremental && progress.remaining_pages == 0, "全量备份复制全部页");
+    Check(!FileExists(std::string(kBackupPath) + ".tmp"), "临时文件已改名");
+    Check(IntegrityOk(kBackupPath), "备份库完整");
+    int64_t rows = QueryValue(kBackupPath, "SELECT COUNT(*) FROM blocked_requests");
+    Check(rows >= 20000 && rows <= 20000 + written, "备份行数");
+    std::printf("全量备份: %lld页, %d步, 重新开始%d次, 并发写入%lld行, 单次写入最长%.2f ms\n",
+                static_cast<long long>(progress.total_pages), progress.steps, progress.restarts,
+                static_cast<long long>(written), max_write_ms);
+}
+
+// 设置每步页数上限且不限速时，备份按上限分步完成
+void TestCappedSteps(BlockedRequestDB* db) {
+    BackupOptions options;
+    options.pages_per_step = 8;
+    options.step_interval_ms = 0;
+    options.max_pages_per_step = 32;
+    std::unique_ptr<DatabaseBackup> backup = db->StartBackup(kBackupPath, options);
+    Check(backup != nullptr && backup->Wait(), "限制每步页数的全量备份成功");
+    if (!backup) return;
+
+    DatabaseBackup::Progress progress = backup->GetProgress();
+    Check(progress.remaining_pages == 0 && progress.steps >= progress.total_pages / 32,
+          "每步复制的页数不超过上限");
+    Check(IntegrityOk(kBackupPath), "限制每步页数的备份库完整");
+}
+
+// 备份两步之间不持有读事务，检查点可以截断WAL；取消后不留下文件
+void TestCheckpointAndCancel(BlockedRequestDB* db) {
+    const std::string cancel_path = "database_backup_test.cancel.db";
+    RemoveBackupFiles(cancel_path);
+
+    BackupOptions options;
+    options.pages_per_step = 4;
+    options.step_interval_ms = 50;
+    std::unique_ptr<DatabaseBackup> backup = db->StartBackup(cancel_path, options);
+    std::this_thread::sleep_for(std::chrono::milliseconds(120));
+    Check(AddRows(db, 200000, 500), "备份期间写入");
+
+    sqlite3* raw = nullptr;
+    sqlite3_open(kDbPath, &raw);
+    sqlite3_busy_timeout(raw, 5000);
+    sqlite3_stmt* stmt = nullptr;
+    int busy = -1;
+    int log_frames = -1;
+    if (sqlite3_prepare_v2(raw, "PRAGMA wal_checkpoint(TRUNCATE)", -1, &stmt, nullptr) ==
+            SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW) {
+        busy = sqlite3_column_int(stmt, 0);
+        log_frames = sqlite3_column_int(stmt, 1);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(raw);
+    Check(busy == 0 && log_frames == 0, "备份期间WAL可以截断");
+
+    Check(!backup->GetProgress().finished, "慢速备份尚未完成");
+    backup->Cancel();
+    Check(!backup->Wait(), "取消后返回失败");
+    Check(!backup->GetProgress().error.empty(), "取消原因");
+    Check(!FileExists(cancel_path) && !FileExists(cancel_path + ".tmp"), "取消后不留下文件");
+}
+
+// 在全量备份之上按高水位追加新记录
+void TestIncremental(BlockedRequestDB* db) {
+    Check(AddRows(db, 300000, 2500), "新增记录");
+    int64_t source_rows = QueryValue(kDbPath, "SELECT COUNT(*) FROM blocked_requests");
+    int64_t source_max = QueryValue(kDbPath, "SELECT MAX(id) FROM blocked_requests");
+    int64_t backup_rows = QueryValue(kBackupPath, "SELECT COUNT(*) FROM blocked_requests");
+
+    BackupOptions options;
+    options.incremental = true;
+    options.rows_per_step = 1000;
+    options.step_interval_ms = 1;
+    std::unique_ptr<DatabaseBackup> backup = db->StartBackup(kBackupPath, options);
+    Check(backup && backup->Wait(), "增量备份成功");
+    if (!backup) return;
+
+    DatabaseBackup::Progress progress = backup->GetProgress();
+    Check(progress.incremental, "执行增量备份");
+    Check(progress.rows_copied == source_rows - backup_rows, "只追加新记录");
+    Check(progress.high_water_mark == source_max, "高水位");
+    Check(QueryValue(kBackupPath, "SELECT COUNT(*) FROM blocked_requests") == source_rows,
+          "增量后行数一致");
+    Check(IntegrityOk(kBackupPath), "增量后URL索引一致");
+
+    // 没有新记录时不写入
+    backup = db->StartBackup(kBackupPath, options);
+    Check(backup && backup->Wait() && backup->GetProgress().rows_copied == 0, "没有新记录");
+
+    // 备份库不存在时退化为全量
+    RemoveBackupFiles(kBackupPath);
+    backup = db->StartBackup(kBackupPath, options);
+    Check(backup && backup->Wait() && !backup->GetProgress().incremental, "没有基础备份时做全量");
+    Check(QueryValue(kBackupPath, "SELECT COUNT(*) FROM blocked_requests") == source_rows,
+          "全量行数");
+}
+
+}  // namespace
+
+int main() {
+    RemoveBackupFiles(kDbPath);
+    RemoveBackupFiles(kBackupPath);
+
+    BlockedRequestDB db;
+    if (!db.Initialize(kDbPath) || !db.SetUrlSearchEnabled(true)) {
+        std::fprintf(stderr, "初始化失败\n");
+        return 1;
+    }
+    Check(AddRows(&db, 0, 20000), "初始数据");
+
+    TestFullBackupWhileWriting(&db);
+    TestCappedSteps(&db);
+    TestCheckpointAndCancel(&db);
+    TestIncremental(&db);
+
+    BlockedRequestDB closed;
+    Check(closed.StartBackup(kBackupPath, BackupOptions()) == nullptr, "未初始化时不能备份");
+
+    db.Close();
+    RemoveBackupFiles(kDbPath);
+    RemoveBackupFiles(kBackupPath);
+
+    return TestResult("在线备份");
+}
@@ -0,0 +1,203 @@
+#include "smart_batch_manager.h"
+#include "test_util.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// 地理信息补全测试
+// 验证IP解析、按网段缓存、补全在刷新线程上执行且country写入数据库，
+// 以及旧数据库自动增加country列
+
+namespace {
+
+// 按IPv4第一段给出国家：10.x为/8网段的CN，192.168.1.x按/28划分（单地址缓存），
+// 其余地址查不到；每次查询睡眠模拟真实数据库的耗时
+class FakeResolver : public GeoResolver {
+public:
+    bool Lookup(const IpAddress& address, std::string* country, int* prefix_length) override {
+        calls++;
+        last_thread = std::this_thread::get_id();
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+
+        if (!address.is_v4) {
+            *prefix_length = 32;
+            *country = "DE";
+            return true;
+        }
+        const uint8_t* v4 = address.bytes + 12;
+        if (v4[0] == 10) {
+            *prefix_length = 96 + 8;
+            *country = "CN";
+            return true;
+        }
+        if (v4[0] == 192 && v4[1] == 168 && v4[2] == 1) {
+            *prefix_length = 96 + 28;
+            *country = v4[3] < 16 ? "US" : "JP";
+            return true;
+        }
+        *prefix_length = 96 + 16;
+        return false;
+    }
+
+    std::atomic<int> calls{0};
+    std::thread::id last_thread;
+};
+
+BlockedRequest MakeRequestTo(int i, const std::string& ip) {
+    BlockedRequest request = MakeRequest(i);
+    request.dest_ip = ip;
+    return request;
+}
+
+void TestParse() {
+    IpAddress address;
+    Check(IpAddress::Parse("10.1.2.3", &address) && address.is_v4 && address.bytes[10] == 0xff &&
+              address.bytes[12] == 10 && address.bytes[15] == 3,
+          "解析IPv4");
+    Check(IpAddress::Parse("2001:db8::1", &address) && !address.is_v4 &&
+              address.bytes[0] == 0x20 && address.bytes[15] == 1,
+          "解析IPv6");
+    Check(!IpAddress::Parse("", &address), "空串无效");
+    Check(!IpAddress::Parse("10.1.2", &address), "不完整的IPv4无效");
+    Check(!IpAddress::Parse("10.1.2.3 ", &address), "带空格无效");
+    Check(!IpAddress::Parse("tracker.example.net", &address), "域名无效");
+}
+
+void TestCache() {
+    auto resolver = std::make_unique<FakeResolver>();
+    FakeResolver* fake = resolver.get();
+    GeoEnricher enricher(std::move(resolver));
+
+    // /8网段覆盖/24缓存粒度：同一/24内只查一次
+    Check(enricher.Resolve("10.1.2.3") == "CN", "查询国家");
+    Check(enricher.Resolve("10.1.2.200") == "CN", "同网段命中缓存");
+    Check(fake->calls == 1, "同一/24只查询一次");
+    Check(enricher.Resolve("10.1.3.1") == "CN" && fake->calls == 2, "不同/24重新查询");
+
+    // /28小于缓存粒度：按单个地址缓存，不会把US网段的结果用于JP网段
+    Check(enricher.Resolve("192.168.1.5") == "US", "/28网段");
+    Check(enricher.Resolve("192.168.1.20") == "JP", "相邻/28网段结果不同");
+    Check(enricher.Resolve("192.168.1.5") == "US" && fake->calls == 4, "单地址缓存");
+
+    // 查不到的结果同样缓存
+    Check(enricher.Resolve("172.16.0.1").empty() && enricher.Resolve("172.16.0.2").empty(),
+          "查不到时为空");
+    Check(fake->calls == 5, "查不到的结果按网段缓存");
+    Check(enricher.Resolve("not-an-ip").empty() && fake->calls == 5, "无效IP不查询");
+
+    Check(enricher.Resolve("2001:db8::1") == "DE", "IPv6");
+    Check(enricher.Resolve("2001:db8:0:1::1") == "DE" && fake->calls == 6, "IPv6按/48缓存");
+
+    GeoEnricher::Stats stats = enricher.GetStats();
+    Check(stats.lookups == 6 && stats.invalid_ips == 1 && stats.not_found == 1, "统计");
+
+    // 已有country和没有dest_ip的请求不变
+    std::vector<BlockedRequestView> batch(3);
+    batch[0].dest_ip = "10.9.9.9";
+    batch[1].dest_ip = "10.9.9.9";
+    batch[1].country = "FR";
+    enricher.Enrich(&batch);
+    Check(batch[0].country == "CN" && batch[1].country == "FR" && batch[2].country.empty(),
+          "批量补全");
+}
+
+void TestManager() {
+    const char kDbPath[] = "geo_enrichment_test.db";
+    RemoveDatabase(kDbPath);
+
+    auto resolver = std::make_unique<FakeResolver>();
+    FakeResolver* fake = resolver.get();
+    auto enricher = std::make_shared<GeoEnricher>(std::move(resolver));
+
+    SmartBatchManager manager(kDbPath);
+    SmartBatchManager::Config config;
+    config.batch_size = 20;
+    config.geo_enricher = enricher;
+    manager.SetConfig(config);
+    if (!manager.Initialize()) {
+        Check(false, "初始化");
+        return;
+    }
+    manager.Start();
+
+    // 200条请求来自50个不同的/24
+    std::vector<BlockedRequest> requests;
+    for (int i = 0; i < 200; ++i) {
+        requests.push_back(MakeRequestTo(i, "10.0." + std::to_string(i % 50) + "." +
+                                              std::to_string(i)));
+    }
+    requests[3].dest_ip.clear();
+    requests[4].dest_ip = "172.16.0.1";
+
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& request : requests) {
+        manager.AddRequest(request);
+    }
+    double add_us = std::chrono::duration<double, std::micro>(
+                        std::chrono::steady_clock::now() - start).count() / requests.size();
+    manager.WaitForFlushComplete();
+
+    Check(fake->calls == 51, "每个/24查询一次");
+    Check(fake->last_thread != std::this_thread::get_id(), "补全不在调用线程上执行");
+    manager.Stop();
+
+    std::vector<BlockedRequest> stored = manager.GetDatabase()->GetAllRequests(1000);
+    Check(stored.size() == 200, "全部写入");
+    int cn = 0;
+    for (const auto& request : stored) {
+        if (request.country == "CN") cn++;
+        if (request.timestamp == 1700000000000 + 3 || request.timestamp == 1700000000000 + 4) {
+            Check(request.country.empty(), "没有IP或查不到时country为空");
+        }
+        Check(request.dest_ip.empty(), "目的IP不落库");
+    }
+    Check(cn == 198, "country写入数据库");
+    std::printf("AddRequest平均耗时 %.2f us（解析器每次查询200 us）\n", add_us);
+    RemoveDatabase(kDbPath);
+}
+
+// 没有country列的旧数据库在打开时补上该列
+void TestMigration() {
+    const char kDbPath[] = "geo_migration_test.db";
+    RemoveDatabase(kDbPath);
+    sqlite3* raw = nullptr;
+    sqlite3_open(kDbPath, &raw);
+    sqlite3_exec(raw,
+                 "CREATE TABLE blocked_requests (id INTEGER PRIMARY KEY AUTOINCREMENT, "
+                 "url TEXT NOT NULL, host TEXT NOT NULL, reason TEXT NOT NULL, "
+                 "timestamp INTEGER NOT NULL, reported INTEGER DEFAULT 0, "
+                 "browser_id TEXT DEFAULT '', tab_id INTEGER DEFAULT 0);"
+                 "INSERT INTO blocked_requests (url, host, reason, timestamp) "
+                 "VALUES ('https://a.example.com/', 'a.example.com', 'r', 1);",
+                 nullptr, nullptr, nullptr);
+    sqlite3_close(raw);
+
+    BlockedRequestDB db;
+    Check(db.Initialize(kDbPath), "打开旧数据库");
+    BlockedRequest request = MakeRequestTo(1, "");
+    request.country = "CN";
+    Check(db.AddBlockedRequest(request), "迁移后写入");
+    std::vector<BlockedRequest> stored = db.GetAllRequests(10);
+    Check(stored.size() == 2, "旧记录保留");
+    for (const auto& row : stored) {
+        Check(row.country == (row.timestamp == 1 ? "" : "CN"), "country列");
+    }
+    db.Close();
+    RemoveDatabase(kDbPath);
+}
+
+}  // namespace
+
+int main() {
+    TestParse();
+    TestCache();
+    TestManager();
+    TestMigration();
+
+    return TestResult("地理信息补全");
+}
@@ -0,0 +1,111 @@
+#include "smart_batch_manager.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+// 摄入路径堆分配计数测试
+// 替换全局operator new统计分配次数，验证预热后AddRequest（包括期间
+// 触发的批量写入）不再申请堆内存
+
+namespace {
+std::atomic<bool> g_counting{false};
+std::atomic<int64_t> g_allocations{0};
+}  // namespace
+
+void* operator new(size_t size) {
+    if (g_counting.load(std::memory_order_relaxed)) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+int main() {
+    const char kDbPath[] = "ingest_alloc_test.db";
+    unlink(kDbPath);
+    unlink("ingest_alloc_test.db-wal");
+    unlink("ingest_alloc_test.db-shm");
+
+    SmartBatchManager manager(kDbPath);
+    if (!manager.Initialize()) {
+        std::fprintf(stderr, "初始化失败\n");
+        return 1;
+    }
+
+    SmartBatchManager::Config config;
+    config.batch_size = 64;
+    config.enable_immediate_flush = true;
+    config.enable_timer_flush = false;
+    manager.SetConfig(config);
+
+    // 测试数据提前构造好，计数期间不再创建std::string
+    std::vector<std::string> urls;
+    for (int i = 0; i < 16; ++i) {
+        urls.push_back("https://tracker" + std::to_string(i) +
+                       ".example.com/collect?uid=0123456789abcdef&event=pageview");
+    }
+    const std::string host = "tracker.example.com";
+    const std::string reason = "广告追踪";
+    const std::string browser_id = "Chrome/120.0.0.0";
+
+    auto add = [&](int i) {
+        BlockedRequestView request;
+        request.url = urls[i % urls.size()];
+        request.host = host;
+        request.reason = reason;
+        request.timestamp = 1700000000000LL + i;
+        request.browser_id = browser_id;
+        request.tab_id = i % 20;
+        manager.AddRequest(request);
+    };
+
+    // 预热：让两个批次的arena和容量都分配到位
+    const int kWarmup = static_cast<int>(config.batch_size) * 4;
+    for (int i = 0; i < kWarmup; ++i) {
+        add(i);
+    }
+
+    const int kRequests = 10000;
+    g_counting.store(true);
+    for (int i = 0; i < kRequests; ++i) {
+        add(kWarmup + i);
+    }
+    g_counting.store(false);
+
+    manager.FlushBatch();
+
+    int64_t allocations = g_allocations.load();
+    std::printf("%d 条请求期间堆分配次数: %lld\n", kRequests,
+                static_cast<long long>(allocations));
+
+    unlink(kDbPath);
+    unlink("ingest_alloc_test.db-wal");
+    unlink("ingest_alloc_test.db-shm");
+    return allocations == 0 ? 0 : 1;
+}
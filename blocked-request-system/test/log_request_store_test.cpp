@@ -0,0 +1,271 @@
+#include "log_request_store.h"
+#include "test_util.h"
+#include <algorithm>
+#include <cstdio>
+#include <dirent.h>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// 日志结构存储后端测试
+// 覆盖重启恢复、确认重放、尾帧损坏截断、中间段损坏、整段清理和旧格式段文件
+
+namespace {
+
+const char kDirectory[] = "log_request_store_test_data";
+
+void RemoveDirectory() {
+    if (DIR* dir = opendir(kDirectory)) {
+        while (dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name == "." || name == "..") continue;
+            unlink((std::string(kDirectory) + "/" + name).c_str());
+        }
+        closedir(dir);
+    }
+    rmdir(kDirectory);
+}
+
+std::vector<BlockedRequestView> MakeBatch(const std::string& url, int64_t first_timestamp,
+                                          int count) {
+    std::vector<BlockedRequestView> batch;
+    for (int i = 0; i < count; ++i) {
+        BlockedRequestView request;
+        request.url = url;
+        request.host = "tracker.example.com";
+        request.reason = "广告追踪";
+        request.timestamp = first_timestamp + i;
+        request.browser_id = "Chrome/120.0.0.0";
+        request.tab_id = i;
+        request.country = "US";
+        batch.push_back(request);
+    }
+    return batch;
+}
+
+uint32_t Crc32(const std::string& data) {
+    uint32_t crc = 0xFFFFFFFFu;
+    for (unsigned char byte : data) {
+        crc ^= byte;
+        for (int k = 0; k < 8; ++k) {
+            crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+// 按旧格式（BLG1，记录没有country）写一个段文件
+void WriteLegacySegment(const std::string& url, int count) {
+    struct LegacyRecordHeader {
+        int64_t id;
+        int64_t timestamp;
+        int64_t tab_id;
+        uint32_t lengths[4];
+    };
+    const std::string host = "tracker.example.com";
+    const std::string reason = "广告追踪";
+    const std::string browser_id = "Chrome/120.0.0.0";
+    std::string payload;
+    for (int i = 0; i < count; ++i) {
+        LegacyRecordHeader record = {
+            i + 1, i, i,
+            {static_cast<uint32_t>(url.size()), static_cast<uint32_t>(host.size()),
+             static_cast<uint32_t>(reason.size()), static_cast<uint32_t>(browser_id.size())}};
+        payload.append(reinterpret_cast<const char*>(&record), sizeof(record));
+        payload += url + host + reason + browser_id;
+    }
+    uint32_t header[4] = {0x31474c42, static_cast<uint32_t>(count),
+                          static_cast<uint32_t>(payload.size()), Crc32(payload)};
+    mkdir(kDirectory, 0755);
+    int fd = open((std::string(kDirectory) + "/segment-00000001.log").c_str(),
+                  O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    Check(write(fd, header, sizeof(header)) == static_cast<ssize_t>(sizeof(header)) &&
+              write(fd, payload.data(), payload.size()) ==
+                  static_cast<ssize_t>(payload.size()),
+          "写入旧格式段文件");
+    close(fd);
+}
+
+// 按序号排列的段文件路径
+std::vector<std::string> SegmentPaths() {
+    std::vector<std::string> paths;
+    if (DIR* dir = opendir(kDirectory)) {
+        while (dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name.compare(0, 8, "segment-") == 0) {
+                paths.push_back(std::string(kDirectory) + "/" + name);
+            }
+        }
+        closedir(dir);
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+std::string LastSegmentPath() {
+    std::vector<std::string> paths = SegmentPaths();
+    return paths.empty() ? std::string() : paths.back();
+}
+
+off_t FileSize(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? st.st_size : -1;
+}
+
+// 翻转文件中间的一个字节
+void FlipMiddleByte(const std::string& path) {
+    int fd = open(path.c_str(), O_RDWR);
+    off_t offset = FileSize(path) / 2;
+    char byte = 0;
+    Check(pread(fd, &byte, 1, offset) == 1, "读取段文件");
+    byte = static_cast<char>(byte ^ 0x40);
+    Check(pwrite(fd, &byte, 1, offset) == 1, "写入段文件");
+    close(fd);
+}
+
+// 中间的段损坏时打开失败，之后的段不被截断
+void TestCorruptMiddleSegment(const LogRequestStore::Options& options, const std::string& url) {
+    {
+        LogRequestStore store(options);
+        Check(store.Open(kDirectory), "首次打开");
+        for (int i = 0; i < 20; ++i) {
+            Check(store.AppendBatch(MakeBatch(url, i * 10, 10)), "写入批次");
+        }
+    }
+    std::vector<std::string> paths = SegmentPaths();
+    Check(paths.size() >= 3, "至少三个段");
+    if (paths.size() < 3) return;
+    std::vector<off_t> sizes;
+    for (const auto& path : paths) sizes.push_back(FileSize(path));
+
+    const std::string& middle = paths[paths.size() / 2];
+    FlipMiddleByte(middle);
+    {
+        LogRequestStore store(options);
+        Check(!store.Open(kDirectory), "中间的段损坏时打开失败");
+    }
+    bool intact = SegmentPaths() == paths;
+    for (size_t i = 0; i < paths.size() && intact; ++i) {
+        intact = FileSize(paths[i]) == sizes[i];
+    }
+    Check(intact, "打开失败时不截断任何段");
+
+    // 修复后全部记录仍在
+    FlipMiddleByte(middle);
+    LogRequestStore store(options);
+    Check(store.Open(kDirectory), "修复后打开");
+    Check(store.ScanUnreported(1000).size() == 200, "修复后记录完整");
+}
+
+}  // namespace
+
+int main() {
+    RemoveDirectory();
+
+    const std::string url = "https://ads.example.com/pixel?id=42";
+    LogRequestStore::Options options;
+    options.segment_bytes = 4096;
+
+    // 旧格式的帧仍可读取，之后追加的新格式记录带country
+    {
+        WriteLegacySegment(url, 3);
+        {
+            LogRequestStore store(options);
+            Check(store.Open(kDirectory), "打开旧格式段文件");
+            std::vector<BlockedRequest> requests = store.ScanUnreported(10);
+            Check(requests.size() == 3 && requests.back().id == 3 &&
+                      requests.back().url == url && requests.back().country.empty(),
+                  "读取旧格式记录");
+            Check(store.AppendBatch(MakeBatch(url, 100, 2)), "旧格式段之后追加");
+        }
+        LogRequestStore store(options);
+        Check(store.Open(kDirectory), "混合格式重启");
+        std::vector<BlockedRequest> requests = store.ScanUnreported(10);
+        Check(requests.size() == 5 && requests[2].country.empty() && requests[3].id == 4 &&
+                  requests[3].country == "US" && requests[4].browser_id == "Chrome/120.0.0.0",
+              "混合格式的记录");
+    }
+    RemoveDirectory();
+
+    // 写入、确认一部分后重启，未上报记录和确认状态都应恢复
+    {
+        LogRequestStore store(options);
+        Check(store.Open(kDirectory), "首次打开");
+        for (int i = 0; i < 20; ++i) {
+            Check(store.AppendBatch(MakeBatch(url, i * 10, 10)), "写入批次");
+        }
+        Check(store.segment_count() > 1, "超过阈值后滚动段文件");
+
+        std::vector<BlockedRequest> requests = store.ScanUnreported(50);
+        Check(requests.size() == 50, "扫描返回limit条");
+        if (requests.size() == 50) {
+            Check(requests.front().id == 1 && requests.back().id == 50, "id从1开始连续");
+            Check(requests.front().url == url && requests.front().reason == "广告追踪",
+                  "字段内容完整");
+        }
+
+        std::vector<int64_t> ids;
+        for (const auto& request : requests) ids.push_back(request.id);
+        Check(store.Ack(ids), "确认上报");
+    }
+
+    {
+        LogRequestStore store(options);
+        Check(store.Open(kDirectory), "重启后打开");
+        std::vector<BlockedRequest> requests = store.ScanUnreported(1000);
+        Check(requests.size() == 150, "重启后未上报记录数");
+        Check(!requests.empty() && requests.front().id == 51, "确认状态已重放");
+        Check(!requests.empty() && requests.back().country == "US", "country已恢复");
+    }
+
+    // 在最后一个段尾部追加半个帧，模拟写入中途崩溃
+    {
+        std::string path = LastSegmentPath();
+        struct stat before;
+        stat(path.c_str(), &before);
+        int fd = open(path.c_str(), O_WRONLY | O_APPEND);
+        const char garbage[] = "BLG1\x05\x00\x00\x00partial";
+        Check(write(fd, garbage, sizeof(garbage)) == static_cast<ssize_t>(sizeof(garbage)),
+              "写入损坏尾帧");
+        close(fd);
+
+        LogRequestStore store(options);
+        Check(store.Open(kDirectory), "损坏尾帧后打开");
+        struct stat after;
+        stat(path.c_str(), &after);
+        Check(after.st_size == before.st_size, "损坏尾帧被截断");
+        Check(store.ScanUnreported(1000).size() == 150, "截断后记录数不变");
+
+        Check(store.AppendBatch(MakeBatch(url, 1000, 5)), "截断后继续写入");
+        std::vector<BlockedRequest> requests = store.ScanUnreported(1000);
+        Check(requests.size() == 155 && requests.back().id == 205, "新记录id接续");
+    }
+
+    // 全部确认后清理，只保留最后一个段
+    {
+        LogRequestStore store(options);
+        Check(store.Open(kDirectory), "清理前打开");
+        std::vector<int64_t> ids;
+        for (const auto& request : store.ScanUnreported(1000)) ids.push_back(request.id);
+        Check(store.Ack(ids), "全部确认");
+        Check(store.Expire(10000), "清理");
+        Check(store.segment_count() == 1, "清理后只保留最后一个段");
+        Check(store.ScanUnreported(1000).empty(), "清理后没有未上报记录");
+        Check(store.AppendBatch(MakeBatch(url, 2000, 1)), "清理后写入");
+    }
+
+    {
+        LogRequestStore store(options);
+        Check(store.Open(kDirectory), "清理后重启");
+        std::vector<BlockedRequest> requests = store.ScanUnreported(1000);
+        Check(requests.size() == 1 && requests.front().id == 206, "清理后重启id不复用");
+    }
+
+    RemoveDirectory();
+    TestCorruptMiddleSegment(options, url);
+    RemoveDirectory();
+
+    return TestResult("日志结构存储");
+}
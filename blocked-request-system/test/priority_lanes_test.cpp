@@ -0,0 +1,164 @@
+#include "smart_batch_manager.h"
+#include "test_util.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+// 优先级通道测试
+// 验证按拦截原因路由、高优先级通道立即提交、低优先级通道按截止时间提交，
+// 超时的低优先级批次随高优先级写入一起提交（防饿死），以及写入期间重建通道
+
+namespace {
+
+bool IsReady(const std::shared_future<bool>& future) {
+    return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+BlockedRequest MakeLaneRequest(int i, const std::string& reason) {
+    BlockedRequest request = MakeRequest(i);
+    request.url = "https://host" + std::to_string(i % 7) + ".example.com/x?i=" + std::to_string(i);
+    request.host = "host" + std::to_string(i % 7) + ".example.com";
+    request.reason = reason;
+    return request;
+}
+
+SmartBatchManager::Config MakeConfig(bool enable_timer_flush) {
+    SmartBatchManager::Config config;
+    config.enable_timer_flush = enable_timer_flush;
+
+    SmartBatchManager::LaneConfig security;
+    security.name = "security";
+    security.reasons = {"恶意软件", "钓鱼网站"};
+    security.batch_size = 1;
+    security.max_delay_ms = 5;
+
+    SmartBatchManager::LaneConfig bulk;
+    bulk.name = "bulk";
+    bulk.batch_size = 1000;
+    bulk.max_delay_ms = 100;
+
+    config.lanes = {security, bulk};
+    return config;
+}
+
+}  // namespace
+
+int main() {
+    const char kDbPath[] = "priority_lanes_test.db";
+    RemoveDatabase(kDbPath);
+
+    // 调度线程运行时：高优先级立即提交，低优先级在截止时间后提交
+    {
+        SmartBatchManager manager(kDbPath);
+        manager.SetConfig(MakeConfig(true));
+        if (!manager.Initialize()) {
+            std::fprintf(stderr, "初始化失败\n");
+            return 1;
+        }
+        manager.Start();
+
+        std::shared_future<bool> bulk;
+        for (int i = 0; i < 50; ++i) {
+            bulk = manager.AddRequestAsync(MakeLaneRequest(i, "广告追踪"));
+        }
+        auto start = std::chrono::steady_clock::now();
+        std::shared_future<bool> critical = manager.AddRequestAsync(MakeLaneRequest(50, "钓鱼网站"));
+        Check(IsReady(critical) && critical.get(), "高优先级请求立即提交");
+        Check(!IsReady(bulk), "低优先级批次未到截止时间时不提交");
+
+        Check(bulk.wait_for(std::chrono::seconds(2)) == std::future_status::ready && bulk.get(),
+              "低优先级批次在截止时间后提交");
+        auto waited = std::chrono::steady_clock::now() - start;
+        Check(waited < std::chrono::seconds(1), "低优先级批次等待时间受max_delay_ms约束");
+
+        auto lanes = manager.GetLaneStats();
+        Check(lanes.size() == 2 && lanes[0].name == "security" && lanes[1].name == "bulk",
+              "通道统计顺序与配置一致");
+        if (lanes.size() == 2) {
+            Check(lanes[0].total_requests == 1 && lanes[0].size_flushes == 1, "高优先级通道统计");
+            Check(lanes[1].total_requests == 50 && lanes[1].flushed_requests == 50 &&
+                  lanes[1].deadline_flushes == 1, "低优先级通道统计");
+        }
+        manager.Stop();
+    }
+
+    // 没有调度线程时，超时的低优先级批次随高优先级写入一起提交
+    {
+        SmartBatchManager manager(kDbPath);
+        manager.SetConfig(MakeConfig(false));
+        if (!manager.Initialize()) {
+            std::fprintf(stderr, "初始化失败\n");
+            return 1;
+        }
+
+        std::shared_future<bool> bulk = manager.AddRequestAsync(MakeLaneRequest(100, "广告追踪"));
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        Check(!IsReady(bulk), "没有调度线程时低优先级批次等待");
+
+        manager.AddRequest(MakeLaneRequest(101, "恶意软件"));
+        Check(IsReady(bulk) && bulk.get(), "超时的低优先级批次随高优先级写入提交");
+
+        auto lanes = manager.GetLaneStats();
+        if (lanes.size() == 2) {
+            Check(lanes[1].piggyback_flushes == 1 && lanes[1].max_wait_ms >= 100,
+                  "防饿死提交计入统计");
+        }
+
+        // 未列出的拦截原因进入最后一个通道
+        std::shared_future<bool> other = manager.AddRequestAsync(MakeLaneRequest(102, "未知原因"));
+        Check(!IsReady(other), "未列出的原因进入低优先级通道");
+        manager.FlushBatch();
+        Check(IsReady(other) && other.get(), "手动刷新提交全部通道");
+
+        auto stats = manager.GetDatabase()->GetStatistics();
+        Check(stats.total_requests == 54, "全部请求已写入");
+    }
+
+    // 写入的同时反复切换通道数，每条请求的统计都落在它所在的通道上
+    {
+        SmartBatchManager manager(kDbPath);
+        manager.SetConfig(MakeConfig(false));
+        if (!manager.Initialize()) {
+            std::fprintf(stderr, "初始化失败\n");
+            return 1;
+        }
+
+        const int kWriters = 2;
+        const int kRequestsPerWriter = 2000;
+        std::vector<std::thread> writers;
+        for (int t = 0; t < kWriters; ++t) {
+            writers.emplace_back([&manager, t] {
+                for (int i = 0; i < kRequestsPerWriter; ++i) {
+                    const char* reason = i % 50 == 0 ? "恶意软件" : "广告追踪";
+                    manager.AddRequest(MakeLaneRequest(1000 + t * kRequestsPerWriter + i, reason));
+                }
+            });
+        }
+        for (int i = 0; i < 200; ++i) {
+            manager.SetConfig(i % 2 == 0 ? SmartBatchManager::Config() : MakeConfig(false));
+        }
+        for (auto& writer : writers) {
+            writer.join();
+        }
+
+        manager.SetConfig(MakeConfig(false));
+        manager.AddRequest(MakeLaneRequest(9000, "恶意软件"));
+        manager.AddRequest(MakeLaneRequest(9001, "广告追踪"));
+        auto lanes = manager.GetLaneStats();
+        Check(lanes.size() == 2 && lanes[0].total_requests == 1 && lanes[1].total_requests == 1 &&
+                  lanes[1].buffered_requests == 1,
+              "重建通道后的统计");
+        manager.FlushBatch();
+
+        auto stats = manager.GetDatabase()->GetStatistics();
+        Check(stats.total_requests == 54 + kWriters * kRequestsPerWriter + 2,
+              "切换通道期间的请求全部写入");
+    }
+
+    RemoveDatabase(kDbPath);
+
+    return TestResult("优先级通道");
+}
@@ -1,4 +1,5 @@
 #include "blocked_request_db.h"
+#include "report_codec.h"
 #include <iostream>
 #include <chrono>
 #include <thread>
@@ -14,6 +15,12 @@ class DatabaseReader {
 private:
     BlockedRequestDB db_;
     std::atomic<bool> running_{false};
+
+    // 上报编码器和模拟收集端的解码器
+    ReportEncoder encoder_{DefaultReportCompression()};
+    ReportDecoder collector_decoder_;
+    std::string payload_;
+    std::vector<BlockedRequest> collected_;
     std::thread reader_thread_;
     
     // 配置参数
@@ -112,11 +119,20 @@ private:
     
     void ProcessUnreportedRequests(const std::vector<BlockedRequest>& requests) {
         std::cout << "  开始处理未上报记录..." << std::endl;
-        
+
+        // 整批编码为一个上报负载
+        if (!encoder_.Encode(requests, &payload_)) {
+            std::cout << "  ✗ 上报负载编码失败" << std::endl;
+            return;
+        }
+        std::cout << "  上报负载: " << payload_.size() << " 字节，"
+                  << requests.size() << " 条记录，压缩方式 "
+                  << ReportCompressionName(encoder_.compression()) << std::endl;
+
+        // 模拟上报到服务器
+        bool report_success = SimulateUpload(payload_, requests.size());
+
         for (const auto& request : requests) {
-            // 模拟上报到服务器
-            bool report_success = SimulateReport(request);
-            
             if (report_success) {
                 // 标记为已上报
                 if (db_.MarkAsReported(request.id, 200, "上报成功")) {
@@ -132,15 +148,12 @@ private:
                               << request.host << std::endl;
                 }
             }
-            
-            // 模拟网络延迟
-            std::this_thread::sleep_for(std::chrono::milliseconds(50));
         }
         
         std::cout << "  处理完成" << std::endl;
     }
     
-    bool SimulateReport(const BlockedRequest& request) {
+    bool SimulateUpload(const std::string& payload, size_t expected_count) {
         // 模拟上报成功率90%
         static std::random_device rd;
         static std::mt19937 gen(rd());
@@ -151,8 +164,13 @@ private:
         // 模拟网络延迟
         std::this_thread::sleep_for(std::chrono::milliseconds(10));
         
-        // 使用request参数避免警告（可以用于日志记录）
-        (void)request;  // 标记为已使用
+        // 模拟收集端解码负载
+        collected_.clear();
+        if (!collector_decoder_.Decode(payload.data(), payload.size(), &collected_) ||
+            collected_.size() != expected_count) {
+            std::cout << "  ✗ 收集端解码失败" << std::endl;
+            return false;
+        }
         
         return success;
     }
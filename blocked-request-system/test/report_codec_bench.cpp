@@ -0,0 +1,158 @@
+#include "report_codec.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+// 上报批次编码基准
+// 对比逐条JSON上报与批次二进制编码（各压缩方式）的每条字节数和编码吞吐
+//
+// 用法: ./report_codec_bench [记录数] [批次大小]
+
+namespace {
+
+// 模拟真实分布：少数追踪域名占大多数请求，url带用户id（同一用户的id重复出现）
+std::vector<BlockedRequest> GenerateRequests(int count) {
+    std::mt19937 gen(42);
+    std::vector<std::string> hosts;
+    for (int i = 0; i < 200; ++i) {
+        hosts.push_back("tracker" + std::to_string(i) + ".analytics-example.com");
+    }
+    const std::vector<std::string> paths = {
+        "/collect", "/pixel.gif", "/v1/events", "/sdk/track.js", "/beacon", "/ads/impression",
+    };
+    const std::vector<std::string> reasons = {
+        "广告追踪", "恶意域名", "隐私保护", "弹窗广告", "挖矿脚本",
+    };
+    std::geometric_distribution<int> host_dist(0.05);
+    std::uniform_int_distribution<int> small(0, 1000);
+    std::uniform_int_distribution<uint64_t> random64(0, UINT64_MAX);
+    std::vector<uint64_t> uids;
+    for (int i = 0; i < 1000; ++i) {
+        uids.push_back(random64(gen));
+    }
+
+    std::vector<BlockedRequest> requests;
+    int64_t timestamp = 1700000000000;
+    for (int i = 0; i < count; ++i) {
+        BlockedRequest request;
+        request.id = i + 1;
+        request.host = hosts[host_dist(gen) % hosts.size()];
+        char query[64];
+        std::snprintf(query, sizeof(query), "?uid=%016llx&v=%d",
+                      static_cast<unsigned long long>(uids[small(gen) % uids.size()]),
+                      small(gen) % 8);
+        request.url = "https://" + request.host + paths[small(gen) % paths.size()] + query;
+        request.reason = reasons[small(gen) % reasons.size()];
+        timestamp += small(gen) % 200;
+        request.timestamp = timestamp;
+        request.reported = false;
+        request.browser_id = "shop-" + std::to_string(small(gen) % 8);
+        request.tab_id = small(gen) % 40;
+        requests.push_back(std::move(request));
+    }
+    return requests;
+}
+
+void AppendJsonString(std::string* out, const std::string& value) {
+    out->push_back('"');
+    for (char c : value) {
+        if (c == '"' || c == '\\') out->push_back('\\');
+        out->push_back(c);
+    }
+    out->push_back('"');
+}
+
+// 现有上报方式：每条记录单独序列化为一个JSON对象
+void EncodeJson(const BlockedRequest& request, std::string* out) {
+    out->clear();
+    *out += "{\"id\":" + std::to_string(request.id);
+    *out += ",\"url\":";
+    AppendJsonString(out, request.url);
+    *out += ",\"host\":";
+    AppendJsonString(out, request.host);
+    *out += ",\"reason\":";
+    AppendJsonString(out, request.reason);
+    *out += ",\"timestamp\":" + std::to_string(request.timestamp);
+    *out += ",\"browser_id\":";
+    AppendJsonString(out, request.browser_id);
+    *out += ",\"tab_id\":" + std::to_string(request.tab_id) + "}";
+}
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int total = argc > 1 ? std::atoi(argv[1]) : 200000;
+    int batch_size = argc > 2 ? std::atoi(argv[2]) : 500;
+    if (total <= 0 || batch_size <= 0) {
+        std::fprintf(stderr, "用法: %s [记录数] [批次大小]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<BlockedRequest> requests = GenerateRequests(total);
+    std::vector<std::vector<BlockedRequest>> batches;
+    for (int i = 0; i < total; i += batch_size) {
+        batches.emplace_back(requests.begin() + i,
+                             requests.begin() + std::min(total, i + batch_size));
+    }
+
+    std::printf("记录数: %d，批次大小: %d\n", total, batch_size);
+    std::printf("格式          字节/条    编码 条/秒     压缩比   解码 条/秒\n");
+
+    // 逐条JSON
+    std::string payload;
+    int64_t json_bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& request : requests) {
+        EncodeJson(request, &payload);
+        json_bytes += static_cast<int64_t>(payload.size());
+    }
+    double json_seconds = SecondsSince(start);
+    std::printf("%-10s %10.1f %12.0f %10.1fx %12s\n", "json", double(json_bytes) / total,
+                total / json_seconds, 1.0, "-");
+
+    for (ReportCompression compression :
+         {ReportCompression::kNone, ReportCompression::kLz4, ReportCompression::kZlib,
+          ReportCompression::kZstd}) {
+        if (!IsReportCompressionAvailable(compression)) continue;
+
+        ReportEncoder encoder(compression);
+        ReportDecoder decoder;
+        std::vector<std::string> payloads(batches.size());
+
+        int64_t bytes = 0;
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < batches.size(); ++i) {
+            if (!encoder.Encode(batches[i], &payloads[i])) {
+                std::fprintf(stderr, "编码失败: %s\n", ReportCompressionName(compression));
+                return 1;
+            }
+            bytes += static_cast<int64_t>(payloads[i].size());
+        }
+        double encode_seconds = SecondsSince(start);
+
+        std::vector<BlockedRequest> decoded;
+        decoded.reserve(batch_size);
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < batches.size(); ++i) {
+            decoded.clear();
+            if (!decoder.Decode(payloads[i].data(), payloads[i].size(), &decoded) ||
+                decoded.size() != batches[i].size() || decoded.back().url != batches[i].back().url) {
+                std::fprintf(stderr, "解码失败: %s\n", ReportCompressionName(compression));
+                return 1;
+            }
+        }
+        double decode_seconds = SecondsSince(start);
+
+        std::printf("%-10s %10.1f %12.0f %10.1fx %12.0f\n", ReportCompressionName(compression),
+                    double(bytes) / total, total / encode_seconds, double(json_bytes) / bytes,
+                    total / decode_seconds);
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include "report_codec.h"
+#include "test_util.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// 上报批次编解码测试
+// 覆盖各压缩方式的往返一致性、url前缀压缩的边界情况和损坏负载
+
+namespace {
+
+// 各字段直接给定，用于覆盖编码的边界值
+BlockedRequest MakeCodecRequest(int64_t id, const std::string& url, const std::string& host,
+                                int64_t timestamp, int64_t tab_id) {
+    BlockedRequest request = MakeRequest(0);
+    request.id = id;
+    request.url = url;
+    request.host = host;
+    request.timestamp = timestamp;
+    request.browser_id = "shop-" + std::to_string(id % 3);
+    request.tab_id = tab_id;
+    request.country = id % 2 ? "US" : "";
+    return request;
+}
+
+bool SameRequests(const std::vector<BlockedRequest>& a, const std::vector<BlockedRequest>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].id != b[i].id || a[i].url != b[i].url || a[i].host != b[i].host ||
+            a[i].reason != b[i].reason || a[i].timestamp != b[i].timestamp ||
+            a[i].browser_id != b[i].browser_id || a[i].tab_id != b[i].tab_id ||
+            a[i].country != b[i].country || b[i].reported) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main() {
+    std::vector<BlockedRequest> requests = {
+        MakeCodecRequest(100, "https://ads.example.com/pixel?id=1", "ads.example.com",
+                         1700000000000, 3),
+        MakeCodecRequest(101, "http://ads.example.com", "ads.example.com", 1700000000005, 3),
+        // url不以host开头
+        MakeCodecRequest(103, "https://cdn.other.net/lib.js", "ads.example.com", 1699999999000,
+                         -1),
+        // host只是url中主机名的前缀
+        MakeCodecRequest(99, "https://ads.example.com.evil.io/x", "ads.example.com", 0, 0),
+        MakeCodecRequest(INT64_MAX, "", "", INT64_MIN, INT64_MAX),
+        MakeCodecRequest(INT64_MIN, "https://", "", INT64_MAX, INT64_MIN),
+    };
+
+    for (ReportCompression compression :
+         {ReportCompression::kNone, ReportCompression::kZstd, ReportCompression::kLz4,
+          ReportCompression::kZlib}) {
+        if (!IsReportCompressionAvailable(compression)) {
+            std::printf("跳过不可用的压缩方式: %s\n", ReportCompressionName(compression));
+            continue;
+        }
+
+        ReportEncoder encoder(compression);
+        ReportDecoder decoder;
+        std::string payload;
+
+        // 编码器和解码器复用多次
+        for (int round = 0; round < 2; ++round) {
+            Check(encoder.Encode(requests, &payload), "编码");
+            std::vector<BlockedRequest> decoded;
+            Check(decoder.Decode(payload.data(), payload.size(), &decoded), "解码");
+            Check(SameRequests(requests, decoded), "往返一致");
+        }
+
+        std::vector<BlockedRequest> empty;
+        Check(encoder.Encode(empty, &payload), "编码空批次");
+        std::vector<BlockedRequest> decoded;
+        Check(decoder.Decode(payload.data(), payload.size(), &decoded) && decoded.empty(),
+              "解码空批次");
+
+        // 截断的负载都应该被拒绝，且不留下半解码的记录
+        Check(encoder.Encode(requests, &payload), "编码");
+        for (size_t size = 0; size < payload.size(); ++size) {
+            decoded.clear();
+            if (decoder.Decode(payload.data(), size, &decoded) || !decoded.empty()) {
+                Check(false, "拒绝截断的负载");
+                break;
+            }
+        }
+    }
+
+    // 版本1的负载没有country列：一条记录，id=7，字符串表h/r/b，url为"abc"
+    {
+        const char kVersion1[] = "BRP1\x01\x00\x12"
+                                 "\x01\x03\x01" "h" "\x01" "r" "\x01" "b"
+                                 "\x0e\x02\x00\x00\x01\x02\x0c" "abc";
+        std::vector<BlockedRequest> decoded;
+        ReportDecoder decoder;
+        Check(decoder.Decode(kVersion1, sizeof(kVersion1) - 1, &decoded) &&
+                  decoded.size() == 1 && decoded[0].id == 7 && decoded[0].host == "h" &&
+                  decoded[0].browser_id == "b" && decoded[0].url == "abc" &&
+                  decoded[0].country.empty(),
+              "解码版本1的负载");
+    }
+
+    std::string garbage = "BRP1\x01\x00\xff\xff\xff\xff\x7f";
+    std::vector<BlockedRequest> decoded;
+    ReportDecoder decoder;
+    Check(!decoder.Decode(garbage.data(), garbage.size(), &decoded), "拒绝超长的正文长度");
+
+    return TestResult("上报批次编解码");
+}
@@ -0,0 +1,45 @@
+#include "request_broker.h"
+#include <csignal>
+#include <iostream>
+#include <pthread.h>
+
+// 写入代理守护进程
+// 独占数据库写连接，多个浏览器进程通过Unix域套接字提交批次
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cout << "用法: " << argv[0] << " <socket_path> <db_path>" << std::endl;
+        return 1;
+    }
+
+    // 屏蔽退出信号，由主线程同步等待，工作线程继承该屏蔽字
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    RequestBrokerServer::Config config;
+    config.socket_path = argv[1];
+    config.db_path = argv[2];
+
+    RequestBrokerServer server(config);
+    if (!server.Start()) {
+        std::cerr << "代理启动失败" << std::endl;
+        return 1;
+    }
+
+    int received = 0;
+    sigwait(&signals, &received);
+
+    server.Stop();
+
+    auto stats = server.GetStats();
+    std::cout << "\n=== 写入代理统计 ===" << std::endl;
+    std::cout << "连接数: " << stats.connections << std::endl;
+    std::cout << "批次数: " << stats.batches << std::endl;
+    std::cout << "请求数: " << stats.requests << std::endl;
+    std::cout << "合并提交数: " << stats.commits << std::endl;
+    std::cout << "失败提交数: " << stats.failed_commits << std::endl;
+    return 0;
+}
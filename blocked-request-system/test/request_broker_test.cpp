@@ -0,0 +1,232 @@
+#include "request_broker.h"
+#include "smart_batch_manager.h"
+#include "test_util.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <sqlite3.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// 写入代理测试
+// 多个客户端并发发送批次：每条记录恰好提交一次且带上country、确认在提交之后到达、
+// 并发的批次合并提交；记录数与负载不符的帧被拒绝，代理继续服务其他连接；
+// 代理重启后SmartBatchManager重连并重试一次
+
+namespace {
+
+const char kDbPath[] = "request_broker_test.db";
+const int kClients = 8;
+const int kBatchesPerClient = 50;
+const int kRequestsPerBatch = 20;
+
+std::string SocketPath() {
+    return "/tmp/request_broker_test." + std::to_string(getpid()) + ".sock";
+}
+
+std::unique_ptr<RequestBrokerServer> StartServer() {
+    RequestBrokerServer::Config config;
+    config.socket_path = SocketPath();
+    config.db_path = kDbPath;
+    auto server = std::make_unique<RequestBrokerServer>(config);
+    Check(server->Start(), "启动代理");
+    return server;
+}
+
+int64_t QueryValue(sqlite3* db, const std::string& sql) {
+    int64_t value = -1;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW) {
+        value = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+int64_t QueryValue(const std::string& sql) {
+    sqlite3* db = nullptr;
+    int64_t value = -1;
+    if (sqlite3_open_v2(kDbPath, &db, SQLITE_OPEN_READONLY, nullptr) == SQLITE_OK) {
+        value = QueryValue(db, sql);
+    }
+    sqlite3_close(db);
+    return value;
+}
+
+std::string RequestUrl(int client, int batch, int index) {
+    return "https://tracker.example.net/c" + std::to_string(client) + "/b" +
+           std::to_string(batch) + "/r" + std::to_string(index);
+}
+
+void TestConcurrentClients() {
+    std::unique_ptr<RequestBrokerServer> server = StartServer();
+
+    std::atomic<int> acked{0};
+    std::atomic<int> failed{0};
+    std::atomic<int> ack_before_commit{0};
+    std::vector<std::thread> clients;
+    for (int c = 0; c < kClients; ++c) {
+        clients.emplace_back([&, c] {
+            RequestBrokerClient client(SocketPath());
+            sqlite3* reader = nullptr;
+            if (!client.Connect() ||
+                sqlite3_open_v2(kDbPath, &reader, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+                failed++;
+                sqlite3_close(reader);
+                return;
+            }
+            std::vector<BlockedRequest> requests(kRequestsPerBatch);
+            std::vector<BlockedRequestView> batch(kRequestsPerBatch);
+            for (int b = 0; b < kBatchesPerClient; ++b) {
+                for (int r = 0; r < kRequestsPerBatch; ++r) {
+                    requests[r] = MakeRequest(r);
+                    requests[r].url = RequestUrl(c, b, r);
+                    requests[r].tab_id = c;
+                    requests[r].country = r % 2 ? "US" : "";
+                    batch[r] = MakeRequestView(requests[r]);
+                }
+                if (!client.SendBatch(batch)) {
+                    failed++;
+                    continue;
+                }
+                acked++;
+                // 确认到达时批次已经提交，其他连接能读到
+                if (b % 10 == 0 &&
+                    QueryValue(reader, "SELECT COUNT(*) FROM blocked_requests WHERE url = '" +
+                                           RequestUrl(c, b, kRequestsPerBatch - 1) + "'") != 1) {
+                    ack_before_commit++;
+                }
+            }
+            sqlite3_close(reader);
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+
+    RequestBrokerServer::Stats stats = server->GetStats();
+    server->Stop();
+
+    const int64_t total_batches = kClients * kBatchesPerClient;
+    const int64_t total_requests = total_batches * kRequestsPerBatch;
+    Check(failed == 0 && acked == total_batches, "每个批次都收到确认");
+    Check(ack_before_commit == 0, "确认在提交之后到达");
+    Check(stats.connections == kClients && stats.batches == total_batches &&
+              stats.requests == total_requests && stats.failed_commits == 0,
+          "代理统计");
+    Check(stats.commits < total_batches, "并发批次合并提交");
+    Check(QueryValue("SELECT COUNT(*) FROM blocked_requests") == total_requests, "记录总数");
+    Check(QueryValue("SELECT COUNT(DISTINCT url) FROM blocked_requests") == total_requests,
+          "每条记录只提交一次");
+    Check(QueryValue("SELECT COUNT(*) FROM blocked_requests WHERE country = 'US'") ==
+              total_requests / 2,
+          "country随批次写入");
+    std::printf("%d个客户端, %lld个批次, 合并为%lld次提交\n", kClients,
+                static_cast<long long>(stats.batches), static_cast<long long>(stats.commits));
+}
+
+// 与request_broker.cc中的请求帧头布局一致
+struct RawFrameHeader {
+    uint32_t magic;
+    uint32_t payload_size;
+    uint64_t sequence;
+    uint32_t count;
+};
+
+// 发送一个只有帧头的请求帧，返回代理是否没有回复确认；
+// 代理在解码失败时停止读取该连接，等待200ms足够它处理完这一帧
+bool SendHeaderOnly(uint32_t count) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    std::string path = SocketPath();
+    std::memcpy(addr.sun_path, path.c_str(), path.size());
+    timeval timeout = {0, 200 * 1000};
+    bool rejected = false;
+    if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0) {
+        RawFrameHeader header = {0x32515242, 0, 1, count};
+        char ack[16];
+        rejected = send(fd, &header, sizeof(header), MSG_NOSIGNAL) == sizeof(header) &&
+                   recv(fd, ack, sizeof(ack), 0) <= 0;
+    }
+    if (fd >= 0) close(fd);
+    return rejected;
+}
+
+// 记录数远大于负载能容纳的帧不能让代理按记录数分配内存
+void TestMalformedCount() {
+    std::unique_ptr<RequestBrokerServer> server = StartServer();
+    Check(SendHeaderOnly(0xFFFFFFFF), "拒绝记录数过大的帧");
+    Check(SendHeaderOnly(1), "拒绝记录数与负载不符的帧");
+
+    RequestBrokerClient client(SocketPath());
+    BlockedRequest request = MakeRequest(1);
+    request.url = "https://tracker.example.net/after-malformed";
+    std::vector<BlockedRequestView> batch = {MakeRequestView(request)};
+    Check(client.Connect() && client.SendBatch(batch), "无效帧之后代理继续服务其他客户端");
+
+    RequestBrokerServer::Stats stats = server->GetStats();
+    Check(stats.batches == 1 && stats.requests == 1, "无效帧不计入统计");
+    server->Stop();
+}
+
+void TestReconnectAfterRestart() {
+    std::unique_ptr<RequestBrokerServer> server = StartServer();
+
+    SmartBatchManager::Config config;
+    config.batch_size = 1000;
+    config.enable_immediate_flush = false;
+    config.enable_timer_flush = false;
+    config.broker_socket_path = SocketPath();
+    SmartBatchManager manager(kDbPath);
+    manager.SetConfig(config);
+    Check(manager.Initialize(), "连接代理");
+
+    BlockedRequest request = MakeRequest(1);
+    request.url = "https://tracker.example.net/before-restart";
+    std::shared_future<bool> before = manager.AddRequestAsync(request);
+    manager.FlushBatch();
+    Check(before.get(), "重启前提交");
+
+    // 代理重启后原连接已断开，下一次刷新重连后重试一次
+    server->Stop();
+    server.reset();
+    server = StartServer();
+
+    request.url = "https://tracker.example.net/after-restart";
+    std::shared_future<bool> after = manager.AddRequestAsync(request);
+    manager.FlushBatch();
+    Check(after.get(), "重启后重连并提交");
+
+    RequestBrokerServer::Stats stats = server->GetStats();
+    Check(stats.connections == 1 && stats.batches == 1 && stats.requests == 1,
+          "重连后只重试一次");
+    server->Stop();
+
+    Check(QueryValue("SELECT COUNT(*) FROM blocked_requests "
+                     "WHERE url = 'https://tracker.example.net/before-restart'") == 1,
+          "重启前的记录只提交一次");
+    Check(QueryValue("SELECT COUNT(*) FROM blocked_requests "
+                     "WHERE url = 'https://tracker.example.net/after-restart'") == 1,
+          "重试的记录只提交一次");
+}
+
+}  // namespace
+
+int main() {
+    RemoveDatabase(kDbPath);
+    TestConcurrentClients();
+    RemoveDatabase(kDbPath);
+    TestMalformedCount();
+    RemoveDatabase(kDbPath);
+    TestReconnectAfterRestart();
+    RemoveDatabase(kDbPath);
+    return TestResult("写入代理");
+}
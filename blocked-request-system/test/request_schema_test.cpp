@@ -0,0 +1,116 @@
+#include "blocked_request_schema.h"
+#include "test_util.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// 编译期列描述测试
+// 验证生成的SQL文本、按投影读取只填充投影内的列，以及NULL和内嵌\0的文本
+
+namespace {
+
+const char kDbPath[] = "request_schema_test.db";
+
+using namespace request_schema;
+
+using HostRow = Projection<Id, Host>;
+using TimeRow = Projection<Timestamp, TabId, Reported>;
+
+// SQL在编译期生成
+constexpr auto kHostSQL = "SELECT " + HostRow::kColumnList + " FROM blocked_requests";
+static_assert(kHostSQL.size() == std::strlen("SELECT id, host FROM blocked_requests"),
+              "列清单长度");
+static_assert(InsertRow::kPlaceholders.size() == std::strlen("?, ?, ?, ?, ?, ?, ?"), "占位符长度");
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+}  // namespace
+
+int main() {
+    Check(std::string(kHostSQL.c_str()) == "SELECT id, host FROM blocked_requests", "投影SQL");
+    Check(std::string(FullRow::kColumnList.c_str()) ==
+              "id, url, host, reason, timestamp, reported, browser_id, tab_id, country",
+          "完整列清单");
+    Check(std::string(FullRow::QualifiedColumnList("b.").c_str()).rfind("b.id, b.url, ", 0) == 0,
+          "带别名的列清单");
+    Check(std::string(InsertRow::kPlaceholders.c_str()) == "?, ?, ?, ?, ?, ?, ?", "占位符");
+
+    RemoveDatabase(kDbPath);
+    BlockedRequestDB db;
+    if (!db.Initialize(kDbPath)) {
+        std::fprintf(stderr, "初始化失败\n");
+        return 1;
+    }
+
+    std::vector<BlockedRequest> requests;
+    for (int i = 0; i < 2000; ++i) {
+        BlockedRequest request{};
+        request.url = "https://tracker.example.net/pixel?uid=" + std::to_string(i);
+        request.host = i % 2 ? "tracker.example.net" : "ads.example.com";
+        request.reason = "广告追踪";
+        request.timestamp = 1700000000000 + i;
+        request.browser_id = "Chrome/120.0.0.0";
+        request.tab_id = i % 16;
+        requests.push_back(request);
+    }
+    requests[7].url = std::string("https://x.example.com/a\0b", 25);
+    Check(db.AddBlockedRequests(requests), "写入");
+
+    // 完整读取与原数据一致，内嵌\0的文本按长度读取
+    std::vector<BlockedRequest> full = db.GetUnreportedRequests(10);
+    Check(full.size() == 10, "完整读取行数");
+    if (full.size() == 10) {
+        Check(full[3].url == requests[3].url && full[3].host == requests[3].host &&
+                  full[3].reason == requests[3].reason && full[3].tab_id == 3 &&
+                  full[3].browser_id == requests[3].browser_id && !full[3].reported,
+              "完整读取内容");
+        Check(full[7].url.size() == 25 && full[7].url == requests[7].url, "内嵌\\0的url");
+    }
+
+    // 投影读取只填充投影内的列
+    std::vector<BlockedRequest> hosts = db.GetUnreportedRequests<HostRow>(10);
+    Check(hosts.size() == 10, "投影读取行数");
+    if (hosts.size() == 10 && full.size() == 10) {
+        Check(hosts[5].id == full[5].id && hosts[5].host == full[5].host, "投影列内容");
+        Check(hosts[5].url.empty() && hosts[5].reason.empty() && hosts[5].browser_id.empty() &&
+                  hosts[5].timestamp == 0 && hosts[5].tab_id == 0,
+              "投影外的列保持默认值");
+    }
+
+    std::vector<BlockedRequest> times = db.GetAllRequests<TimeRow>(5);
+    Check(times.size() == 5 && times[0].timestamp == 1700000000000 + 1999 &&
+              times[0].tab_id == 1999 % 16 && times[0].id == 0 && times[0].host.empty(),
+          "按时间倒序的投影读取");
+
+    // 缓存的语句可以重复使用
+    Check(db.GetUnreportedRequests<HostRow>(3).size() == 3, "再次投影读取");
+
+    // NULL文本读为空串
+    sqlite3* raw = nullptr;
+    sqlite3_open(kDbPath, &raw);
+    sqlite3_exec(raw, "UPDATE blocked_requests SET browser_id = NULL WHERE id = 1", nullptr,
+                 nullptr, nullptr);
+    sqlite3_close(raw);
+    std::vector<BlockedRequest> first = db.GetUnreportedRequests(1);
+    Check(first.size() == 1 && first[0].id == 1 && first[0].browser_id.empty(), "NULL读为空串");
+
+    // 读取耗时对比，仅供参考
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 20; ++i) db.GetUnreportedRequests(2000);
+    double full_ms = MillisecondsSince(start) / 20;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 20; ++i) db.GetUnreportedRequests<HostRow>(2000);
+    double host_ms = MillisecondsSince(start) / 20;
+    std::printf("读取2000行: 完整 %.2f ms，id+host %.2f ms\n", full_ms, host_ms);
+
+    db.Close();
+    RemoveDatabase(kDbPath);
+
+    return TestResult("列描述");
+}
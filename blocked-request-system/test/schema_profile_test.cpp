@@ -0,0 +1,217 @@
+#include "blocked_request_db.h"
+#include "test_util.h"
+#include <cstdio>
+#include <set>
+#include <sqlite3.h>
+#include <string>
+#include <vector>
+
+// 索引方案迁移测试
+// 验证没有方案记录的旧数据库识别为kLegacy、方案之间来回迁移后索引和schema_meta
+// 与方案一致、数据不受影响，各方案下按时间清理已上报记录都走索引，
+// 以及只读连接不修改数据库
+
+namespace {
+
+const char kDbPath[] = "schema_profile_test.db";
+
+// 旧版数据库：没有country列和schema_meta表，只有五个单列索引
+const char kLegacySchemaSQL[] = R"(
+  CREATE TABLE blocked_requests (
+    id INTEGER PRIMARY KEY AUTOINCREMENT,
+    url TEXT NOT NULL,
+    host TEXT NOT NULL,
+    reason TEXT NOT NULL,
+    timestamp INTEGER NOT NULL,
+    reported INTEGER DEFAULT 0,
+    browser_id TEXT DEFAULT '',
+    tab_id INTEGER DEFAULT 0
+  );
+  CREATE INDEX idx_timestamp ON blocked_requests(timestamp);
+  CREATE INDEX idx_reported ON blocked_requests(reported);
+  CREATE INDEX idx_host ON blocked_requests(host);
+  CREATE INDEX idx_browser_id ON blocked_requests(browser_id);
+  CREATE INDEX idx_tab_id ON blocked_requests(tab_id);
+  INSERT INTO blocked_requests (url, host, reason, timestamp, reported)
+    VALUES ('https://old.example.com/a', 'old.example.com', '广告追踪', 1000, 1),
+           ('https://old.example.com/b', 'old.example.com', '广告追踪', 2000, 0);
+)";
+
+const std::set<std::string> kLegacyIndexes = {
+    "idx_timestamp", "idx_reported", "idx_host", "idx_browser_id", "idx_tab_id",
+};
+const std::set<std::string> kWriteIndexes = {
+    "idx_unreported_queue", "idx_reported_retention",
+};
+const std::set<std::string> kQueryIndexes = {
+    "idx_unreported_queue", "idx_timestamp", "idx_host_timestamp",
+    "idx_browser_tab_timestamp", "idx_reported_timestamp",
+};
+
+bool Execute(const char* sql) {
+    sqlite3* db = nullptr;
+    bool ok = sqlite3_open(kDbPath, &db) == SQLITE_OK &&
+              sqlite3_exec(db, sql, nullptr, nullptr, nullptr) == SQLITE_OK;
+    sqlite3_close(db);
+    return ok;
+}
+
+// 按行读取第一列的文本
+std::vector<std::string> QueryColumn(const char* sql) {
+    std::vector<std::string> values;
+    sqlite3* db = nullptr;
+    if (sqlite3_open_v2(kDbPath, &db, SQLITE_OPEN_READONLY, nullptr) == SQLITE_OK) {
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK) {
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                const unsigned char* text = sqlite3_column_text(stmt, 0);
+                values.push_back(text ? reinterpret_cast<const char*>(text) : "");
+            }
+        }
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_close(db);
+    return values;
+}
+
+// sqlite_master中的命名索引，不含主键和UNIQUE约束自动建的索引
+std::set<std::string> Indexes() {
+    std::vector<std::string> names = QueryColumn(
+        "SELECT name FROM sqlite_master WHERE type = 'index' "
+        "AND tbl_name = 'blocked_requests' AND sql IS NOT NULL");
+    return std::set<std::string>(names.begin(), names.end());
+}
+
+std::string RecordedProfile() {
+    std::vector<std::string> values =
+        QueryColumn("SELECT value FROM schema_meta WHERE key = 'schema_profile'");
+    return values.empty() ? "" : values.front();
+}
+
+// 用EXPLAIN QUERY PLAN的detail列判断：清理语句不能是全表扫描
+bool DeleteUsesIndex() {
+    sqlite3* db = nullptr;
+    bool uses_index = false;
+    if (sqlite3_open_v2(kDbPath, &db, SQLITE_OPEN_READONLY, nullptr) == SQLITE_OK) {
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db,
+                               "EXPLAIN QUERY PLAN DELETE FROM blocked_requests "
+                               "WHERE reported = 1 AND timestamp < ?",
+                               -1, &stmt, nullptr) == SQLITE_OK) {
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                std::string detail = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+                uses_index = uses_index || detail.find("INDEX") != std::string::npos;
+            }
+        }
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_close(db);
+    return uses_index;
+}
+
+void CheckProfile(BlockedRequestDB* db, SchemaProfile profile,
+                  const std::set<std::string>& indexes, const char* message) {
+    std::string recorded = std::to_string(static_cast<int>(profile));
+    if (db->schema_profile() != profile || Indexes() != indexes ||
+        RecordedProfile() != recorded) {
+        std::fprintf(stderr, "索引: ");
+        for (const auto& name : Indexes()) {
+            std::fprintf(stderr, "%s ", name.c_str());
+        }
+        std::fprintf(stderr, "方案记录: %s\n", RecordedProfile().c_str());
+        Check(false, message);
+    }
+}
+
+void TestLegacyRoundTrip() {
+    RemoveDatabase(kDbPath);
+    Check(Execute(kLegacySchemaSQL), "创建旧版数据库");
+
+    BlockedRequestDB db;
+    Check(db.Initialize(kDbPath), "打开旧版数据库");
+    CheckProfile(&db, SchemaProfile::kLegacy, kLegacyIndexes, "旧版数据库识别为kLegacy");
+    Check(QueryColumn("SELECT country FROM blocked_requests").size() == 2,
+          "旧版数据库增加country列");
+
+    Check(db.MigrateSchemaProfile(SchemaProfile::kWriteOptimized), "迁移到kWriteOptimized");
+    CheckProfile(&db, SchemaProfile::kWriteOptimized, kWriteIndexes, "kWriteOptimized的索引");
+    Check(DeleteUsesIndex(), "kWriteOptimized下清理已上报记录走索引");
+
+    for (int i = 0; i < 10; ++i) {
+        BlockedRequest request = MakeRequest(i);
+        request.timestamp = 3000 + i;
+        Check(db.AddBlockedRequest(request), "迁移后写入");
+    }
+
+    Check(db.MigrateSchemaProfile(SchemaProfile::kQueryOptimized), "迁移到kQueryOptimized");
+    CheckProfile(&db, SchemaProfile::kQueryOptimized, kQueryIndexes, "kQueryOptimized的索引");
+    Check(DeleteUsesIndex(), "kQueryOptimized下清理已上报记录走索引");
+
+    Check(db.MigrateSchemaProfile(SchemaProfile::kWriteOptimized), "迁回kWriteOptimized");
+    CheckProfile(&db, SchemaProfile::kWriteOptimized, kWriteIndexes, "迁回后的索引");
+
+    // 迁移不影响数据，清理只删除早于截止时间的已上报记录
+    Check(db.GetUnreportedRequests(100).size() == 11, "未上报记录");
+    Check(db.DeleteReportedRequestsBefore(5000), "清理已上报记录");
+    Check(QueryColumn("SELECT id FROM blocked_requests").size() == 11, "清理后的记录数");
+    db.Close();
+
+    // 重新打开沿用记录的方案；记录的方案缺少索引时补齐
+    Check(Execute("DROP INDEX idx_reported_retention"), "删除索引");
+    BlockedRequestDB reopened;
+    Check(reopened.Initialize(kDbPath), "重新打开");
+    CheckProfile(&reopened, SchemaProfile::kWriteOptimized, kWriteIndexes, "重新打开后补齐索引");
+    reopened.Close();
+
+    BlockedRequestDB query;
+    Check(query.Initialize(kDbPath, SchemaProfile::kQueryOptimized), "打开时指定方案");
+    CheckProfile(&query, SchemaProfile::kQueryOptimized, kQueryIndexes, "打开时迁移");
+    query.Close();
+    RemoveDatabase(kDbPath);
+}
+
+void TestNewDatabase() {
+    RemoveDatabase(kDbPath);
+    BlockedRequestDB db;
+    Check(db.Initialize(kDbPath), "新建数据库");
+    CheckProfile(&db, SchemaProfile::kWriteOptimized, kWriteIndexes,
+                 "新建数据库使用kWriteOptimized");
+    db.Close();
+    RemoveDatabase(kDbPath);
+}
+
+// 只读连接不建表、不迁移方案，也不能写入
+void TestReadOnly() {
+    RemoveDatabase(kDbPath);
+    BlockedRequestDB missing;
+    Check(!missing.InitializeReadOnly(kDbPath) && access(kDbPath, F_OK) != 0,
+          "只读打开不存在的数据库失败且不创建文件");
+
+    BlockedRequestDB writer;
+    Check(writer.Initialize(kDbPath, SchemaProfile::kQueryOptimized), "写连接打开");
+    Check(writer.AddBlockedRequest(MakeRequest(1)), "写连接写入");
+
+    BlockedRequestDB reader;
+    Check(reader.InitializeReadOnly(kDbPath), "只读打开");
+    Check(reader.schema_profile() == SchemaProfile::kQueryOptimized, "只读连接读取记录的方案");
+    Check(reader.GetUnreportedRequests(10).size() == 1, "只读连接查询");
+    Check(!reader.AddBlockedRequest(MakeRequest(2)), "只读连接不能写入");
+    Check(!reader.MigrateSchemaProfile(SchemaProfile::kWriteOptimized), "只读连接不能迁移");
+    CheckProfile(&writer, SchemaProfile::kQueryOptimized, kQueryIndexes, "只读连接不改变索引");
+
+    // 写连接之后的写入对只读连接可见
+    Check(writer.AddBlockedRequest(MakeRequest(3)), "再次写入");
+    Check(reader.GetUnreportedRequests(10).size() == 2, "只读连接看到新写入");
+    reader.Close();
+    writer.Close();
+    RemoveDatabase(kDbPath);
+}
+
+}  // namespace
+
+int main() {
+    TestLegacyRoundTrip();
+    TestNewDatabase();
+    TestReadOnly();
+    return TestResult("索引方案迁移");
+}
@@ -12,6 +12,7 @@
 class BrowserSimulator {
 private:
     SmartBatchManager manager_;
+    std::string broker_socket_path_;
     std::atomic<bool> running_{false};
     std::thread simulation_thread_;
     
@@ -33,26 +34,28 @@ private:
     };
 
 public:
-    BrowserSimulator(const std::string& db_path) : manager_(db_path) {}
+    BrowserSimulator(const std::string& db_path, const std::string& broker_socket_path = "")
+        : manager_(db_path), broker_socket_path_(broker_socket_path) {}
     
     ~BrowserSimulator() {
         Stop();
     }
     
     bool Initialize() {
-        if (!manager_.Initialize()) {
-            std::cerr << "管理器初始化失败" << std::endl;
-            return false;
-        }
-        
         // 配置参数
         SmartBatchManager::Config config;
         config.batch_size = 10;              // 10条触发刷新
         config.flush_interval_minutes = 1;   // 1分钟定时刷新
         config.enable_immediate_flush = true;
         config.enable_timer_flush = true;
+        config.broker_socket_path = broker_socket_path_;
         
         manager_.SetConfig(config);
+
+        if (!manager_.Initialize()) {
+            std::cerr << "管理器初始化失败" << std::endl;
+            return false;
+        }
         return true;
     }
     
@@ -163,11 +166,13 @@ private:
     }
 };
 
-int main() {
+int main(int argc, char* argv[]) {
     std::cout << "浏览器拦截模拟器" << std::endl;
     std::cout << "==================" << std::endl;
     
-    BrowserSimulator simulator("blocked_requests.db");
+    // 可选参数：写入代理的套接字路径
+    std::string broker_socket_path = argc > 1 ? argv[1] : "";
+    BrowserSimulator simulator("blocked_requests.db", broker_socket_path);
     
     if (!simulator.Initialize()) {
         std::cerr << "初始化失败" << std::endl;
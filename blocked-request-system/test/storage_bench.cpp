@@ -0,0 +1,163 @@
+#include "log_request_store.h"
+#include "request_store.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// 存储后端对比基准
+// 对SQLite后端和日志结构后端跑同样的负载：批量写入、扫描未上报并确认、按时间清理
+//
+// 用法: ./storage_bench [记录数] [批次大小]
+
+namespace {
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 统计文件或目录下文件的总大小
+int64_t DiskUsage(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return 0;
+    if (!S_ISDIR(st.st_mode)) return st.st_size;
+
+    int64_t total = 0;
+    if (DIR* dir = opendir(path.c_str())) {
+        while (dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name == "." || name == "..") continue;
+            total += DiskUsage(path + "/" + name);
+        }
+        closedir(dir);
+    }
+    return total;
+}
+
+void RemovePath(const std::string& path) {
+    if (DIR* dir = opendir(path.c_str())) {
+        while (dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name == "." || name == "..") continue;
+            unlink((path + "/" + name).c_str());
+        }
+        closedir(dir);
+        rmdir(path.c_str());
+        return;
+    }
+    unlink(path.c_str());
+    unlink((path + "-wal").c_str());
+    unlink((path + "-shm").c_str());
+}
+
+bool RunWorkload(const char* name, RequestStore* store, const std::string& path,
+                 int total, int batch_size) {
+    RemovePath(path);
+    if (!store->Open(path)) {
+        std::fprintf(stderr, "%s: 打开失败\n", name);
+        return false;
+    }
+
+    std::vector<std::string> urls;
+    for (int i = 0; i < 64; ++i) {
+        urls.push_back("https://tracker" + std::to_string(i) +
+                       ".example.com/collect?uid=0123456789abcdef&event=pageview&seq=" +
+                       std::to_string(i * 7919));
+    }
+    const std::string host = "tracker.example.com";
+    const std::string reason = "广告追踪";
+    const std::string browser_id = "Chrome/120.0.0.0";
+    const int64_t base_timestamp = 1700000000000;
+
+    // 写入
+    std::vector<BlockedRequestView> batch;
+    batch.reserve(batch_size);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < total; i += batch_size) {
+        batch.clear();
+        for (int j = i; j < total && j < i + batch_size; ++j) {
+            BlockedRequestView request;
+            request.url = urls[j % urls.size()];
+            request.host = host;
+            request.reason = reason;
+            request.timestamp = base_timestamp + j;
+            request.browser_id = browser_id;
+            request.tab_id = j % 32;
+            batch.push_back(request);
+        }
+        if (!store->AppendBatch(batch)) {
+            std::fprintf(stderr, "%s: 写入失败\n", name);
+            return false;
+        }
+    }
+    double ingest_seconds = SecondsSince(start);
+    int64_t disk_bytes = DiskUsage(path);
+
+    // 扫描未上报并确认，模拟上报循环
+    start = std::chrono::steady_clock::now();
+    int64_t scanned = 0;
+    std::vector<int64_t> ids;
+    while (true) {
+        std::vector<BlockedRequest> requests = store->ScanUnreported(1000);
+        if (requests.empty()) break;
+        ids.clear();
+        for (const auto& request : requests) ids.push_back(request.id);
+        if (!store->Ack(ids)) {
+            std::fprintf(stderr, "%s: 确认失败\n", name);
+            return false;
+        }
+        scanned += static_cast<int64_t>(requests.size());
+    }
+    double scan_seconds = SecondsSince(start);
+
+    // 清理全部已上报记录
+    start = std::chrono::steady_clock::now();
+    if (!store->Expire(base_timestamp + total)) {
+        std::fprintf(stderr, "%s: 清理失败\n", name);
+        return false;
+    }
+    double expire_seconds = SecondsSince(start);
+    int64_t disk_after = DiskUsage(path);
+
+    store->Close();
+    RemovePath(path);
+
+    if (scanned != total) {
+        std::fprintf(stderr, "%s: 扫描到 %lld 条，期望 %d 条\n", name,
+                     static_cast<long long>(scanned), total);
+        return false;
+    }
+
+    std::printf("%-8s 写入 %9.0f 条/秒  扫描+确认 %9.0f 条/秒  清理 %7.1f ms  "
+                "磁盘 %6.1f MB -> %5.1f MB\n",
+                name, total / ingest_seconds, scanned / scan_seconds, expire_seconds * 1000,
+                disk_bytes / 1048576.0, disk_after / 1048576.0);
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int total = argc > 1 ? std::atoi(argv[1]) : 200000;
+    int batch_size = argc > 2 ? std::atoi(argv[2]) : 500;
+    if (total <= 0 || batch_size <= 0) {
+        std::fprintf(stderr, "用法: %s [记录数] [批次大小]\n", argv[0]);
+        return 1;
+    }
+
+    std::printf("记录数: %d，批次大小: %d\n", total, batch_size);
+
+    SqliteRequestStore sqlite_store;
+    LogRequestStore::Options options;
+    options.segment_bytes = 4 * 1024 * 1024;
+    LogRequestStore log_store(options);
+
+    bool success = RunWorkload("sqlite", &sqlite_store, "storage_bench.db", total, batch_size) &&
+                   RunWorkload("log", &log_store, "storage_bench_log", total, batch_size);
+    return success ? 0 : 1;
+}
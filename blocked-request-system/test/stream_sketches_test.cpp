@@ -0,0 +1,220 @@
+#include "smart_batch_manager.h"
+#include "stream_sketches.h"
+#include "test_util.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// 流式统计测试
+// 验证高频host的准确性、不同url数的误差、分片合并、时间窗口，
+// 以及通过SmartBatchManager接入后的查询
+
+namespace {
+
+const int64_t kBaseTime = 1700000000000;
+
+// 长尾分布：host0最多，hostN的次数约为host0的1/(N+1)
+std::string SkewedHost(int i) {
+    static const int kWeights[] = {400, 200, 133, 100, 80, 67, 57, 50};
+    int slot = i % 2000;
+    for (int h = 0; h < 8; ++h) {
+        if (slot < kWeights[h]) return "host" + std::to_string(h) + ".example.com";
+        slot -= kWeights[h];
+    }
+    // 剩余的落到大量只出现一两次的host上
+    return "tail" + std::to_string(i) + ".example.com";
+}
+
+BlockedRequest MakeHostRequest(const std::string& host, int i, int64_t timestamp) {
+    BlockedRequest request = MakeRequest(i);
+    request.url = "https://" + host + "/page?i=" + std::to_string(i);
+    request.host = host;
+    request.reason = (i % 10 == 0) ? "恶意软件" : "广告拦截";
+    request.timestamp = timestamp;
+    request.browser_id = "browser-" + std::to_string(i % 4);
+    request.tab_id = i % 16;
+    return request;
+}
+
+void AddRequest(StreamSketches* sketches, const BlockedRequest& request) {
+    sketches->Add(MakeRequestView(request));
+}
+
+void TestTopHosts() {
+    StreamSketches sketches;
+    for (int i = 0; i < 20000; ++i) {
+        AddRequest(&sketches, MakeHostRequest(SkewedHost(i), i, kBaseTime + i));
+    }
+
+    auto top = sketches.TopHosts(5);
+    Check(top.size() == 5, "TopHosts返回5项");
+    for (size_t h = 0; h < top.size(); ++h) {
+        std::string expected = "host" + std::to_string(h) + ".example.com";
+        Check(top[h].key == expected, "高频host排序正确");
+    }
+    if (!top.empty()) {
+        // host0真实次数为 400 * 10 = 4000
+        Check(top[0].count - top[0].error <= 4000 && top[0].count >= 4000,
+              "Space-Saving误差界包含真实次数");
+    }
+    int64_t estimate = sketches.EstimateHostCount("host1.example.com");
+    Check(estimate >= 2000 && estimate < 2200, "Count-Min估计接近真实次数");
+
+    auto reasons = sketches.TopReasons(2);
+    Check(reasons.size() == 2 && reasons[0].key == "广告拦截" && reasons[0].count == 18000,
+          "TopReasons统计正确");
+}
+
+void TestDistinctUrls() {
+    StreamSketches sketches;
+    const int kDistinct = 10000;
+    for (int round = 0; round < 2; ++round) {
+        for (int i = 0; i < kDistinct; ++i) {
+            BlockedRequest request = MakeHostRequest("a.example.com", i, kBaseTime + i);
+            request.browser_id = "browser-x";
+            request.tab_id = 1;
+            AddRequest(&sketches, request);
+        }
+    }
+
+    double browser = sketches.DistinctUrls("browser-x");
+    double tab = sketches.DistinctTabUrls("browser-x", 1);
+    std::printf("不同url数: 真实 %d, 按浏览器 %.0f, 按标签页 %.0f\n", kDistinct, browser, tab);
+    Check(std::fabs(browser - kDistinct) / kDistinct < 0.05, "按浏览器估计误差<5%");
+    Check(std::fabs(tab - kDistinct) / kDistinct < 0.2, "按标签页估计误差<20%");
+    Check(sketches.DistinctUrls("browser-none") == 0, "未出现的浏览器为0");
+}
+
+void TestMerge() {
+    StreamSketches whole;
+    StreamSketches left;
+    StreamSketches right;
+    for (int i = 0; i < 20000; ++i) {
+        BlockedRequest request = MakeHostRequest(SkewedHost(i), i, kBaseTime + i * 100);
+        AddRequest(&whole, request);
+        AddRequest(i % 2 ? &left : &right, request);
+    }
+    Check(left.Merge(right), "Options一致时可以合并");
+
+    auto expected = whole.TopHosts(5);
+    auto merged = left.TopHosts(5);
+    Check(expected.size() == merged.size(), "合并后TopHosts项数一致");
+    for (size_t h = 0; h < expected.size() && h < merged.size(); ++h) {
+        Check(expected[h].key == merged[h].key, "合并后高频host一致");
+    }
+    Check(whole.EstimateHostCount("host2.example.com") ==
+              left.EstimateHostCount("host2.example.com"),
+          "合并后Count-Min与整体一致");
+    Check(std::fabs(whole.DistinctUrls("browser-1") - left.DistinctUrls("browser-1")) < 1e-6,
+          "合并后HyperLogLog与整体一致");
+
+    StreamSketches::Options options;
+    options.bucket_ms = 1000;
+    StreamSketches other(options);
+    Check(!left.Merge(other), "Options不一致时拒绝合并");
+}
+
+void TestWindow() {
+    StreamSketches::Options options;
+    options.bucket_ms = 1000;
+    options.bucket_count = 10;
+    StreamSketches sketches(options);
+
+    // 第0秒大量old.example.com，第5秒起只有new.example.com
+    for (int i = 0; i < 500; ++i) {
+        AddRequest(&sketches, MakeHostRequest("old.example.com", i, kBaseTime + i));
+    }
+    for (int i = 0; i < 100; ++i) {
+        AddRequest(&sketches, MakeHostRequest("new.example.com", i, kBaseTime + 5000 + i * 10));
+    }
+
+    auto all = sketches.TopHosts(1);
+    Check(!all.empty() && all[0].key == "old.example.com", "全窗口内old最多");
+    auto recent = sketches.TopHosts(1, 2000);
+    Check(!recent.empty() && recent[0].key == "new.example.com", "最近2秒内只有new");
+    Check(sketches.EstimateHostCount("old.example.com", 2000) == 0, "窗口外的桶不计入");
+
+    // 超出保留范围后旧桶被淘汰
+    AddRequest(&sketches, MakeHostRequest("late.example.com", 0, kBaseTime + 20000));
+    Check(sketches.EstimateHostCount("old.example.com") == 0, "过期的桶被淘汰");
+    Check(sketches.latest_bucket_start() == kBaseTime + 20000, "最新桶起始时间正确");
+
+    // 比保留范围还旧的请求直接丢弃
+    AddRequest(&sketches, MakeHostRequest("stale.example.com", 0, kBaseTime));
+    Check(sketches.EstimateHostCount("stale.example.com") == 0, "过旧的请求被丢弃");
+}
+
+void TestQueryLatency() {
+    StreamSketches sketches;
+    for (int i = 0; i < 200000; ++i) {
+        AddRequest(&sketches, MakeHostRequest(SkewedHost(i), i, kBaseTime + i * 18));
+    }
+
+    const int kQueries = 200;
+    size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int q = 0; q < kQueries; ++q) {
+        sink += sketches.TopHosts(10).size();
+    }
+    auto middle = std::chrono::steady_clock::now();
+    for (int q = 0; q < kQueries; ++q) {
+        sink += static_cast<size_t>(sketches.DistinctUrls("browser-1"));
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::printf("60桶窗口查询: TopHosts %.1f us/次, DistinctUrls %.1f us/次 (sink=%zu)\n",
+                std::chrono::duration<double, std::micro>(middle - start).count() / kQueries,
+                std::chrono::duration<double, std::micro>(end - middle).count() / kQueries,
+                sink);
+}
+
+void TestManager() {
+    const char kDbPath[] = "stream_sketches_test.db";
+    RemoveDatabase(kDbPath);
+
+    {
+        SmartBatchManager manager(kDbPath);
+        SmartBatchManager::Config config;
+        config.enable_timer_flush = false;
+        config.batch_size = 100;
+        manager.SetConfig(config);
+        Check(manager.GetSketches() == nullptr, "默认不启用流式统计");
+
+        config.enable_sketches = true;
+        manager.SetConfig(config);
+        if (!manager.Initialize()) {
+            Check(false, "初始化失败");
+            return;
+        }
+        for (int i = 0; i < 1000; ++i) {
+            manager.AddRequest(MakeHostRequest(SkewedHost(i), i, kBaseTime + i));
+        }
+        auto sketches = manager.GetSketches();
+        Check(sketches != nullptr, "启用后可以获取流式统计");
+        if (sketches) {
+            auto top = sketches->TopHosts(1);
+            Check(!top.empty() && top[0].key == "host0.example.com", "接入后统计到高频host");
+        }
+
+        manager.SetConfig(config);
+        Check(manager.GetSketches() == sketches, "参数不变时保留已有统计");
+        manager.Stop();
+    }
+
+    RemoveDatabase(kDbPath);
+}
+
+}  // namespace
+
+int main() {
+    TestTopHosts();
+    TestDistinctUrls();
+    TestMerge();
+    TestWindow();
+    TestQueryLatency();
+    TestManager();
+
+    return TestResult("流式统计");
+}
@@ -0,0 +1,53 @@
+#ifndef TEST_UTIL_H_
+#define TEST_UTIL_H_
+
+#include "blocked_request_db.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+
+// 各测试共用的检查计数、数据库文件清理和请求构造
+
+inline int g_failures = 0;
+
+inline void Check(bool condition, const char* message) {
+    if (!condition) {
+        std::fprintf(stderr, "失败: %s\n", message);
+        ++g_failures;
+    }
+}
+
+// 输出汇总，返回值作为main的退出码
+inline int TestResult(const char* name) {
+    if (g_failures > 0) {
+        std::fprintf(stderr, "%s测试失败: %d 项\n", name, g_failures);
+        return 1;
+    }
+    std::printf("%s测试通过\n", name);
+    return 0;
+}
+
+// 删除数据库文件及其WAL、共享内存和回滚日志文件
+inline void RemoveDatabase(const std::string& path) {
+    unlink(path.c_str());
+    unlink((path + "-wal").c_str());
+    unlink((path + "-shm").c_str());
+    unlink((path + "-journal").c_str());
+}
+
+// 第i条测试请求：url各不相同，时间戳按i递增；各测试在此基础上改写需要的字段
+inline BlockedRequest MakeRequest(int64_t i) {
+    BlockedRequest request{};
+    request.id = 0;
+    request.url = "https://tracker.example.net/p?i=" + std::to_string(i);
+    request.host = "tracker.example.net";
+    request.reason = "广告追踪";
+    request.timestamp = 1700000000000 + i;
+    request.reported = false;
+    request.browser_id = "Chrome/120.0.0.0";
+    request.tab_id = i % 8;
+    return request;
+}
+
+#endif  // TEST_UTIL_H_
@@ -0,0 +1,165 @@
+#include "blocked_request_db.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// URL子串索引基准
+// 同样的记录分别写入未开启和开启URL索引的数据库，对比写入吞吐和文件大小，
+// 再对比索引搜索与全表扫描的首页延迟，用于按部署决定是否开启索引
+//
+// 用法: ./url_search_bench [记录数] [批次大小]
+
+namespace {
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int64_t FileSize(const std::string& path) {
+    struct stat st;
+    int64_t total = 0;
+    for (const char* suffix : {"", "-wal"}) {
+        if (stat((path + suffix).c_str(), &st) == 0) total += st.st_size;
+    }
+    return total;
+}
+
+void RemoveDatabase(const std::string& path) {
+    unlink(path.c_str());
+    unlink((path + "-wal").c_str());
+    unlink((path + "-shm").c_str());
+}
+
+// 生成形态各异的url：若干跟踪域名 × 路径模板 × 随机参数
+std::vector<BlockedRequest> MakeRequests(int total) {
+    static const char* const kHosts[] = {
+        "www.google-analytics.com", "stats.g.doubleclick.net", "connect.facebook.net",
+        "bat.bing.com", "px.ads.linkedin.com", "sb.scorecardresearch.com",
+        "cdn.segment.com", "api.mixpanel.com", "tracker.example.net", "ads.example.com",
+    };
+    static const char* const kPaths[] = {
+        "/g/collect?v=2&tid=G-", "/pagead/viewthroughconversion/", "/tr/?id=",
+        "/action/0?ti=", "/px/li_sync?pid=", "/b2?c1=2&c2=", "/v1/track?writeKey=",
+        "/track/?data=", "/pixel.gif?uid=", "/banner/",
+    };
+
+    std::mt19937_64 rng(20240601);
+    std::vector<BlockedRequest> requests(total);
+    for (int i = 0; i < total; ++i) {
+        BlockedRequest& request = requests[i];
+        const char* host = kHosts[rng() % 10];
+        char token[24];
+        std::snprintf(token, sizeof(token), "%016llx", static_cast<unsigned long long>(rng()));
+        request.id = 0;
+        request.url = std::string("https://") + host + kPaths[rng() % 10] + token +
+                      "&seq=" + std::to_string(i);
+        request.host = host;
+        request.reason = "广告追踪";
+        request.timestamp = 1700000000000 + i;
+        request.reported = false;
+        request.browser_id = "Chrome/120.0.0.0";
+        request.tab_id = i % 16;
+    }
+    return requests;
+}
+
+double Insert(BlockedRequestDB* db, const std::vector<BlockedRequest>& requests, int batch_size) {
+    std::vector<BlockedRequestView> batch;
+    batch.reserve(batch_size);
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& request : requests) {
+        batch.push_back(MakeRequestView(request));
+        if (static_cast<int>(batch.size()) == batch_size) {
+            db->AddBlockedRequests(batch);
+            batch.clear();
+        }
+    }
+    if (!batch.empty()) db->AddBlockedRequests(batch);
+    return SecondsSince(start);
+}
+
+// 取首页，返回平均毫秒数
+double TimeSearch(BlockedRequestDB* db, const std::string& pattern, int repeat, size_t* hits) {
+    BlockedRequestDB::UrlSearchPage page;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeat; ++i) {
+        db->SearchByUrl(pattern, 0, 50, &page);
+    }
+    *hits = page.requests.size();
+    return SecondsSince(start) * 1000 / repeat;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int total = argc > 1 ? std::atoi(argv[1]) : 200000;
+    int batch_size = argc > 2 ? std::atoi(argv[2]) : 100;
+    if (total <= 0 || batch_size <= 0) {
+        std::fprintf(stderr, "用法: %s [记录数] [批次大小]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<BlockedRequest> requests = MakeRequests(total);
+    const std::string plain_path = "url_search_bench_plain.db";
+    const std::string indexed_path = "url_search_bench_indexed.db";
+    RemoveDatabase(plain_path);
+    RemoveDatabase(indexed_path);
+
+    BlockedRequestDB plain;
+    BlockedRequestDB indexed;
+    if (!plain.Initialize(plain_path) || !indexed.Initialize(indexed_path)) {
+        std::fprintf(stderr, "初始化失败\n");
+        return 1;
+    }
+    if (!indexed.SetUrlSearchEnabled(true)) {
+        std::fprintf(stderr, "SQLite不支持FTS5 trigram\n");
+        return 1;
+    }
+
+    double plain_seconds = Insert(&plain, requests, batch_size);
+    double indexed_seconds = Insert(&indexed, requests, batch_size);
+    sqlite3* handle = nullptr;
+    for (const std::string& path : {plain_path, indexed_path}) {
+        if (sqlite3_open(path.c_str(), &handle) == SQLITE_OK) {
+            sqlite3_wal_checkpoint_v2(handle, nullptr, SQLITE_CHECKPOINT_TRUNCATE, nullptr, nullptr);
+        }
+        sqlite3_close(handle);
+    }
+
+    std::printf("写入 %d 条，批次 %d\n", total, batch_size);
+    std::printf("  %-10s %10.0f 条/秒  %8.1f MB\n", "无索引", total / plain_seconds,
+                FileSize(plain_path) / 1048576.0);
+    std::printf("  %-10s %10.0f 条/秒  %8.1f MB\n", "URL索引", total / indexed_seconds,
+                FileSize(indexed_path) / 1048576.0);
+    std::printf("  写入耗时增加 %.0f%%，文件增大 %.0f%%\n",
+                (indexed_seconds / plain_seconds - 1) * 100,
+                (static_cast<double>(FileSize(indexed_path)) / FileSize(plain_path) - 1) * 100);
+
+    // 常见子串、只出现一次的随机token、很少出现的序号、不存在的子串
+    const std::string& sample = requests[total / 2].url;
+    const std::string token = sample.substr(sample.find("&seq=") - 16, 12);
+    const std::string patterns[] = {
+        "/g/collect?", token, "seq=" + std::to_string(total / 3), "/no/such/path",
+    };
+    std::printf("首页搜索（50条）\n");
+    std::printf("  %-28s %12s %12s %6s\n", "pattern", "扫描(ms)", "索引(ms)", "命中");
+    for (const auto& pattern : patterns) {
+        size_t scan_hits = 0;
+        size_t index_hits = 0;
+        double scan_ms = TimeSearch(&plain, pattern, 3, &scan_hits);
+        double index_ms = TimeSearch(&indexed, pattern, 20, &index_hits);
+        std::printf("  %-28s %12.2f %12.3f %6zu%s\n", pattern.c_str(), scan_ms, index_ms,
+                    index_hits, scan_hits == index_hits ? "" : "  (结果不一致)");
+    }
+
+    plain.Close();
+    indexed.Close();
+    RemoveDatabase(plain_path);
+    RemoveDatabase(indexed_path);
+    return 0;
+}
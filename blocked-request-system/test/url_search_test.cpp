@@ -0,0 +1,169 @@
+#include "blocked_request_db.h"
+#include "test_util.h"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// URL子串搜索测试
+// 验证索引与全表扫描结果一致、分页不重不漏、写入/删除时索引同步维护，
+// 以及短模式和未开启索引时的回退
+
+namespace {
+
+const char kDbPath[] = "url_search_test.db";
+
+BlockedRequest MakeSearchRequest(int i, int64_t timestamp) {
+    BlockedRequest request = MakeRequest(i);
+    switch (i % 4) {
+        case 0:
+            request.url = "https://www.google-analytics.com/g/collect?v=2&tid=" + std::to_string(i);
+            break;
+        case 1:
+            request.url = "https://ads.example.com/banner/" + std::to_string(i) + ".js";
+            break;
+        case 2:
+            request.url = "https://cdn.example.com/\"quoted\"/[*]/p?i=" + std::to_string(i);
+            break;
+        default:
+            request.url = "https://tracker.example.net/pixel?x=" + std::to_string(i);
+            break;
+    }
+    request.host = "example.com";
+    request.reason = "广告拦截";
+    request.timestamp = timestamp;
+    return request;
+}
+
+bool AddRange(BlockedRequestDB* db, int begin, int end, int64_t timestamp) {
+    std::vector<BlockedRequest> requests;
+    for (int i = begin; i < end; ++i) {
+        requests.push_back(MakeSearchRequest(i, timestamp));
+    }
+    return db->AddBlockedRequests(requests);
+}
+
+// 分页取出全部结果，检查每页按id递减且页间不重叠
+std::vector<int64_t> SearchAll(BlockedRequestDB* db, const std::string& pattern, int limit) {
+    std::vector<int64_t> ids;
+    int64_t cursor = 0;
+    BlockedRequestDB::UrlSearchPage page;
+    do {
+        if (!db->SearchByUrl(pattern, cursor, limit, &page)) {
+            Check(false, "SearchByUrl失败");
+            break;
+        }
+        for (const auto& request : page.requests) {
+            Check(ids.empty() || request.id < ids.back(), "结果按id递减且不重复");
+            Check(request.url.find(pattern) != std::string::npos, "结果包含pattern");
+            ids.push_back(request.id);
+        }
+        cursor = page.next_cursor;
+    } while (cursor != 0);
+    return ids;
+}
+
+// 与全表扫描对照：关闭索引后的结果
+std::vector<int64_t> ExpectedIds(BlockedRequestDB* db, const std::string& pattern) {
+    std::vector<int64_t> ids;
+    for (const auto& request : db->GetAllRequests(1000000)) {
+        if (request.url.find(pattern) != std::string::npos) {
+            ids.push_back(request.id);
+        }
+    }
+    std::sort(ids.rbegin(), ids.rend());
+    return ids;
+}
+
+bool IndexIntegrityOk() {
+    sqlite3* db = nullptr;
+    if (sqlite3_open(kDbPath, &db) != SQLITE_OK) {
+        sqlite3_close(db);
+        return false;
+    }
+    int result = sqlite3_exec(db,
+                              "INSERT INTO blocked_requests_url_fts (blocked_requests_url_fts, rank) "
+                              "VALUES ('integrity-check', 1)",
+                              nullptr, nullptr, nullptr);
+    sqlite3_close(db);
+    return result == SQLITE_OK;
+}
+
+}  // namespace
+
+int main() {
+    RemoveDatabase(kDbPath);
+
+    {
+        BlockedRequestDB db;
+        if (!db.Initialize(kDbPath)) {
+            std::fprintf(stderr, "初始化失败\n");
+            return 1;
+        }
+        Check(!db.url_search_enabled(), "默认不开启URL索引");
+
+        // 另一个在开启前打开的连接，写入时应发现索引已开启
+        BlockedRequestDB other;
+        Check(other.Initialize(kDbPath), "打开第二个连接");
+
+        // 开启前已有的记录在开启时重建进索引
+        Check(AddRange(&db, 0, 300, 1000), "写入旧记录");
+        if (!db.SetUrlSearchEnabled(true)) {
+            std::fprintf(stderr, "SQLite不支持FTS5 trigram，跳过\n");
+            RemoveDatabase(kDbPath);
+            return 0;
+        }
+        Check(db.url_search_enabled(), "开启URL索引");
+
+        // 开启后的写入在同一事务内更新索引
+        Check(AddRange(&db, 300, 500, 2000), "写入新记录");
+        Check(AddRange(&other, 500, 599, 2000), "第二个连接批量写入");
+        Check(other.AddBlockedRequest(MakeSearchRequest(599, 2000)), "第二个连接单条写入");
+        Check(other.url_search_enabled(), "第二个连接发现索引已开启");
+        Check(IndexIntegrityOk(), "索引与内容表一致");
+
+        // 含GLOB通配符和引号的模式按字面匹配
+        const std::string patterns[] = {"/collect?", "banner/1", "\"quoted\"", "/[*]/p?i=1",
+                                        "pixel?x=59", "?x"};
+        for (const auto& pattern : patterns) {
+            std::vector<int64_t> expected = ExpectedIds(&db, pattern);
+            Check(!expected.empty(), "对照结果非空");
+            Check(SearchAll(&db, pattern, 7) == expected, "分页结果与全表扫描一致");
+            Check(SearchAll(&db, pattern, 1000) == expected, "单页结果与全表扫描一致");
+        }
+
+        BlockedRequestDB::UrlSearchPage page;
+        Check(db.SearchByUrl("/COLLECT?", 0, 10, &page) && page.requests.empty(), "区分大小写");
+        Check(db.SearchByUrl("no-such-substring", 0, 10, &page) && page.requests.empty() &&
+                  page.next_cursor == 0,
+              "无结果时cursor为0");
+        Check(!db.SearchByUrl("", 0, 10, &page), "空pattern返回false");
+
+        // 删除记录时索引同步删除
+        std::vector<int64_t> reported;
+        for (const auto& request : db.GetAllRequests(1000000)) {
+            if (request.timestamp == 1000) reported.push_back(request.id);
+        }
+        Check(db.MarkAsReported(reported), "标记旧记录已上报");
+        Check(db.DeleteReportedRequestsBefore(1500), "删除旧记录");
+        Check(IndexIntegrityOk(), "删除后索引与内容表一致");
+        Check(SearchAll(&db, "/collect?", 50).size() == 75, "删除后只剩新记录");
+    }
+
+    // 重新打开后沿用索引，关闭后回退到全表扫描
+    {
+        BlockedRequestDB db;
+        Check(db.Initialize(kDbPath), "重新打开");
+        Check(db.url_search_enabled(), "重新打开后索引仍开启");
+        std::vector<int64_t> indexed = SearchAll(&db, "/collect?", 20);
+        Check(db.SetUrlSearchEnabled(false), "关闭URL索引");
+        Check(!db.url_search_enabled(), "索引已关闭");
+        Check(SearchAll(&db, "/collect?", 20) == indexed, "关闭后扫描结果一致");
+        Check(AddRange(&db, 600, 610, 3000), "关闭后仍可写入");
+    }
+
+    RemoveDatabase(kDbPath);
+
+    return TestResult("URL搜索");
+}
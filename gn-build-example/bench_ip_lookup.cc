@@ -0,0 +1,159 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "maxminddb.h"
+
+// MMDB_lookup_string、MMDB_lookup_sockaddr和MMDB_get_value的吞吐量与单次耗时分位数
+// 地址随机生成：IPv4取全部地址空间，IPv6取2000::/3，ipv6_ratio为IPv6地址的比例
+// （只对IPv6数据库有效）。配合mmdb_writer生成的数据库作为各项查询优化的基线：
+//   mmdb_writer /tmp/bench.mmdb --networks 1000000 --build-epoch 1
+//   bench_ip_lookup /tmp/bench.mmdb
+// 用法: bench_ip_lookup <mmdb_path> [lookups] [ipv6_ratio]
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    const char* name;
+    double ns_per_op;       // 连续执行时的平均耗时
+    std::vector<double> latencies;
+};
+
+// 先连续执行一遍计吞吐量，再逐次计时得到分位数（含读时钟的开销）
+template <typename F>
+Result Measure(const char* name, size_t count, F&& op) {
+    Result result;
+    result.name = name;
+    auto start = Clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        op(i);
+    }
+    result.ns_per_op =
+        std::chrono::duration<double, std::nano>(Clock::now() - start).count() / count;
+    result.latencies.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        auto op_start = Clock::now();
+        op(i);
+        result.latencies.push_back(
+            std::chrono::duration<double, std::nano>(Clock::now() - op_start).count());
+    }
+    std::sort(result.latencies.begin(), result.latencies.end());
+    return result;
+}
+
+double Percentile(const std::vector<double>& sorted, double p) {
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
+
+void Print(const Result& result) {
+    const auto& l = result.latencies;
+    printf("%-22s %8.0f %8.2f %8.0f %8.0f %8.0f %8.0f %9.0f\n", result.name, result.ns_per_op,
+           1e3 / result.ns_per_op, Percentile(l, 0.5), Percentile(l, 0.9), Percentile(l, 0.99),
+           Percentile(l, 0.999), l.back());
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <mmdb_path> [lookups] [ipv6_ratio]\n", argv[0]);
+        return 1;
+    }
+    size_t lookups = argc > 2 ? strtoull(argv[2], nullptr, 10) : 1000000;
+    double ipv6_ratio = argc > 3 ? atof(argv[3]) : 0.2;
+    if (lookups == 0) {
+        printf("Usage: %s <mmdb_path> [lookups] [ipv6_ratio]\n", argv[0]);
+        return 1;
+    }
+    MMDB_s mmdb;
+    int status = MMDB_open(argv[1], MMDB_MODE_MMAP, &mmdb);
+    if (status != MMDB_SUCCESS) {
+        fprintf(stderr, "无法打开 %s: %s\n", argv[1], MMDB_strerror(status));
+        return 1;
+    }
+    if (mmdb.metadata.ip_version != 6) {
+        ipv6_ratio = 0;
+    }
+
+    std::mt19937 rng(20240617);
+    std::bernoulli_distribution is_ipv6(ipv6_ratio);
+    std::vector<std::string> ips(lookups);
+    std::vector<sockaddr_storage> sockaddrs(lookups);
+    for (size_t i = 0; i < lookups; ++i) {
+        char text[INET6_ADDRSTRLEN];
+        memset(&sockaddrs[i], 0, sizeof(sockaddrs[i]));
+        if (is_ipv6(rng)) {
+            auto* sin6 = reinterpret_cast<sockaddr_in6*>(&sockaddrs[i]);
+            sin6->sin6_family = AF_INET6;
+            for (int k = 0; k < 16; ++k) {
+                sin6->sin6_addr.s6_addr[k] = static_cast<uint8_t>(rng());
+            }
+            sin6->sin6_addr.s6_addr[0] = 0x20 | (sin6->sin6_addr.s6_addr[0] & 0x1f);
+            inet_ntop(AF_INET6, &sin6->sin6_addr, text, sizeof(text));
+        } else {
+            auto* sin = reinterpret_cast<sockaddr_in*>(&sockaddrs[i]);
+            sin->sin_family = AF_INET;
+            sin->sin_addr.s_addr = rng();
+            inet_ntop(AF_INET, &sin->sin_addr, text, sizeof(text));
+        }
+        ips[i] = text;
+    }
+
+    // 查到的数据记录，供MMDB_get_value使用；同时预热映射的页面
+    std::vector<MMDB_entry_s> entries;
+    for (size_t i = 0; i < lookups; ++i) {
+        int mmdb_error = 0;
+        MMDB_lookup_result_s result = MMDB_lookup_sockaddr(
+            &mmdb, reinterpret_cast<const sockaddr*>(&sockaddrs[i]), &mmdb_error);
+        if (mmdb_error == MMDB_SUCCESS && result.found_entry) {
+            entries.push_back(result.entry);
+        }
+    }
+
+    uint64_t sink = 0;
+    std::vector<Result> results;
+    results.push_back(Measure("MMDB_lookup_string", lookups, [&](size_t i) {
+        int gai_error = 0;
+        int mmdb_error = 0;
+        MMDB_lookup_result_s result =
+            MMDB_lookup_string(&mmdb, ips[i].c_str(), &gai_error, &mmdb_error);
+        sink += result.found_entry;
+    }));
+    results.push_back(Measure("MMDB_lookup_sockaddr", lookups, [&](size_t i) {
+        int mmdb_error = 0;
+        MMDB_lookup_result_s result = MMDB_lookup_sockaddr(
+            &mmdb, reinterpret_cast<const sockaddr*>(&sockaddrs[i]), &mmdb_error);
+        sink += result.found_entry;
+    }));
+    if (!entries.empty()) {
+        results.push_back(Measure("MMDB_get_value", entries.size(), [&](size_t i) {
+            MMDB_entry_data_s entry_data;
+            MMDB_get_value(&entries[i], &entry_data, "country", "iso_code", NULL);
+            sink += entry_data.has_data;
+        }));
+    }
+
+    printf("%s: %u nodes, %u-bit records, IPv%u; %zu lookups (%.0f%% IPv6), %.1f%% found\n",
+           argv[1], mmdb.metadata.node_count, mmdb.metadata.record_size,
+           mmdb.metadata.ip_version, lookups, ipv6_ratio * 100,
+           100.0 * entries.size() / lookups);
+    printf("%-22s %8s %8s %8s %8s %8s %8s %9s\n", "operation", "ns/op", "Mops/s", "p50", "p90",
+           "p99", "p99.9", "max");
+    for (const auto& result : results) {
+        Print(result);
+    }
+    printf("(%d)\n", static_cast<int>(sink & 1));
+    MMDB_close(&mmdb);
+    return 0;
+}
@@ -0,0 +1,42 @@
+#!/bin/sh
+# Two-stage profile-guided build.
+#
+#   1. Build instrumented binaries (pgo_phase="generate").
+#   2. Train them on a synthetic lookup workload: a generated database, the
+#      lookup benchmark, IpChecker single and batched lookups and bulk mode.
+#   3. Rebuild everything in the same output directory with the profiles
+#      (pgo_phase="use").
+#
+# Usage: build/pgo.sh [out_dir] [extra gn args]
+#   build/pgo.sh out/pgo 'target_march="native"'
+
+set -e
+
+out_dir=${1:-out/pgo}
+extra_args=${2:-}
+args="is_official_build=true $extra_args"
+profile_dir="$out_dir/pgo-profile"
+
+gn gen "$out_dir" --args="$args pgo_phase=\"generate\""
+ninja -C "$out_dir" mmdb_writer bench_ip_lookup check_ip_tool test_lookup_batch test_record_memo
+
+rm -rf "$profile_dir"
+db="$out_dir/pgo-train.mmdb"
+ips="$out_dir/pgo-train.txt"
+"$out_dir/mmdb_writer" "$db" --networks 500000 --ipv6-ratio 0.2 --record-size 28 \
+    --build-epoch 1
+awk 'BEGIN {
+    srand(1)
+    for (i = 0; i < 1000000; i++) {
+        printf "%d.%d.%d.%d\n", rand() * 256, rand() * 256, rand() * 256, rand() * 256
+    }
+}' > "$ips"
+"$out_dir/bench_ip_lookup" "$db" 500000 0.2
+"$out_dir/test_lookup_batch" "$db"
+"$out_dir/test_record_memo" "$db"
+"$out_dir/check_ip_tool" --bulk "$db" "$ips" --quiet
+"$out_dir/check_ip_tool" --bulk "$db" "$ips" --quiet --ipv4-table
+rm -f "$db" "$ips"
+
+gn gen "$out_dir" --args="$args pgo_phase=\"use\""
+ninja -C "$out_dir"
@@ -0,0 +1,472 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+// 生成合成的MaxMind DB文件，供没有网络、拿不到GeoLite数据库时测试和基准使用
+// 网段随机（后插入的网段覆盖先插入的重叠部分），数据记录仿照GeoIP2 City的结构：
+// continent（指针，多条记录共用）、country、registered_country、subdivisions、city、
+// location，每三条记录带一个autonomous_system_number。参数、种子和build_epoch相同时
+// 生成的文件相同。
+// 用法: mmdb_writer <output_path> [--networks N] [--ipv6-ratio R] [--record-size 24|28|32]
+//                   [--records K] [--ip-version 4|6] [--type NAME] [--seed S]
+//                   [--build-epoch T]
+
+namespace {
+
+struct WriterOptions {
+    const char* output_path = nullptr;
+    size_t networks = 100000;
+    double ipv6_ratio = 0.2;        // IPv6网段的比例，--ip-version 4时忽略
+    int record_size = 28;
+    size_t records = 4096;          // 不同数据记录的条数
+    int ip_version = 6;
+    const char* database_type = "Synthetic-City";
+    uint32_t seed = 1;
+    uint64_t build_epoch = 0;       // 0表示当前时间
+};
+
+// MaxMind DB数据段的类型
+enum DataType {
+    kPointer = 1,
+    kUtf8String = 2,
+    kDouble = 3,
+    kUint16 = 5,
+    kUint32 = 6,
+    kMap = 7,
+    kUint64 = 9,
+    kArray = 11,
+};
+
+// 数据段编码
+class DataWriter {
+public:
+    std::string& bytes() { return bytes_; }
+    uint32_t size() const { return static_cast<uint32_t>(bytes_.size()); }
+
+    void Control(int type, size_t size) {
+        uint8_t first = type <= 7 ? static_cast<uint8_t>(type << 5) : 0;
+        if (size < 29) {
+            first |= static_cast<uint8_t>(size);
+        } else if (size < 29 + 256) {
+            first |= 29;
+        } else if (size < 285 + 65536) {
+            first |= 30;
+        } else {
+            first |= 31;
+        }
+        bytes_.push_back(static_cast<char>(first));
+        if (type > 7) {
+            bytes_.push_back(static_cast<char>(type - 7));
+        }
+        if (size >= 285 + 65536) {
+            BigEndian(size - 65821, 3);
+        } else if (size >= 285) {
+            BigEndian(size - 285, 2);
+        } else if (size >= 29) {
+            BigEndian(size - 29, 1);
+        }
+    }
+
+    void String(const std::string& value) {
+        Control(kUtf8String, value.size());
+        bytes_ += value;
+    }
+
+    void Uint16(uint16_t value) { Unsigned(kUint16, value); }
+    void Uint32(uint32_t value) { Unsigned(kUint32, value); }
+    void Uint64(uint64_t value) { Unsigned(kUint64, value); }
+
+    void Double(double value) {
+        Control(kDouble, 8);
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        BigEndian(bits, 8);
+    }
+
+    void Map(size_t entries) { Control(kMap, entries); }
+    void Array(size_t items) { Control(kArray, items); }
+
+    // 指向数据段内offset处的值
+    void Pointer(uint32_t offset) {
+        if (offset < (1u << 11)) {
+            bytes_.push_back(static_cast<char>(kPointer << 5 | offset >> 8));
+            BigEndian(offset, 1);
+        } else if (offset < (1u << 19) + 2048) {
+            offset -= 2048;
+            bytes_.push_back(static_cast<char>(kPointer << 5 | 1 << 3 | offset >> 16));
+            BigEndian(offset, 2);
+        } else if (offset < (1u << 27) + 526336) {
+            offset -= 526336;
+            bytes_.push_back(static_cast<char>(kPointer << 5 | 2 << 3 | offset >> 24));
+            BigEndian(offset, 3);
+        } else {
+            bytes_.push_back(static_cast<char>(kPointer << 5 | 3 << 3));
+            BigEndian(offset, 4);
+        }
+    }
+
+private:
+    // 整数按最少的字节存放
+    void Unsigned(int type, uint64_t value) {
+        size_t length = 0;
+        while (length < 8 && (value >> (8 * length)) != 0) {
+            length++;
+        }
+        Control(type, length);
+        BigEndian(value, length);
+    }
+
+    void BigEndian(uint64_t value, size_t length) {
+        for (size_t i = length; i > 0; --i) {
+            bytes_.push_back(static_cast<char>(value >> (8 * (i - 1))));
+        }
+    }
+
+    std::string bytes_;
+};
+
+// 搜索树，子节点为kEmpty、节点下标或kData|数据记录编号
+class TreeBuilder {
+public:
+    static constexpr uint32_t kEmpty = 0xffffffffu;
+    static constexpr uint32_t kData = 0x80000000u;
+
+    TreeBuilder() { nodes_.push_back({kEmpty, kEmpty}); }
+
+    // address为16字节大端，prefix_length按地址的全部位数计
+    void Insert(const uint8_t address[16], int prefix_length, uint32_t record) {
+        uint32_t node = 0;
+        for (int depth = 0; depth < prefix_length; ++depth) {
+            int bit = address[depth >> 3] >> (7 - (depth & 7)) & 1;
+            if (depth == prefix_length - 1) {
+                nodes_[node].child[bit] = kData | record;
+                return;
+            }
+            uint32_t child = nodes_[node].child[bit];
+            if (child == kEmpty || (child & kData)) {
+                // 在已有的网段里插入更细的网段：拆开，两边先继承原来的结果
+                uint32_t split = static_cast<uint32_t>(nodes_.size());
+                nodes_.push_back({child, child});
+                nodes_[node].child[bit] = split;
+                child = split;
+            }
+            node = child;
+        }
+    }
+
+    // 按先序重新编号，去掉被更粗的网段覆盖后不可达的节点
+    void Compact() {
+        std::vector<Node> compacted;
+        std::vector<uint32_t> stack = {0};
+        std::vector<uint32_t> renumbered(nodes_.size(), kEmpty);
+        std::vector<uint32_t> order;
+        while (!stack.empty()) {
+            uint32_t node = stack.back();
+            stack.pop_back();
+            renumbered[node] = static_cast<uint32_t>(order.size());
+            order.push_back(node);
+            for (int bit = 1; bit >= 0; --bit) {
+                uint32_t child = nodes_[node].child[bit];
+                if (child != kEmpty && !(child & kData)) {
+                    stack.push_back(child);
+                }
+            }
+        }
+        for (uint32_t node : order) {
+            Node copy = nodes_[node];
+            for (uint32_t& child : copy.child) {
+                if (child != kEmpty && !(child & kData)) {
+                    child = renumbered[child];
+                }
+            }
+            compacted.push_back(copy);
+        }
+        nodes_.swap(compacted);
+    }
+
+    // 按记录位数写出搜索树，record_offsets为每条数据记录在数据段内的偏移
+    bool Write(FILE* file, int record_size, const std::vector<uint32_t>& record_offsets) const {
+        uint64_t node_count = nodes_.size();
+        uint64_t limit = uint64_t{1} << record_size;
+        std::vector<uint8_t> bytes;
+        bytes.reserve(nodes_.size() * record_size / 4);
+        for (const Node& node : nodes_) {
+            uint64_t values[2];
+            for (int bit = 0; bit < 2; ++bit) {
+                uint32_t child = node.child[bit];
+                if (child == kEmpty) {
+                    values[bit] = node_count;
+                } else if (child & kData) {
+                    // 数据段前有16字节的分隔
+                    values[bit] = node_count + 16 + record_offsets[child & ~kData];
+                } else {
+                    values[bit] = child;
+                }
+                if (values[bit] >= limit) {
+                    fprintf(stderr, "Record value %llu does not fit in %d bits, "
+                            "use a larger --record-size\n",
+                            static_cast<unsigned long long>(values[bit]), record_size);
+                    return false;
+                }
+            }
+            uint32_t left = static_cast<uint32_t>(values[0]);
+            uint32_t right = static_cast<uint32_t>(values[1]);
+            switch (record_size) {
+                case 24:
+                    Append(&bytes, left, 3);
+                    Append(&bytes, right, 3);
+                    break;
+                case 28:
+                    // 中间字节的高4位属于左记录，低4位属于右记录
+                    Append(&bytes, left & 0xffffff, 3);
+                    bytes.push_back(static_cast<uint8_t>((left >> 24) << 4 | right >> 24));
+                    Append(&bytes, right & 0xffffff, 3);
+                    break;
+                default:
+                    Append(&bytes, left, 4);
+                    Append(&bytes, right, 4);
+                    break;
+            }
+        }
+        return fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    }
+
+    size_t node_count() const { return nodes_.size(); }
+
+private:
+    struct Node {
+        uint32_t child[2];
+    };
+
+    static void Append(std::vector<uint8_t>* bytes, uint32_t value, int length) {
+        for (int i = length - 1; i >= 0; --i) {
+            bytes->push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    std::vector<Node> nodes_;
+};
+
+const char* const kCountries[] = {
+    "CN", "US", "JP", "DE", "GB", "FR", "KR", "IN", "BR", "RU", "CA", "AU", "IT", "NL",
+    "ES", "SE", "SG", "HK", "TW", "VN", "ID", "TH", "MX", "AR", "ZA", "EG", "NG", "TR",
+    "PL", "UA", "CH", "AT", "BE", "IE", "NO", "FI", "DK", "NZ", "PH", "MY",
+};
+constexpr size_t kCountryCount = sizeof(kCountries) / sizeof(kCountries[0]);
+
+const char* const kContinents[] = {"AS", "NA", "EU", "SA", "AF", "OC"};
+constexpr size_t kContinentCount = sizeof(kContinents) / sizeof(kContinents[0]);
+
+// 各国家所在的大洲，下标对应kContinents
+const uint8_t kCountryContinent[kCountryCount] = {
+    0, 1, 0, 2, 2, 2, 0, 0, 3, 2, 1, 5, 2, 2, 2, 2, 0, 0, 0, 0,
+    0, 0, 1, 3, 4, 4, 4, 0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 5, 0, 0,
+};
+
+// 写出数据段，返回每条数据记录的偏移
+std::vector<uint32_t> WriteRecords(size_t records, std::mt19937* rng, DataWriter* data) {
+    // 大洲先写一次，数据记录用指针引用，与官方数据库的做法一样
+    uint32_t continent_offsets[kContinentCount];
+    for (size_t i = 0; i < kContinentCount; ++i) {
+        continent_offsets[i] = data->size();
+        data->Map(2);
+        data->String("code");
+        data->String(kContinents[i]);
+        data->String("geoname_id");
+        data->Uint32(6255146 + static_cast<uint32_t>(i));
+    }
+
+    std::vector<uint32_t> offsets(records);
+    for (size_t r = 0; r < records; ++r) {
+        offsets[r] = data->size();
+        size_t country = r % kCountryCount;
+        size_t registered = (*rng)() % 8 == 0 ? (*rng)() % kCountryCount : country;
+        bool has_asn = r % 3 == 0;
+        size_t subdivisions = r % 3;
+        std::string suffix = std::to_string(r);
+
+        data->Map(has_asn ? 7 : 6);
+        data->String("continent");
+        data->Pointer(continent_offsets[kCountryContinent[country]]);
+        data->String("country");
+        data->Map(2);
+        data->String("iso_code");
+        data->String(kCountries[country]);
+        data->String("names");
+        data->Map(1);
+        data->String("en");
+        data->String(std::string("Country ") + kCountries[country]);
+        data->String("registered_country");
+        data->Map(1);
+        data->String("iso_code");
+        data->String(kCountries[registered]);
+        data->String("subdivisions");
+        data->Array(subdivisions);
+        for (size_t k = 0; k < subdivisions; ++k) {
+            data->Map(1);
+            data->String("iso_code");
+            data->String("S" + suffix + "-" + std::to_string(k));
+        }
+        data->String("city");
+        data->Map(1);
+        data->String("names");
+        data->Map(1);
+        data->String("en");
+        data->String("City " + suffix);
+        data->String("location");
+        data->Map(2);
+        data->String("latitude");
+        data->Double(static_cast<double>((*rng)() % 180000) / 1000 - 90);
+        data->String("longitude");
+        data->Double(static_cast<double>((*rng)() % 360000) / 1000 - 180);
+        if (has_asn) {
+            data->String("autonomous_system_number");
+            data->Uint32(64512 + static_cast<uint32_t>(r));
+        }
+    }
+    return offsets;
+}
+
+std::string Metadata(const WriterOptions& options, size_t node_count) {
+    DataWriter meta;
+    meta.Map(9);
+    meta.String("binary_format_major_version");
+    meta.Uint16(2);
+    meta.String("binary_format_minor_version");
+    meta.Uint16(0);
+    meta.String("build_epoch");
+    meta.Uint64(options.build_epoch ? options.build_epoch
+                                    : static_cast<uint64_t>(time(nullptr)));
+    meta.String("database_type");
+    meta.String(options.database_type);
+    meta.String("description");
+    meta.Map(1);
+    meta.String("en");
+    meta.String("Synthetic database generated by mmdb_writer");
+    meta.String("ip_version");
+    meta.Uint16(static_cast<uint16_t>(options.ip_version));
+    meta.String("languages");
+    meta.Array(1);
+    meta.String("en");
+    meta.String("node_count");
+    meta.Uint32(static_cast<uint32_t>(node_count));
+    meta.String("record_size");
+    meta.Uint16(static_cast<uint16_t>(options.record_size));
+    return std::string("\xab\xcd\xefMaxMind.com") + meta.bytes();
+}
+
+bool ParseOptions(int argc, char* argv[], WriterOptions* options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg[0] != '-') {
+            if (options->output_path) {
+                return false;
+            }
+            options->output_path = arg;
+            continue;
+        }
+        if (!value) {
+            return false;
+        }
+        if (strcmp(arg, "--networks") == 0) {
+            options->networks = strtoull(value, nullptr, 10);
+        } else if (strcmp(arg, "--ipv6-ratio") == 0) {
+            options->ipv6_ratio = atof(value);
+        } else if (strcmp(arg, "--record-size") == 0) {
+            options->record_size = atoi(value);
+        } else if (strcmp(arg, "--records") == 0) {
+            options->records = strtoull(value, nullptr, 10);
+        } else if (strcmp(arg, "--ip-version") == 0) {
+            options->ip_version = atoi(value);
+        } else if (strcmp(arg, "--type") == 0) {
+            options->database_type = value;
+        } else if (strcmp(arg, "--seed") == 0) {
+            options->seed = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        } else if (strcmp(arg, "--build-epoch") == 0) {
+            options->build_epoch = strtoull(value, nullptr, 10);
+        } else {
+            return false;
+        }
+        i++;
+    }
+    return options->output_path && options->records > 0 &&
+           (options->record_size == 24 || options->record_size == 28 ||
+            options->record_size == 32) &&
+           (options->ip_version == 4 || options->ip_version == 6) &&
+           options->ipv6_ratio >= 0 && options->ipv6_ratio <= 1;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    WriterOptions options;
+    if (!ParseOptions(argc, argv, &options)) {
+        printf("Usage: %s <output_path> [--networks N] [--ipv6-ratio R] [--record-size 24|28|32]\n"
+               "       [--records K] [--ip-version 4|6] [--type NAME] [--seed S] [--build-epoch T]\n",
+               argv[0]);
+        return 1;
+    }
+    std::mt19937 rng(options.seed);
+    std::bernoulli_distribution is_ipv6(options.ip_version == 6 ? options.ipv6_ratio : 0);
+
+    TreeBuilder tree;
+    // IPv6数据库中IPv4网段放在::/96下
+    int ipv4_offset = options.ip_version == 6 ? 96 : 0;
+    for (size_t n = 0; n < options.networks; ++n) {
+        uint8_t address[16] = {};
+        int prefix_length;
+        if (is_ipv6(rng)) {
+            // 2000::/3内，/32到/64
+            for (int i = 0; i < 8; ++i) {
+                address[i] = static_cast<uint8_t>(rng());
+            }
+            address[0] = static_cast<uint8_t>(0x20 | (address[0] & 0x1f));
+            prefix_length = 32 + static_cast<int>(rng() % 33);
+        } else {
+            // /16到/32，多数为/20到/24，与真实数据库的分布相近
+            uint32_t ipv4 = rng();
+            int index = ipv4_offset / 8;
+            address[index] = static_cast<uint8_t>(ipv4 >> 24);
+            address[index + 1] = static_cast<uint8_t>(ipv4 >> 16);
+            address[index + 2] = static_cast<uint8_t>(ipv4 >> 8);
+            address[index + 3] = static_cast<uint8_t>(ipv4);
+            static const int kIpv4Prefixes[] = {16, 18, 20, 21, 22, 22, 23, 24, 24, 24,
+                                                24, 24, 25, 26, 27, 28, 29, 30, 32, 32};
+            prefix_length = ipv4_offset + kIpv4Prefixes[rng() % 20];
+        }
+        tree.Insert(address, prefix_length, static_cast<uint32_t>(rng() % options.records));
+    }
+    tree.Compact();
+
+    DataWriter data;
+    std::vector<uint32_t> record_offsets = WriteRecords(options.records, &rng, &data);
+
+    FILE* file = fopen(options.output_path, "wb");
+    if (!file) {
+        fprintf(stderr, "Failed to create %s\n", options.output_path);
+        return 1;
+    }
+    std::string separator(16, '\0');
+    std::string metadata = Metadata(options, tree.node_count());
+    bool ok = tree.Write(file, options.record_size, record_offsets) &&
+              fwrite(separator.data(), 1, separator.size(), file) == separator.size() &&
+              fwrite(data.bytes().data(), 1, data.size(), file) == data.size() &&
+              fwrite(metadata.data(), 1, metadata.size(), file) == metadata.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        fprintf(stderr, "Failed to write %s\n", options.output_path);
+        remove(options.output_path);
+        return 1;
+    }
+    fprintf(stderr, "%s: %zu networks, %zu nodes, %zu records, %u bytes of data, %d-bit records\n",
+            options.output_path, options.networks, tree.node_count(), options.records,
+            data.size(), options.record_size);
+    return 0;
+}
@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "maxminddb.h"
+// data-pool.h是libmaxminddb的内部头文件，没有extern "C"
+extern "C" {
+#include "data-pool.h"
+}
+
+// 检查重置后复用的data pool：按同样顺序分配到同样的内存、连成同样顺序的链表；
+// 再对随机地址查到的数据记录，比较MMDB_get_entry_data_list_with_pool与
+// MMDB_get_entry_data_list得到的链表，并给出两者的耗时
+// 用法: test_data_pool <mmdb_path> [cases]
+
+namespace {
+
+// 分配count个元素并连成链表，检查链表按分配顺序排列，返回分配到的地址
+std::vector<MMDB_entry_data_list_s*> Fill(MMDB_data_pool_s* pool, size_t count, int* failures) {
+    std::vector<MMDB_entry_data_list_s*> elements;
+    for (size_t i = 0; i < count; ++i) {
+        MMDB_entry_data_list_s* element = data_pool_alloc(pool);
+        if (!element || element->next || element->entry_data.has_data) {
+            fprintf(stderr, "第%zu次分配得到的元素未清零\n", i);
+            (*failures)++;
+            return elements;
+        }
+        element->entry_data.uint32 = static_cast<uint32_t>(i);
+        element->entry_data.has_data = true;
+        elements.push_back(element);
+    }
+    MMDB_entry_data_list_s* list = data_pool_to_list(pool);
+    size_t i = 0;
+    for (; list; list = list->next, ++i) {
+        if (i >= elements.size() || list != elements[i] || list->entry_data.uint32 != i) {
+            break;
+        }
+    }
+    if (i != elements.size()) {
+        fprintf(stderr, "%zu个元素的链表顺序不对，第%zu个不同\n", count, i);
+        (*failures)++;
+    }
+    return elements;
+}
+
+int TestReset() {
+    int failures = 0;
+    MMDB_data_pool_s* pool = data_pool_new(64);
+    // 第一轮跨过多个块；重置后同样多的元素应复用同样的内存
+    std::vector<MMDB_entry_data_list_s*> first = Fill(pool, 1000, &failures);
+    size_t blocks = pool->index;
+    data_pool_reset(pool);
+    std::vector<MMDB_entry_data_list_s*> again = Fill(pool, 1000, &failures);
+    if (first != again || pool->index != blocks) {
+        fprintf(stderr, "重置后没有按原来的顺序复用内存\n");
+        failures++;
+    }
+    // 更少、更多的元素
+    data_pool_reset(pool);
+    std::vector<MMDB_entry_data_list_s*> fewer = Fill(pool, 100, &failures);
+    if (!std::equal(fewer.begin(), fewer.end(), first.begin())) {
+        fprintf(stderr, "重置后分配更少的元素时没有复用内存\n");
+        failures++;
+    }
+    data_pool_reset(pool);
+    std::vector<MMDB_entry_data_list_s*> more = Fill(pool, 5000, &failures);
+    if (!std::equal(first.begin(), first.end(), more.begin())) {
+        fprintf(stderr, "重置后分配更多的元素时没有先复用已有的内存\n");
+        failures++;
+    }
+    // 空的pool不构成链表
+    data_pool_reset(pool);
+    if (data_pool_to_list(pool) != nullptr) {
+        fprintf(stderr, "重置后的空pool构成了链表\n");
+        failures++;
+    }
+    data_pool_destroy(pool);
+    return failures;
+}
+
+// 逐个元素比较两个链表
+bool SameList(const MMDB_entry_data_list_s* a, const MMDB_entry_data_list_s* b) {
+    for (; a && b; a = a->next, b = b->next) {
+        if (memcmp(&a->entry_data, &b->entry_data, sizeof(a->entry_data)) != 0) {
+            return false;
+        }
+    }
+    return !a && !b;
+}
+
+double NanosecondsPerItem(std::chrono::steady_clock::time_point start, size_t items) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+               .count() / items;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <mmdb_path> [cases]\n", argv[0]);
+        return 1;
+    }
+    int cases = argc > 2 ? atoi(argv[2]) : 200000;
+    int failures = TestReset();
+
+    MMDB_s mmdb;
+    if (MMDB_open(argv[1], MMDB_MODE_MMAP, &mmdb) != MMDB_SUCCESS) {
+        fprintf(stderr, "无法打开 %s\n", argv[1]);
+        return 1;
+    }
+    std::mt19937 rng(20240618);
+    std::vector<MMDB_entry_s> entries;
+    for (int i = 0; i < cases; ++i) {
+        uint8_t address[16] = {};
+        uint32_t value = rng();
+        memcpy(address + 12, &value, 4);
+        int mmdb_error = 0;
+        MMDB_lookup_result_s result = MMDB_lookup_address(&mmdb, address, AF_INET, &mmdb_error);
+        if (mmdb_error == MMDB_SUCCESS && result.found_entry) {
+            entries.push_back(result.entry);
+        }
+    }
+    if (entries.empty()) {
+        fprintf(stderr, "没有查到任何数据记录\n");
+        return 1;
+    }
+
+    MMDB_data_pool_s* pool = MMDB_data_pool_create();
+    for (auto& entry : entries) {
+        MMDB_entry_data_list_s* expected = nullptr;
+        MMDB_entry_data_list_s* actual = nullptr;
+        if (MMDB_get_entry_data_list(&entry, &expected) != MMDB_SUCCESS ||
+            MMDB_get_entry_data_list_with_pool(&entry, pool, &actual) != MMDB_SUCCESS ||
+            !SameList(expected, actual)) {
+            if (++failures <= 10) {
+                fprintf(stderr, "链表不同，数据记录偏移 %u\n", entry.offset);
+            }
+        }
+        MMDB_free_entry_data_list(expected);
+        // pool由调用方持有，这里什么也不做
+        MMDB_free_entry_data_list(actual);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    size_t sink = 0;
+    for (auto& entry : entries) {
+        MMDB_entry_data_list_s* list = nullptr;
+        MMDB_get_entry_data_list(&entry, &list);
+        sink += list != nullptr;
+        MMDB_free_entry_data_list(list);
+    }
+    double fresh_ns = NanosecondsPerItem(start, entries.size());
+    start = std::chrono::steady_clock::now();
+    for (auto& entry : entries) {
+        MMDB_entry_data_list_s* list = nullptr;
+        MMDB_get_entry_data_list_with_pool(&entry, pool, &list);
+        sink += list != nullptr;
+    }
+    double pooled_ns = NanosecondsPerItem(start, entries.size());
+    printf("%zu条数据记录，解码完整记录耗时: 每次新建pool %.0f ns，复用pool %.0f ns (%d)\n",
+           entries.size(), fresh_ns, pooled_ns, static_cast<int>(sink & 1));
+
+    MMDB_data_pool_free(pool);
+    MMDB_close(&mmdb);
+    if (failures > 0) {
+        fprintf(stderr, "data pool测试失败: %d 项\n", failures);
+        return 1;
+    }
+    printf("data pool测试通过\n");
+    return 0;
+}
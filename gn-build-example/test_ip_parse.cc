@@ -0,0 +1,243 @@
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "maxminddb.h"
+
+// 比较MMDB_parse_address与getaddrinfo(AI_NUMERICHOST)对随机变异输入的解析结果，
+// 给出数据库路径时再比较MMDB_lookup_string_n与基于getaddrinfo的查询结果
+// 用法: test_ip_parse [mmdb_path] [cases]
+
+namespace {
+
+struct Parsed {
+    int error = 0;
+    int family = 0;
+    uint8_t address[16] = {};
+};
+
+// 原来的解析路径
+Parsed ParseWithGetaddrinfo(const std::string& text) {
+    Parsed parsed;
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_flags = AI_NUMERICHOST;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* addresses = nullptr;
+    parsed.error = getaddrinfo(text.c_str(), nullptr, &hints, &addresses);
+    if (parsed.error == 0) {
+        parsed.family = addresses->ai_addr->sa_family;
+        if (parsed.family == AF_INET6) {
+            memcpy(parsed.address,
+                   reinterpret_cast<sockaddr_in6*>(addresses->ai_addr)->sin6_addr.s6_addr, 16);
+        } else {
+            memcpy(parsed.address + 12,
+                   &reinterpret_cast<sockaddr_in*>(addresses->ai_addr)->sin_addr.s_addr, 4);
+        }
+    }
+    if (addresses) {
+        freeaddrinfo(addresses);
+    }
+    return parsed;
+}
+
+Parsed ParseFast(const std::string& text) {
+    Parsed parsed;
+    parsed.error = MMDB_parse_address(text.data(), text.size(), parsed.address, &parsed.family);
+    return parsed;
+}
+
+bool SameParse(const Parsed& a, const Parsed& b) {
+    if ((a.error == 0) != (b.error == 0)) {
+        return false;
+    }
+    if (a.error != 0) {
+        return a.error == b.error;
+    }
+    return a.family == b.family && memcmp(a.address, b.address, 16) == 0;
+}
+
+std::string RandomIpv4(std::mt19937& rng) {
+    char text[INET_ADDRSTRLEN];
+    uint32_t value = rng();
+    // 偏向小数值，覆盖0和单个数字的字节
+    if (rng() % 4 == 0) {
+        value &= 0x0f0f0f0f;
+    }
+    inet_ntop(AF_INET, &value, text, sizeof(text));
+    return text;
+}
+
+std::string RandomIpv6(std::mt19937& rng) {
+    uint8_t bytes[16];
+    for (auto& byte : bytes) {
+        byte = static_cast<uint8_t>(rng());
+    }
+    // 制造连续的零组，让inet_ntop输出"::"
+    int zero_start = rng() % 8;
+    int zero_count = rng() % 6;
+    for (int i = zero_start; i < zero_start + zero_count && i < 8; ++i) {
+        bytes[i * 2] = bytes[i * 2 + 1] = 0;
+    }
+    if (rng() % 8 == 0) {
+        memset(bytes, 0, 10);
+        bytes[10] = bytes[11] = 0xff;  // IPv4映射地址，输出带点分十进制
+    }
+    char text[INET6_ADDRSTRLEN];
+    inet_ntop(AF_INET6, bytes, text, sizeof(text));
+    std::string result = text;
+    if (rng() % 4 == 0) {
+        for (auto& c : result) {
+            if (c >= 'a' && c <= 'f') c = static_cast<char>(c - 'a' + 'A');
+        }
+    }
+    return result;
+}
+
+std::string Mutate(std::string text, std::mt19937& rng) {
+    static const char kAlphabet[] = "0123456789abcdefABCDEFxX:.%/ -\t";
+    int mutations = 1 + rng() % 3;
+    for (int i = 0; i < mutations; ++i) {
+        size_t pos = text.empty() ? 0 : rng() % (text.size() + 1);
+        char c = kAlphabet[rng() % (sizeof(kAlphabet) - 1)];
+        switch (rng() % 6) {
+            case 0:
+                text.insert(pos, 1, c);
+                break;
+            case 1:
+                if (pos < text.size()) text.erase(pos, 1);
+                break;
+            case 2:
+                if (pos < text.size()) text[pos] = c;
+                break;
+            case 3:
+                text = text.substr(0, pos);
+                break;
+            case 4:
+                // 重复一段，制造多余的组或多个"::"
+                if (!text.empty()) text.insert(pos, text.substr(rng() % text.size(), 1 + rng() % 5));
+                break;
+            default:
+                text.insert(pos, 1, '0');  // 前导零
+                break;
+        }
+    }
+    return text;
+}
+
+std::vector<std::string> BuildCorpus(int cases) {
+    std::vector<std::string> corpus = {
+        "", "0.0.0.0", "255.255.255.255", "256.0.0.1", "1.2.3", "1", "1.2", "0x7f.1",
+        "010.0.0.1", "01.2.3.4", "1.2.3.4.", ".1.2.3.4", "1..2.3", "1.2.3.4 ", " 1.2.3.4",
+        "::", "::1", "1::", ":::", "1:::2", "::ffff:1.2.3.4", "::1.2.3.4", "::ffff:1.2.3",
+        "::ffff:01.2.3.4", "1:2:3:4:5:6:7:8", "1:2:3:4:5:6:7:8:9", "1:2:3:4:5:6:7::",
+        "::2:3:4:5:6:7:8", "1:2:3:4:5:6:7::8", "12345::", "fe80::1%lo", "FFFF::abcd",
+        "1:2:3:4:5:6:1.2.3.4", "1:2:3:4:5:6:7:1.2.3.4", ":1::", "1:", "1.2.3.4:80",
+    };
+    std::mt19937 rng(20240611);
+    while (static_cast<int>(corpus.size()) < cases) {
+        std::string seed = rng() % 2 ? RandomIpv4(rng) : RandomIpv6(rng);
+        corpus.push_back(rng() % 3 == 0 ? seed : Mutate(seed, rng));
+    }
+    return corpus;
+}
+
+double NanosecondsPerItem(std::chrono::steady_clock::time_point start, size_t items) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+               .count() / items;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const char* db_path = argc > 1 ? argv[1] : nullptr;
+    int cases = argc > 2 ? atoi(argv[2]) : 200000;
+    std::vector<std::string> corpus = BuildCorpus(cases);
+
+    int failures = 0;
+    int valid = 0;
+    for (const auto& text : corpus) {
+        Parsed expected = ParseWithGetaddrinfo(text);
+        Parsed actual = ParseFast(text);
+        if (expected.error == 0) valid++;
+        if (!SameParse(expected, actual)) {
+            if (++failures <= 10) {
+                fprintf(stderr, "解析结果不同: \"%s\" getaddrinfo=%d fast=%d\n", text.c_str(),
+                        expected.error, actual.error);
+            }
+        }
+    }
+
+    // 不以\0结尾的输入只解析给定长度
+    uint8_t address[16];
+    int family = 0;
+    if (MMDB_parse_address("1.2.3.4567", 7, address, &family) != 0 || family != AF_INET ||
+        address[12] != 1 || address[15] != 4) {
+        fprintf(stderr, "按长度解析失败\n");
+        failures++;
+    }
+    if (MMDB_parse_address("1.2.3.4\0x", 9, address, &family) == 0) {
+        fprintf(stderr, "内嵌\\0应当无效\n");
+        failures++;
+    }
+
+    if (db_path) {
+        MMDB_s mmdb;
+        if (MMDB_open(db_path, MMDB_MODE_MMAP, &mmdb) != MMDB_SUCCESS) {
+            fprintf(stderr, "无法打开 %s\n", db_path);
+            return 1;
+        }
+        for (const auto& text : corpus) {
+            Parsed parsed = ParseWithGetaddrinfo(text);
+            int gai_error = 0;
+            int mmdb_error = 0;
+            MMDB_lookup_result_s actual = MMDB_lookup_string_n(&mmdb, text.data(), text.size(),
+                                                               &gai_error, &mmdb_error);
+            if (parsed.error != 0) {
+                if (gai_error != parsed.error) failures++;
+                continue;
+            }
+            int expected_error = 0;
+            MMDB_lookup_result_s expected =
+                MMDB_lookup_address(&mmdb, parsed.address, parsed.family, &expected_error);
+            if (gai_error != 0 || mmdb_error != expected_error ||
+                actual.found_entry != expected.found_entry ||
+                actual.netmask != expected.netmask ||
+                actual.entry.offset != expected.entry.offset) {
+                if (++failures <= 10) {
+                    fprintf(stderr, "查询结果不同: \"%s\"\n", text.c_str());
+                }
+            }
+        }
+        MMDB_close(&mmdb);
+    }
+
+    // 规范格式输入的解析耗时
+    std::vector<std::string> canonical;
+    std::mt19937 rng(7);
+    for (int i = 0; i < 100000; ++i) {
+        canonical.push_back(i % 2 ? RandomIpv4(rng) : RandomIpv6(rng));
+    }
+    auto start = std::chrono::steady_clock::now();
+    int sink = 0;
+    for (const auto& text : canonical) sink += ParseWithGetaddrinfo(text).family;
+    double gai_ns = NanosecondsPerItem(start, canonical.size());
+    start = std::chrono::steady_clock::now();
+    for (const auto& text : canonical) sink += ParseFast(text).family;
+    double fast_ns = NanosecondsPerItem(start, canonical.size());
+
+    printf("%zu个输入（%d个有效），解析耗时: getaddrinfo %.0f ns，直接解析 %.0f ns (%d)\n",
+           corpus.size(), valid, gai_ns, fast_ns, sink & 1);
+    if (failures > 0) {
+        fprintf(stderr, "IP解析测试失败: %d 项\n", failures);
+        return 1;
+    }
+    printf("IP解析测试通过\n");
+    return 0;
+}
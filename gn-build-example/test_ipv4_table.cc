@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "ipv4_table.h"
+#include "maxminddb.h"
+
+// 从数据库建IPv4直接索引表，输出建表耗时和内存占用，对照搜索树检查每个网段，
+// 再比较随机地址的查询结果和耗时
+// 用法: test_ipv4_table <mmdb_path> [cases]
+
+namespace {
+
+bool LookupWithTree(const MMDB_s* mmdb, uint32_t ip, char country[3]) {
+    uint8_t address[16] = {};
+    address[12] = static_cast<uint8_t>(ip >> 24);
+    address[13] = static_cast<uint8_t>(ip >> 16);
+    address[14] = static_cast<uint8_t>(ip >> 8);
+    address[15] = static_cast<uint8_t>(ip);
+    country[0] = '\0';
+    int mmdb_error = 0;
+    MMDB_lookup_result_s result = MMDB_lookup_address(mmdb, address, AF_INET, &mmdb_error);
+    if (mmdb_error || !result.found_entry) {
+        return false;
+    }
+    MMDB_entry_data_s entry_data;
+    int ret = MMDB_get_value(&result.entry, &entry_data, "country", "iso_code", NULL);
+    if (ret != MMDB_SUCCESS || !entry_data.has_data ||
+        entry_data.type != MMDB_DATA_TYPE_UTF8_STRING || entry_data.data_size != 2) {
+        return false;
+    }
+    memcpy(country, entry_data.utf8_string, 2);
+    country[2] = '\0';
+    return true;
+}
+
+double NanosecondsPerItem(std::chrono::steady_clock::time_point start, size_t items) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+               .count() / items;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <mmdb_path> [cases]\n", argv[0]);
+        return 1;
+    }
+    int cases = argc > 2 ? atoi(argv[2]) : 1000000;
+    MMDB_s mmdb;
+    if (MMDB_open(argv[1], MMDB_MODE_MMAP, &mmdb) != MMDB_SUCCESS) {
+        fprintf(stderr, "无法打开 %s\n", argv[1]);
+        return 1;
+    }
+    std::unique_ptr<Ipv4CountryTable> table = Ipv4CountryTable::Build(&mmdb);
+    if (!table) {
+        MMDB_close(&mmdb);
+        return 1;
+    }
+    const Ipv4CountryTable::Stats& stats = table->GetStats();
+    printf("建表耗时 %.1f ms，%zu个网段，%zu个国家代码，%zu个第二级块，占用 %.1f MB\n",
+           stats.build_ms, stats.networks, stats.countries, stats.blocks,
+           stats.bytes / (1024.0 * 1024.0));
+
+    size_t failures = table->Verify(&mmdb);
+
+    std::mt19937 rng(20240612);
+    std::vector<uint32_t> addresses(cases);
+    for (auto& ip : addresses) {
+        ip = rng();
+    }
+    for (uint32_t ip : addresses) {
+        char expected[3];
+        char actual[3];
+        bool expected_found = LookupWithTree(&mmdb, ip, expected);
+        bool actual_found = table->Lookup(ip, actual);
+        if (expected_found != actual_found || strcmp(expected, actual) != 0) {
+            if (++failures <= 10) {
+                fprintf(stderr, "查询结果不同: %u\n", ip);
+            }
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int sink = 0;
+    char country[3];
+    for (uint32_t ip : addresses) sink += LookupWithTree(&mmdb, ip, country);
+    double tree_ns = NanosecondsPerItem(start, addresses.size());
+    start = std::chrono::steady_clock::now();
+    for (uint32_t ip : addresses) sink += table->Lookup(ip, country);
+    double table_ns = NanosecondsPerItem(start, addresses.size());
+    printf("随机地址查询耗时: 搜索树 %.0f ns，直接索引表 %.1f ns (%d)\n", tree_ns, table_ns,
+           sink & 1);
+
+    MMDB_close(&mmdb);
+    if (failures > 0) {
+        fprintf(stderr, "IPv4直接索引表测试失败: %zu 项\n", failures);
+        return 1;
+    }
+    printf("IPv4直接索引表测试通过\n");
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ip_checker.h"
+#include "maxminddb.h"
+
+// 比较MMDB_lookup_addresses与逐个MMDB_lookup_address的结果，
+// 以及IpChecker::LookupCountries与逐个LookupCountry的结果，并比较两者的耗时
+// 用法: test_lookup_batch <mmdb_path> [cases]
+
+namespace {
+
+std::vector<std::string> RandomAddresses(int cases) {
+    std::mt19937 rng(20240613);
+    std::vector<std::string> ips;
+    ips.reserve(cases);
+    for (int i = 0; i < cases; ++i) {
+        char text[INET6_ADDRSTRLEN];
+        if (rng() % 8 == 0) {
+            uint8_t bytes[16];
+            for (auto& byte : bytes) {
+                byte = static_cast<uint8_t>(rng());
+            }
+            inet_ntop(AF_INET6, bytes, text, sizeof(text));
+        } else {
+            uint32_t value = rng();
+            inet_ntop(AF_INET, &value, text, sizeof(text));
+        }
+        ips.push_back(i % 1000 == 0 ? "not an ip" : text);
+    }
+    return ips;
+}
+
+double NanosecondsPerItem(std::chrono::steady_clock::time_point start, size_t items) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+               .count() / items;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <mmdb_path> [cases]\n", argv[0]);
+        return 1;
+    }
+    const char* db_path = argv[1];
+    int cases = argc > 2 ? atoi(argv[2]) : 1000000;
+    std::vector<std::string> ips = RandomAddresses(cases);
+    int failures = 0;
+
+    MMDB_s mmdb;
+    if (MMDB_open(db_path, MMDB_MODE_MMAP, &mmdb) != MMDB_SUCCESS) {
+        fprintf(stderr, "无法打开 %s\n", db_path);
+        return 1;
+    }
+    std::vector<uint8_t> addresses;
+    std::vector<int> families;
+    for (const auto& ip : ips) {
+        uint8_t address[16];
+        int family = 0;
+        if (MMDB_parse_address(ip.data(), ip.size(), address, &family) == 0) {
+            addresses.insert(addresses.end(), address, address + 16);
+            families.push_back(family);
+        }
+    }
+    size_t count = families.size();
+    std::vector<MMDB_lookup_result_s> expected(count);
+    std::vector<int> expected_errors(count);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        expected[i] =
+            MMDB_lookup_address(&mmdb, &addresses[i * 16], families[i], &expected_errors[i]);
+    }
+    double single_ns = NanosecondsPerItem(start, count);
+
+    std::vector<MMDB_lookup_result_s> actual(count);
+    std::vector<int> actual_errors(count);
+    start = std::chrono::steady_clock::now();
+    MMDB_lookup_addresses(&mmdb, addresses.data(), families.data(), count, actual.data(),
+                          actual_errors.data());
+    double batch_ns = NanosecondsPerItem(start, count);
+
+    for (size_t i = 0; i < count; ++i) {
+        if (actual_errors[i] != expected_errors[i] ||
+            actual[i].found_entry != expected[i].found_entry ||
+            actual[i].netmask != expected[i].netmask ||
+            actual[i].entry.offset != expected[i].entry.offset ||
+            actual[i].entry.mmdb != expected[i].entry.mmdb) {
+            if (++failures <= 10) {
+                fprintf(stderr, "搜索树查询结果不同: 第%zu个地址\n", i);
+            }
+        }
+    }
+    printf("搜索树查询耗时: 逐个 %.0f ns，批量 %.0f ns\n", single_ns, batch_ns);
+    MMDB_close(&mmdb);
+
+    // 不启用缓存，比较完整的查询（解析、遍历、解码）
+    IpChecker::Options options;
+    options.cache_entries = 0;
+    IpChecker checker;
+    if (!checker.Open(db_path, options)) {
+        return 1;
+    }
+    std::vector<std::string_view> views(ips.begin(), ips.end());
+    std::vector<IpChecker::CountryResult> results(views.size());
+    start = std::chrono::steady_clock::now();
+    checker.LookupCountries(views.data(), views.size(), results.data());
+    double countries_batch_ns = NanosecondsPerItem(start, views.size());
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < views.size(); ++i) {
+        char country[3];
+        bool found = checker.LookupCountry(views[i], country);
+        if (found != results[i].found || strcmp(country, results[i].country) != 0) {
+            if (++failures <= 10) {
+                fprintf(stderr, "国家代码不同: %s\n", ips[i].c_str());
+            }
+        }
+    }
+    double countries_single_ns = NanosecondsPerItem(start, views.size());
+    printf("国家代码查询耗时: 逐个 %.0f ns，批量 %.0f ns\n", countries_single_ns,
+           countries_batch_ns);
+
+    // 启用缓存时批量结果也应相同
+    IpChecker cached;
+    if (!cached.Open(db_path)) {
+        return 1;
+    }
+    cached.LookupCountries(views.data(), views.size(), results.data());
+    for (size_t i = 0; i < views.size(); ++i) {
+        char country[3];
+        bool found = checker.LookupCountry(views[i], country);
+        if (found != results[i].found || strcmp(country, results[i].country) != 0) {
+            if (++failures <= 10) {
+                fprintf(stderr, "启用缓存时国家代码不同: %s\n", ips[i].c_str());
+            }
+        }
+    }
+
+    if (failures > 0) {
+        fprintf(stderr, "批量查询测试失败: %d 项\n", failures);
+        return 1;
+    }
+    printf("批量查询测试通过\n");
+    return 0;
+}
@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "maxminddb.h"
+
+// 对随机地址查到的数据记录，比较MMDB_project与逐个路径调用MMDB_aget_value的结果，
+// 再比较取四个字段时两者的耗时
+// 用法: test_projection <mmdb_path> [cases]
+
+namespace {
+
+const char* const kCountryIsoCode[] = {"country", "iso_code", NULL};
+const char* const kRegisteredCountry[] = {"registered_country", "iso_code", NULL};
+const char* const kContinentCode[] = {"continent", "code", NULL};
+const char* const kAsn[] = {"autonomous_system_number", NULL};
+const char* const kCountryName[] = {"country", "names", "en", NULL};
+const char* const kFirstSubdivision[] = {"subdivisions", "0", "iso_code", NULL};
+const char* const kLastSubdivision[] = {"subdivisions", "-1", "iso_code", NULL};
+const char* const kSecondSubdivision[] = {"subdivisions", "1", "iso_code", NULL};
+const char* const kMissingSubdivision[] = {"subdivisions", "5", "iso_code", NULL};
+const char* const kNotAnIndex[] = {"subdivisions", "x", NULL};
+const char* const kCountry[] = {"country", NULL};
+const char* const kContinent[] = {"continent", NULL};
+const char* const kThroughString[] = {"country", "iso_code", "x", NULL};
+const char* const kRecord[] = {NULL};
+
+const char* const* const kPaths[] = {
+    kCountryIsoCode, kRegisteredCountry, kContinentCode, kAsn, kCountryName,
+    kFirstSubdivision, kLastSubdivision, kSecondSubdivision, kMissingSubdivision,
+    kNotAnIndex, kCountry, kContinent, kThroughString, kRecord, kCountryIsoCode,
+};
+constexpr size_t kPathCount = sizeof(kPaths) / sizeof(kPaths[0]);
+
+// 分类常用的四个字段
+const char* const* const kClassifyPaths[] = {kCountryIsoCode, kRegisteredCountry, kContinentCode,
+                                             kAsn};
+
+bool SameEntryData(const MMDB_entry_data_s& a, const MMDB_entry_data_s& b) {
+    if (a.has_data != b.has_data) {
+        return false;
+    }
+    if (!a.has_data) {
+        return true;
+    }
+    if (a.type != b.type || a.offset != b.offset || a.offset_to_next != b.offset_to_next) {
+        return false;
+    }
+    // decode_one只为字符串、字节串、map和数组设置data_size，其他类型保留上一次解码的值
+    switch (a.type) {
+        case MMDB_DATA_TYPE_UTF8_STRING:
+            return a.data_size == b.data_size &&
+                   memcmp(a.utf8_string, b.utf8_string, a.data_size) == 0;
+        case MMDB_DATA_TYPE_BYTES:
+        case MMDB_DATA_TYPE_MAP:
+        case MMDB_DATA_TYPE_ARRAY:
+            return a.data_size == b.data_size;
+        case MMDB_DATA_TYPE_UINT32:
+            return a.uint32 == b.uint32;
+        default:
+            return true;
+    }
+}
+
+double NanosecondsPerItem(std::chrono::steady_clock::time_point start, size_t items) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+               .count() / items;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <mmdb_path> [cases]\n", argv[0]);
+        return 1;
+    }
+    int cases = argc > 2 ? atoi(argv[2]) : 200000;
+    MMDB_s mmdb;
+    if (MMDB_open(argv[1], MMDB_MODE_MMAP, &mmdb) != MMDB_SUCCESS) {
+        fprintf(stderr, "无法打开 %s\n", argv[1]);
+        return 1;
+    }
+    MMDB_projection_s* projection = nullptr;
+    MMDB_projection_s* classify = nullptr;
+    if (MMDB_projection_create(kPaths, kPathCount, &projection) != MMDB_SUCCESS ||
+        MMDB_projection_create(kClassifyPaths, 4, &classify) != MMDB_SUCCESS) {
+        fprintf(stderr, "无法编译取值路径\n");
+        return 1;
+    }
+
+    std::mt19937 rng(20240614);
+    std::vector<MMDB_entry_s> entries;
+    for (int i = 0; i < cases; ++i) {
+        uint8_t address[16] = {};
+        uint32_t value = rng();
+        memcpy(address + 12, &value, 4);
+        int mmdb_error = 0;
+        MMDB_lookup_result_s result = MMDB_lookup_address(&mmdb, address, AF_INET, &mmdb_error);
+        if (mmdb_error == MMDB_SUCCESS && result.found_entry) {
+            entries.push_back(result.entry);
+        }
+    }
+    if (entries.empty()) {
+        fprintf(stderr, "没有查到任何数据记录\n");
+        return 1;
+    }
+
+    int failures = 0;
+    for (auto& entry : entries) {
+        MMDB_entry_data_s results[kPathCount];
+        if (MMDB_project(&entry, projection, results) != MMDB_SUCCESS) {
+            failures++;
+            continue;
+        }
+        for (size_t i = 0; i < kPathCount; ++i) {
+            MMDB_entry_data_s expected;
+            MMDB_aget_value(&entry, &expected, kPaths[i]);
+            if (!SameEntryData(expected, results[i])) {
+                if (++failures <= 10) {
+                    fprintf(stderr, "第%zu条路径结果不同，数据记录偏移 %u\n", i, entry.offset);
+                }
+            }
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t sink = 0;
+    for (auto& entry : entries) {
+        for (auto path : kClassifyPaths) {
+            MMDB_entry_data_s entry_data;
+            MMDB_aget_value(&entry, &entry_data, path);
+            sink += entry_data.has_data;
+        }
+    }
+    double aget_ns = NanosecondsPerItem(start, entries.size());
+    start = std::chrono::steady_clock::now();
+    for (auto& entry : entries) {
+        MMDB_entry_data_s entry_data[4];
+        MMDB_project(&entry, classify, entry_data);
+        sink += entry_data[0].has_data + entry_data[3].has_data;
+    }
+    double project_ns = NanosecondsPerItem(start, entries.size());
+    printf("%zu条数据记录，取四个字段耗时: 逐个路径 %.0f ns，一次遍历 %.0f ns (%d)\n",
+           entries.size(), aget_ns, project_ns, static_cast<int>(sink & 1));
+
+    MMDB_projection_free(projection);
+    MMDB_projection_free(classify);
+    MMDB_close(&mmdb);
+    if (failures > 0) {
+        fprintf(stderr, "取值路径测试失败: %d 项\n", failures);
+        return 1;
+    }
+    printf("取值路径测试通过\n");
+    return 0;
+}
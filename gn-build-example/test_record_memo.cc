@@ -0,0 +1,146 @@
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ip_checker.h"
+
+// 比较按数据记录偏移缓存解码结果与每次都解码的查询结果，并给出耗时和缓存占用；
+// 给出第二个数据库时，再检查同一个IpChecker重新Open()后不会用到旧数据库的缓存
+// 用法: test_record_memo <mmdb_path> [other_mmdb_path] [cases]
+
+namespace {
+
+std::vector<std::string> RandomAddresses(int cases) {
+    std::mt19937 rng(20240615);
+    std::vector<std::string> ips;
+    ips.reserve(cases);
+    for (int i = 0; i < cases; ++i) {
+        char text[INET_ADDRSTRLEN];
+        uint32_t value = rng();
+        inet_ntop(AF_INET, &value, text, sizeof(text));
+        ips.push_back(text);
+    }
+    return ips;
+}
+
+bool SameClassification(const IpChecker::Classification& a, const IpChecker::Classification& b) {
+    return strcmp(a.country, b.country) == 0 &&
+           strcmp(a.registered_country, b.registered_country) == 0 &&
+           strcmp(a.continent, b.continent) == 0 && a.asn == b.asn;
+}
+
+// 比较两个IpChecker对同一组地址的查询结果，返回不一致的地址数
+int Compare(const IpChecker& expected, const IpChecker& actual,
+            const std::vector<std::string>& ips) {
+    int failures = 0;
+    for (const auto& ip : ips) {
+        char expected_country[3];
+        char actual_country[3];
+        IpChecker::Classification expected_classification;
+        IpChecker::Classification actual_classification;
+        bool same = expected.LookupCountry(ip, expected_country) ==
+                        actual.LookupCountry(ip, actual_country) &&
+                    strcmp(expected_country, actual_country) == 0 &&
+                    expected.Classify(ip, &expected_classification) ==
+                        actual.Classify(ip, &actual_classification) &&
+                    SameClassification(expected_classification, actual_classification);
+        if (!same && ++failures <= 10) {
+            fprintf(stderr, "查询结果不同: %s\n", ip.c_str());
+        }
+    }
+    return failures;
+}
+
+double NanosecondsPerItem(std::chrono::steady_clock::time_point start, size_t items) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+               .count() / items;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <mmdb_path> [other_mmdb_path] [cases]\n", argv[0]);
+        return 1;
+    }
+    const char* db_path = argv[1];
+    const char* other_db_path = argc > 2 ? argv[2] : nullptr;
+    int cases = argc > 3 ? atoi(argv[3]) : 500000;
+    std::vector<std::string> ips = RandomAddresses(cases);
+
+    // 都不启用网段缓存，每次查询都要遍历搜索树并取数据记录
+    IpChecker::Options plain_options;
+    plain_options.cache_entries = 0;
+    plain_options.record_memo_entries = 0;
+    IpChecker::Options memo_options;
+    memo_options.cache_entries = 0;
+    IpChecker plain;
+    IpChecker memo;
+    if (!plain.Open(db_path, plain_options) || !memo.Open(db_path, memo_options)) {
+        return 1;
+    }
+
+    // 多个线程同时填充和读取缓存
+    std::vector<std::thread> threads;
+    std::vector<int> thread_failures(4);
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] { thread_failures[t] = Compare(plain, memo, ips); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    int failures = 0;
+    for (int count : thread_failures) {
+        failures += count;
+    }
+
+    // 只对查到数据记录的地址计时，差别都在取数据记录上
+    std::vector<std::string> found;
+    IpChecker::Classification classification;
+    for (const auto& ip : ips) {
+        if (plain.Classify(ip, &classification)) found.push_back(ip);
+    }
+    if (found.empty()) {
+        fprintf(stderr, "没有查到任何数据记录\n");
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    int sink = 0;
+    for (const auto& ip : found) sink += plain.Classify(ip, &classification);
+    double plain_ns = NanosecondsPerItem(start, found.size());
+    start = std::chrono::steady_clock::now();
+    for (const auto& ip : found) sink += memo.Classify(ip, &classification);
+    double memo_ns = NanosecondsPerItem(start, found.size());
+    RecordMemo<IpChecker::Classification>::Stats stats = memo.GetRecordMemoStats();
+    printf("分类查询耗时: 每次解码 %.0f ns，缓存解码结果 %.0f ns (%d)\n", plain_ns, memo_ns,
+           sink & 1);
+    printf("解码结果缓存: %zu/%zu个槽位，占用 %.1f MB\n", stats.used, stats.capacity,
+           stats.bytes / (1024.0 * 1024.0));
+
+    if (other_db_path) {
+        // 同一个对象换数据库后，结果应与新打开的对象相同
+        IpChecker fresh;
+        if (!memo.Open(other_db_path, memo_options) || !fresh.Open(other_db_path, plain_options)) {
+            return 1;
+        }
+        if (memo.GetRecordMemoStats().used != 0) {
+            fprintf(stderr, "重新打开后解码结果缓存未清空\n");
+            failures++;
+        }
+        failures += Compare(fresh, memo, ips);
+    }
+
+    if (failures > 0) {
+        fprintf(stderr, "解码结果缓存测试失败: %d 项\n", failures);
+        return 1;
+    }
+    printf("解码结果缓存测试通过\n");
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "reloadable_ip_checker.h"
+
+// 多个线程不停查询的同时，在两个数据库之间反复Reload()：每个Snapshot内的查询结果
+// 必须都来自同一个数据库，打不开的文件不能替换当前数据库；给出每次Reload()的耗时
+// 和查询线程在此期间的最长单次查询耗时
+// 两个数据库的database_type须相同
+// 用法: test_reload <mmdb_path> <other_mmdb_path> [reloads]
+
+namespace {
+
+constexpr int kReaders = 3;
+constexpr size_t kSnapshotLookups = 8;
+
+std::vector<std::string> RandomAddresses(int cases) {
+    std::mt19937 rng(20240616);
+    std::vector<std::string> ips;
+    ips.reserve(cases);
+    for (int i = 0; i < cases; ++i) {
+        char text[INET_ADDRSTRLEN];
+        uint32_t value = rng();
+        inet_ntop(AF_INET, &value, text, sizeof(text));
+        ips.push_back(text);
+    }
+    return ips;
+}
+
+// 预先算好每个地址在两个数据库中的结果，空字符串表示查不到
+struct Expected {
+    char first[3];
+    char second[3];
+};
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        printf("Usage: %s <mmdb_path> <other_mmdb_path> [reloads]\n", argv[0]);
+        return 1;
+    }
+    const char* paths[2] = {argv[1], argv[2]};
+    int reloads = argc > 3 ? atoi(argv[3]) : 40;
+    std::vector<std::string> ips = RandomAddresses(20000);
+
+    std::vector<Expected> expected(ips.size());
+    for (int db = 0; db < 2; ++db) {
+        IpChecker reference;
+        if (!reference.Open(paths[db])) {
+            return 1;
+        }
+        for (size_t i = 0; i < ips.size(); ++i) {
+            reference.LookupCountry(ips[i], db == 0 ? expected[i].first : expected[i].second);
+        }
+    }
+
+    ReloadableIpChecker checker;
+    char country[3];
+    if (checker.LookupCountry(ips[0], country) || checker.Acquire()) {
+        fprintf(stderr, "未加载数据库时查到了结果\n");
+        return 1;
+    }
+    if (!checker.Reload(paths[0])) {
+        return 1;
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> failures{0};
+    std::vector<uint64_t> lookups(kReaders);
+    std::vector<double> slowest_us(kReaders);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < kReaders; ++t) {
+        readers.emplace_back([&, t] {
+            size_t next = t * 997;
+            while (!stop.load(std::memory_order_relaxed)) {
+                auto start = std::chrono::steady_clock::now();
+                ReloadableIpChecker::Snapshot snapshot = checker.Acquire();
+                // 同一个Snapshot内的结果要么都与第一个数据库相同，要么都与第二个相同
+                bool first = true;
+                bool second = true;
+                for (size_t k = 0; k < kSnapshotLookups; ++k, ++next) {
+                    size_t i = next % ips.size();
+                    char result[3];
+                    snapshot->LookupCountry(ips[i], result);
+                    first = first && strcmp(result, expected[i].first) == 0;
+                    second = second && strcmp(result, expected[i].second) == 0;
+                }
+                if (!first && !second && failures.fetch_add(1) < 10) {
+                    fprintf(stderr, "同一个Snapshot内的结果来自不同数据库\n");
+                }
+                double us = std::chrono::duration<double, std::micro>(
+                                std::chrono::steady_clock::now() - start).count();
+                slowest_us[t] = std::max(slowest_us[t], us);
+                lookups[t] += kSnapshotLookups;
+            }
+        });
+    }
+
+    double slowest_reload_ms = 0;
+    double total_reload_ms = 0;
+    for (int i = 1; i <= reloads; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        if (!checker.Reload(paths[i % 2])) {
+            failures++;
+        }
+        double ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start).count();
+        slowest_reload_ms = std::max(slowest_reload_ms, ms);
+        total_reload_ms += ms;
+        if (i % 10 == 0) {
+            // 打不开的文件不替换当前数据库
+            uint64_t generation = checker.generation();
+            if (checker.Reload("/nonexistent/GeoLite2-Country.mmdb") ||
+                checker.generation() != generation || !checker.Acquire()) {
+                fprintf(stderr, "打开失败后替换了当前数据库\n");
+                failures++;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    stop = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    if (checker.generation() != static_cast<uint64_t>(reloads) + 1) {
+        fprintf(stderr, "Reload()次数不符: %llu\n",
+                static_cast<unsigned long long>(checker.generation()));
+        failures++;
+    }
+    // 最后一次加载的是paths[reloads % 2]
+    const char* last = nullptr;
+    for (size_t i = 0; i < ips.size(); ++i) {
+        last = reloads % 2 == 0 ? expected[i].first : expected[i].second;
+        if (checker.LookupCountry(ips[i], country) != (last[0] != '\0') ||
+            strcmp(country, last) != 0) {
+            if (++failures <= 10) {
+                fprintf(stderr, "最后加载的数据库查询结果不同: %s\n", ips[i].c_str());
+            }
+        }
+    }
+
+    uint64_t total_lookups = 0;
+    double slowest = 0;
+    for (int t = 0; t < kReaders; ++t) {
+        total_lookups += lookups[t];
+        slowest = std::max(slowest, slowest_us[t]);
+    }
+    printf("%d次Reload()，平均 %.1f ms，最长 %.1f ms；期间查询 %llu 次，最长一组 %.0f us\n",
+           reloads, total_reload_ms / reloads, slowest_reload_ms,
+           static_cast<unsigned long long>(total_lookups), slowest);
+
+    if (failures > 0) {
+        fprintf(stderr, "热更新测试失败: %d 项\n", failures.load());
+        return 1;
+    }
+    printf("热更新测试通过\n");
+    return 0;
+}
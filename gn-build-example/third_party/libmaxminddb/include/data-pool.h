@@ -22,7 +22,8 @@
 // the order of the list.
 //
 // The memory only grows. There is no support for releasing an element you take
-// back to the pool.
+// back to the pool, but data_pool_reset() rewinds the whole pool so that its
+// blocks can be reused for a new list.
 typedef struct MMDB_data_pool_s {
     // Index of the current block we're allocating out of.
     size_t index;
@@ -42,11 +43,17 @@ typedef struct MMDB_data_pool_s {
     // An array of pointers to blocks of memory holding space for list
     // elements.
     MMDB_entry_data_list_s *blocks[DATA_POOL_NUM_BLOCKS];
+
+    // Set for pools created by MMDB_data_pool_create(). Lists built in such a
+    // pool belong to the caller's pool, so MMDB_free_entry_data_list() leaves
+    // them alone.
+    bool caller_owned;
 } MMDB_data_pool_s;
 
 bool can_multiply(size_t const, size_t const, size_t const);
 MMDB_data_pool_s *data_pool_new(size_t const);
 void data_pool_destroy(MMDB_data_pool_s *const);
+void data_pool_reset(MMDB_data_pool_s *const);
 MMDB_entry_data_list_s *data_pool_alloc(MMDB_data_pool_s *const);
 MMDB_entry_data_list_s *data_pool_to_list(MMDB_data_pool_s *const);
 
@@ -226,6 +226,40 @@ extern MMDB_lookup_result_s
 MMDB_lookup_sockaddr(const MMDB_s *const mmdb,
                      const struct sockaddr *const sockaddr,
                      int *const mmdb_error);
+/* Like MMDB_lookup_string, but takes a length instead of requiring a
+ * NUL-terminated string. Canonical IPv4 and IPv6 literals are parsed
+ * directly without getaddrinfo() or any allocation; anything else falls back
+ * to getaddrinfo() so the results are identical to MMDB_lookup_string. */
+extern MMDB_lookup_result_s
+MMDB_lookup_string_n(const MMDB_s *const mmdb,
+                     const char *const ipstr,
+                     size_t length,
+                     int *const gai_error,
+                     int *const mmdb_error);
+/* Parses an IP literal into a 16-byte address. IPv4 addresses are stored in
+ * the last four bytes with the first twelve zeroed and *family set to
+ * AF_INET. Returns 0 or a getaddrinfo() error code. */
+extern int MMDB_parse_address(const char *const ipstr,
+                              size_t length,
+                              uint8_t address[16],
+                              int *const family);
+/* Looks up an address produced by MMDB_parse_address. */
+extern MMDB_lookup_result_s MMDB_lookup_address(const MMDB_s *const mmdb,
+                                                const uint8_t address[16],
+                                                int family,
+                                                int *const mmdb_error);
+/* Looks up count addresses produced by MMDB_parse_address. addresses holds
+ * count consecutive 16-byte addresses and families[i] is the family of the
+ * i-th one. Several search tree walks are kept in flight and advanced one
+ * level at a time, prefetching each walk's next node, so their cache misses
+ * overlap. results[i] and mmdb_errors[i] are set exactly as
+ * MMDB_lookup_address would set them for the i-th address. */
+extern void MMDB_lookup_addresses(const MMDB_s *const mmdb,
+                                  const uint8_t *addresses,
+                                  const int *families,
+                                  size_t count,
+                                  MMDB_lookup_result_s *results,
+                                  int *mmdb_errors);
 extern int MMDB_read_node(const MMDB_s *const mmdb,
                           uint32_t node_number,
                           MMDB_search_node_s *const node);
@@ -238,6 +272,23 @@ extern int MMDB_vget_value(MMDB_entry_s *const start,
 extern int MMDB_aget_value(MMDB_entry_s *const start,
                            MMDB_entry_data_s *const entry_data,
                            const char *const *const path);
+/* A set of lookup paths compiled once with MMDB_projection_create and then
+ * extracted from records together with MMDB_project. */
+typedef struct MMDB_projection_s MMDB_projection_s;
+/* Compiles path_count paths. paths[i] is a NULL-terminated array of path
+ * elements, as passed to MMDB_aget_value; the strings are copied. */
+extern int MMDB_projection_create(const char *const *const *paths,
+                                  size_t path_count,
+                                  MMDB_projection_s **const projection);
+extern void MMDB_projection_free(MMDB_projection_s *const projection);
+/* Extracts every path of the projection from the record at start in a single
+ * traversal, stopping as soon as all of them have been found. results must
+ * hold one MMDB_entry_data_s per path; results[i] is what MMDB_aget_value
+ * gives for path i, with has_data false when the path is not in the record.
+ * Only corrupt data is reported as an error. */
+extern int MMDB_project(MMDB_entry_s *const start,
+                        const MMDB_projection_s *const projection,
+                        MMDB_entry_data_s *const results);
 extern int MMDB_get_metadata_as_entry_data_list(
     const MMDB_s *const mmdb, MMDB_entry_data_list_s **const entry_data_list);
 extern int
@@ -245,6 +296,20 @@ MMDB_get_entry_data_list(MMDB_entry_s *start,
                          MMDB_entry_data_list_s **const entry_data_list);
 extern void
 MMDB_free_entry_data_list(MMDB_entry_data_list_s *const entry_data_list);
+/* A caller-owned arena for MMDB_get_entry_data_list_with_pool. The pool keeps
+ * its memory between calls and only grows to fit the largest record decoded
+ * with it, so keeping one pool per thread makes steady-state full-record
+ * decoding allocation free. A pool must not be used by two threads at once. */
+struct MMDB_data_pool_s;
+extern struct MMDB_data_pool_s *MMDB_data_pool_create(void);
+extern void MMDB_data_pool_free(struct MMDB_data_pool_s *const pool);
+/* Like MMDB_get_entry_data_list, but builds the list in pool, which is reset
+ * first. The list stays valid until the pool is used again or freed;
+ * MMDB_free_entry_data_list does nothing for it. */
+extern int MMDB_get_entry_data_list_with_pool(
+    MMDB_entry_s *start,
+    struct MMDB_data_pool_s *const pool,
+    MMDB_entry_data_list_s **const entry_data_list);
 extern void MMDB_close(MMDB_s *const mmdb);
 extern const char *MMDB_lib_version(void);
 extern int
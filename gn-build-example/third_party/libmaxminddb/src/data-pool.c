@@ -8,6 +8,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 // Allocate an MMDB_data_pool_s. It initially has space for size
 // MMDB_entry_data_list_s structs.
@@ -55,7 +56,8 @@ void data_pool_destroy(MMDB_data_pool_s *const pool) {
         return;
     }
 
-    for (size_t i = 0; i <= pool->index; i++) {
+    // After a reset, blocks past the current index may still be allocated.
+    for (size_t i = 0; i < DATA_POOL_NUM_BLOCKS; i++) {
         free(pool->blocks[i]);
     }
 
@@ -83,6 +85,16 @@ MMDB_entry_data_list_s *data_pool_alloc(MMDB_data_pool_s *const pool) {
         return NULL;
     }
 
+    // A pool that was reset keeps its blocks. Move on to the next one if we
+    // allocated it before.
+    if (pool->blocks[new_index]) {
+        pool->index = new_index;
+        pool->block = pool->blocks[new_index];
+        pool->size = pool->sizes[new_index];
+        pool->used = 1;
+        return pool->block;
+    }
+
     if (!can_multiply(SIZE_MAX, pool->size, 2)) {
         return NULL;
     }
@@ -110,6 +122,31 @@ MMDB_entry_data_list_s *data_pool_alloc(MMDB_data_pool_s *const pool) {
     return element;
 }
 
+// Rewind the pool so that data_pool_alloc() hands out its memory again from
+// the start. Any list previously built from the pool becomes invalid. The
+// blocks are kept, so refilling the pool up to its previous size does not
+// allocate. The structs that were handed out are zeroed, as calloc() left
+// them, so a reused pool builds exactly the list a new pool would.
+void data_pool_reset(MMDB_data_pool_s *const pool) {
+    if (!pool) {
+        return;
+    }
+
+    for (size_t i = 0; i <= pool->index; i++) {
+        size_t used = pool->sizes[i];
+        if (i == pool->index) {
+            used = pool->used;
+        }
+        memset(pool->blocks[i], 0, used * sizeof(MMDB_entry_data_list_s));
+        pool->blocks[i]->pool = pool;
+    }
+
+    pool->index = 0;
+    pool->block = pool->blocks[0];
+    pool->size = pool->sizes[0];
+    pool->used = 0;
+}
+
 // Turn the structs in the array-like pool into a linked list.
 //
 // Before calling this function, the list isn't linked up.
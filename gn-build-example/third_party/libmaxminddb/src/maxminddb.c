@@ -35,6 +35,14 @@ typedef ADDRESS_FAMILY sa_family_t;
 
 #define MMDB_DATA_SECTION_SEPARATOR (16)
 #define MAXIMUM_DATA_STRUCTURE_DEPTH (512)
+/* Number of search tree walks MMDB_lookup_addresses keeps in flight. */
+#define LOOKUP_BATCH_WIDTH (16)
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define PREFETCH(p) __builtin_prefetch(p)
+#else
+    #define PREFETCH(p) ((void)(p))
+#endif
 
 #ifdef MMDB_DEBUG
     #define DEBUG_MSG(msg) fprintf(stderr, msg "\n")
@@ -131,6 +139,41 @@ typedef struct record_info_s {
     uint8_t right_record_offset;
 } record_info_s;
 
+/* One path element of a compiled projection. The paths form a trie rooted at
+ * nodes[0]; children of a node are linked through next_sibling, and index 0
+ * (the root) doubles as "none". */
+typedef struct projection_node_s {
+    char *key;
+    size_t key_length;
+    /* Whether key is an array index as lookup_path_in_array parses it. */
+    bool is_index;
+    long index;
+    /* The first path that ends at this node, or -1. */
+    long result_index;
+    size_t first_child;
+    size_t next_sibling;
+} projection_node_s;
+
+struct MMDB_projection_s {
+    projection_node_s *nodes;
+    size_t node_count;
+    size_t node_capacity;
+    /* For each path, the path whose result it shares (itself unless the same
+     * path was given more than once). */
+    size_t *result_paths;
+    size_t path_count;
+    /* Number of nodes with a result_index. */
+    size_t target_count;
+};
+
+typedef struct projection_state_s {
+    const MMDB_s *mmdb;
+    const MMDB_projection_s *projection;
+    MMDB_entry_data_s *results;
+    /* Results still to be found; the traversal stops when it reaches 0. */
+    size_t remaining;
+} projection_state_s;
+
 #define METADATA_MARKER "\xab\xcd\xefMaxMind.com"
 /* This is 128kb */
 #define METADATA_BLOCK_MAX_SIZE 131072
@@ -159,10 +202,20 @@ static int populate_description_metadata(MMDB_s *mmdb,
                                          MMDB_s *metadata_db,
                                          MMDB_entry_s *metadata_start);
 static int resolve_any_address(const char *ipstr, struct addrinfo **addresses);
+static bool parse_ipv4_literal(const char *p, const char *end, uint8_t *out);
+static bool parse_ipv6_literal(const char *p, const char *end, uint8_t *out);
+static int parse_address_with_getaddrinfo(const char *ipstr,
+                                          size_t length,
+                                          uint8_t address[16],
+                                          int *const family);
 static int find_address_in_search_tree(const MMDB_s *const mmdb,
                                        uint8_t const *address,
                                        sa_family_t address_family,
                                        MMDB_lookup_result_s *result);
+static int search_tree_result(const MMDB_s *const mmdb,
+                              uint64_t value,
+                              uint16_t current_bit,
+                              MMDB_lookup_result_s *result);
 static record_info_s record_info_for_database(const MMDB_s *const mmdb);
 static int find_ipv4_start_node(MMDB_s *const mmdb);
 static uint8_t record_type(const MMDB_s *const mmdb, uint64_t record);
@@ -179,6 +232,21 @@ static int lookup_path_in_map(const char *path_elem,
                               MMDB_entry_data_s *entry_data);
 static int skip_map_or_array(const MMDB_s *const mmdb,
                              MMDB_entry_data_s *entry_data);
+static size_t add_projection_child(MMDB_projection_s *projection,
+                                   size_t parent,
+                                   const char *key);
+static int project_value(projection_state_s *state,
+                         const projection_node_s *node,
+                         uint32_t offset,
+                         uint32_t *next);
+static int project_map(projection_state_s *state,
+                       const projection_node_s *node,
+                       const MMDB_entry_data_s *map,
+                       uint32_t *end);
+static int project_array(projection_state_s *state,
+                         const projection_node_s *node,
+                         const MMDB_entry_data_s *array,
+                         uint32_t *end);
 static int decode_one_follow(const MMDB_s *const mmdb,
                              uint32_t offset,
                              MMDB_entry_data_s *entry_data);
@@ -193,6 +261,9 @@ static int get_entry_data_list(const MMDB_s *const mmdb,
                                MMDB_entry_data_list_s *const entry_data_list,
                                MMDB_data_pool_s *const pool,
                                int depth);
+static int fill_entry_data_list(MMDB_entry_s *start,
+                                MMDB_data_pool_s *const pool,
+                                MMDB_entry_data_list_s **const entry_data_list);
 static float get_ieee754_float(const uint8_t *restrict p);
 static double get_ieee754_double(const uint8_t *restrict p);
 static uint32_t get_uint32(const uint8_t *p);
@@ -873,22 +944,242 @@ MMDB_lookup_result_s MMDB_lookup_string(const MMDB_s *const mmdb,
                                         const char *const ipstr,
                                         int *const gai_error,
                                         int *const mmdb_error) {
+    if (NULL == ipstr) {
+        MMDB_lookup_result_s result = {.found_entry = false,
+                                       .netmask = 0,
+                                       .entry = {.mmdb = mmdb, .offset = 0}};
+        struct addrinfo *addresses = NULL;
+        *gai_error = resolve_any_address(ipstr, &addresses);
+        if (!*gai_error) {
+            result = MMDB_lookup_sockaddr(mmdb, addresses->ai_addr, mmdb_error);
+        }
+        if (NULL != addresses) {
+            freeaddrinfo(addresses);
+        }
+        return result;
+    }
+
+    return MMDB_lookup_string_n(
+        mmdb, ipstr, strlen(ipstr), gai_error, mmdb_error);
+}
+
+MMDB_lookup_result_s MMDB_lookup_string_n(const MMDB_s *const mmdb,
+                                          const char *const ipstr,
+                                          size_t length,
+                                          int *const gai_error,
+                                          int *const mmdb_error) {
     MMDB_lookup_result_s result = {.found_entry = false,
                                    .netmask = 0,
                                    .entry = {.mmdb = mmdb, .offset = 0}};
 
-    struct addrinfo *addresses = NULL;
-    *gai_error = resolve_any_address(ipstr, &addresses);
+    uint8_t address[16];
+    int family = 0;
+    *gai_error = MMDB_parse_address(ipstr, length, address, &family);
+    if (*gai_error) {
+        return result;
+    }
+
+    return MMDB_lookup_address(mmdb, address, family, mmdb_error);
+}
 
-    if (!*gai_error) {
-        result = MMDB_lookup_sockaddr(mmdb, addresses->ai_addr, mmdb_error);
+int MMDB_parse_address(const char *const ipstr,
+                       size_t length,
+                       uint8_t address[16],
+                       int *const family) {
+    if (length > 0) {
+        const char *end = ipstr + length;
+        // A literal containing ':' can only be IPv6.
+        if (NULL == memchr(ipstr, ':', length)) {
+            if (parse_ipv4_literal(ipstr, end, address + 12)) {
+                memset(address, 0, 12);
+                *family = AF_INET;
+                return 0;
+            }
+        } else if (parse_ipv6_literal(ipstr, end, address)) {
+            *family = AF_INET6;
+            return 0;
+        }
+    }
+
+    // Shorthand and octal/hex IPv4 forms, scoped IPv6 addresses and invalid
+    // input are left to getaddrinfo() so that the accepted syntax and the
+    // error codes stay exactly the same as MMDB_lookup_string.
+    return parse_address_with_getaddrinfo(ipstr, length, address, family);
+}
+
+// Parses exactly four decimal octets without leading zeros (inet_pton
+// syntax). getaddrinfo() reads leading zeros as octal, so those are rejected
+// here and handled by the fallback.
+static bool parse_ipv4_literal(const char *p, const char *end, uint8_t *out) {
+    for (int i = 0; i < 4; i++) {
+        if (i > 0) {
+            if (p == end || *p != '.') {
+                return false;
+            }
+            p++;
+        }
+        if (p == end || *p < '0' || *p > '9') {
+            return false;
+        }
+        unsigned int value = (unsigned int)(*p++ - '0');
+        if (value == 0 && p != end && *p >= '0' && *p <= '9') {
+            return false;
+        }
+        while (p != end && *p >= '0' && *p <= '9') {
+            value = value * 10 + (unsigned int)(*p++ - '0');
+            if (value > 255) {
+                return false;
+            }
+        }
+        out[i] = (uint8_t)value;
+    }
+    return p == end;
+}
+
+static int hex_digit_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// Follows the grammar of inet_pton(AF_INET6): up to eight groups of one to
+// four hex digits, at most one "::", and an optional trailing dotted IPv4
+// address.
+static bool parse_ipv6_literal(const char *p, const char *end, uint8_t *out) {
+    uint8_t tmp[16] = {0};
+    uint8_t *tp = tmp;
+    uint8_t *const tmp_end = tmp + 16;
+    uint8_t *gap = NULL;
+    const char *group_start;
+    unsigned int value = 0;
+    int digits = 0;
+
+    if (p == end) {
+        return false;
+    }
+    // A leading ':' must be the start of "::".
+    if (*p == ':') {
+        if (++p == end || *p != ':') {
+            return false;
+        }
+    }
+    group_start = p;
+
+    while (p != end) {
+        char c = *p++;
+        int digit = hex_digit_value(c);
+        if (digit >= 0) {
+            if (++digits > 4) {
+                return false;
+            }
+            value = (value << 4) | (unsigned int)digit;
+            continue;
+        }
+        if (c == ':') {
+            group_start = p;
+            if (digits == 0) {
+                if (gap) {
+                    return false;
+                }
+                gap = tp;
+                continue;
+            }
+            if (p == end || tp + 2 > tmp_end) {
+                return false;
+            }
+            *tp++ = (uint8_t)(value >> 8);
+            *tp++ = (uint8_t)value;
+            value = 0;
+            digits = 0;
+            continue;
+        }
+        if (c == '.' && tp + 4 <= tmp_end &&
+            parse_ipv4_literal(group_start, end, tp)) {
+            tp += 4;
+            digits = 0;
+            break;
+        }
+        return false;
+    }
+
+    if (digits > 0) {
+        if (tp + 2 > tmp_end) {
+            return false;
+        }
+        *tp++ = (uint8_t)(value >> 8);
+        *tp++ = (uint8_t)value;
+    }
+    if (gap) {
+        if (tp == tmp_end) {
+            return false;
+        }
+        size_t tail = (size_t)(tp - gap);
+        memmove(tmp_end - tail, gap, tail);
+        memset(gap, 0, (size_t)(tmp_end - tail - gap));
+        tp = tmp_end;
+    }
+    if (tp != tmp_end) {
+        return false;
+    }
+
+    memcpy(out, tmp, 16);
+    return true;
+}
+
+static int parse_address_with_getaddrinfo(const char *ipstr,
+                                          size_t length,
+                                          uint8_t address[16],
+                                          int *const family) {
+    // The string has to be NUL-terminated for getaddrinfo(). An embedded NUL
+    // would silently truncate it, so reject that outright.
+    if (length > 0 && NULL != memchr(ipstr, '\0', length)) {
+        return EAI_NONAME;
+    }
+
+    char stack_copy[64];
+    char *copy = stack_copy;
+    if (length >= sizeof(stack_copy)) {
+        copy = malloc(length + 1);
+        if (NULL == copy) {
+            return EAI_MEMORY;
+        }
+    }
+    if (length > 0) {
+        memcpy(copy, ipstr, length);
+    }
+    copy[length] = '\0';
+
+    struct addrinfo *addresses = NULL;
+    int gai_error = resolve_any_address(copy, &addresses);
+    if (!gai_error) {
+        const struct sockaddr *sockaddr = addresses->ai_addr;
+        if (sockaddr->sa_family == AF_INET6) {
+            memcpy(address,
+                   ((struct sockaddr_in6 const *)sockaddr)->sin6_addr.s6_addr,
+                   16);
+        } else {
+            memset(address, 0, 12);
+            memcpy(address + 12,
+                   &((struct sockaddr_in const *)sockaddr)->sin_addr.s_addr,
+                   4);
+        }
+        *family = sockaddr->sa_family;
     }
 
     if (NULL != addresses) {
         freeaddrinfo(addresses);
     }
-
-    return result;
+    if (copy != stack_copy) {
+        free(copy);
+    }
+    return gai_error;
 }
 
 static int resolve_any_address(const char *ipstr, struct addrinfo **addresses) {
@@ -909,38 +1200,210 @@ static int resolve_any_address(const char *ipstr, struct addrinfo **addresses) {
 MMDB_lookup_result_s MMDB_lookup_sockaddr(const MMDB_s *const mmdb,
                                           const struct sockaddr *const sockaddr,
                                           int *const mmdb_error) {
+    uint8_t address[16];
+    if (sockaddr->sa_family == AF_INET6) {
+        memcpy(address,
+               ((struct sockaddr_in6 const *)sockaddr)->sin6_addr.s6_addr,
+               16);
+    } else {
+        memset(address, 0, 12);
+        memcpy(address + 12,
+               &((struct sockaddr_in const *)sockaddr)->sin_addr.s_addr,
+               4);
+    }
+
+    return MMDB_lookup_address(mmdb, address, sockaddr->sa_family, mmdb_error);
+}
+
+MMDB_lookup_result_s MMDB_lookup_address(const MMDB_s *const mmdb,
+                                         const uint8_t address[16],
+                                         int family,
+                                         int *const mmdb_error) {
     MMDB_lookup_result_s result = {.found_entry = false,
                                    .netmask = 0,
                                    .entry = {.mmdb = mmdb, .offset = 0}};
 
-    uint8_t mapped_address[16];
-    uint8_t const *address;
+    uint8_t const *search_address = address;
     if (mmdb->metadata.ip_version == 4) {
-        if (sockaddr->sa_family == AF_INET6) {
+        if (family == AF_INET6) {
             *mmdb_error = MMDB_IPV6_LOOKUP_IN_IPV4_DATABASE_ERROR;
             return result;
         }
-        address = (uint8_t const *)&((struct sockaddr_in const *)sockaddr)
-                      ->sin_addr.s_addr;
-    } else {
-        if (sockaddr->sa_family == AF_INET6) {
-            address = (uint8_t const *)&((struct sockaddr_in6 const *)sockaddr)
-                          ->sin6_addr.s6_addr;
-        } else {
-            address = mapped_address;
-            memset(mapped_address, 0, 12);
-            memcpy(mapped_address + 12,
-                   &((struct sockaddr_in const *)sockaddr)->sin_addr.s_addr,
-                   4);
-        }
+        search_address = address + 12;
     }
 
     *mmdb_error = find_address_in_search_tree(
-        mmdb, address, sockaddr->sa_family, &result);
+        mmdb, search_address, (sa_family_t)family, &result);
 
     return result;
 }
 
+/* Reads the left (bit 0) or right (bit 1) record of a node. Same as the
+ * record_info_s getters, but without an indirect call per tree level. */
+static inline uint32_t
+read_record(const uint8_t *node, uint16_t record_length, uint8_t bit) {
+    switch (record_length) {
+        case 6:
+            return get_uint24(node + 3 * bit);
+        case 7:
+            return bit ? get_right_28_bit_record(node + 3)
+                       : get_left_28_bit_record(node);
+        default:
+            return get_uint32(node + 4 * bit);
+    }
+}
+
+typedef struct lookup_lane_s {
+    size_t index;
+    const uint8_t *address;
+    uint64_t value;
+    uint16_t current_bit;
+} lookup_lane_s;
+
+/* Sets up the walk for addresses[index]. Returns false if the lookup already
+ * finished (IPv6 address in an IPv4 database, or an IPv4 subtree that ends
+ * before the first bit), in which case the result has been filled in. */
+static bool start_lane(const MMDB_s *const mmdb,
+                       const uint8_t *addresses,
+                       const int *families,
+                       size_t index,
+                       lookup_lane_s *lane,
+                       MMDB_lookup_result_s *results,
+                       int *mmdb_errors) {
+    const uint8_t *address = addresses + index * 16;
+    results[index] = (MMDB_lookup_result_s){
+        .found_entry = false, .netmask = 0, .entry = {.mmdb = mmdb, .offset = 0}};
+    mmdb_errors[index] = MMDB_SUCCESS;
+
+    lane->index = index;
+    lane->address = address;
+    lane->value = 0;
+    lane->current_bit = 0;
+    if (mmdb->metadata.ip_version == 4) {
+        if (families[index] == AF_INET6) {
+            mmdb_errors[index] = MMDB_IPV6_LOOKUP_IN_IPV4_DATABASE_ERROR;
+            return false;
+        }
+        lane->address = address + 12;
+    } else if (families[index] == AF_INET) {
+        lane->value = mmdb->ipv4_start_node.node_value;
+        lane->current_bit = mmdb->ipv4_start_node.netmask;
+    }
+
+    if (lane->current_bit >= mmdb->depth ||
+        lane->value >= mmdb->metadata.node_count) {
+        mmdb_errors[index] = search_tree_result(
+            mmdb, lane->value, lane->current_bit, &results[index]);
+        return false;
+    }
+    PREFETCH(&mmdb->file_content[lane->value * mmdb->full_record_byte_size]);
+    return true;
+}
+
+/* Pulls the next address that still needs a walk into lane. Returns false
+ * when all addresses have been started. */
+static bool refill_lane(const MMDB_s *const mmdb,
+                        const uint8_t *addresses,
+                        const int *families,
+                        size_t count,
+                        size_t *next,
+                        lookup_lane_s *lane,
+                        MMDB_lookup_result_s *results,
+                        int *mmdb_errors) {
+    while (*next < count) {
+        size_t index = (*next)++;
+        if (start_lane(
+                mmdb, addresses, families, index, lane, results, mmdb_errors)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MMDB_lookup_addresses(const MMDB_s *const mmdb,
+                           const uint8_t *addresses,
+                           const int *families,
+                           size_t count,
+                           MMDB_lookup_result_s *results,
+                           int *mmdb_errors) {
+    record_info_s record_info = record_info_for_database(mmdb);
+    if (record_info.right_record_offset == 0) {
+        for (size_t i = 0; i < count; i++) {
+            results[i] = (MMDB_lookup_result_s){
+                .found_entry = false,
+                .netmask = 0,
+                .entry = {.mmdb = mmdb, .offset = 0}};
+            mmdb_errors[i] = MMDB_UNKNOWN_DATABASE_FORMAT_ERROR;
+        }
+        return;
+    }
+
+    lookup_lane_s lanes[LOOKUP_BATCH_WIDTH];
+    size_t active = 0;
+    size_t next = 0;
+    while (active < LOOKUP_BATCH_WIDTH &&
+           refill_lane(mmdb,
+                       addresses,
+                       families,
+                       count,
+                       &next,
+                       &lanes[active],
+                       results,
+                       mmdb_errors)) {
+        active++;
+    }
+
+    uint32_t node_count = mmdb->metadata.node_count;
+    const uint8_t *search_tree = mmdb->file_content;
+    /* Each pass advances every walk by one level. The node a walk needs next
+     * was prefetched on the previous pass, so the misses of all walks in
+     * flight overlap instead of being taken one after another. */
+    while (active > 0) {
+        for (size_t i = 0; i < active;) {
+            lookup_lane_s *lane = &lanes[i];
+            const uint8_t *record_pointer =
+                &search_tree[lane->value * record_info.record_length];
+            if (record_pointer + record_info.record_length >
+                mmdb->data_section) {
+                mmdb_errors[lane->index] = MMDB_CORRUPT_SEARCH_TREE_ERROR;
+            } else {
+                uint16_t current_bit = lane->current_bit;
+                uint8_t bit = 1U & (lane->address[current_bit >> 3] >>
+                                    (7 - (current_bit % 8)));
+                lane->value = read_record(
+                    record_pointer, record_info.record_length, bit);
+                lane->current_bit++;
+                if (lane->current_bit < mmdb->depth &&
+                    lane->value < node_count) {
+                    PREFETCH(
+                        &search_tree[lane->value * record_info.record_length]);
+                    i++;
+                    continue;
+                }
+                mmdb_errors[lane->index] =
+                    search_tree_result(mmdb,
+                                       lane->value,
+                                       lane->current_bit,
+                                       &results[lane->index]);
+            }
+            /* This walk is done: start the next address in its place, or
+             * drop the lane once every address has been started. */
+            if (!refill_lane(mmdb,
+                             addresses,
+                             families,
+                             count,
+                             &next,
+                             lane,
+                             results,
+                             mmdb_errors)) {
+                lanes[i] = lanes[--active];
+            } else {
+                i++;
+            }
+        }
+    }
+}
+
 static int find_address_in_search_tree(const MMDB_s *const mmdb,
                                        uint8_t const *address,
                                        sa_family_t address_family,
@@ -977,6 +1440,15 @@ static int find_address_in_search_tree(const MMDB_s *const mmdb,
         }
     }
 
+    return search_tree_result(mmdb, value, current_bit, result);
+}
+
+/* Fills in result for the record a search tree walk ended on. */
+static int search_tree_result(const MMDB_s *const mmdb,
+                              uint64_t value,
+                              uint16_t current_bit,
+                              MMDB_lookup_result_s *result) {
+    uint32_t node_count = mmdb->metadata.node_count;
     result->netmask = current_bit;
 
     if (value >= node_count + mmdb->data_section_size) {
@@ -1355,6 +1827,284 @@ static int skip_map_or_array(const MMDB_s *const mmdb,
     return MMDB_SUCCESS;
 }
 
+int MMDB_projection_create(const char *const *const *paths,
+                           size_t path_count,
+                           MMDB_projection_s **const projection) {
+    *projection = NULL;
+    MMDB_projection_s *compiled = calloc(1, sizeof(MMDB_projection_s));
+    if (NULL == compiled) {
+        return MMDB_OUT_OF_MEMORY_ERROR;
+    }
+    compiled->path_count = path_count;
+    compiled->result_paths = calloc(path_count + 1, sizeof(size_t));
+    if (NULL == compiled->result_paths ||
+        SIZE_MAX == add_projection_child(compiled, 0, NULL)) {
+        MMDB_projection_free(compiled);
+        return MMDB_OUT_OF_MEMORY_ERROR;
+    }
+
+    for (size_t i = 0; i < path_count; i++) {
+        if (NULL == paths[i]) {
+            MMDB_projection_free(compiled);
+            return MMDB_INVALID_LOOKUP_PATH_ERROR;
+        }
+        size_t node = 0;
+        for (const char *const *path_elem = paths[i]; NULL != *path_elem;
+             path_elem++) {
+            node = add_projection_child(compiled, node, *path_elem);
+            if (SIZE_MAX == node) {
+                MMDB_projection_free(compiled);
+                return MMDB_OUT_OF_MEMORY_ERROR;
+            }
+        }
+        projection_node_s *target = &compiled->nodes[node];
+        if (target->result_index < 0) {
+            target->result_index = (long)i;
+            compiled->target_count++;
+        }
+        compiled->result_paths[i] = (size_t)target->result_index;
+    }
+
+    *projection = compiled;
+    return MMDB_SUCCESS;
+}
+
+void MMDB_projection_free(MMDB_projection_s *const projection) {
+    if (NULL == projection) {
+        return;
+    }
+    for (size_t i = 0; i < projection->node_count; i++) {
+        free(projection->nodes[i].key);
+    }
+    free(projection->nodes);
+    free(projection->result_paths);
+    free(projection);
+}
+
+/* Returns the child of parent with the given key, adding it if needed, or
+ * SIZE_MAX if out of memory. With a NULL key, adds the root node. */
+static size_t add_projection_child(MMDB_projection_s *projection,
+                                   size_t parent,
+                                   const char *key) {
+    if (NULL != key) {
+        size_t key_length = strlen(key);
+        for (size_t child = projection->nodes[parent].first_child; child != 0;
+             child = projection->nodes[child].next_sibling) {
+            const projection_node_s *node = &projection->nodes[child];
+            if (node->key_length == key_length &&
+                !memcmp(node->key, key, key_length)) {
+                return child;
+            }
+        }
+    }
+
+    if (projection->node_count == projection->node_capacity) {
+        size_t capacity =
+            projection->node_capacity ? projection->node_capacity * 2 : 8;
+        projection_node_s *nodes =
+            realloc(projection->nodes, capacity * sizeof(projection_node_s));
+        if (NULL == nodes) {
+            return SIZE_MAX;
+        }
+        projection->nodes = nodes;
+        projection->node_capacity = capacity;
+    }
+
+    size_t index = projection->node_count;
+    projection_node_s *node = &projection->nodes[index];
+    memset(node, 0, sizeof(projection_node_s));
+    node->result_index = -1;
+    if (NULL != key) {
+        node->key = mmdb_strdup(key);
+        if (NULL == node->key) {
+            return SIZE_MAX;
+        }
+        node->key_length = strlen(key);
+
+        char *first_invalid;
+        int saved_errno = errno;
+        errno = 0;
+        node->index = strtol(key, &first_invalid, 10);
+        node->is_index = ERANGE != errno && !*first_invalid;
+        errno = saved_errno;
+
+        /* Append so that siblings keep the order the paths were given in. */
+        size_t *link = &projection->nodes[parent].first_child;
+        while (*link != 0) {
+            link = &projection->nodes[*link].next_sibling;
+        }
+        *link = index;
+    }
+    projection->node_count++;
+    return index;
+}
+
+int MMDB_project(MMDB_entry_s *const start,
+                 const MMDB_projection_s *const projection,
+                 MMDB_entry_data_s *const results) {
+    memset(results, 0, projection->path_count * sizeof(MMDB_entry_data_s));
+    projection_state_s state = {.mmdb = start->mmdb,
+                                .projection = projection,
+                                .results = results,
+                                .remaining = projection->target_count};
+
+    uint32_t next;
+    int status = project_value(&state, &projection->nodes[0], start->offset, &next);
+    if (MMDB_SUCCESS != status) {
+        memset(results, 0, projection->path_count * sizeof(MMDB_entry_data_s));
+        return status;
+    }
+
+    for (size_t i = 0; i < projection->path_count; i++) {
+        if (projection->result_paths[i] != i) {
+            results[i] = results[projection->result_paths[i]];
+        }
+    }
+    return MMDB_SUCCESS;
+}
+
+/* Visits the value at offset, which node's path leads to. Stores it if a
+ * path ends there and descends into maps and arrays that paths continue
+ * into. *next is set to the offset after the value, like offset_to_next of a
+ * non-following decode, unless all results have been found. */
+static int project_value(projection_state_s *state,
+                         const projection_node_s *node,
+                         uint32_t offset,
+                         uint32_t *next) {
+    const MMDB_s *const mmdb = state->mmdb;
+    MMDB_entry_data_s value;
+    CHECKED_DECODE_ONE(mmdb, offset, &value);
+
+    bool is_pointer = MMDB_DATA_TYPE_POINTER == value.type;
+    uint32_t after_pointer = value.offset_to_next;
+    if (is_pointer) {
+        CHECKED_DECODE_ONE(mmdb, value.pointer, &value);
+        /* Pointers to pointers are illegal under the spec */
+        if (MMDB_DATA_TYPE_POINTER == value.type) {
+            return MMDB_INVALID_DATA_ERROR;
+        }
+        if (MMDB_DATA_TYPE_MAP != value.type &&
+            MMDB_DATA_TYPE_ARRAY != value.type) {
+            value.offset_to_next = after_pointer;
+        }
+    }
+
+    if (node->result_index >= 0) {
+        state->results[node->result_index] = value;
+        state->remaining--;
+    }
+
+    uint32_t end = value.offset_to_next;
+    int status = MMDB_SUCCESS;
+    if (state->remaining > 0) {
+        if (node->first_child != 0 && MMDB_DATA_TYPE_MAP == value.type) {
+            status = project_map(state, node, &value, &end);
+        } else if (node->first_child != 0 &&
+                   MMDB_DATA_TYPE_ARRAY == value.type) {
+            status = project_array(state, node, &value, &end);
+        } else if (!is_pointer) {
+            status = skip_map_or_array(mmdb, &value);
+            end = value.offset_to_next;
+        }
+    }
+
+    *next = is_pointer ? after_pointer : end;
+    return status;
+}
+
+static int project_map(projection_state_s *state,
+                       const projection_node_s *node,
+                       const MMDB_entry_data_s *map,
+                       uint32_t *end) {
+    const MMDB_s *const mmdb = state->mmdb;
+    const projection_node_s *const nodes = state->projection->nodes;
+    uint32_t offset = map->offset_to_next;
+
+    for (uint32_t i = 0; i < map->data_size && state->remaining > 0; i++) {
+        MMDB_entry_data_s key;
+        CHECKED_DECODE_ONE_FOLLOW(mmdb, offset, &key);
+        if (MMDB_DATA_TYPE_UTF8_STRING != key.type) {
+            return MMDB_INVALID_DATA_ERROR;
+        }
+
+        const projection_node_s *child = NULL;
+        for (size_t c = node->first_child; c != 0; c = nodes[c].next_sibling) {
+            if (nodes[c].key_length == key.data_size &&
+                !memcmp(nodes[c].key, key.utf8_string, key.data_size)) {
+                child = &nodes[c];
+                break;
+            }
+        }
+
+        if (NULL != child) {
+            int status =
+                project_value(state, child, key.offset_to_next, &offset);
+            if (MMDB_SUCCESS != status) {
+                return status;
+            }
+        } else {
+            /* We don't want to follow a pointer here. If the value is a
+             * pointer we simply skip it and keep going */
+            MMDB_entry_data_s value;
+            CHECKED_DECODE_ONE(mmdb, key.offset_to_next, &value);
+            int status = skip_map_or_array(mmdb, &value);
+            if (MMDB_SUCCESS != status) {
+                return status;
+            }
+            offset = value.offset_to_next;
+        }
+    }
+
+    *end = offset;
+    return MMDB_SUCCESS;
+}
+
+static int project_array(projection_state_s *state,
+                         const projection_node_s *node,
+                         const MMDB_entry_data_s *array,
+                         uint32_t *end) {
+    const MMDB_s *const mmdb = state->mmdb;
+    const projection_node_s *const nodes = state->projection->nodes;
+    uint32_t size = array->data_size;
+    uint32_t offset = array->offset_to_next;
+
+    for (uint32_t i = 0; i < size && state->remaining > 0; i++) {
+        /* Several paths can name the same element, e.g. "1" and "-1" in an
+         * array of two. Negative indexes count from the end, as in
+         * lookup_path_in_array. */
+        bool matched = false;
+        uint32_t next = offset;
+        for (size_t c = node->first_child; c != 0 && state->remaining > 0;
+             c = nodes[c].next_sibling) {
+            long index = nodes[c].index;
+            if (!nodes[c].is_index ||
+                (index < 0 ? index + (long)size != (long)i
+                           : index != (long)i)) {
+                continue;
+            }
+            int status = project_value(state, &nodes[c], offset, &next);
+            if (MMDB_SUCCESS != status) {
+                return status;
+            }
+            matched = true;
+        }
+
+        if (!matched) {
+            MMDB_entry_data_s value;
+            CHECKED_DECODE_ONE(mmdb, offset, &value);
+            int status = skip_map_or_array(mmdb, &value);
+            if (MMDB_SUCCESS != status) {
+                return status;
+            }
+            next = value.offset_to_next;
+        }
+        offset = next;
+    }
+
+    *end = offset;
+    return MMDB_SUCCESS;
+}
+
 static int decode_one_follow(const MMDB_s *const mmdb,
                              uint32_t offset,
                              MMDB_entry_data_s *entry_data) {
@@ -1643,22 +2393,56 @@ int MMDB_get_entry_data_list(MMDB_entry_s *start,
         return MMDB_OUT_OF_MEMORY_ERROR;
     }
 
+    int const status = fill_entry_data_list(start, pool, entry_data_list);
+    if (MMDB_SUCCESS != status) {
+        data_pool_destroy(pool);
+    }
+    return status;
+}
+
+MMDB_data_pool_s *MMDB_data_pool_create(void) {
+    MMDB_data_pool_s *const pool = data_pool_new(MMDB_POOL_INIT_SIZE);
+    if (pool) {
+        pool->caller_owned = true;
+    }
+    return pool;
+}
+
+void MMDB_data_pool_free(MMDB_data_pool_s *const pool) {
+    data_pool_destroy(pool);
+}
+
+int MMDB_get_entry_data_list_with_pool(
+    MMDB_entry_s *start,
+    MMDB_data_pool_s *const pool,
+    MMDB_entry_data_list_s **const entry_data_list) {
+    *entry_data_list = NULL;
+    if (!pool) {
+        return MMDB_INVALID_DATA_ERROR;
+    }
+
+    data_pool_reset(pool);
+    return fill_entry_data_list(start, pool, entry_data_list);
+}
+
+/* Decodes the record at start into an empty pool. On error the pool is left
+ * for the caller to destroy or reset. */
+static int fill_entry_data_list(MMDB_entry_s *start,
+                                MMDB_data_pool_s *const pool,
+                                MMDB_entry_data_list_s **const entry_data_list) {
     MMDB_entry_data_list_s *const list = data_pool_alloc(pool);
     if (!list) {
-        data_pool_destroy(pool);
         return MMDB_OUT_OF_MEMORY_ERROR;
     }
 
     int const status =
         get_entry_data_list(start->mmdb, start->offset, list, pool, 0);
     if (MMDB_SUCCESS != status) {
-        data_pool_destroy(pool);
         return status;
     }
 
     *entry_data_list = data_pool_to_list(pool);
     if (!*entry_data_list) {
-        data_pool_destroy(pool);
         return MMDB_OUT_OF_MEMORY_ERROR;
     }
 
@@ -1854,7 +2638,13 @@ void MMDB_free_entry_data_list(MMDB_entry_data_list_s *const entry_data_list) {
     if (entry_data_list == NULL) {
         return;
     }
-    data_pool_destroy(entry_data_list->pool);
+    MMDB_data_pool_s *const pool = entry_data_list->pool;
+    /* Lists built with MMDB_get_entry_data_list_with_pool live until the
+     * caller reuses or frees the pool. */
+    if (pool->caller_owned) {
+        return;
+    }
+    data_pool_destroy(pool);
 }
 
 void MMDB_close(MMDB_s *const mmdb) { free_mmdb_struct(mmdb); }
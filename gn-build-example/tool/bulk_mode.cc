@@ -0,0 +1,385 @@
+#include "bulk_mode.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ip_checker.h"
+
+namespace {
+
+constexpr size_t kChunkBytes = 1 << 20;
+// 每次交给LookupCountries的行数
+constexpr size_t kLookupBatch = 1024;
+// 每个工作线程的在途块数上限，读stdin时限制占用的内存
+constexpr size_t kChunksPerThread = 4;
+// 国家计数按两个字节的代码直接索引
+constexpr size_t kCountrySlots = 65536;
+
+using Clock = std::chrono::steady_clock;
+
+struct Chunk {
+    std::string storage;        // 从stdin读入的数据，mmap输入时为空
+    std::string_view data;      // 以完整的行结束
+    std::string output;
+    uint64_t lines = 0;
+    double busy_ms = 0;         // 工作线程处理这一块的耗时
+    bool done = false;
+};
+
+// 每个工作线程单独累加，结束时合并，避免争用
+struct WorkerCounts {
+    std::vector<uint64_t> countries = std::vector<uint64_t>(kCountrySlots);
+    uint64_t not_found = 0;
+};
+
+std::string_view Trim(std::string_view line) {
+    size_t begin = 0;
+    size_t end = line.size();
+    while (begin < end && (line[begin] == ' ' || line[begin] == '\t')) {
+        begin++;
+    }
+    while (end > begin &&
+           (line[end - 1] == ' ' || line[end - 1] == '\t' || line[end - 1] == '\r')) {
+        end--;
+    }
+    return line.substr(begin, end - begin);
+}
+
+class BulkRunner {
+public:
+    BulkRunner(const IpChecker& checker, const BulkOptions& options, int threads)
+        : checker_(checker),
+          quiet_(options.quiet),
+          max_in_flight_(threads * kChunksPerThread),
+          counts_(threads) {
+        for (int i = 0; i < threads; ++i) {
+            workers_.emplace_back(&BulkRunner::Work, this, &counts_[i]);
+        }
+    }
+
+    ~BulkRunner() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        work_cv_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    // 交给工作线程，并按顺序写出已完成的块；在途块数到上限时等最早的块完成
+    void Submit(std::unique_ptr<Chunk> chunk) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(chunk.get());
+            in_flight_.push_back(std::move(chunk));
+        }
+        work_cv_.notify_one();
+        Drain(max_in_flight_);
+    }
+
+    // 等全部块处理完并写出
+    void Finish() { Drain(0); }
+
+    void PrintSummary(double elapsed_s, int threads) const;
+
+private:
+    void Work(WorkerCounts* counts);
+    void Process(Chunk* chunk, WorkerCounts* counts, std::vector<std::string_view>* ips,
+                 std::vector<IpChecker::CountryResult>* results) const;
+
+    // 按顺序写出队首已完成的块，直到在途块数不超过limit且队首未完成
+    void Drain(size_t limit) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!in_flight_.empty()) {
+            if (!in_flight_.front()->done) {
+                if (in_flight_.size() <= limit) {
+                    return;
+                }
+                done_cv_.wait(lock, [this] { return in_flight_.front()->done; });
+            }
+            std::unique_ptr<Chunk> chunk = std::move(in_flight_.front());
+            in_flight_.pop_front();
+            lock.unlock();
+            if (!quiet_) {
+                fwrite(chunk->output.data(), 1, chunk->output.size(), stdout);
+            }
+            lines_ += chunk->lines;
+            if (chunk->lines > 0) {
+                chunk_ms_.push_back(chunk->busy_ms);
+                busy_ms_ += chunk->busy_ms;
+            }
+            lock.lock();
+        }
+    }
+
+    const IpChecker& checker_;
+    bool quiet_;
+    size_t max_in_flight_;
+
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    std::deque<Chunk*> queue_;                        // 待处理
+    std::deque<std::unique_ptr<Chunk>> in_flight_;   // 按输入顺序，尚未写出
+    bool closed_ = false;
+
+    // 只在写出时（提交输入的线程）更新
+    uint64_t lines_ = 0;
+    double busy_ms_ = 0;
+    std::vector<double> chunk_ms_;
+
+    std::vector<WorkerCounts> counts_;
+    std::vector<std::thread> workers_;
+};
+
+void BulkRunner::Work(WorkerCounts* counts) {
+    std::vector<std::string_view> ips;
+    std::vector<IpChecker::CountryResult> results;
+    ips.reserve(kLookupBatch);
+    results.resize(kLookupBatch);
+    while (true) {
+        Chunk* chunk;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [this] { return !queue_.empty() || closed_; });
+            if (queue_.empty()) {
+                return;
+            }
+            chunk = queue_.front();
+            queue_.pop_front();
+        }
+        Process(chunk, counts, &ips, &results);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            chunk->done = true;
+        }
+        done_cv_.notify_all();
+    }
+}
+
+void BulkRunner::Process(Chunk* chunk, WorkerCounts* counts, std::vector<std::string_view>* ips,
+                         std::vector<IpChecker::CountryResult>* results) const {
+    auto start = Clock::now();
+    if (!quiet_) {
+        // 每行输出比输入多一个制表符和国家代码
+        chunk->output.reserve(chunk->data.size() + chunk->data.size() / 4);
+    }
+    auto flush = [&]() {
+        checker_.LookupCountries(ips->data(), ips->size(), results->data());
+        for (size_t i = 0; i < ips->size(); ++i) {
+            const IpChecker::CountryResult& result = (*results)[i];
+            if (result.found) {
+                counts->countries[static_cast<uint8_t>(result.country[0]) << 8 |
+                                  static_cast<uint8_t>(result.country[1])]++;
+            } else {
+                counts->not_found++;
+            }
+            if (!quiet_) {
+                chunk->output.append((*ips)[i]);
+                chunk->output.push_back('\t');
+                chunk->output.append(result.found ? result.country : "--");
+                chunk->output.push_back('\n');
+            }
+        }
+        chunk->lines += ips->size();
+        ips->clear();
+    };
+
+    std::string_view data = chunk->data;
+    while (!data.empty()) {
+        size_t newline = data.find('\n');
+        std::string_view line = data.substr(0, newline);
+        data.remove_prefix(newline == std::string_view::npos ? data.size() : newline + 1);
+        line = Trim(line);
+        if (line.empty()) {
+            continue;
+        }
+        ips->push_back(line);
+        if (ips->size() == kLookupBatch) {
+            flush();
+        }
+    }
+    if (!ips->empty()) {
+        flush();
+    }
+    chunk->busy_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void BulkRunner::PrintSummary(double elapsed_s, int threads) const {
+    std::vector<std::pair<uint64_t, int>> countries;
+    uint64_t not_found = 0;
+    for (size_t code = 0; code < kCountrySlots; ++code) {
+        uint64_t count = 0;
+        for (const auto& worker : counts_) {
+            count += worker.countries[code];
+        }
+        if (count > 0) {
+            countries.emplace_back(count, static_cast<int>(code));
+        }
+    }
+    for (const auto& worker : counts_) {
+        not_found += worker.not_found;
+    }
+    std::sort(countries.rbegin(), countries.rend());
+
+    fprintf(stderr, "Lookups: %llu, found: %llu, not found: %llu\n",
+            static_cast<unsigned long long>(lines_),
+            static_cast<unsigned long long>(lines_ - not_found),
+            static_cast<unsigned long long>(not_found));
+    for (const auto& country : countries) {
+        fprintf(stderr, "  %c%c %12llu  %6.2f%%\n", country.second >> 8, country.second & 0xff,
+                static_cast<unsigned long long>(country.first),
+                100.0 * country.first / lines_);
+    }
+    fprintf(stderr, "Elapsed: %.3f s, %.2f M lookups/s, %d threads\n", elapsed_s,
+            elapsed_s > 0 ? lines_ / elapsed_s / 1e6 : 0.0, threads);
+    if (!chunk_ms_.empty()) {
+        std::vector<double> sorted = chunk_ms_;
+        std::sort(sorted.begin(), sorted.end());
+        auto percentile = [&](double p) {
+            return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+        };
+        fprintf(stderr,
+                "Latency: %.0f ns per lookup per thread; per %zu KB chunk p50 %.2f ms, "
+                "p99 %.2f ms, max %.2f ms\n",
+                busy_ms_ * 1e6 / lines_, kChunkBytes / 1024, percentile(0.5), percentile(0.99),
+                sorted.back());
+    }
+}
+
+// 整个文件只读映射，按行边界切块；块直接指向映射
+bool SubmitMappedFile(const char* path, BulkRunner* runner) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        fprintf(stderr, "Failed to stat %s: %s\n", path, strerror(errno));
+        close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    if (size == 0) {
+        close(fd);
+        return true;
+    }
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        fprintf(stderr, "Failed to map %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    madvise(mapping, size, MADV_SEQUENTIAL);
+
+    const char* base = static_cast<const char*>(mapping);
+    size_t begin = 0;
+    while (begin < size) {
+        size_t end = std::min(size, begin + kChunkBytes);
+        if (end < size) {
+            const void* newline = memchr(base + end, '\n', size - end);
+            end = newline ? static_cast<const char*>(newline) - base + 1 : size;
+        }
+        std::unique_ptr<Chunk> chunk(new Chunk());
+        chunk->data = std::string_view(base + begin, end - begin);
+        runner->Submit(std::move(chunk));
+        begin = end;
+    }
+    // 映射在全部块写出后才能解除
+    runner->Finish();
+    munmap(mapping, size);
+    return true;
+}
+
+// 从stdin按块读入，每块在最后一个换行处截断，余下的部分并入下一块
+bool SubmitStdin(BulkRunner* runner) {
+    std::string carry;
+    while (true) {
+        std::unique_ptr<Chunk> chunk(new Chunk());
+        std::string& storage = chunk->storage;
+        storage.swap(carry);
+        size_t filled = storage.size();
+        storage.resize(filled + kChunkBytes);
+        size_t n = fread(&storage[filled], 1, kChunkBytes, stdin);
+        storage.resize(filled + n);
+        if (n == 0) {
+            if (ferror(stdin)) {
+                fprintf(stderr, "Failed to read stdin\n");
+                return false;
+            }
+            // 输入结束，剩下的不完整行也处理
+            if (!storage.empty()) {
+                chunk->data = storage;
+                runner->Submit(std::move(chunk));
+            }
+            runner->Finish();
+            return true;
+        }
+        size_t last_newline = storage.rfind('\n');
+        if (last_newline == std::string::npos) {
+            // 一行比一块还长，继续读
+            carry.swap(storage);
+            continue;
+        }
+        carry.assign(storage, last_newline + 1, std::string::npos);
+        storage.resize(last_newline + 1);
+        chunk->data = storage;
+        runner->Submit(std::move(chunk));
+    }
+}
+
+}  // namespace
+
+int RunBulk(const BulkOptions& options) {
+    IpChecker::Options checker_options;
+    checker_options.ipv4_table = options.ipv4_table;
+    IpChecker checker;
+    auto open_start = Clock::now();
+    if (!checker.Open(options.db_path, checker_options)) {
+        return 1;
+    }
+    double open_ms = std::chrono::duration<double, std::milli>(Clock::now() - open_start).count();
+
+    int threads = options.threads;
+    if (threads <= 0) {
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+        if (threads <= 0) threads = 1;
+    }
+    // 结果按块整体写出，stdout用大缓冲
+    static char output_buffer[1 << 20];
+    setvbuf(stdout, output_buffer, _IOFBF, sizeof(output_buffer));
+
+    BulkRunner runner(checker, options, threads);
+    auto start = Clock::now();
+    bool from_stdin = !options.input_path || strcmp(options.input_path, "-") == 0;
+    bool ok = from_stdin ? SubmitStdin(&runner) : SubmitMappedFile(options.input_path, &runner);
+    if (!ok) {
+        runner.Finish();
+    }
+    fflush(stdout);
+    double elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+    fprintf(stderr, "Database opened in %.1f ms\n", open_ms);
+    runner.PrintSummary(elapsed_s, threads);
+    return ok ? 0 : 1;
+}
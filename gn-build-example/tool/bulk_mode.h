@@ -0,0 +1,16 @@
+#pragma once
+
+// check_ip_tool的批量模式
+// 每行一个IP，输入为文件（只读mmap）或stdin。输入按行边界切成块，多个工作线程共享
+// 同一个IpChecker分别处理，结果按输入顺序输出为"ip<TAB>国家代码"（查不到为"--"），
+// 空行跳过。结束时在stderr输出各国家的计数、吞吐量和延迟。
+struct BulkOptions {
+    const char* db_path = nullptr;
+    const char* input_path = nullptr;   // nullptr或"-"表示stdin
+    int threads = 0;                    // 工作线程数，0表示按CPU核数
+    bool quiet = false;                 // 不逐行输出结果，只输出汇总
+    bool ipv4_table = false;            // 见IpChecker::Options::ipv4_table
+};
+
+// 返回进程退出码
+int RunBulk(const BulkOptions& options);
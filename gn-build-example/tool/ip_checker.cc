@@ -4,27 +4,391 @@
 #include <string.h>
 #include <stdio.h>
 
-bool is_china_ip(const char* ip, const char* db_path) {
-    MMDB_s mmdb;
-    int status = MMDB_open(db_path, MMDB_MODE_MMAP, &mmdb);
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace {
+
+// LookupCountries每次交给MMDB_lookup_addresses的地址数，相关数组都放在栈上
+constexpr size_t kBatchSize = 256;
+
+const char* const kCountryPath[] = {"country", "iso_code", NULL};
+const char* const kRegisteredCountryPath[] = {"registered_country", "iso_code", NULL};
+const char* const kContinentPath[] = {"continent", "code", NULL};
+const char* const kAsnPath[] = {"autonomous_system_number", NULL};
+
+const char* const* const kCountryPaths[] = {kCountryPath};
+// 顺序与Classify中的字段对应
+const char* const* const kClassifyPaths[] = {kCountryPath, kRegisteredCountryPath,
+                                             kContinentPath, kAsnPath};
+
+// 两个字母的代码写入code（以\0结尾），其他情况返回false
+bool CopyCode(const MMDB_entry_data_s& entry_data, char code[3]) {
+    if (!entry_data.has_data || entry_data.type != MMDB_DATA_TYPE_UTF8_STRING ||
+        entry_data.data_size != 2) {
+        return false;
+    }
+    memcpy(code, entry_data.utf8_string, 2);
+    code[2] = '\0';
+    return true;
+}
+
+// 读取数据记录中的country.iso_code
+void ReadCountry(MMDB_entry_s* entry, const MMDB_projection_s* projection,
+                 IpPrefixCache::Value* value) {
+    MMDB_entry_data_s entry_data;
+    if (MMDB_project(entry, projection, &entry_data) == MMDB_SUCCESS &&
+        CopyCode(entry_data, value->country)) {
+        value->found = true;
+    }
+}
+
+}  // namespace
+
+IpChecker::IpChecker()
+    : mmdb_(nullptr), country_projection_(nullptr), classify_projection_(nullptr) {}
+
+IpChecker::~IpChecker() {
+    Close();
+}
+
+bool IpChecker::Open(const char* db_path) {
+    return Open(db_path, Options());
+}
+
+bool IpChecker::Open(const char* db_path, const Options& options) {
+    Close();
+    std::unique_ptr<MMDB_s> mmdb(new MMDB_s());
+    int status = MMDB_open(db_path, MMDB_MODE_MMAP, mmdb.get());
     if (status != MMDB_SUCCESS) {
         fprintf(stderr, "Failed to open MMDB: %s\n", MMDB_strerror(status));
         return false;
     }
-    int gai_error = 0, mmdb_error = 0;
-    MMDB_lookup_result_s result = MMDB_lookup_string(&mmdb, ip, &gai_error, &mmdb_error);
-    if (gai_error || mmdb_error || !result.found_entry) {
-        MMDB_close(&mmdb);
+    mmdb_ = mmdb.release();
+    status = MMDB_projection_create(kCountryPaths, 1, &country_projection_);
+    if (status == MMDB_SUCCESS) {
+        status = MMDB_projection_create(kClassifyPaths, 4, &classify_projection_);
+    }
+    if (status != MMDB_SUCCESS) {
+        fprintf(stderr, "Failed to compile lookup paths: %s\n", MMDB_strerror(status));
+        Close();
         return false;
     }
-    MMDB_entry_data_s entry_data;
-    int ret = MMDB_get_value(&result.entry, &entry_data, "country", "iso_code", NULL);
-    if (ret == MMDB_SUCCESS && entry_data.has_data && entry_data.type == MMDB_DATA_TYPE_UTF8_STRING) {
-        if (entry_data.data_size == 2 && strncmp(entry_data.utf8_string, "CN", 2) == 0) {
-            MMDB_close(&mmdb);
-            return true;
+    if (options.record_memo_entries > 0) {
+        record_memo_.reset(new RecordMemo<Classification>(options.record_memo_entries));
+    }
+    if (options.cache_entries > 0) {
+        cache_.reset(new IpPrefixCache(options.cache_entries, options.cache_prefix_v4,
+                                       options.cache_prefix_v6));
+    }
+    if (options.ipv4_table) {
+        // 建表失败时仍可使用，IPv4查询退回搜索树
+        ipv4_table_ = Ipv4CountryTable::Build(mmdb_);
+        if (ipv4_table_ && options.verify_ipv4_table) {
+            size_t mismatches = ipv4_table_->Verify(mmdb_);
+            if (mismatches > 0) {
+                fprintf(stderr, "IPv4 table does not match the search tree (%zu networks)\n",
+                        mismatches);
+                ipv4_table_.reset();
+            }
+        }
+    }
+    return true;
+}
+
+void IpChecker::Close() {
+    if (mmdb_) {
+        MMDB_close(mmdb_);
+        delete mmdb_;
+        mmdb_ = nullptr;
+    }
+    MMDB_projection_free(country_projection_);
+    MMDB_projection_free(classify_projection_);
+    country_projection_ = nullptr;
+    classify_projection_ = nullptr;
+    cache_.reset();
+    ipv4_table_.reset();
+    record_memo_.reset();
+}
+
+bool IpChecker::GetDatabaseInfo(DatabaseInfo* info) const {
+    if (!mmdb_) {
+        return false;
+    }
+    info->database_type = mmdb_->metadata.database_type;
+    info->ip_version = mmdb_->metadata.ip_version;
+    info->record_size = mmdb_->metadata.record_size;
+    info->node_count = mmdb_->metadata.node_count;
+    info->build_epoch = mmdb_->metadata.build_epoch;
+    return true;
+}
+
+bool IpChecker::LookupCountry(const char* ip, char country[3]) const {
+    if (!ip) {
+        country[0] = '\0';
+        return false;
+    }
+    return LookupCountry(std::string_view(ip), country);
+}
+
+bool IpChecker::LookupCountry(std::string_view ip, char country[3]) const {
+    country[0] = '\0';
+    if (!mmdb_) {
+        return false;
+    }
+    uint8_t address[16];
+    int family = 0;
+    if (MMDB_parse_address(ip.data(), ip.size(), address, &family) != 0) {
+        return false;
+    }
+    bool is_v4 = family == AF_INET;
+    if (is_v4 && ipv4_table_) {
+        uint32_t ipv4 = uint32_t{address[12]} << 24 | uint32_t{address[13]} << 16 |
+                        uint32_t{address[14]} << 8 | address[15];
+        return ipv4_table_->Lookup(ipv4, country);
+    }
+
+    IpPrefixCache::Value value;
+    if (cache_ && cache_->Find(address, is_v4, &value)) {
+        memcpy(country, value.country, 3);
+        return value.found;
+    }
+
+    // MMDB_lookup_address和MMDB_get_value只读取映射，不修改MMDB_s
+    int mmdb_error = 0;
+    MMDB_lookup_result_s result = MMDB_lookup_address(mmdb_, address, family, &mmdb_error);
+    if (mmdb_error) {
+        return false;
+    }
+    if (result.found_entry) {
+        value = CountryForRecord(&result.entry);
+    }
+    CacheResult(address, is_v4, result.netmask, value);
+    memcpy(country, value.country, 3);
+    return value.found;
+}
+
+void IpChecker::CacheResult(const uint8_t address[16], bool is_v4, int netmask,
+                            const IpPrefixCache::Value& value) const {
+    if (!cache_) {
+        return;
+    }
+    // netmask按数据库的位数计：IPv6数据库中的IPv4地址从第96位开始
+    if (is_v4 && mmdb_->metadata.ip_version == 6) {
+        netmask = netmask > 96 ? netmask - 96 : 0;
+    }
+    cache_->Insert(address, is_v4, netmask, value);
+}
+
+void IpChecker::LookupCountries(const std::string_view* ips, size_t count,
+                                CountryResult* results) const {
+    for (size_t begin = 0; begin < count; begin += kBatchSize) {
+        LookupBatch(ips + begin, std::min(kBatchSize, count - begin), results + begin);
+    }
+}
+
+void IpChecker::LookupBatch(const std::string_view* ips, size_t count,
+                            CountryResult* results) const {
+    uint8_t addresses[kBatchSize][16];
+    int families[kBatchSize];
+    size_t indexes[kBatchSize];
+    size_t pending = 0;
+    for (size_t i = 0; i < count; ++i) {
+        CountryResult& result = results[i];
+        result = CountryResult();
+        if (!mmdb_ || MMDB_parse_address(ips[i].data(), ips[i].size(), addresses[pending],
+                                         &families[pending]) != 0) {
+            continue;
         }
+        bool is_v4 = families[pending] == AF_INET;
+        const uint8_t* address = addresses[pending];
+        if (is_v4 && ipv4_table_) {
+            uint32_t ipv4 = uint32_t{address[12]} << 24 | uint32_t{address[13]} << 16 |
+                            uint32_t{address[14]} << 8 | address[15];
+            result.found = ipv4_table_->Lookup(ipv4, result.country);
+            continue;
+        }
+        IpPrefixCache::Value value;
+        if (cache_ && cache_->Find(address, is_v4, &value)) {
+            result.found = value.found;
+            memcpy(result.country, value.country, 3);
+            continue;
+        }
+        indexes[pending++] = i;
+    }
+    if (pending == 0) {
+        return;
+    }
+
+    MMDB_lookup_result_s lookups[kBatchSize];
+    int errors[kBatchSize];
+    MMDB_lookup_addresses(mmdb_, addresses[0], families, pending, lookups, errors);
+
+    // 先为所有数据记录发出预取，再一次遍历解码；同一条数据记录的解码结果按偏移缓存
+#if defined(__GNUC__) || defined(__clang__)
+    for (size_t j = 0; j < pending; ++j) {
+        if (errors[j] == MMDB_SUCCESS && lookups[j].found_entry) {
+            __builtin_prefetch(mmdb_->data_section + lookups[j].entry.offset);
+        }
+    }
+#endif
+    for (size_t j = 0; j < pending; ++j) {
+        if (errors[j] != MMDB_SUCCESS) {
+            continue;
+        }
+        IpPrefixCache::Value value;
+        if (lookups[j].found_entry) {
+            value = CountryForRecord(&lookups[j].entry);
+        }
+        CountryResult& result = results[indexes[j]];
+        result.found = value.found;
+        memcpy(result.country, value.country, 3);
+        CacheResult(addresses[j], families[j] == AF_INET, lookups[j].netmask, value);
+    }
+}
+
+bool IpChecker::Classify(std::string_view ip, Classification* classification) const {
+    *classification = Classification();
+    if (!mmdb_) {
+        return false;
+    }
+    uint8_t address[16];
+    int family = 0;
+    if (MMDB_parse_address(ip.data(), ip.size(), address, &family) != 0) {
+        return false;
+    }
+    int mmdb_error = 0;
+    MMDB_lookup_result_s result = MMDB_lookup_address(mmdb_, address, family, &mmdb_error);
+    if (mmdb_error || !result.found_entry) {
+        return false;
+    }
+    return ClassifyRecord(&result.entry, classification);
+}
+
+IpPrefixCache::Value IpChecker::CountryForRecord(MMDB_entry_s* entry) const {
+    IpPrefixCache::Value value;
+    if (!record_memo_) {
+        ReadCountry(entry, country_projection_, &value);
+        return value;
+    }
+    // 启用缓存时整条记录只解码一次，国家代码从完整的分类结果中取
+    Classification classification;
+    if (ClassifyRecord(entry, &classification) && classification.country[0] != '\0') {
+        memcpy(value.country, classification.country, 3);
+        value.found = true;
+    }
+    return value;
+}
+
+bool IpChecker::ClassifyRecord(MMDB_entry_s* entry, Classification* classification) const {
+    if (record_memo_ && record_memo_->Find(entry->offset, classification)) {
+        return true;
+    }
+    MMDB_entry_data_s fields[4];
+    if (MMDB_project(entry, classify_projection_, fields) != MMDB_SUCCESS) {
+        return false;
+    }
+    CopyCode(fields[0], classification->country);
+    CopyCode(fields[1], classification->registered_country);
+    CopyCode(fields[2], classification->continent);
+    if (fields[3].has_data && fields[3].type == MMDB_DATA_TYPE_UINT32) {
+        classification->asn = fields[3].uint32;
+    }
+    if (record_memo_) {
+        record_memo_->Insert(entry->offset, *classification);
+    }
+    return true;
+}
+
+bool IpChecker::IsChinaIp(const char* ip) const {
+    char country[3];
+    return LookupCountry(ip, country) && strcmp(country, "CN") == 0;
+}
+
+bool IpChecker::IsChinaIp(std::string_view ip) const {
+    char country[3];
+    return LookupCountry(ip, country) && strcmp(country, "CN") == 0;
+}
+
+RecordMemo<IpChecker::Classification>::Stats IpChecker::GetRecordMemoStats() const {
+    return record_memo_ ? record_memo_->GetStats() : RecordMemo<Classification>::Stats();
+}
+
+IpPrefixCache::Stats IpChecker::GetCacheStats() const {
+    return cache_ ? cache_->GetStats() : IpPrefixCache::Stats();
+}
+
+const Ipv4CountryTable::Stats* IpChecker::GetIpv4TableStats() const {
+    return ipv4_table_ ? &ipv4_table_->GetStats() : nullptr;
+}
+
+struct ip_checker {
+    IpChecker checker;
+};
+
+ip_checker* ip_checker_open(const char* db_path) {
+    std::unique_ptr<ip_checker> handle(new ip_checker());
+    if (!handle->checker.Open(db_path)) {
+        return NULL;
+    }
+    return handle.release();
+}
+
+void ip_checker_close(ip_checker* checker) {
+    delete checker;
+}
+
+bool ip_checker_lookup_country(const ip_checker* checker, const char* ip, char country[3]) {
+    if (!checker) {
+        country[0] = '\0';
+        return false;
+    }
+    return checker->checker.LookupCountry(ip, country);
+}
+
+bool ip_checker_lookup_country_n(const ip_checker* checker, const char* ip, size_t length,
+                                 char country[3]) {
+    if (!checker || (!ip && length > 0)) {
+        country[0] = '\0';
+        return false;
+    }
+    return checker->checker.LookupCountry(std::string_view(ip, length), country);
+}
+
+bool ip_checker_is_china_ip(const ip_checker* checker, const char* ip) {
+    return checker && checker->checker.IsChinaIp(ip);
+}
+
+namespace {
+
+// is_china_ip按路径缓存的查询对象，进程退出前不关闭，返回的指针一直有效
+const IpChecker* SharedChecker(const char* db_path) {
+    static std::mutex mutex;
+    static std::map<std::string, std::unique_ptr<IpChecker>>* checkers =
+        new std::map<std::string, std::unique_ptr<IpChecker>>();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = checkers->find(db_path);
+    if (it != checkers->end()) {
+        return it->second.get();
+    }
+    // 打开失败不缓存，下次调用重试
+    std::unique_ptr<IpChecker> checker(new IpChecker());
+    if (!checker->Open(db_path)) {
+        return nullptr;
+    }
+    return checkers->emplace(db_path, std::move(checker)).first->second.get();
+}
+
+}  // namespace
+
+bool is_china_ip(const char* ip, const char* db_path) {
+    if (!db_path) {
+        return false;
     }
-    MMDB_close(&mmdb);
-    return false;
+    const IpChecker* checker = SharedChecker(db_path);
+    return checker && checker->IsChinaIp(ip);
 }
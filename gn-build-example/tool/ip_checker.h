@@ -1,11 +1,139 @@
 #pragma once
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
+
+#include <memory>
+#include <string_view>
+
+#include "ip_prefix_cache.h"
+#include "ipv4_table.h"
+#include "record_memo.h"
+
+struct MMDB_s;
+struct MMDB_projection_s;
+struct MMDB_entry_s;
+
+// 常驻的IP查询对象
+// Open()时打开一次GeoIP2数据库（只读mmap并解析元数据），之后的查询只读共享映射，
+// 不加锁，同一个对象可以在多个线程间并发使用。Open()和析构不能与查询并发
+class IpChecker {
+public:
+    struct Options {
+        size_t cache_entries = 65536;   // 网段结果缓存的槽位数，0表示不缓存
+        int cache_prefix_v4 = 24;       // 缓存粒度，见IpPrefixCache
+        int cache_prefix_v6 = 48;
+        // 打开时把IPv4子树展开成直接索引表（64MB加上每个细分的/24网段256字节），IPv4查询不再遍历搜索树
+        bool ipv4_table = false;
+        bool verify_ipv4_table = false;  // 建表后对照搜索树检查每个网段
+        // 按数据记录偏移缓存解码结果的槽位数（每个24字节），0表示每次都解码
+        size_t record_memo_entries = 65536;
+    };
+
+    struct CountryResult {
+        bool found = false;       // 查到国家代码
+        char country[3] = {};     // ISO国家代码，以\0结尾
+    };
+
+    // 数据库中没有的字段为空字符串或0；16字节，可整个存入RecordMemo
+    struct Classification {
+        char country[3] = {};             // country.iso_code
+        char registered_country[3] = {};  // registered_country.iso_code
+        char continent[3] = {};           // continent.code
+        uint32_t asn = 0;                 // autonomous_system_number
+    };
+
+    // 数据库元数据，database_type指向映射中的元数据，数据库关闭前有效
+    struct DatabaseInfo {
+        const char* database_type = nullptr;
+        uint16_t ip_version = 0;
+        uint16_t record_size = 0;
+        uint32_t node_count = 0;
+        uint64_t build_epoch = 0;
+    };
+
+    IpChecker();
+    ~IpChecker();
+
+    IpChecker(const IpChecker&) = delete;
+    IpChecker& operator=(const IpChecker&) = delete;
+
+    // 打开数据库，失败时返回false并在stderr输出原因
+    bool Open(const char* db_path);
+    bool Open(const char* db_path, const Options& options);
+
+    bool IsOpen() const { return mmdb_ != nullptr; }
+
+    // 查询ip所属国家的ISO代码，写入country（以\0结尾），查到返回true
+    // 规范格式的IP直接解析，不经过getaddrinfo，也不分配内存
+    bool LookupCountry(std::string_view ip, char country[3]) const;
+    bool LookupCountry(const char* ip, char country[3]) const;
+
+    // 批量查询，结果与逐个调用LookupCountry相同，results至少count项
+    // 未命中缓存的地址交给MMDB_lookup_addresses交错遍历搜索树，再一次性解码数据记录，
+    // 适合日志等大批量分类
+    void LookupCountries(const std::string_view* ips, size_t count, CountryResult* results) const;
+
+    // 一次遍历数据记录取出Classification的全部字段，查到记录返回true
+    // 不经过网段缓存和IPv4直接索引表，数据记录的解码结果仍按偏移缓存
+    bool Classify(std::string_view ip, Classification* classification) const;
+
+    // 检查IP是否为中国IP
+    bool IsChinaIp(std::string_view ip) const;
+    bool IsChinaIp(const char* ip) const;
+
+    // 未打开时返回false
+    bool GetDatabaseInfo(DatabaseInfo* info) const;
+
+    // 网段缓存的命中统计，未启用缓存时全为0
+    IpPrefixCache::Stats GetCacheStats() const;
+
+    // 数据记录解码结果缓存的占用，未启用时全为0
+    RecordMemo<Classification>::Stats GetRecordMemoStats() const;
+
+    // IPv4直接索引表的建表统计，未启用时返回nullptr
+    const Ipv4CountryTable::Stats* GetIpv4TableStats() const;
+
+private:
+    void Close();
+    void LookupBatch(const std::string_view* ips, size_t count, CountryResult* results) const;
+    IpPrefixCache::Value CountryForRecord(MMDB_entry_s* entry) const;
+    bool ClassifyRecord(MMDB_entry_s* entry, Classification* classification) const;
+    void CacheResult(const uint8_t address[16], bool is_v4, int netmask,
+                     const IpPrefixCache::Value& value) const;
+
+    MMDB_s* mmdb_;
+    // Open()时编译的取值路径：只取国家代码，和Classify用的全部字段
+    MMDB_projection_s* country_projection_;
+    MMDB_projection_s* classify_projection_;
+    std::unique_ptr<IpPrefixCache> cache_;
+    std::unique_ptr<Ipv4CountryTable> ipv4_table_;
+    std::unique_ptr<RecordMemo<Classification>> record_memo_;
+};
+
 extern "C" {
 #endif
 
+// C接口，对应IpChecker
+typedef struct ip_checker ip_checker;
+
+// 打开数据库，失败返回NULL
+ip_checker* ip_checker_open(const char* db_path);
+
+void ip_checker_close(ip_checker* checker);
+
+// 查询国家ISO代码，country至少3字节；查到返回true
+bool ip_checker_lookup_country(const ip_checker* checker, const char* ip, char country[3]);
+
+// 同上，ip为长度为length的缓冲区，不要求以\0结尾
+bool ip_checker_lookup_country_n(const ip_checker* checker, const char* ip, size_t length,
+                                 char country[3]);
+
+bool ip_checker_is_china_ip(const ip_checker* checker, const char* ip);
+
 // 检查IP是否为中国IP，db_path为GeoIP2数据库路径
+// 兼容旧接口：每个db_path只在首次调用时打开，之后复用常驻的IpChecker
 bool is_china_ip(const char* ip, const char* db_path);
 
 #ifdef __cplusplus
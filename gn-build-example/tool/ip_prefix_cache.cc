@@ -0,0 +1,171 @@
+#include "ip_prefix_cache.h"
+
+namespace {
+
+constexpr size_t kMaxShards = 64;
+
+// 64位混合函数（splitmix64的收尾步骤）
+uint64_t Mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+uint64_t ReadBigEndian64(const uint8_t* p) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+// 保留高prefix位
+uint64_t MaskHigh(uint64_t value, int prefix) {
+    if (prefix <= 0) return 0;
+    if (prefix >= 64) return value;
+    return value & ~(~0ULL >> prefix);
+}
+
+}  // namespace
+
+// 槽位：seq为奇数时正在写入；meta低8位为键的前缀长度+1，其后为国家代码和found标志
+struct IpPrefixCache::Slot {
+    std::atomic<uint32_t> seq{0};
+    std::atomic<uint32_t> meta{0};
+    std::atomic<uint64_t> high{0};
+    std::atomic<uint64_t> low{0};
+};
+
+struct alignas(64) IpPrefixCache::Shard {
+    mutable std::atomic<uint64_t> hits{0};
+    mutable std::atomic<uint64_t> misses{0};
+};
+
+IpPrefixCache::IpPrefixCache(size_t capacity, int prefix_v4, int prefix_v6)
+    : prefix_v4_(prefix_v4 < 0 || prefix_v4 > 32 ? 24 : prefix_v4),
+      prefix_v6_(prefix_v6 < 0 || prefix_v6 > 128 ? 48 : prefix_v6) {
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    mask_ = size - 1;
+    shard_count_ = size < kMaxShards ? size : kMaxShards;
+    int slot_bits = 0;
+    while ((size_t{1} << slot_bits) < size) {
+        slot_bits++;
+    }
+    int shard_bits = 0;
+    while ((size_t{1} << shard_bits) < shard_count_) {
+        shard_bits++;
+    }
+    shard_shift_ = slot_bits - shard_bits;
+    slots_.reset(new Slot[size]);
+    shards_.reset(new Shard[shard_count_]);
+}
+
+IpPrefixCache::~IpPrefixCache() = default;
+
+IpPrefixCache::Key IpPrefixCache::MakeKey(const uint8_t address[16], bool is_v4,
+                                          int prefix) const {
+    Key key;
+    // IPv4只用最后4字节，前缀换算到128位地址空间
+    int bits = is_v4 ? 96 + prefix : prefix;
+    key.high = MaskHigh(ReadBigEndian64(address), bits);
+    key.low = MaskHigh(ReadBigEndian64(address + 8), bits - 64);
+    key.prefix = static_cast<uint32_t>(bits) + 1;
+    return key;
+}
+
+size_t IpPrefixCache::SlotIndex(const Key& key) const {
+    return Mix(key.high * 0x9e3779b97f4a7c15ULL ^ key.low ^ (uint64_t{key.prefix} << 56)) &
+           mask_;
+}
+
+bool IpPrefixCache::Probe(const Key& key, Value* value) const {
+    const Slot& slot = slots_[SlotIndex(key)];
+    uint32_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq & 1) {
+        return false;
+    }
+    uint32_t meta = slot.meta.load(std::memory_order_relaxed);
+    uint64_t high = slot.high.load(std::memory_order_relaxed);
+    uint64_t low = slot.low.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) != seq) {
+        return false;
+    }
+    if ((meta & 0xff) != key.prefix || high != key.high || low != key.low) {
+        return false;
+    }
+    value->found = (meta >> 24) & 1;
+    value->country[0] = static_cast<char>((meta >> 8) & 0xff);
+    value->country[1] = static_cast<char>((meta >> 16) & 0xff);
+    value->country[2] = '\0';
+    return true;
+}
+
+void IpPrefixCache::Store(const Key& key, const Value& value) {
+    Slot& slot = slots_[SlotIndex(key)];
+    uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+    // 其他线程正在写这个槽位时放弃，结果下次再缓存
+    if ((seq & 1) ||
+        !slot.seq.compare_exchange_strong(seq, seq + 1, std::memory_order_relaxed)) {
+        return;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    uint32_t meta = key.prefix |
+                    (uint32_t{static_cast<uint8_t>(value.country[0])} << 8) |
+                    (uint32_t{static_cast<uint8_t>(value.country[1])} << 16) |
+                    (value.found ? 1u << 24 : 0u);
+    slot.meta.store(meta, std::memory_order_relaxed);
+    slot.high.store(key.high, std::memory_order_relaxed);
+    slot.low.store(key.low, std::memory_order_relaxed);
+    slot.seq.store(seq + 2, std::memory_order_release);
+}
+
+bool IpPrefixCache::Find(const uint8_t address[16], bool is_v4, Value* value) const {
+    int coarse = is_v4 ? prefix_v4_ : prefix_v6_;
+    Key coarse_key = MakeKey(address, is_v4, coarse);
+    const Shard& shard = shards_[SlotIndex(coarse_key) >> shard_shift_];
+    if (Probe(coarse_key, value) || Probe(MakeKey(address, is_v4, is_v4 ? 32 : 128), value)) {
+        shard.hits.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    shard.misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void IpPrefixCache::Insert(const uint8_t address[16], bool is_v4, int network_prefix,
+                           const Value& value) {
+    int coarse = is_v4 ? prefix_v4_ : prefix_v6_;
+    int exact = is_v4 ? 32 : 128;
+    // 网段覆盖整个缓存粒度时按粒度缓存，否则只缓存这个地址
+    Store(MakeKey(address, is_v4, network_prefix <= coarse ? coarse : exact), value);
+}
+
+void IpPrefixCache::Clear() {
+    for (size_t i = 0; i <= mask_; ++i) {
+        Slot& slot = slots_[i];
+        // 与Store相同的写入协议，只是不放弃：等正在写的线程结束
+        uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+        while ((seq & 1) ||
+               !slot.seq.compare_exchange_weak(seq, seq + 1, std::memory_order_relaxed)) {
+            seq = slot.seq.load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.meta.store(0, std::memory_order_relaxed);
+        slot.seq.store(seq + 2, std::memory_order_release);
+    }
+}
+
+IpPrefixCache::Stats IpPrefixCache::GetStats() const {
+    Stats stats;
+    for (size_t i = 0; i < shard_count_; ++i) {
+        stats.hits += shards_[i].hits.load(std::memory_order_relaxed);
+        stats.misses += shards_[i].misses.load(std::memory_order_relaxed);
+    }
+    stats.capacity = mask_ + 1;
+    return stats;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+
+// 按网段缓存IP查询结果
+// 数据库查询结果带有所属网段的前缀长度：网段覆盖整个缓存粒度（IPv4默认/24，IPv6默认/48）
+// 时以该粒度的网段为键，同一网段内的地址共用一条；网段更细时以单个地址为键。
+// 查找时先查粒度网段，再查单个地址。
+//
+// 容量在构造时固定，按哈希直接映射，冲突时覆盖旧条目。每个槽位带一个序号（seqlock），
+// 读不加锁，读到写了一半的槽位时当作未命中；两个线程同时写同一个槽位时后到的放弃。
+// 槽位按分片划分，命中/未命中计数按分片分别累加，避免所有线程争用同一个计数器。
+class IpPrefixCache {
+public:
+    struct Value {
+        bool found = false;       // 数据库中是否有国家代码
+        char country[3] = {};     // ISO国家代码，以\0结尾
+    };
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        size_t capacity = 0;      // 槽位数
+    };
+
+    // capacity向上取整到2的幂；prefix_v4/v6为缓存粒度
+    IpPrefixCache(size_t capacity, int prefix_v4, int prefix_v6);
+    ~IpPrefixCache();
+
+    IpPrefixCache(const IpPrefixCache&) = delete;
+    IpPrefixCache& operator=(const IpPrefixCache&) = delete;
+
+    // address为MMDB_parse_address给出的16字节地址，IPv4在最后4字节
+    bool Find(const uint8_t address[16], bool is_v4, Value* value) const;
+
+    // network_prefix为结果所属网段的前缀长度，按地址族计（IPv4为0~32）
+    void Insert(const uint8_t address[16], bool is_v4, int network_prefix, const Value& value);
+
+    // 清空全部条目，可与查找并发
+    void Clear();
+
+    Stats GetStats() const;
+
+private:
+    struct Slot;
+    struct Shard;
+    struct Key {
+        uint64_t high;
+        uint64_t low;
+        uint32_t prefix;          // 键的前缀长度+1，0表示空槽位
+    };
+
+    Key MakeKey(const uint8_t address[16], bool is_v4, int prefix) const;
+    size_t SlotIndex(const Key& key) const;
+    bool Probe(const Key& key, Value* value) const;
+    void Store(const Key& key, const Value& value);
+
+    int prefix_v4_;
+    int prefix_v6_;
+    size_t mask_;
+    int shard_shift_;
+    std::unique_ptr<Slot[]> slots_;
+    std::unique_ptr<Shard[]> shards_;
+    size_t shard_count_;
+};
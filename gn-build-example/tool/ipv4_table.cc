@@ -0,0 +1,186 @@
+#include "ipv4_table.h"
+#include <stdio.h>
+#include <string.h>
+#include "maxminddb.h"
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+namespace {
+
+constexpr size_t kLevel1Size = size_t{1} << 24;
+constexpr size_t kMaxCodes = 256;
+// 搜索树与数据段之间的16个零字节，数据记录值减去node_count和它得到数据段内偏移
+constexpr uint64_t kDataSectionSeparator = 16;
+
+// 读取数据记录中的country.iso_code，没有时返回false
+bool ReadCountry(const MMDB_s* mmdb, uint32_t offset, char country[2]) {
+    MMDB_entry_s entry = {mmdb, offset};
+    MMDB_entry_data_s entry_data;
+    int ret = MMDB_get_value(&entry, &entry_data, "country", "iso_code", NULL);
+    if (ret != MMDB_SUCCESS || !entry_data.has_data ||
+        entry_data.type != MMDB_DATA_TYPE_UTF8_STRING || entry_data.data_size != 2) {
+        return false;
+    }
+    memcpy(country, entry_data.utf8_string, 2);
+    return true;
+}
+
+// 深度优先遍历IPv4子树，对每个叶子记录调用visit(base, depth, record)：
+// base为网段首地址（主机字节序），depth为前缀长度，record为原始记录值
+// （等于node_count表示空记录，更大的是数据记录）。搜索树损坏时返回false
+template <typename Visit>
+bool WalkRecord(const MMDB_s* mmdb, uint64_t record, uint32_t base, int depth, Visit& visit) {
+    uint32_t node_count = mmdb->metadata.node_count;
+    if (record >= node_count) {
+        if (record >= uint64_t{node_count} + mmdb->data_section_size) {
+            return false;
+        }
+        return visit(base, depth, record);
+    }
+    if (depth >= 32) {
+        return false;
+    }
+    MMDB_search_node_s node;
+    if (MMDB_read_node(mmdb, static_cast<uint32_t>(record), &node) != MMDB_SUCCESS) {
+        return false;
+    }
+    return WalkRecord(mmdb, node.left_record, base, depth + 1, visit) &&
+           WalkRecord(mmdb, node.right_record, base | (1u << (31 - depth)), depth + 1, visit);
+}
+
+template <typename Visit>
+bool WalkIpv4(const MMDB_s* mmdb, Visit visit) {
+    // IPv6数据库的IPv4子树从::/96开始；树不到96层时整个IPv4空间落在同一条记录里
+    uint64_t root = mmdb->metadata.ip_version == 6 ? mmdb->ipv4_start_node.node_value : 0;
+    return WalkRecord(mmdb, root, 0, 0, visit);
+}
+
+uint32_t DataOffset(const MMDB_s* mmdb, uint64_t record) {
+    return static_cast<uint32_t>(record - mmdb->metadata.node_count - kDataSectionSeparator);
+}
+
+}  // namespace
+
+Ipv4CountryTable::Ipv4CountryTable() = default;
+
+Ipv4CountryTable::~Ipv4CountryTable() = default;
+
+std::unique_ptr<Ipv4CountryTable> Ipv4CountryTable::Build(const MMDB_s* mmdb) {
+    auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<Ipv4CountryTable> table(new Ipv4CountryTable());
+    table->level1_.reset(new uint32_t[kLevel1Size]());
+    table->countries_.push_back({'\0', '\0'});
+
+    // 同一条数据记录被很多网段引用，按偏移量只解码一次
+    std::unordered_map<uint32_t, uint8_t> codes_by_offset;
+    std::unordered_map<uint16_t, uint8_t> codes_by_country;
+    const char* error = nullptr;
+
+    auto code_for = [&](uint64_t record, uint8_t* code) {
+        if (record == mmdb->metadata.node_count) {
+            *code = 0;
+            return true;
+        }
+        uint32_t offset = DataOffset(mmdb, record);
+        auto it = codes_by_offset.find(offset);
+        if (it != codes_by_offset.end()) {
+            *code = it->second;
+            return true;
+        }
+        char country[2];
+        *code = 0;
+        if (ReadCountry(mmdb, offset, country)) {
+            uint16_t key = static_cast<uint16_t>(static_cast<uint8_t>(country[0]) << 8 |
+                                                 static_cast<uint8_t>(country[1]));
+            auto found = codes_by_country.find(key);
+            if (found != codes_by_country.end()) {
+                *code = found->second;
+            } else if (table->countries_.size() < kMaxCodes) {
+                *code = static_cast<uint8_t>(table->countries_.size());
+                table->countries_.push_back({country[0], country[1]});
+                codes_by_country.emplace(key, *code);
+            } else {
+                error = "too many distinct country codes";
+                return false;
+            }
+        }
+        codes_by_offset.emplace(offset, *code);
+        return true;
+    };
+
+    auto fill = [&](uint32_t base, int depth, uint64_t record) {
+        uint8_t code;
+        if (!code_for(record, &code)) {
+            return false;
+        }
+        table->stats_.networks++;
+        uint32_t* level1 = table->level1_.get();
+        if (depth <= 24) {
+            std::fill_n(level1 + (base >> 8), size_t{1} << (24 - depth), code);
+            return true;
+        }
+        // 比/24更细的网段：遍历是深度优先的，同一个/24下的叶子连续出现，
+        // 第一次遇到时分配第二级块；每个/24最多一块，块号不会超出32位条目
+        uint32_t& entry = level1[base >> 8];
+        if (entry < 256) {
+            size_t blocks = table->level2_.size() >> 8;
+            table->level2_.resize(table->level2_.size() + 256);
+            entry = static_cast<uint32_t>(256 + blocks);
+        }
+        uint8_t* block = &table->level2_[(size_t{entry} - 256) << 8];
+        std::fill_n(block + (base & 0xff), size_t{1} << (32 - depth), code);
+        return true;
+    };
+
+    if (!WalkIpv4(mmdb, fill)) {
+        fprintf(stderr, "Failed to build IPv4 table: %s\n",
+                error ? error : MMDB_strerror(MMDB_CORRUPT_SEARCH_TREE_ERROR));
+        return nullptr;
+    }
+    table->level2_.shrink_to_fit();
+
+    Stats& stats = table->stats_;
+    stats.blocks = table->level2_.size() >> 8;
+    stats.countries = table->countries_.size() - 1;
+    stats.bytes = kLevel1Size * sizeof(uint32_t) + table->level2_.size() +
+                  table->countries_.size() * sizeof(table->countries_[0]);
+    stats.build_ms = std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - start).count();
+    return table;
+}
+
+size_t Ipv4CountryTable::Verify(const MMDB_s* mmdb) const {
+    size_t mismatches = 0;
+    auto check_address = [&](uint32_t ip) {
+        uint8_t address[16] = {};
+        address[12] = static_cast<uint8_t>(ip >> 24);
+        address[13] = static_cast<uint8_t>(ip >> 16);
+        address[14] = static_cast<uint8_t>(ip >> 8);
+        address[15] = static_cast<uint8_t>(ip);
+        int mmdb_error = 0;
+        MMDB_lookup_result_s result = MMDB_lookup_address(mmdb, address, AF_INET, &mmdb_error);
+        char expected[2] = {};
+        bool expected_found = mmdb_error == MMDB_SUCCESS && result.found_entry &&
+                              ReadCountry(mmdb, result.entry.offset, expected);
+        char actual[3];
+        bool actual_found = Lookup(ip, actual);
+        return actual_found == expected_found &&
+               (!actual_found || memcmp(actual, expected, 2) == 0);
+    };
+    auto check = [&](uint32_t base, int depth, uint64_t) {
+        uint32_t last = base | (depth >= 32 ? 0 : ~0u >> depth);
+        if (!check_address(base) || !check_address(last)) {
+            if (++mismatches <= 10) {
+                fprintf(stderr, "IPv4 table mismatch: %u.%u.%u.%u/%d\n", base >> 24,
+                        (base >> 16) & 0xff, (base >> 8) & 0xff, base & 0xff, depth);
+            }
+        }
+        return true;
+    };
+    if (!WalkIpv4(mmdb, check)) {
+        mismatches++;
+    }
+    return mismatches;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+struct MMDB_s;
+
+// IPv4国家代码直接索引表（DIR-24-8）
+// 打开数据库后把IPv4子树（IPv6数据库从ipv4_start_node开始）展开成两级表：
+// 第一级按地址高24位索引，共2^24个32位条目，值小于256时就是国家编号，
+// 否则指向一个256项的第二级块（按低8位索引，每项为国家编号），用于比/24更细的网段。
+// 查询最多两次内存访问，不再逐位遍历搜索树。
+//
+// 国家编号0表示数据库中没有国家代码，其余编号对应countries_中的ISO代码，最多255个。
+// 第一级固定64MB，第二级每块256字节，按比/24更细的/24网段数分配。表建好后只读，可多线程共享。
+class Ipv4CountryTable {
+public:
+    struct Stats {
+        size_t networks = 0;      // IPv4子树中的网段（叶子记录）数
+        size_t blocks = 0;        // 第二级块数
+        size_t countries = 0;     // 不同的国家代码数
+        size_t bytes = 0;         // 两级表占用的内存
+        double build_ms = 0;      // 建表耗时
+    };
+
+    // 从数据库建表，失败时返回nullptr并在stderr输出原因
+    static std::unique_ptr<Ipv4CountryTable> Build(const MMDB_s* mmdb);
+
+    ~Ipv4CountryTable();
+
+    Ipv4CountryTable(const Ipv4CountryTable&) = delete;
+    Ipv4CountryTable& operator=(const Ipv4CountryTable&) = delete;
+
+    // ip为主机字节序的IPv4地址，查到国家代码返回true
+    bool Lookup(uint32_t ip, char country[3]) const {
+        uint32_t entry = level1_[ip >> 8];
+        uint8_t code = entry < 256 ? static_cast<uint8_t>(entry)
+                                   : level2_[(size_t{entry} - 256) << 8 | (ip & 0xff)];
+        country[0] = countries_[code][0];
+        country[1] = countries_[code][1];
+        country[2] = '\0';
+        return code != 0;
+    }
+
+    // 对照搜索树逐个检查每个网段的首尾地址，返回不一致的网段数
+    size_t Verify(const MMDB_s* mmdb) const;
+
+    const Stats& GetStats() const { return stats_; }
+
+private:
+    Ipv4CountryTable();
+
+    std::unique_ptr<uint32_t[]> level1_;
+    std::vector<uint8_t> level2_;
+    std::vector<std::array<char, 2>> countries_;
+    Stats stats_;
+};
@@ -1,14 +1,68 @@
+#include "bulk_mode.h"
 #include "ip_checker.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+void PrintUsage(const char* program) {
+    printf("Usage: %s <ip> <mmdb_path>\n", program);
+    printf("       %s --bulk <mmdb_path> [input_file|-] [--threads N] [--quiet] [--ipv4-table]\n",
+           program);
+}
+
+// 解析--bulk之后的参数，失败返回false
+bool ParseBulkOptions(int argc, char* argv[], BulkOptions* options) {
+    for (int i = 2; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--threads") == 0) {
+            if (i + 1 >= argc) {
+                return false;
+            }
+            options->threads = atoi(argv[++i]);
+            if (options->threads <= 0) {
+                return false;
+            }
+        } else if (strcmp(arg, "--quiet") == 0) {
+            options->quiet = true;
+        } else if (strcmp(arg, "--ipv4-table") == 0) {
+            options->ipv4_table = true;
+        } else if (arg[0] == '-' && arg[1] == '-') {
+            return false;
+        } else if (!options->db_path) {
+            options->db_path = arg;
+        } else if (!options->input_path) {
+            options->input_path = arg;
+        } else {
+            return false;
+        }
+    }
+    return options->db_path != nullptr;
+}
+
+}  // namespace
 
 int main(int argc, char* argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "--bulk") == 0) {
+        BulkOptions options;
+        if (!ParseBulkOptions(argc, argv, &options)) {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+        return RunBulk(options);
+    }
     if (argc != 3) {
-        printf("Usage: %s <ip> <mmdb_path>\n", argv[0]);
+        PrintUsage(argv[0]);
         return 1;
     }
     const char* ip = argv[1];
     const char* db_path = argv[2];
-    if (is_china_ip(ip, db_path)) {
+    IpChecker checker;
+    if (!checker.Open(db_path)) {
+        return 1;
+    }
+    if (checker.IsChinaIp(ip)) {
         printf("%s is a China IP.\n", ip);
     } else {
         printf("%s is NOT a China IP.\n", ip);
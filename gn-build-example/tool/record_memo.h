@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+#include <memory>
+#include <type_traits>
+
+// 按数据记录偏移缓存解码结果
+// GeoIP数据库中大量网段指向同一条数据记录（每个国家/城市一条），同一条记录只需解码一次。
+// 第一次遇到某条记录时解码并存入，之后遍历完搜索树只需按entry.offset读一个槽位。
+//
+// 容量在构造时固定，按偏移哈希直接映射，冲突时覆盖旧条目。槽位与IpPrefixCache一样带序号，
+// 读不加锁，读到写了一半的槽位时当作未命中。T须可平凡复制且不超过16字节。
+// 结果只对构造时对应的那个数据库有效，重新打开数据库时随之重建。
+template <typename T>
+class RecordMemo {
+    static_assert(std::is_trivially_copyable<T>::value && sizeof(T) <= 16,
+                  "RecordMemo stores T in two 64-bit words");
+
+public:
+    struct Stats {
+        size_t capacity = 0;      // 槽位数
+        size_t used = 0;          // 存过结果的槽位数
+        size_t bytes = 0;         // 槽位占用的内存
+    };
+
+    // capacity向上取整到2的幂
+    explicit RecordMemo(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask_ = size - 1;
+        slots_.reset(new Slot[size]);
+    }
+
+    RecordMemo(const RecordMemo&) = delete;
+    RecordMemo& operator=(const RecordMemo&) = delete;
+
+    bool Find(uint32_t offset, T* value) const {
+        const Slot& slot = slots_[SlotIndex(offset)];
+        uint32_t seq = slot.seq.load(std::memory_order_acquire);
+        if (seq & 1) {
+            return false;
+        }
+        uint32_t key = slot.key.load(std::memory_order_relaxed);
+        uint64_t words[2] = {slot.words[0].load(std::memory_order_relaxed),
+                             slot.words[1].load(std::memory_order_relaxed)};
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != seq || key != offset + 1) {
+            return false;
+        }
+        memcpy(value, words, sizeof(T));
+        return true;
+    }
+
+    void Insert(uint32_t offset, const T& value) {
+        Slot& slot = slots_[SlotIndex(offset)];
+        uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+        // 其他线程正在写这个槽位时放弃
+        if ((seq & 1) ||
+            !slot.seq.compare_exchange_strong(seq, seq + 1, std::memory_order_relaxed)) {
+            return;
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        uint64_t words[2] = {};
+        memcpy(words, &value, sizeof(T));
+        if (slot.key.exchange(offset + 1, std::memory_order_relaxed) == 0) {
+            used_.fetch_add(1, std::memory_order_relaxed);
+        }
+        slot.words[0].store(words[0], std::memory_order_relaxed);
+        slot.words[1].store(words[1], std::memory_order_relaxed);
+        slot.seq.store(seq + 2, std::memory_order_release);
+    }
+
+    Stats GetStats() const {
+        Stats stats;
+        stats.capacity = mask_ + 1;
+        stats.used = used_.load(std::memory_order_relaxed);
+        stats.bytes = stats.capacity * sizeof(Slot);
+        return stats;
+    }
+
+private:
+    // key为偏移+1，0表示空槽位
+    struct Slot {
+        std::atomic<uint32_t> seq{0};
+        std::atomic<uint32_t> key{0};
+        std::atomic<uint64_t> words[2] = {};
+    };
+
+    size_t SlotIndex(uint32_t offset) const {
+        return (uint64_t{offset} * 0x9e3779b97f4a7c15ULL) >> 32 & mask_;
+    }
+
+    size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<size_t> used_{0};
+};
@@ -0,0 +1,119 @@
+#include "reloadable_ip_checker.h"
+#include <stdio.h>
+#include <string.h>
+
+#include <thread>
+
+ReloadableIpChecker::ReloadableIpChecker() = default;
+
+ReloadableIpChecker::ReloadableIpChecker(const IpChecker::Options& options) : options_(options) {}
+
+ReloadableIpChecker::~ReloadableIpChecker() {
+    delete current_.load(std::memory_order_relaxed);
+}
+
+bool ReloadableIpChecker::Reload(const char* db_path) {
+    std::lock_guard<std::mutex> lock(reload_mutex_);
+    // 新数据库完整打开后才对读者可见
+    std::unique_ptr<IpChecker> replacement(new IpChecker());
+    if (!replacement->Open(db_path, options_)) {
+        return false;
+    }
+    IpChecker* current = current_.load(std::memory_order_relaxed);
+    if (current && !ValidateReplacement(*current, *replacement)) {
+        return false;
+    }
+    IpChecker* old = current_.exchange(replacement.release(), std::memory_order_seq_cst);
+    if (old) {
+        WaitForReaders();
+        delete old;
+    }
+    generation_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool ReloadableIpChecker::ValidateReplacement(const IpChecker& current,
+                                              const IpChecker& replacement) const {
+    IpChecker::DatabaseInfo current_info;
+    IpChecker::DatabaseInfo info;
+    if (!current.GetDatabaseInfo(&current_info) || !replacement.GetDatabaseInfo(&info)) {
+        return false;
+    }
+    if (info.node_count == 0) {
+        fprintf(stderr, "Refusing to reload: database has an empty search tree\n");
+        return false;
+    }
+    // 例如把Country库换成ASN库，之后的查询都会查不到
+    const char* current_type = current_info.database_type ? current_info.database_type : "";
+    const char* type = info.database_type ? info.database_type : "";
+    if (strcmp(current_type, type) != 0) {
+        fprintf(stderr, "Refusing to reload: database type changed from %s to %s\n",
+                current_type, type);
+        return false;
+    }
+    if (info.build_epoch < current_info.build_epoch) {
+        fprintf(stderr, "Reloading an older database (build epoch %llu < %llu)\n",
+                static_cast<unsigned long long>(info.build_epoch),
+                static_cast<unsigned long long>(current_info.build_epoch));
+    }
+    return true;
+}
+
+ReloadableIpChecker::Snapshot ReloadableIpChecker::Acquire() const {
+    static std::atomic<size_t> next_shard{0};
+    thread_local size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % kReaderShards;
+    uint32_t epoch = epoch_.load(std::memory_order_seq_cst) & 1;
+    std::atomic<int64_t>* counter = &shards_[shard].readers[epoch];
+    // 先登记再读指针：读到旧指针的读者，Reload()等待时一定能看到它的计数
+    counter->fetch_add(1, std::memory_order_seq_cst);
+    return Snapshot(counter, current_.load(std::memory_order_seq_cst));
+}
+
+void ReloadableIpChecker::WaitForReaders() {
+    // 读者读epoch与登记计数之间可能隔着一次切换，所以要切换两次，
+    // 两组计数器各等一次，才能确定读到旧指针的读者都已结束
+    for (int phase = 0; phase < 2; ++phase) {
+        uint32_t old_epoch = epoch_.fetch_add(1, std::memory_order_seq_cst) & 1;
+        for (auto& shard : shards_) {
+            while (shard.readers[old_epoch].load(std::memory_order_acquire) != 0) {
+                std::this_thread::yield();
+            }
+        }
+    }
+}
+
+bool ReloadableIpChecker::LookupCountry(std::string_view ip, char country[3]) const {
+    Snapshot snapshot = Acquire();
+    if (!snapshot) {
+        country[0] = '\0';
+        return false;
+    }
+    return snapshot->LookupCountry(ip, country);
+}
+
+void ReloadableIpChecker::LookupCountries(const std::string_view* ips, size_t count,
+                                          IpChecker::CountryResult* results) const {
+    Snapshot snapshot = Acquire();
+    if (!snapshot) {
+        for (size_t i = 0; i < count; ++i) {
+            results[i] = IpChecker::CountryResult();
+        }
+        return;
+    }
+    snapshot->LookupCountries(ips, count, results);
+}
+
+bool ReloadableIpChecker::Classify(std::string_view ip,
+                                   IpChecker::Classification* classification) const {
+    Snapshot snapshot = Acquire();
+    if (!snapshot) {
+        *classification = IpChecker::Classification();
+        return false;
+    }
+    return snapshot->Classify(ip, classification);
+}
+
+bool ReloadableIpChecker::IsChinaIp(std::string_view ip) const {
+    Snapshot snapshot = Acquire();
+    return snapshot && snapshot->IsChinaIp(ip);
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string_view>
+
+#include "ip_checker.h"
+
+// 可在查询进行中换数据库的IpChecker
+// Reload()在旁边完整打开新文件（映射、校验元数据、编译取值路径、建缓存和IPv4表）后，
+// 用一次原子交换发布；查询开始时取当前的IpChecker，整个查询都在同一个数据库上完成，
+// 不会看到加载了一半的数据库。旧的IpChecker连同它的映射、缓存和索引表，
+// 等所有在它上面开始的查询结束后才释放。
+//
+// 读者只做计数器加减和一次指针读取，不加锁、不等待（wait-free）；等待只发生在
+// Reload()里。计数器按线程分散到多个缓存行，两组交替使用（epoch），
+// 新来的读者进入另一组，Reload()不会被源源不断的查询饿死。
+class ReloadableIpChecker {
+public:
+    // 持有期间对应的数据库不会被释放；不要长期持有，否则Reload()会一直等待
+    class Snapshot {
+    public:
+        Snapshot(Snapshot&& other) noexcept : counter_(other.counter_), checker_(other.checker_) {
+            other.counter_ = nullptr;
+            other.checker_ = nullptr;
+        }
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+        Snapshot& operator=(Snapshot&&) = delete;
+        ~Snapshot() {
+            if (counter_) {
+                counter_->fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        // 未打开数据库时为nullptr
+        const IpChecker* get() const { return checker_; }
+        const IpChecker* operator->() const { return checker_; }
+        explicit operator bool() const { return checker_ != nullptr; }
+
+    private:
+        friend class ReloadableIpChecker;
+        Snapshot(std::atomic<int64_t>* counter, const IpChecker* checker)
+            : counter_(counter), checker_(checker) {}
+
+        std::atomic<int64_t>* counter_;
+        const IpChecker* checker_;
+    };
+
+    ReloadableIpChecker();
+    explicit ReloadableIpChecker(const IpChecker::Options& options);
+    // 不能与查询并发
+    ~ReloadableIpChecker();
+
+    ReloadableIpChecker(const ReloadableIpChecker&) = delete;
+    ReloadableIpChecker& operator=(const ReloadableIpChecker&) = delete;
+
+    // 打开db_path并替换当前数据库，返回时旧数据库已释放
+    // 新文件打不开、元数据不合法或数据库类型与当前不同时返回false并在stderr输出原因，
+    // 继续使用当前数据库。更新文件时应先写到临时文件再rename()过去
+    bool Reload(const char* db_path);
+
+    Snapshot Acquire() const;
+
+    // 以下查询各自取一次Snapshot，结果与IpChecker相同；未打开时返回false
+    bool LookupCountry(std::string_view ip, char country[3]) const;
+    void LookupCountries(const std::string_view* ips, size_t count,
+                         IpChecker::CountryResult* results) const;
+    bool Classify(std::string_view ip, IpChecker::Classification* classification) const;
+    bool IsChinaIp(std::string_view ip) const;
+
+    // 成功的Reload()次数
+    uint64_t generation() const { return generation_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t kReaderShards = 16;
+
+    // 每个分片两个计数器，对应两个epoch
+    struct alignas(64) ReaderShard {
+        std::atomic<int64_t> readers[2] = {};
+    };
+
+    // 等待所有在旧epoch上开始的读者结束
+    void WaitForReaders();
+    bool ValidateReplacement(const IpChecker& current, const IpChecker& replacement) const;
+
+    IpChecker::Options options_;
+    std::atomic<IpChecker*> current_{nullptr};
+    std::atomic<uint32_t> epoch_{0};
+    mutable ReaderShard shards_[kReaderShards];
+    std::mutex reload_mutex_;   // Reload()之间互斥
+    std::atomic<uint64_t> generation_{0};
+};